@@ -55,6 +55,26 @@
 
 #include "Forge/Mem/TF_Memory.h"
 #include "TF/Forge/Math/TF_FastHash.h"
+#include "Common_3/Utilities/Threading/ThreadSystem.h"
+
+#include "Splat/SplatArena.h"
+#include "Splat/SplatBvh.h"
+#include "Splat/SplatCache.h"
+#include "Splat/SplatCovariance.h"
+#include "Splat/SplatDepthSort.h"
+#include "Splat/SplatImage.h"
+#include "Splat/SplatJobs.h"
+#include "Splat/SplatLod.h"
+#include "Splat/SplatMorton.h"
+#include "Splat/SplatPly.h"
+#include "Splat/SplatPreprocess.h"
+#include "Splat/SplatProgressive.h"
+#include "Splat/SplatPrune.h"
+#include "Splat/SplatQuantize.h"
+#include "Splat/SplatRaster.h"
+#include "Splat/SplatScene.h"
+#include "Splat/SplatShEval.h"
+#include "Splat/SplatStreamer.h"
 
 ///// Demo structures
 //struct PlanetInfoStruct
@@ -74,6 +94,12 @@ struct UniformBlock
 {
     CameraMatrix mProjectView;
 };
+
+struct ShEvalBlock
+{
+    vec4     mEye;
+    uint32_t mParams[4]; // splat count, degree
+};
 uint64_t mNumOfPoints;
 
 //struct UniformBlockSky
@@ -87,40 +113,218 @@ const uint     gTimeOffset = 600000; // For visually better starting locations
 const float    gRotSelfScale = 0.0004f;
 const float    gRotOrbitYScale = 0.001f;
 const float    gRotOrbitZScale = 0.00001f;
+// Scene loaded by Init. requestSceneLoad replaces it at runtime: the next
+// scene loads on a worker and is uploaded into its own buffers in batches
+// that fit gSceneSwapUploadUsPerFrame, the current one draws until the
+// copies complete and is released once no frame in flight uses it.
+const char*    gScenePath = "treehill/point_cloud/iteration_7000/point_cloud.ply";
+const uint64_t gSceneSwapBatchSplats = 65536;
+const int64_t  gSceneSwapUploadUsPerFrame = 4000;
+// Write a splat cache after parsing a PLY and load from it on later launches.
+const bool     gSplatCacheEnabled = true;
+// Drop invalid, invisible and duplicate splats after parsing a PLY, with
+// the thresholds of splatPruneDescDefaults. The cache stores the pruned scene
+// and is rebuilt when a threshold changes. splat_prune does the same offline.
+const bool     gSplatPruneEnabled = true;
+// Reorder every stream by Morton code of the splat positions after loading, so
+// splats close in space are close in memory. The cache stores the sorted order.
+const bool     gSplatMortonOrderEnabled = true;
+// 63 bit codes instead of 30 bit, for scenes spanning more than 1024 cells per axis.
+const bool     gSplatMortonWideCodes = false;
+// Compressed copy built at load time, see SplatQuality. The load logs its
+// size and PSNR against the fp32 data to pick a level per deployment, and the
+// preprocess pass reads the SH above the dc band from it instead of floats.
+const uint32_t gSplatQuality = SPLAT_QUALITY_NONE;
+// Keep the decoded scene in system memory for the CPU reference rasterizer.
+const bool     gSplatKeepSystemCopy = true;
+// Store the activated 3D covariance of every splat at load, see
+// SplatCovarianceMode, so the reference rasterizer projects without
+// rebuilding it from scale and rotation. splat_project_bench
+// measures every mode.
+const uint32_t gSplatCovarianceMode = SPLAT_COVARIANCE_ON_THE_FLY;
+// Draw splats back to front with an order sorted on a worker one frame behind.
+const bool     gDepthSortEnabled = true;
+// Draw only the splats a BVH over the scene finds inside the view frustum.
+const bool     gFrustumCullEnabled = true;
+// Build a hierarchy of merged splats at load and draw a cut of it whose
+// error stays below gSplatLodMaxErrorPixels, meant for large captures seen
+// from afar. Replaces the BVH cull and the asynchronous depth sort, the cut
+// is frustum culled and sorted every frame.
+const bool     gSplatLodEnabled = false;
+const float    gSplatLodMaxErrorPixels = 1.0f;
+// Stream a chunk file written by splat_chunk convert instead of loading the
+// whole scene. Resident chunks stay within the budget and are mirrored in host
+// visible vertex buffers; the visible resident chunks are sorted every frame.
+// Replaces every other path above.
+const bool     gSplatStreamingEnabled = false;
+const char*    gSplatStreamingPath = "treehill/point_cloud/iteration_7000/point_cloud.splatchunks";
+const uint32_t gSplatStreamingBudgetMB = 512;
+// Store the splat cache coarse to fine and, once it is, load it in batches on
+// a worker while drawing the prefix that has arrived. Needs gSplatCacheEnabled,
+// the launch that writes the cache loads synchronously. The depth sort and the
+// BVH cull start once the scene is complete, the LOD and the compressed copy
+// are not built on the progressive path.
+const bool     gSplatProgressiveLoadEnabled = false;
+const uint64_t gSplatProgressiveBatchSplats = 65536;
+const int64_t  gSplatProgressiveUploadUsPerFrame = 4000;
+// View dependent color: the spherical harmonics are evaluated into the color
+// stream up to the degree picked in the UI, by a compute pass before the draw
+// or on the CPU, where clusters of splats keep their colors while the eye
+// moves less than gShEvalMaxAngle as seen from them. NONE keeps the position
+// colors. Streaming only mirrors positions and always uses NONE.
+enum ShEvalMode
+{
+    SH_EVAL_NONE,
+    SH_EVAL_GPU,
+    SH_EVAL_CPU,
+};
+const ShEvalMode gShEvalMode = SH_EVAL_GPU;
+const float      gShEvalMaxAngle = 0.25f * PI / 180.0f;
+// Cull, project and color the splats in a compute pass, sort the visible list
+// it appends back to front on the GPU and draw it as Gaussian quads blended
+// in that order, by an indirect draw whose instance count the pass writes.
+// Takes over from the depth sorter, the BVH cull and the SH evaluation above,
+// the degree slider still applies and NONE draws the dc colors. The LOD cut
+// and streaming keep the point draw. Switched in the UI: the two paths own
+// different buffers, pipelines and descriptor sets, so a switch resets the
+// app and Init builds the other one.
+bool             gSplatGpuPreprocessEnabled = true;
+// Every this many frames the records and the sorted visible list of the
+// preprocess pass are read back and compared bit for bit with the CPU twin
+// run on the same constants and splats, 0 never. A debug check: the twin
+// runs over the whole scene on the main thread.
+const uint32_t   gSplatPreprocessCheckInterval = 0;
+// Pipeline statistics around the splat and UI draws, with the overdraw of the
+// splat pass, shown in the UI on GPUs that support the queries.
+const bool       gPipelineStatsEnabled = true;
+// Transient per frame lists come from a frame arena. From this many frames
+// after a load or a reference render on, any splat heap call between the
+// start of Update and the end of Draw is reported and asserts.
+const uint32_t   gSteadyFrameWarmup = 4;
+// Workers of the job graph running the frustum cull, the CPU SH evaluation
+// and the reference render, 0 for one per core. The calling thread is one.
+const uint32_t   gSplatJobWorkers = 0;
+
+// Vertex buffers of a scene, see addSplatVertexBuffers. The preprocess pass
+// reads the packed splats and the SH, the point draw the positions and
+// colors, the buffers the other path reads are not created.
+enum SplatUploadBuffer
+{
+    SPLAT_UPLOAD_SPLATS,    // SplatGpuSplat, read by the pass every frame
+    SPLAT_UPLOAD_SHS,       // SplatGpuShRestEncoding words for the pass, SphericalHarmonics for the SH eval of the points
+    SPLAT_UPLOAD_POSITIONS,
+    SPLAT_UPLOAD_COLORS,
+    SPLAT_UPLOAD_SH_TABLE,  // chunk ranges or codebook of the compressed SH for the pass, written at creation
+    SPLAT_UPLOAD_NUM_BUFFERS
+};
+
+// Outputs of the preprocess pass for a scene, see addPreprocessBuffers.
+enum SplatPreprocessBuffer
+{
+    SPLAT_PREPROCESS_RECORDS,   // SplatPreprocessRecord per splat
+    SPLAT_PREPROCESS_VISIBLE,   // compacted splat indices, the quad instances once sorted
+    SPLAT_PREPROCESS_KEYS,      // depth key per visible entry, sorted along
+    SPLAT_PREPROCESS_DRAW_ARGS, // SplatPreprocessDrawArgs
+    SPLAT_PREPROCESS_SORT_ARGS, // SplatPreprocessDispatchArgs per sort step
+    SPLAT_PREPROCESS_NUM_BUFFERS
+};
 
-struct SphericalHarmonics {
-   Tf32x3_s dc;
-   union {
-       Tf32x3_s rest_32x3[15]; 
-       float rest[15 * 3]; 
-   };
+// Steps of a scene swap, see requestSceneLoad.
+enum SceneSwapState
+{
+    SCENE_SWAP_IDLE,
+    SCENE_SWAP_LOADING,   // decoded and built on a worker
+    SCENE_SWAP_UPLOADING, // copied to the next buffers a batch at a time
+    SCENE_SWAP_FLUSHING,  // waiting for the copies to complete on the GPU
 };
 
-const hash32_t pycPosition[] = { tfStrHash32(tfCToStrRef("x")), tfStrHash32(tfCToStrRef("y")), tfStrHash32(tfCToStrRef("z")) };
-const hash32_t pycNormal[] = { tfStrHash32(tfCToStrRef("nx")), tfStrHash32(tfCToStrRef("ny")), tfStrHash32(tfCToStrRef("nz")) };
-const hash32_t pycScale[] = { tfStrHash32(tfCToStrRef("scale_0")), tfStrHash32(tfCToStrRef("scale_1")), tfStrHash32(tfCToStrRef("scale_2")) };
-const hash32_t pycDc[] = { tfStrHash32(tfCToStrRef("f_dc_0")), tfStrHash32(tfCToStrRef("f_dc_1")), tfStrHash32(tfCToStrRef("f_dc_2")) };
-const hash32_t pycRotation[] = { tfStrHash32(tfCToStrRef("rot_0")), tfStrHash32(tfCToStrRef("rot_1")), tfStrHash32(tfCToStrRef("rot_2")),tfStrHash32(tfCToStrRef("rot_3"))  };
-const hash32_t pycFeatureReset[] = {
-    tfStrHash32(tfCToStrRef("f_rest_0")),  tfStrHash32(tfCToStrRef("f_rest_1")),  tfStrHash32(tfCToStrRef("f_rest_2")),
-    tfStrHash32(tfCToStrRef("f_rest_3")),  tfStrHash32(tfCToStrRef("f_rest_4")),  tfStrHash32(tfCToStrRef("f_rest_5")),
-    tfStrHash32(tfCToStrRef("f_rest_6")),  tfStrHash32(tfCToStrRef("f_rest_7")),  tfStrHash32(tfCToStrRef("f_rest_8")),
-    tfStrHash32(tfCToStrRef("f_rest_9")),  tfStrHash32(tfCToStrRef("f_rest_10")), tfStrHash32(tfCToStrRef("f_rest_11")),
-    tfStrHash32(tfCToStrRef("f_rest_12")), tfStrHash32(tfCToStrRef("f_rest_13")), tfStrHash32(tfCToStrRef("f_rest_14")),
-    tfStrHash32(tfCToStrRef("f_rest_15")), tfStrHash32(tfCToStrRef("f_rest_16")), tfStrHash32(tfCToStrRef("f_rest_17")),
-    tfStrHash32(tfCToStrRef("f_rest_18")), tfStrHash32(tfCToStrRef("f_rest_19")), tfStrHash32(tfCToStrRef("f_rest_20")),
-    tfStrHash32(tfCToStrRef("f_rest_21")), tfStrHash32(tfCToStrRef("f_rest_22")), tfStrHash32(tfCToStrRef("f_rest_23")),
-    tfStrHash32(tfCToStrRef("f_rest_24")), tfStrHash32(tfCToStrRef("f_rest_25")), tfStrHash32(tfCToStrRef("f_rest_26")),
-    tfStrHash32(tfCToStrRef("f_rest_27")), tfStrHash32(tfCToStrRef("f_rest_28")), tfStrHash32(tfCToStrRef("f_rest_29")),
-    tfStrHash32(tfCToStrRef("f_rest_30")), tfStrHash32(tfCToStrRef("f_rest_31")), tfStrHash32(tfCToStrRef("f_rest_32")),
-    tfStrHash32(tfCToStrRef("f_rest_33")), tfStrHash32(tfCToStrRef("f_rest_34")), tfStrHash32(tfCToStrRef("f_rest_35")),
-    tfStrHash32(tfCToStrRef("f_rest_36")), tfStrHash32(tfCToStrRef("f_rest_37")), tfStrHash32(tfCToStrRef("f_rest_38")),
-    tfStrHash32(tfCToStrRef("f_rest_39")), tfStrHash32(tfCToStrRef("f_rest_40")), tfStrHash32(tfCToStrRef("f_rest_41")),
-    tfStrHash32(tfCToStrRef("f_rest_42")), tfStrHash32(tfCToStrRef("f_rest_43")), tfStrHash32(tfCToStrRef("f_rest_44")),
+// GPU resources sized for one scene. The active scene's are the globals
+// below, the next and the retired scene keep theirs here.
+struct SceneBuffers
+{
+    Buffer* pVertexBuffers[SPLAT_UPLOAD_NUM_BUFFERS];
+    Buffer* pIndexBuffers[gDataBufferCount];
+    Buffer* pShColorBuffers[gDataBufferCount];
+    Buffer* pPreprocessBuffers[SPLAT_PREPROCESS_NUM_BUFFERS];
 };
-static const size_t gNumberOfFeatures = TF_ARRAY_COUNT(pycFeatureReset);
+
 
 RendererContext* pContext = NULL;
+ThreadSystem     gThreadSystem = NULL;
+SplatQuantized   gSplatQuantized = {};
+SplatStreams     gSceneStreams = {};
+SplatCovariances gSceneCovariances = {};
+SplatRasterizer  gReferenceRasterizer = {};
+bool             gReferenceRenderRequested = false;
+SplatDepthSorter gDepthSorter;
+bool             gDepthSorterActive = false;
+SplatBvh         gSceneBvh = {};
+bool             gFrustumCullActive = false;
+uint32_t*        pVisibleSplats = NULL;
+uint8_t*         pVisibleMask = NULL;
+uint64_t         gNumVisibleSplats = 0;
+int64_t          gFrustumCullUs = 0;
+SplatLod         gSceneLod = {};
+bool             gLodActive = false;
+uint32_t*        pLodCut = NULL; // frame arena
+uint64_t         gLodCutSize = 0;
+SplatLodCutStats gLodCutStats = {};
+SplatSortScratch gLodSortScratch = {};
+SplatStreamer    gStreamer = {};
+bool             gStreamingActive = false;
+uint32_t*        pStreamIndices = NULL; // frame arena
+uint64_t         gStreamIndexCount = 0;
+SplatSortScratch gStreamSortScratch = {};
+SplatProgressiveLoader gProgressiveLoader;
+bool             gProgressiveLoadActive = false;
+uint64_t         gProgressiveUploaded = 0; // batches submitted to the GPU
+uint64_t         gProgressiveDrawable = 0; // batches known to have landed
+SyncToken        gProgressiveToken = {}; // completes once the splats up to gProgressiveUploaded have landed
+SplatSceneLoader gSceneLoader;
+SceneSwapState   gSceneSwapState = SCENE_SWAP_IDLE;
+SplatScene       gNextScene = {};
+SceneBuffers     gNextSceneBuffers = {};
+uint64_t         gNextSceneUploaded = 0;   // splats and merged nodes submitted to the GPU
+int64_t          gSceneSwapStartUs = 0;
+SplatScene       gRetiredScene = {};
+SceneBuffers     gRetiredSceneBuffers = {};
+uint32_t         gRetiredSceneFrames = 0;  // frames until the retired scene is released
+uint32_t         gSceneSet = 0;            // set of the active scene buffers in the per scene descriptor sets
+char             gSceneRequestPath[FS_MAX_PATH] = {};
+bool             gSceneLoadRequested = false;
+int64_t          gInitStartUs = 0;
+int64_t          gTimeToFirstFrameUs = 0;
+int64_t          gTimeToFullQualityUs = 0;
+uint32_t         gShDegree = SPLAT_SH_MAX_DEGREE;
+bool             gShEvalGpu = false;    // the compute pass resources exist
+bool             gShEvalActive = false; // the scene is complete, colors follow the eye
+SplatShCache     gShCache = {};
+SplatShCache     gShMergedCache = {};   // LOD merged nodes, they follow the splats
+bool             gPreprocessActive = false;
+SplatPreprocessBlock gPreprocessData = {};
+SplatPreprocessBlock gPreprocessCheckBlock = {}; // constants of the frame read back
+uint32_t         gPreprocessCheckSlot = UINT32_MAX; // frame index whose read back is in flight
+uint32_t         gPreprocessCheckSceneSet = 0;
+uint64_t         gPreprocessCheckFrames = 0;
+Tf32x3_s*        pShColors = NULL;
+uint64_t         gShColorStamps[gDataBufferCount][2] = {};
+vec3             gShEvalEye = vec3(0.0f);
+vec3             gShDispatchedEye = vec3(0.0f);
+uint32_t         gShDispatchedDegree = UINT32_MAX;
+SplatFrameArena  gFrameArena = {};
+uint64_t         gFrameHeapCallsStart = 0;
+uint64_t         gFrameHeapCalls = 0; // last frame
+bool             gFrameMayAllocate = false;
+uint32_t         gSteadyFrames = 0;
+SplatJobSystem   gJobSystem = {};
+SplatJobGraph    gFrameGraph = {};
+SplatJobStats    gFrameGraphStats = {};
+SplatBvhCullJob  gCullJob = {};
+SplatShCachedJob gShJob = {};
+SplatShCachedJob gShMergedJob = {};
+const char*      gFrameStageTokenNames[SPLAT_JOB_MAX_STAGES] = {}; // profiler scopes by stage name
+ProfileToken     gFrameStageTokens[SPLAT_JOB_MAX_STAGES] = {};
+uint32_t         gNumFrameStageTokens = 0;
 Renderer*        pRenderer = NULL;
 
 Queue*     pGraphicsQueue = NULL;
@@ -132,18 +336,49 @@ Semaphore*    pImageAcquiredSemaphore = NULL;
 
 Shader* pParticleShader = NULL;
 Pipeline* pParticlePipeline = NULL;
+Shader* pShEvalShader = NULL;
+Pipeline* pShEvalPipeline = NULL;
+RootSignature* pShEvalRootSignature = NULL;
+Shader* pPreprocessShader = NULL;
+Pipeline* pPreprocessPipeline = NULL;
+RootSignature* pPreprocessRootSignature = NULL;
+Shader* pSortShader = NULL;
+Pipeline* pSortPipeline = NULL;
+RootSignature* pSortRootSignature = NULL;
+uint32_t gSortStepIndex = 0; // root constant of the sort step
+Shader* pSortArgsShader = NULL;
+Pipeline* pSortArgsPipeline = NULL;
+Shader* pSplatQuadShader = NULL;
+Pipeline* pSplatQuadPipeline = NULL;
+RootSignature* pSplatQuadRootSignature = NULL;
 
 RootSignature* pRootSignature = NULL;
-Buffer* pPositionBuffer = NULL;
+Buffer* pSplatBuffer = NULL;
 Buffer* pShsBuffer = NULL;
+Buffer* pPositionBuffer = NULL;
 Buffer* pColorBuffer = NULL;
-Buffer* pNormalBuffer = NULL;
-Buffer* pScaleBuffer = NULL;
-Buffer* pRotationBuffer = NULL;
+Buffer* pShTableBuffer = NULL;
+Buffer* pPreprocessBuffers[SPLAT_PREPROCESS_NUM_BUFFERS] = {};
+Buffer* pDrawArgsResetBuffer = NULL; // the draw arguments before the pass appends
+Buffer* pPreprocessReadback[SPLAT_PREPROCESS_NUM_BUFFERS] = {}; // pass outputs copied for the twin check
+uint64_t gPreprocessReadbackCapacity = 0;
 
 Buffer* pProjViewUniformBuffer[gDataBufferCount] = { NULL };
+Buffer* pShEvalUniformBuffer[gDataBufferCount] = { NULL };
+Buffer* pPreprocessUniformBuffer[gDataBufferCount] = { NULL };
+Buffer* pShColorBuffer[gDataBufferCount] = { NULL }; // CPU evaluated colors
+Buffer* pSplatIndexBuffer[gDataBufferCount] = { NULL };
+uint64_t gSortedIndexVersion[gDataBufferCount] = {};
+uint64_t gIndexedDrawCount[gDataBufferCount] = {}; // 0 draws every splat unindexed
 
 DescriptorSet* pDescriptorSetUniforms = { NULL };
+DescriptorSet* pDescriptorSetShEval = NULL;
+DescriptorSet* pDescriptorSetShEvalUniforms = NULL;
+DescriptorSet* pDescriptorSetPreprocess = NULL;
+DescriptorSet* pDescriptorSetPreprocessUniforms = NULL;
+DescriptorSet* pDescriptorSetSort = NULL;
+DescriptorSet* pDescriptorSetSplatQuad = NULL;
+DescriptorSet* pDescriptorSetSplatQuadUniforms = NULL;
 
 uint32_t     gFrameIndex = 0;
 ProfileToken gGpuProfileToken = PROFILE_INVALID_TOKEN;
@@ -164,6 +399,24 @@ Tsimd_f32x4_t* pPointColor;
 
 static unsigned char gPipelineStatsCharArray[2048] = {};
 static bstring       gPipelineStats = bfromarr(gPipelineStatsCharArray);
+static unsigned char gDepthSortStatsCharArray[512] = {};
+static bstring       gDepthSortStats = bfromarr(gDepthSortStatsCharArray);
+static unsigned char gCullStatsCharArray[256] = {};
+static bstring       gCullStats = bfromarr(gCullStatsCharArray);
+static unsigned char gLodStatsCharArray[256] = {};
+static bstring       gLodStats = bfromarr(gLodStatsCharArray);
+static unsigned char gStreamStatsCharArray[512] = {};
+static bstring       gStreamStats = bfromarr(gStreamStatsCharArray);
+static unsigned char gLoadStatsCharArray[256] = {};
+static bstring       gLoadStats = bfromarr(gLoadStatsCharArray);
+static unsigned char gShEvalStatsCharArray[256] = {};
+static bstring       gShEvalStats = bfromarr(gShEvalStatsCharArray);
+static unsigned char gFrameMemoryStatsCharArray[256] = {};
+static bstring       gFrameMemoryStats = bfromarr(gFrameMemoryStatsCharArray);
+static unsigned char gFrameJobStatsCharArray[512] = {};
+static bstring       gFrameJobStats = bfromarr(gFrameJobStatsCharArray);
+static unsigned char gSceneStatsCharArray[512] = {};
+static bstring       gSceneStats = bfromarr(gSceneStatsCharArray);
 
 void reloadRequest(void*)
 {
@@ -171,66 +424,119 @@ void reloadRequest(void*)
     requestReload(&reload);
 }
 
+void referenceRenderRequest(void*)
+{
+    gReferenceRenderRequested = true;
+}
+
+void sceneLoadRequest(void*)
+{
+    gSceneLoadRequested = true;
+}
 
-struct TPlyArgs4x4_s {
-    TStrSpan mCol0[4];
-    TStrSpan mCol1[4];
-    TStrSpan mCol2[4];
-    TStrSpan mCol3[4];
-};
-static inline bool plyUtilReadf32x3(FileStream* stream, struct TPlyReader* reader, size_t cursor, struct TPlyElement* element,
-                                 hash32_t args[3], struct Tf32x3_s* value); 
-//static inline bool plyUtilReadf32x4x4(FileStream* stream, struct TPlyReader* reader, size_t cursor, struct TPlyElement* element,
-//                                struct TPlyArgs4x4_s args, struct Tf32x4x4_s* value);
-static inline bool plyUtilReadf32x4(FileStream* stream, struct TPlyReader* reader, size_t cursor, struct TPlyElement* element,
-                                 hash32_t args[4], struct Tf32x4_s* value);
-
-//static inline bool plyUtilReadf32x4x4(FileStream* stream, struct TPlyReader* reader, size_t cursor, struct TPlyElement* element,
-//                                struct TPlyArgs4x4_s args, struct Tf32x4x4_s* value) {
-//    struct TPlyAttribResult findAttrib;
-//    struct TPlyNumber       number;
-//    for (size_t i = 0; i < 3; i++) {
-//        if (!plyUtilReadf32x4(stream, reader, cursor, element, args.mCol0, &value->mCol0))
-//            return false;
-//        if (!plyUtilReadf32x4(stream, reader, cursor, element, args.mCol0, &value->mCol1))
-//            return false;
-//        if (!plyUtilReadf32x4(stream, reader, cursor, element, args.mCol0, &value->mCol2))
-//            return false;
-//        if (!plyUtilReadf32x4(stream, reader, cursor, element, args.mCol0, &value->mCol3))
-//            return false;
-//    }
-//
-//    return true;
-//}
-
-
-static inline bool plyUtilReadf32x4(FileStream* stream, struct TPlyReader* reader, size_t cursor, struct TPlyElement* element,
-                                 hash32_t args[4], struct Tf32x4_s* value) {
-    struct TPlyAttribResult findAttrib;
-    struct TPlyNumber       number;
-    for (size_t i = 0; i < 4; i++) {
-        if (!tfPlyFindAttribRef(stream, reader, cursor, element, args[i], &findAttrib))
-            return false;
-        if (!tfPlyDecodeNumber(stream, findAttrib.mCursor, reader->mFormat, findAttrib.mType, &number))
-            return false;
-        value->v[i] = number.flt;
+void preprocessSwitchRequest(void*)
+{
+    ResetDesc reset{ RESET_TYPE_API_SWITCH };
+    requestReset(&reset);
+}
+
+// Profiler scope of a frame graph stage, resolved on its first run. Stage
+// names are literals of the splat library, the pointer identifies them.
+ProfileToken frameStageProfileToken(const char* name)
+{
+    for (uint32_t i = 0; i < gNumFrameStageTokens; i++)
+    {
+        if (gFrameStageTokenNames[i] == name)
+            return gFrameStageTokens[i];
     }
+    if (gNumFrameStageTokens == SPLAT_JOB_MAX_STAGES)
+        return SPLAT_JOB_NO_PROFILE;
+    gFrameStageTokenNames[gNumFrameStageTokens] = name;
+    gFrameStageTokens[gNumFrameStageTokens] = getCpuProfileToken("Splat Frame", name, 0xff00ff00);
+    return gFrameStageTokens[gNumFrameStageTokens++];
+}
 
-    return true;
+
+// The union member of a decoded number follows the property type, integers are converted like the generic
+// decoder of SplatPly does.
+static inline float plyNumberToFloat(uint32_t type, const struct TPlyNumber* number) {
+    switch (type) {
+    case PLY_TYPE_CHAR: return (float)number->i8;
+    case PLY_TYPE_UCHAR: return (float)number->u8;
+    case PLY_TYPE_SHORT: return (float)number->i16;
+    case PLY_TYPE_USHORT: return (float)number->u16;
+    case PLY_TYPE_INT: return (float)number->i32;
+    case PLY_TYPE_UINT: return (float)number->u32;
+    case PLY_TYPE_FLOAT: return number->flt;
+    case PLY_TYPE_DOUBLE: return (float)number->dbl;
+    default:
+        return 0.0f;
+    }
 }
 
+// Slow path for files splatPlyReadLayout rejects, decodes one vertex at a time through TF_ply with the
+// property bindings of the default schema.
+static void plyDecodeSplats(FileStream* fh, struct TPlyReader* reader, struct TPlyElement* element, size_t cursor,
+                            const struct SplatStreams* streams) {
+    const struct SplatPlySchema* schema = splatPlyDefaultSchema();
+    struct TPlyAttribResult      findAttrib;
+    struct TPlyNumber            number;
+
+    // the length of the SH rest run is taken from the first vertex
+    uint32_t numRest = 0;
+    for (uint32_t entryIdx = 0; entryIdx < schema->mNumEntries; entryIdx++) {
+        const struct SplatPlySchemaEntry* entry = &schema->pEntries[entryIdx];
+        if (entry->mStream != SPLAT_PLY_STREAM_SH_REST || !entry->mNumbered)
+            continue;
+        char name[32];
+        for (; numRest < SPLAT_PLY_MAX_REST; numRest++) {
+            snprintf(name, sizeof(name), "%s%u", entry->mName, numRest);
+            if (!tfPlyFindAttribRef(fh, reader, cursor, element, tfStrHash32(tfCToStrRef(name)), &findAttrib))
+                break;
+        }
+        break;
+    }
+    struct SplatPlyBinding bindings[SPLAT_PLY_MAX_BINDINGS];
+    hash32_t               bindingHashes[SPLAT_PLY_MAX_BINDINGS];
+    const uint32_t         numBindings = splatPlySchemaBindings(schema, numRest, bindings, SPLAT_PLY_MAX_BINDINGS);
+    for (uint32_t i = 0; i < numBindings; i++)
+        bindingHashes[i] = tfStrHash32(tfCToStrRef(bindings[i].mName));
+
+    for (size_t eleIdx = 0; eleIdx < element->mNumElements; eleIdx++, cursor += tfPlyNextElement(fh, reader, cursor, element)) {
+        // coefficients of the bands the file does not have stay zero
+        if (streams->pShs)
+            memset(streams->pShs[eleIdx].rest, 0, sizeof(streams->pShs[eleIdx].rest));
+        for (uint32_t i = 0; i < numBindings; i++) {
+            float value = 0.0f;
+            if (tfPlyFindAttribRef(fh, reader, cursor, element, bindingHashes[i], &findAttrib) &&
+                tfPlyDecodeNumber(fh, findAttrib.mCursor, reader->mFormat, findAttrib.mType, &number))
+                value = plyNumberToFloat(findAttrib.mType, &number);
+            splatPlyStoreBinding(streams, eleIdx, &bindings[i], value);
+        }
+    }
+}
 
-static inline bool plyUtilReadf32x3(FileStream* stream, struct TPlyReader* reader, size_t cursor, struct TPlyElement* element,
-                                 hash32_t args[3], struct Tf32x3_s* value) {
-    struct TPlyAttribResult findAttrib;
-    struct TPlyNumber       number;
-    for (size_t i = 0; i < 3; i++) {
-        if (!tfPlyFindAttribRef(stream, reader, cursor, element, args[i], &findAttrib))
-            return false;
-        if (!tfPlyDecodeNumber(stream, findAttrib.mCursor, reader->mFormat, findAttrib.mType, &number))
-            return false;
-        value->v[i] = number.flt;
+// SplatSceneDecodeFunc of the scene loads, the TF_ply reader for the layouts the chunked loader does not take.
+static bool plyDecodeSceneFallback(FileStream* fh, struct SplatStreams* outStreams, uint64_t* outNumSplats)
+{
+    struct TPlyReader   reader = {};
+    size_t              cursor = 0;
+    struct TPlyElement* element = NULL;
+    if (!tfAddPlyFileReader(fh, &reader))
+    {
+        LOGF(eERROR, "Failed to load ply.");
+        return false;
+    }
+    if (!tfPlySeekElementStream(fh, &reader, tfCToStrRef("vertex"), &element, &cursor))
+    {
+        LOGF(eERROR, "Failed to find vertex stream.");
+        tfFreePlyFileReader(&reader);
+        return false;
     }
+    *outNumSplats = element->mNumElements;
+    splatAllocStreams(outStreams, *outNumSplats);
+    plyDecodeSplats(fh, &reader, element, cursor, outStreams);
+    tfFreePlyFileReader(&reader);
     return true;
 }
 
@@ -239,6 +545,8 @@ class Transformations: public IApp
 public:
     bool Init()
     {
+        gInitStartUs = getUSec(false);
+
         // FILE PATHS
         fsSetPathForResourceDir(pSystemFileIO, RM_CONTENT, RD_SHADER_BINARIES, "CompiledShaders");
         fsSetPathForResourceDir(pSystemFileIO, RM_CONTENT, RD_TEXTURES, "Textures");
@@ -264,7 +572,7 @@ public:
         settings.pContext = pContext;
         settings.pSelectedDevice = selection.mDeviceAdapter;
         settings.mProperties = selection.mGpuProperty;
-        settings.mProperties.mPipelineStatsQueries = false;
+        settings.mProperties.mPipelineStatsQueries = settings.mProperties.mPipelineStatsQueries && gPipelineStatsEnabled;
         initRenderer(GetName(), &settings, &pRenderer);
 
         tfFreeGPUConfiguration(&def);
@@ -299,194 +607,22 @@ public:
 
         initResourceLoaderInterface(pRenderer);
 
-        {
-            FileStream fh = {};
-          
-            //element vertex 1734607
-            //property float x
-            //property float y
-            //property float z
-            //property float nx
-            //property float ny
-            //property float nz
-            //property float f_dc_0
-            //property float f_dc_1
-            //property float f_dc_2
-            //property float f_rest_0
-            //property float f_rest_1
-            //property float f_rest_2
-            //property float f_rest_3
-            //property float f_rest_4
-            //property float f_rest_5
-            //property float f_rest_6
-            //property float f_rest_7
-            //property float f_rest_8
-            //property float f_rest_9
-            //property float f_rest_10
-            //property float f_rest_11
-            //property float f_rest_12
-            //property float f_rest_13
-            //property float f_rest_14
-            //property float f_rest_15
-            //property float f_rest_16
-            //property float f_rest_17
-            //property float f_rest_18
-            //property float f_rest_19
-            //property float f_rest_20
-            //property float f_rest_21
-            //property float f_rest_22
-            //property float f_rest_23
-            //property float f_rest_24
-            //property float f_rest_25
-            //property float f_rest_26
-            //property float f_rest_27
-            //property float f_rest_28
-            //property float f_rest_29
-            //property float f_rest_30
-            //property float f_rest_31
-            //property float f_rest_32
-            //property float f_rest_33
-            //property float f_rest_34
-            //property float f_rest_35
-            //property float f_rest_36
-            //property float f_rest_37
-            //property float f_rest_38
-            //property float f_rest_39
-            //property float f_rest_40
-            //property float f_rest_41
-            //property float f_rest_42
-            //property float f_rest_43
-            //property float f_rest_44
-            //property float opacity
-            //property float scale_0
-            //property float scale_1
-            //property float scale_2
-            //property float rot_0
-            //property float rot_1
-            //property float rot_2
-            //property float rot_3
-
-            if (!fsOpenStreamFromPath(RD_OTHER_FILES, "treehill/point_cloud/iteration_7000/point_cloud.ply", FM_READ, &fh)) 
-                return false;
-            struct TPlyReader reader = {};
-            if(!tfAddPlyFileReader(&fh, &reader)) {
-                LOGF(eERROR, "Failed to load ply.");
-                return false;
-            }
+        ThreadSystemInitDesc threadSystemDesc = {};
+        threadSystemDesc.mThreadCount = getNumCPUCores() > 1 ? getNumCPUCores() - 1 : 1;
+        initThreadSystem(&threadSystemDesc, &gThreadSystem);
+        splatJobSystemInit(&gJobSystem, gThreadSystem, gSplatJobWorkers ? gSplatJobWorkers : threadSystemDesc.mThreadCount + 1);
+        splatRasterizerInit(&gReferenceRasterizer);
 
-            size_t cursor = 0;
-            struct TPlyElement* element;
-            if(!tfPlySeekElementStream(&fh, &reader, tfCToStrRef("vertex"), &element, &cursor)) {
-                LOGF(eERROR, "Failed to find vertex stream.");
+        // the LOD cut and the streamed chunks keep the point draw
+        gPreprocessActive = gSplatGpuPreprocessEnabled && !gSplatLodEnabled && !gSplatStreamingEnabled;
+        {
+            strncpy(gSceneRequestPath, gScenePath, sizeof(gSceneRequestPath) - 1);
+            const bool loaded = gSplatStreamingEnabled ? loadSplatStreamer(gSplatStreamingPath)
+                                                       : (gSplatProgressiveLoadEnabled && startProgressiveLoad(gScenePath)) ||
+                                                            loadSplatScene(gScenePath);
+            if (!loaded)
                 return false;
-            }
-
-            {
-                BufferLoadDesc positionVbDesc = {};
-                positionVbDesc.mDesc.mDescriptors = DESCRIPTOR_TYPE_VERTEX_BUFFER;
-                positionVbDesc.mDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_GPU_ONLY;
-                positionVbDesc.mDesc.mSize = sizeof(struct Tf32x3_s) * element->mNumElements;
-                positionVbDesc.ppBuffer = &pPositionBuffer;
-                addResource(&positionVbDesc, NULL);
-            }
-            {
-                BufferLoadDesc positionShDesc = {};
-                positionShDesc.mDesc.mDescriptors = DESCRIPTOR_TYPE_VERTEX_BUFFER;
-                positionShDesc.mDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_GPU_ONLY;
-                positionShDesc.mDesc.mSize = sizeof(struct SphericalHarmonics)* element->mNumElements;
-                positionShDesc.ppBuffer = &pShsBuffer;
-                addResource(&positionShDesc, NULL);
-            }
-            {
-                BufferLoadDesc colorVbDesc = {};
-                colorVbDesc.mDesc.mDescriptors = DESCRIPTOR_TYPE_VERTEX_BUFFER;
-                colorVbDesc.mDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_GPU_ONLY;
-                colorVbDesc.mDesc.mSize = sizeof(struct Tf32x3_s) * element->mNumElements;
-                colorVbDesc.ppBuffer = &pColorBuffer;
-                addResource(&colorVbDesc, NULL);
-            }
-            {
-                BufferLoadDesc bufferDesc = {};
-                bufferDesc.mDesc.mDescriptors = DESCRIPTOR_TYPE_VERTEX_BUFFER;
-                bufferDesc.mDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_GPU_ONLY;
-                bufferDesc.mDesc.mSize = sizeof(struct Tf32x3_s) * element->mNumElements;
-                bufferDesc.ppBuffer = &pNormalBuffer;
-                addResource(&bufferDesc, NULL);
-            }
-            {
-                BufferLoadDesc bufferDesc = {};
-                bufferDesc.mDesc.mDescriptors = DESCRIPTOR_TYPE_VERTEX_BUFFER;
-                bufferDesc.mDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_GPU_ONLY;
-                bufferDesc.mDesc.mSize = sizeof(struct Tf32x3_s) * element->mNumElements;
-                bufferDesc.ppBuffer = &pScaleBuffer;
-                addResource(&bufferDesc, NULL);
-            }
-            {
-                BufferLoadDesc bufferDesc = {};
-                bufferDesc.mDesc.mDescriptors = DESCRIPTOR_TYPE_VERTEX_BUFFER;
-                bufferDesc.mDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_GPU_ONLY;
-                bufferDesc.mDesc.mSize = sizeof(struct Tf32x4_s) * element->mNumElements;
-                bufferDesc.ppBuffer = &pRotationBuffer;
-                addResource(&bufferDesc, NULL);
-            }
-
-            BufferUpdateDesc positionUpdateDesc = { pPositionBuffer };
-            BufferUpdateDesc colorUpdateDesc = { pColorBuffer };
-            BufferUpdateDesc shsUpdateDesc = { pShsBuffer };
-            BufferUpdateDesc normalUpdateDesc = { pNormalBuffer };
-            BufferUpdateDesc scaleUpdateDesc = { pScaleBuffer };
-            BufferUpdateDesc rotationUpdateDesc = { pRotationBuffer};
-            beginUpdateResource(&positionUpdateDesc);
-            beginUpdateResource(&colorUpdateDesc);
-            beginUpdateResource(&shsUpdateDesc);
-            beginUpdateResource(&normalUpdateDesc);
-            beginUpdateResource(&scaleUpdateDesc);
-            beginUpdateResource(&rotationUpdateDesc);
-            struct TPlyAttribResult findAttrib;
-            mNumOfPoints = element->mNumElements;
-        
-            for (size_t eleIdx = 0; eleIdx < element->mNumElements; eleIdx++, cursor += tfPlyNextElement(&fh, &reader, cursor, element)) {
-                {
-                    struct TPlyNumber pos[3];
-                    tfPlyDecodeNumbersByRefs(&fh, &reader, element, cursor, TF_ARRAY_COUNT(pycPosition), pycPosition, pos);
-                    ((Tf32x3_s*)positionUpdateDesc.pMappedData)[eleIdx] = {pos[0].flt, pos[1].flt, pos[2].flt};
-                    ((Tf32x3_s*)colorUpdateDesc.pMappedData)[eleIdx] = {pos[0].flt, pos[1].flt, pos[2].flt};
-                }
-                {
-                    struct TPlyNumber normal[3];
-                    tfPlyDecodeNumbersByRefs(&fh, &reader, element, cursor, TF_ARRAY_COUNT(pycNormal), pycNormal, normal);
-                    ((struct Tf32x3_s*)normalUpdateDesc.pMappedData)[eleIdx] = {normal[0].flt, normal[1].flt, normal[2].flt};
-                }
-                {
-                    struct TPlyNumber scale[3];
-                    tfPlyDecodeNumbersByRefs(&fh, &reader, element, cursor, TF_ARRAY_COUNT(pycScale), pycScale, scale);
-                    ((struct Tf32x3_s*)scaleUpdateDesc.pMappedData)[eleIdx] = { scale[0].flt, scale[1].flt, scale[2].flt };
-                }
-                {
-                    struct TPlyNumber rotations[4];
-                    tfPlyDecodeNumbersByRefs(&fh, &reader, element, cursor, TF_ARRAY_COUNT(pycRotation), pycRotation, rotations);
-                    ((struct Tf32x4_s*)rotationUpdateDesc.pMappedData)[eleIdx] = { rotations[0].flt, rotations[1].flt, rotations[2].flt, rotations[3].flt };
-                }
-                {
-                    struct SphericalHarmonics* harmoics = &((struct SphericalHarmonics*)shsUpdateDesc.pMappedData)[eleIdx];
-                    struct TPlyNumber rc[TF_ARRAY_COUNT(pycDc)];
-                    struct TPlyNumber featureReset[TF_ARRAY_COUNT(pycFeatureReset)];
-                    tfPlyDecodeNumbersByRefs(&fh, &reader, element, cursor, gNumberOfFeatures, pycFeatureReset, featureReset);
-                    for (size_t fIdx = 0; fIdx < TF_ARRAY_COUNT(pycFeatureReset); fIdx++) {
-                        harmoics->rest[fIdx] = featureReset[fIdx].flt;
-                    }
-                    tfPlyDecodeNumbersByRefs(&fh, &reader, element, cursor, TF_ARRAY_COUNT(pycDc), pycDc, rc);
-                    harmoics->dc = { rc[0].flt, rc[1].flt, rc[2].flt };
-                }
-            }
-            endUpdateResource(&colorUpdateDesc);
-            endUpdateResource(&positionUpdateDesc);
-            endUpdateResource(&shsUpdateDesc);
-            endUpdateResource(&normalUpdateDesc);
-            endUpdateResource(&scaleUpdateDesc);
-            endUpdateResource(&rotationUpdateDesc);
-
-            tfFreePlyFileReader(&reader);
+            bformat(&gSceneStats, "Scene: %s, %llu splats\n", gScenePath, (unsigned long long)mNumOfPoints);
            // gGaussianPoints = (struct GaussianPoint*)tf_malloc(sizeof(GaussianPoint) * mNumOfPoints);
            // pPointPos = (Tsimd_f32x4_t*)tf_malloc(sizeof(Tsimd_f32x4_t) * mNumOfPoints);
            // for(size_t pIdx = 0; pIdx < mNumOfPoints; pIdx++) {
@@ -580,6 +716,62 @@ public:
             addResource(&ubDesc, NULL);
         }
 
+        // the streamed vertex buffers carry no spherical harmonics, the preprocess pass evaluates them itself
+        gShEvalGpu = gShEvalMode == SH_EVAL_GPU && !gStreamingActive && !gPreprocessActive;
+        if (gShEvalGpu)
+        {
+            ubDesc.mDesc.pName = "ShEvalUniformBuffer";
+            ubDesc.mDesc.mSize = sizeof(ShEvalBlock);
+            for (uint32_t i = 0; i < gDataBufferCount; ++i)
+            {
+                ubDesc.ppBuffer = &pShEvalUniformBuffer[i];
+                addResource(&ubDesc, NULL);
+            }
+        }
+        if (gPreprocessActive)
+        {
+            ubDesc.mDesc.pName = "PreprocessUniformBuffer";
+            ubDesc.mDesc.mSize = sizeof(SplatPreprocessBlock);
+            for (uint32_t i = 0; i < gDataBufferCount; ++i)
+            {
+                ubDesc.ppBuffer = &pPreprocessUniformBuffer[i];
+                addResource(&ubDesc, NULL);
+            }
+
+            // copied over the draw arguments before every dispatch, the pass counts the instances from 0
+            static const SplatPreprocessDrawArgs resetArgs = { 4, 0, 0, 0 };
+            BufferLoadDesc resetDesc = {};
+            resetDesc.mDesc.pName = "DrawArgsResetBuffer";
+            resetDesc.mDesc.mDescriptors = DESCRIPTOR_TYPE_UNDEFINED;
+            resetDesc.mDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_GPU_ONLY;
+            resetDesc.mDesc.mStartState = RESOURCE_STATE_COPY_SOURCE;
+            resetDesc.mDesc.mSize = sizeof(resetArgs);
+            resetDesc.pData = &resetArgs;
+            resetDesc.ppBuffer = &pDrawArgsResetBuffer;
+            addResource(&resetDesc, NULL);
+            addPreprocessBuffers(mNumOfPoints, pPreprocessBuffers);
+        }
+
+        // the LOD cut is culled and sorted on its own
+        gLodActive = gSplatLodEnabled && gSceneLod.mNumSplats > 0;
+        const uint64_t numNodes = mNumOfPoints + (gLodActive ? gSceneLod.mNumMerged : 0);
+        // a progressive load starts the depth sort and the cull once the scene is complete
+        const bool sortPending = gProgressiveLoadActive && gDepthSortEnabled && !gPreprocessActive;
+        const bool cullPending = gProgressiveLoadActive && gFrustumCullEnabled;
+        if (!gProgressiveLoadActive)
+            initSceneAcceleration();
+
+        // the LOD cut or the streamed indices, plus their sort keys, are rebuilt every frame
+        uint64_t frameBytes = 0;
+        if (gLodActive)
+            frameBytes = numNodes * (sizeof(uint32_t) + sizeof(uint64_t));
+        else if (gStreamingActive)
+            frameBytes = mNumOfPoints * (sizeof(uint32_t) + sizeof(uint64_t));
+        splatFrameArenaInit(&gFrameArena, gDataBufferCount, frameBytes + 256);
+        addSceneFrameBuffers(numNodes, gShEvalMode == SH_EVAL_CPU && !gStreamingActive && !gPreprocessActive,
+                             gDepthSorterActive || gFrustumCullActive || gLodActive || gStreamingActive || sortPending || cullPending,
+                             pShColorBuffer, pSplatIndexBuffer);
+
         // Load fonts
         FontDesc font = {};
         font.pFontPath = "TitilliumText/TitilliumText-Bold.otf";
@@ -602,6 +794,11 @@ public:
         profiler.mHeightUI = mSettings.mHeight;
         initProfiler(&profiler);
 
+        for (uint32_t stage = 0; stage < SPLAT_RASTER_NUM_STAGES; stage++)
+            gReferenceRasterizer.mProfileTokens[stage] =
+                getCpuProfileToken("Reference Render", splatRasterStageName((SplatRasterStage)stage), 0xff00ffff);
+        gNumFrameStageTokens = 0;
+
         // Gpu profiler can only be added after initProfile.
         gGpuProfileToken = addGpuProfiler(pRenderer, pGraphicsQueue, "Graphics");
 
@@ -621,6 +818,116 @@ public:
             uiCreateComponentWidget(pGuiWindow, "Pipeline Stats", &statsWidget, WIDGET_TYPE_DYNAMIC_TEXT);
         }
 
+        if (gDepthSorterActive || sortPending)
+        {
+            static float4     color = { 1.0f, 1.0f, 1.0f, 1.0f };
+            DynamicTextWidget sortWidget;
+            sortWidget.pText = &gDepthSortStats;
+            sortWidget.pColor = &color;
+            uiCreateComponentWidget(pGuiWindow, "Depth Sort", &sortWidget, WIDGET_TYPE_DYNAMIC_TEXT);
+        }
+
+        if (gFrustumCullActive || cullPending)
+        {
+            static float4     color = { 1.0f, 1.0f, 1.0f, 1.0f };
+            DynamicTextWidget cullWidget;
+            cullWidget.pText = &gCullStats;
+            cullWidget.pColor = &color;
+            uiCreateComponentWidget(pGuiWindow, "Frustum Cull", &cullWidget, WIDGET_TYPE_DYNAMIC_TEXT);
+        }
+
+        if (gLodActive)
+        {
+            static float4     color = { 1.0f, 1.0f, 1.0f, 1.0f };
+            DynamicTextWidget lodWidget;
+            lodWidget.pText = &gLodStats;
+            lodWidget.pColor = &color;
+            uiCreateComponentWidget(pGuiWindow, "LOD Cut", &lodWidget, WIDGET_TYPE_DYNAMIC_TEXT);
+        }
+
+        if (gStreamingActive)
+        {
+            static float4     color = { 1.0f, 1.0f, 1.0f, 1.0f };
+            DynamicTextWidget streamWidget;
+            streamWidget.pText = &gStreamStats;
+            streamWidget.pColor = &color;
+            uiCreateComponentWidget(pGuiWindow, "Streaming", &streamWidget, WIDGET_TYPE_DYNAMIC_TEXT);
+        }
+
+        {
+            static float4     color = { 1.0f, 1.0f, 1.0f, 1.0f };
+            DynamicTextWidget memoryWidget;
+            memoryWidget.pText = &gFrameMemoryStats;
+            memoryWidget.pColor = &color;
+            uiCreateComponentWidget(pGuiWindow, "Frame Memory", &memoryWidget, WIDGET_TYPE_DYNAMIC_TEXT);
+        }
+
+        {
+            static float4     color = { 1.0f, 1.0f, 1.0f, 1.0f };
+            DynamicTextWidget jobsWidget;
+            jobsWidget.pText = &gFrameJobStats;
+            jobsWidget.pColor = &color;
+            uiCreateComponentWidget(pGuiWindow, "Frame Jobs", &jobsWidget, WIDGET_TYPE_DYNAMIC_TEXT);
+        }
+
+        {
+            static float4     color = { 1.0f, 1.0f, 1.0f, 1.0f };
+            DynamicTextWidget loadWidget;
+            loadWidget.pText = &gLoadStats;
+            loadWidget.pColor = &color;
+            uiCreateComponentWidget(pGuiWindow, "Load", &loadWidget, WIDGET_TYPE_DYNAMIC_TEXT);
+        }
+
+        if (gShEvalMode != SH_EVAL_NONE && !gStreamingActive)
+        {
+            SliderUintWidget degreeSlider;
+            degreeSlider.pData = &gShDegree;
+            degreeSlider.mMin = 0;
+            degreeSlider.mMax = SPLAT_SH_MAX_DEGREE;
+            degreeSlider.mStep = 1;
+            uiCreateComponentWidget(pGuiWindow, "SH Degree", &degreeSlider, WIDGET_TYPE_SLIDER_UINT);
+
+            static float4     color = { 1.0f, 1.0f, 1.0f, 1.0f };
+            DynamicTextWidget shEvalWidget;
+            shEvalWidget.pText = &gShEvalStats;
+            shEvalWidget.pColor = &color;
+            uiCreateComponentWidget(pGuiWindow, "SH Eval", &shEvalWidget, WIDGET_TYPE_DYNAMIC_TEXT);
+        }
+
+        if (!gStreamingActive)
+        {
+            static float4     color = { 1.0f, 1.0f, 1.0f, 1.0f };
+            DynamicTextWidget sceneWidget;
+            sceneWidget.pText = &gSceneStats;
+            sceneWidget.pColor = &color;
+            uiCreateComponentWidget(pGuiWindow, "Scene", &sceneWidget, WIDGET_TYPE_DYNAMIC_TEXT);
+
+            TextboxWidget pathTextbox;
+            pathTextbox.pText = gSceneRequestPath;
+            pathTextbox.mLength = sizeof(gSceneRequestPath);
+            uiCreateComponentWidget(pGuiWindow, "Scene Path", &pathTextbox, WIDGET_TYPE_TEXTBOX);
+
+            ButtonWidget loadButton;
+            UIWidget*    pLoadButton = uiCreateComponentWidget(pGuiWindow, "Load Scene", &loadButton, WIDGET_TYPE_BUTTON);
+            uiSetWidgetOnEditedCallback(pLoadButton, NULL, sceneLoadRequest);
+        }
+
+        if (!gSplatLodEnabled && !gSplatStreamingEnabled)
+        {
+            CheckboxWidget preprocessCheckbox;
+            preprocessCheckbox.pData = &gSplatGpuPreprocessEnabled;
+            UIWidget*      pPreprocessCheckbox =
+                uiCreateComponentWidget(pGuiWindow, "GPU Preprocess", &preprocessCheckbox, WIDGET_TYPE_CHECKBOX);
+            uiSetWidgetOnEditedCallback(pPreprocessCheckbox, NULL, preprocessSwitchRequest);
+        }
+
+        if (gSceneStreams.pPositions)
+        {
+            ButtonWidget referenceButton;
+            UIWidget*    pReferenceButton = uiCreateComponentWidget(pGuiWindow, "Reference Render", &referenceButton, WIDGET_TYPE_BUTTON);
+            uiSetWidgetOnEditedCallback(pReferenceButton, NULL, referenceRenderRequest);
+        }
+
         waitForAllResourceLoads();
 
         CameraMotionParameters cmp{ 60.0f, 20.0f, 200.0f };
@@ -748,6 +1055,19 @@ public:
         for (uint32_t i = 0; i < gDataBufferCount; ++i)
         {
             removeResource(pProjViewUniformBuffer[i]);
+            if (pSplatIndexBuffer[i])
+                removeResource(pSplatIndexBuffer[i]);
+            if (pShEvalUniformBuffer[i])
+                removeResource(pShEvalUniformBuffer[i]);
+            if (pPreprocessUniformBuffer[i])
+                removeResource(pPreprocessUniformBuffer[i]);
+            if (pShColorBuffer[i])
+                removeResource(pShColorBuffer[i]);
+            // a reset after a preprocess switch adds a different set
+            pSplatIndexBuffer[i] = NULL;
+            pShEvalUniformBuffer[i] = NULL;
+            pPreprocessUniformBuffer[i] = NULL;
+            pShColorBuffer[i] = NULL;
             //removeResource(pSkyboxUniformBuffer[i]);
             if (pRenderer->pProperties->mPipelineStatsQueries)
             {
@@ -758,6 +1078,74 @@ public:
         removeGpuCmdRing(pRenderer, &gGraphicsCmdRing);
         removeSemaphore(pRenderer, pImageAcquiredSemaphore);
 
+        // a scene still loading is cancelled before anything waits on the thread system
+        if (gSceneSwapState == SCENE_SWAP_LOADING)
+            splatSceneLoaderExit(&gSceneLoader);
+        removeSceneBuffers(&gNextSceneBuffers);
+        removeSceneBuffers(&gRetiredSceneBuffers);
+        splatSceneFree(&gNextScene);
+        splatSceneFree(&gRetiredScene);
+        gSceneSwapState = SCENE_SWAP_IDLE;
+        gRetiredSceneFrames = 0;
+        {
+            Buffer* const vertexBuffers[] = { pSplatBuffer, pShsBuffer, pPositionBuffer, pColorBuffer, pShTableBuffer };
+            for (uint32_t i = 0; i < TF_ARRAY_COUNT(vertexBuffers); ++i)
+            {
+                if (vertexBuffers[i])
+                    removeResource(vertexBuffers[i]);
+            }
+            Buffer* const noBuffers[SPLAT_UPLOAD_NUM_BUFFERS] = {};
+            setActiveVertexBuffers(noBuffers);
+            for (uint32_t i = 0; i < SPLAT_PREPROCESS_NUM_BUFFERS; ++i)
+            {
+                if (pPreprocessBuffers[i])
+                    removeResource(pPreprocessBuffers[i]);
+                pPreprocessBuffers[i] = NULL;
+            }
+            if (pDrawArgsResetBuffer)
+                removeResource(pDrawArgsResetBuffer);
+            pDrawArgsResetBuffer = NULL;
+            removePreprocessReadback();
+        }
+
+        if (gDepthSorterActive)
+            splatDepthSorterExit(&gDepthSorter);
+        splatBvhFree(&gSceneBvh);
+        splatFree(pVisibleSplats);
+        splatFree(pVisibleMask);
+        pVisibleSplats = NULL;
+        pVisibleMask = NULL;
+        if (gLodActive)
+            splatSortScratchExit(&gLodSortScratch);
+        splatLodFree(&gSceneLod);
+        pLodCut = NULL;
+        splatShCacheExit(&gShCache);
+        splatShCacheExit(&gShMergedCache);
+        splatFree(pShColors);
+        pShColors = NULL;
+        gShEvalActive = false;
+        if (gProgressiveLoadActive)
+        {
+            splatProgressiveLoaderExit(&gProgressiveLoader);
+            gProgressiveLoadActive = false;
+        }
+        if (gStreamingActive)
+        {
+            splatStreamerExit(&gStreamer);
+            splatSortScratchExit(&gStreamSortScratch);
+            gStreamingActive = false;
+        }
+        pStreamIndices = NULL;
+        splatJobSystemExit(&gJobSystem);
+        exitThreadSystem(gThreadSystem);
+        gThreadSystem = NULL;
+        splatFrameArenaExit(&gFrameArena);
+
+        splatQuantizedFree(&gSplatQuantized);
+        splatFreeStreams(&gSceneStreams);
+        splatCovariancesFree(&gSceneCovariances);
+        splatRasterizerExit(&gReferenceRasterizer);
+
         exitResourceLoaderInterface(pRenderer);
 
         removeQueue(pRenderer, pGraphicsQueue);
@@ -800,6 +1188,33 @@ public:
             updateDescriptorSet(pRenderer, i, pDescriptorSetUniforms, 1, params);
         }
 
+        if (gShEvalGpu)
+        {
+            updateShEvalDescriptorSet(gSceneSet, pPositionBuffer, pShsBuffer, pColorBuffer);
+            for (uint32_t i = 0; i < gDataBufferCount; ++i)
+            {
+                DescriptorData uniformParams[1] = {};
+                uniformParams[0].pName = "shEvalBlock";
+                uniformParams[0].ppBuffers = &pShEvalUniformBuffer[i];
+                updateDescriptorSet(pRenderer, i, pDescriptorSetShEvalUniforms, 1, uniformParams);
+            }
+        }
+
+        if (gPreprocessActive)
+        {
+            SceneBuffers buffers = {};
+            getActiveSceneBuffers(&buffers);
+            updatePreprocessDescriptorSets(gSceneSet, &buffers);
+            for (uint32_t i = 0; i < gDataBufferCount; ++i)
+            {
+                DescriptorData uniformParams[1] = {};
+                uniformParams[0].pName = "preprocessBlock";
+                uniformParams[0].ppBuffers = &pPreprocessUniformBuffer[i];
+                updateDescriptorSet(pRenderer, i, pDescriptorSetPreprocessUniforms, 1, uniformParams);
+                updateDescriptorSet(pRenderer, i, pDescriptorSetSplatQuadUniforms, 1, uniformParams);
+            }
+        }
+
         UserInterfaceLoadDesc uiLoad = {};
         uiLoad.mColorFormat = pSwapChain->ppRenderTargets[0]->mFormat;
         uiLoad.mHeight = mSettings.mHeight;
@@ -851,6 +1266,19 @@ public:
 
     void Update(float deltaTime)
     {
+        // the arena grows before the frame starts, growth is not counted
+        splatFrameArenaBeginFrame(&gFrameArena, gFrameIndex);
+        gFrameHeapCallsStart = splatHeapCallCount();
+        // the scene loader worker allocates through the splat heap while the frame runs
+        gFrameMayAllocate = gProgressiveLoadActive || gSceneSwapState != SCENE_SWAP_IDLE;
+        if (gSceneLoadRequested)
+        {
+            gSceneLoadRequested = false;
+            requestSceneLoad(gSceneRequestPath);
+        }
+        if (gSceneSwapState != SCENE_SWAP_IDLE || gRetiredSceneFrames)
+            updateSceneSwap();
+
         updateInputSystem(deltaTime, mSettings.mWidth, mSettings.mHeight);
 
         pCameraController->update(deltaTime);
@@ -868,6 +1296,195 @@ public:
         CameraMatrix projMat = CameraMatrix::perspectiveReverseZ(horizontal_fov, aspectInverse, 0.1f, 1000.0f);
         gUniformData.mProjectView = projMat * viewMat;
 
+        if (gProgressiveLoadActive)
+            updateProgressiveLoad();
+
+        if (gPreprocessActive)
+        {
+            // a progressive load preprocesses the prefix that has landed
+            SplatCamera camera = {};
+            splatCameraFromView(viewMat, horizontal_fov, &camera);
+            const uint32_t degree = gShEvalMode == SH_EVAL_NONE ? 0 : gShDegree;
+            splatPreprocessBlockFromCamera(&camera, gProgressiveLoadActive ? gProgressiveDrawable : mNumOfPoints, degree, &gSplatQuantized,
+                                           &gPreprocessData);
+            // a codebook is shared by every splat, a splat fetches its index
+            const uint32_t numRest = 3 * ((degree + 1) * (degree + 1) - 1);
+            const uint32_t encoding = gPreprocessData.mParams[2];
+            const uint32_t coldBytes = encoding == SPLAT_GPU_SH_REST_CODEBOOK ? (numRest ? (uint32_t)sizeof(uint32_t) : 0)
+                                       : encoding == SPLAT_GPU_SH_REST_F16    ? numRest * 2
+                                       : encoding == SPLAT_GPU_SH_REST_U8     ? numRest
+                                                                              : numRest * (uint32_t)sizeof(float);
+            bformat(&gShEvalStats, "SH eval: degree %u in the preprocess pass, fetches %u B hot + %u B SH per visible splat\n", degree,
+                    (uint32_t)sizeof(SplatGpuSplat), coldBytes);
+        }
+
+        SplatFrustum frustum;
+        if (gFrustumCullActive || gLodActive || gStreamingActive)
+        {
+            const mat4 projView = projMat.mCamera * viewMat;
+            float      matrix[16];
+            for (uint32_t row = 0; row < 4; row++)
+            {
+                const vec4 projViewRow = projView.getRow(row);
+                matrix[row * 4 + 0] = projViewRow.getX();
+                matrix[row * 4 + 1] = projViewRow.getY();
+                matrix[row * 4 + 2] = projViewRow.getZ();
+                matrix[row * 4 + 3] = projViewRow.getW();
+            }
+            splatFrustumFromMatrix(matrix, &frustum);
+        }
+
+        // The cull and the CPU SH evaluation are independent stages of one
+        // graph. It runs on the job system, which never waits for the thread
+        // system to be idle and so does not wait for the depth sort in flight.
+        splatJobGraphReset(&gFrameGraph);
+        uint32_t cullStage = UINT32_MAX;
+        if (gFrustumCullActive)
+        {
+            for (uint64_t i = 0; i < gNumVisibleSplats; i++)
+                pVisibleMask[pVisibleSplats[i]] = 0;
+            cullStage = splatBvhCullFrustumStages(&gFrameGraph, &gCullJob, &gSceneBvh, &frustum, pVisibleSplats);
+        }
+        const bool shEvalCpu = gShEvalActive && !gShEvalGpu;
+        uint32_t   shMergedStage = UINT32_MAX;
+        if (shEvalCpu)
+        {
+            // Draw copies the clusters that changed
+            gShEvalEye = pCameraController->getViewPosition();
+            const Tf32x3_s eye = { gShEvalEye.getX(), gShEvalEye.getY(), gShEvalEye.getZ() };
+            splatEvalShCachedStages(&gFrameGraph, &gShJob, &gShCache, gShDegree, &gSceneStreams, eye, gShEvalMaxAngle, pShColors);
+            if (gLodActive)
+                shMergedStage = splatEvalShCachedStages(&gFrameGraph, &gShMergedJob, &gShMergedCache, gShDegree, &gSceneLod.mMerged, eye,
+                                                        gShEvalMaxAngle, pShColors + mNumOfPoints);
+        }
+        if (gFrameGraph.mNumStages)
+        {
+            for (uint32_t stage = 0; stage < gFrameGraph.mNumStages; stage++)
+                gFrameGraph.mStages[stage].mProfileToken = frameStageProfileToken(gFrameGraph.mStages[stage].pName);
+            splatJobGraphRun(&gJobSystem, &gFrameGraph, &gFrameGraphStats);
+            bformat(&gFrameJobStats, "Frame jobs: %u stages on %u workers, %.2f ms, %llu ranges, %llu steals\n",
+                    gFrameGraph.mNumStages, gFrameGraphStats.mNumWorkers, gFrameGraphStats.mDurationUs / 1000.0f,
+                    (unsigned long long)gFrameGraphStats.mNumRanges, (unsigned long long)gFrameGraphStats.mNumSteals);
+        }
+        if (gFrustumCullActive)
+        {
+            gNumVisibleSplats = gCullJob.mNumVisible;
+            for (uint64_t i = 0; i < gNumVisibleSplats; i++)
+                pVisibleMask[pVisibleSplats[i]] = 1;
+            // from the cull stage becoming ready to the compaction finishing
+            gFrustumCullUs = gFrameGraph.mStages[cullStage].mDoneUs - gFrameGraph.mStages[cullStage - 1].mReadyUs;
+        }
+
+        // TF views look down +z, the third row gives the view depth
+        const vec4  depthRow = viewMat.getRow(2);
+        const float depthRowValues[4] = { depthRow.getX(), depthRow.getY(), depthRow.getZ(), depthRow.getW() };
+        if (gLodActive)
+        {
+            const vec3     eye = pCameraController->getViewPosition();
+            SplatLodCutDesc cutDesc = {};
+            cutDesc.mEye = { eye.getX(), eye.getY(), eye.getZ() };
+            cutDesc.mFocalPixels = 0.5f * (float)mSettings.mWidth / tanf(0.5f * horizontal_fov);
+            cutDesc.mMaxErrorPixels = gSplatLodMaxErrorPixels;
+            cutDesc.pFrustum = &frustum;
+            const uint64_t numNodes = mNumOfPoints + gSceneLod.mNumMerged;
+            pLodCut = (uint32_t*)splatFrameArenaAlloc(&gFrameArena, sizeof(uint32_t) * numNodes, 64);
+            gLodCutSize = splatLodCut(&gSceneLod, &cutDesc, pLodCut, &gLodCutStats);
+            const int64_t sortStartUs = getUSec(false);
+            uint64_t*     keys = (uint64_t*)splatFrameArenaAlloc(&gFrameArena, sizeof(uint64_t) * gLodCutSize, 64);
+            splatLodSortBackToFront(&gSceneLod, depthRowValues, pLodCut, gLodCutSize, keys, &gLodSortScratch);
+            bformat(&gLodStats,
+                    "LOD cut: %llu nodes (%llu merged) for %llu of %llu splats\n"
+                    "    error max %.2f px, mean %.2f px, cut %.2f ms, sort %.2f ms\n",
+                    (unsigned long long)gLodCutSize, (unsigned long long)gLodCutStats.mNumMerged,
+                    (unsigned long long)gLodCutStats.mNumRepresented, (unsigned long long)mNumOfPoints, gLodCutStats.mMaxErrorPixels,
+                    gLodCutStats.mMeanErrorPixels, gLodCutStats.mDurationUs / 1000.0f, (getUSec(false) - sortStartUs) / 1000.0f);
+        }
+
+        if (gStreamingActive)
+        {
+            const vec3    eye = pCameraController->getViewPosition();
+            const int64_t startUs = getUSec(false);
+            splatStreamerUpdate(&gStreamer, { eye.getX(), eye.getY(), eye.getZ() }, &frustum, deltaTime);
+            uploadStreamedSlots();
+            const int64_t gatherStartUs = getUSec(false);
+            pStreamIndices = (uint32_t*)splatFrameArenaAlloc(&gFrameArena, sizeof(uint32_t) * mNumOfPoints, 64);
+            uint64_t* keys = (uint64_t*)splatFrameArenaAlloc(&gFrameArena, sizeof(uint64_t) * mNumOfPoints, 64);
+            gStreamIndexCount = splatStreamerGatherVisible(&gStreamer, depthRowValues, pStreamIndices, keys, &gStreamSortScratch);
+            const SplatStreamerStats& stats = gStreamer.mStats;
+            bformat(&gStreamStats,
+                    "Streaming: %u of %u visible chunks resident, %llu splats drawn\n"
+                    "    resident %.1f of %.1f MB (peak %.1f), update %.2f ms, sort %.2f ms, last stall %.2f ms\n"
+                    "    requests %llu, misses %llu, prefetches %llu (%llu hits), evictions %llu, dropped %llu, failed %llu\n"
+                    "    loaded %.1f MB, stalled %.2f ms\n",
+                    stats.mVisibleResident, stats.mVisibleChunks, (unsigned long long)gStreamIndexCount,
+                    stats.mResidentBytes / (1024.0f * 1024.0f), gStreamer.mNumSlots * gStreamer.mSlotSize / (1024.0f * 1024.0f),
+                    stats.mPeakResidentBytes / (1024.0f * 1024.0f), (gatherStartUs - startUs) / 1000.0f,
+                    (getUSec(false) - gatherStartUs) / 1000.0f, stats.mLastStallUs / 1000.0f, (unsigned long long)stats.mRequests,
+                    (unsigned long long)stats.mMisses, (unsigned long long)stats.mPrefetches, (unsigned long long)stats.mPrefetchHits,
+                    (unsigned long long)stats.mEvictions, (unsigned long long)stats.mDropped, (unsigned long long)stats.mFailed,
+                    stats.mBytesLoaded / (1024.0f * 1024.0f), stats.mStallUs / 1000.0f);
+        }
+
+        if (gDepthSorterActive)
+        {
+            splatDepthSorterKick(&gDepthSorter, depthRowValues);
+            if (!splatDepthSorterIsBusy(&gDepthSorter))
+            {
+                const SplatDepthSortStats& stats = gDepthSorter.mStats;
+                bformat(&gDepthSortStats,
+                        "Depth sort: %.2f ms, disorder %.2f\n"
+                        "    incremental %llu, full %llu (disorder %llu, budget %llu), skipped %llu\n",
+                        stats.mLastDurationUs / 1000.0f, stats.mLastDisorder, (unsigned long long)stats.mNumIncremental,
+                        (unsigned long long)stats.mNumFull, (unsigned long long)stats.mNumDisorderFallbacks,
+                        (unsigned long long)stats.mNumBudgetFallbacks, (unsigned long long)stats.mNumSkippedKicks);
+            }
+        }
+        if (gFrustumCullActive)
+        {
+            bformat(&gCullStats, "Frustum cull: %.2f ms, %llu of %llu splats visible\n", gFrustumCullUs / 1000.0f,
+                    (unsigned long long)gNumVisibleSplats, (unsigned long long)mNumOfPoints);
+        }
+
+        if (gShEvalActive)
+        {
+            if (gShEvalGpu)
+            {
+                gShEvalEye = pCameraController->getViewPosition();
+                bformat(&gShEvalStats, "SH eval: degree %u on the GPU\n", gShDegree);
+            }
+            else
+            {
+                SplatShEvalStats stats = gShJob.mStats;
+                if (shMergedStage != UINT32_MAX)
+                {
+                    const SplatShEvalStats& mergedStats = gShMergedJob.mStats;
+                    stats.mNumEvaluated += mergedStats.mNumEvaluated;
+                    stats.mNumSkipped += mergedStats.mNumSkipped;
+                    stats.mDurationUs += mergedStats.mDurationUs;
+                }
+                bformat(&gShEvalStats, "SH eval: degree %u, %llu of %llu clusters evaluated, %.2f ms\n", gShDegree,
+                        (unsigned long long)stats.mNumEvaluated, (unsigned long long)(stats.mNumEvaluated + stats.mNumSkipped),
+                        stats.mDurationUs / 1000.0f);
+            }
+        }
+
+        // the reference waits for a progressive load to complete
+        SplatFrameArenaStats arenaStats = {};
+        splatFrameArenaGetStats(&gFrameArena, &arenaStats);
+        bformat(&gFrameMemoryStats,
+                "Frame memory: %.2f MB used of %.2f MB, high water %.2f MB, %u threads\n"
+                "    %llu overflows, %llu growths, %llu heap calls last frame\n",
+                arenaStats.mUsed / (1024.0f * 1024.0f), arenaStats.mCapacity / (1024.0f * 1024.0f),
+                arenaStats.mHighWater / (1024.0f * 1024.0f), arenaStats.mNumThreads, (unsigned long long)arenaStats.mNumOverflows,
+                (unsigned long long)arenaStats.mNumGrowths, (unsigned long long)gFrameHeapCalls);
+
+        if (gReferenceRenderRequested && !gProgressiveLoadActive)
+        {
+            gReferenceRenderRequested = false;
+            gFrameMayAllocate = true;
+            referenceRender(viewMat, horizontal_fov);
+        }
+
         viewMat.setTranslation(vec3(0));
         //gUniformDataSky = {};
         //gUniformDataSky.mProjectView = projMat * viewMat;
@@ -892,6 +1509,8 @@ public:
         getFenceStatus(pRenderer, elem.pFence, &fenceStatus);
         if (fenceStatus == FENCE_STATUS_INCOMPLETE)
             waitForFences(pRenderer, 1, &elem.pFence);
+        if (gPreprocessCheckSlot == gFrameIndex)
+            checkPreprocessReadback();
 
         // Update uniform buffers
         BufferUpdateDesc viewProjCbv = { pProjViewUniformBuffer[gFrameIndex] };
@@ -899,6 +1518,71 @@ public:
         memcpy(viewProjCbv.pMappedData, &gUniformData, sizeof(gUniformData));
         endUpdateResource(&viewProjCbv);
 
+        // the newest finished depth order, usually computed for an earlier frame
+        uint64_t        sortedVersion = 0;
+        const uint32_t* sortedOrder = gDepthSorterActive ? splatDepthSorterAcquire(&gDepthSorter, &sortedVersion) : NULL;
+        if (gStreamingActive)
+        {
+            // slot s holds splats s * capacity onwards in the vertex buffers
+            BufferUpdateDesc indexUpdate = { pSplatIndexBuffer[gFrameIndex] };
+            beginUpdateResource(&indexUpdate);
+            memcpy(indexUpdate.pMappedData, pStreamIndices, sizeof(uint32_t) * gStreamIndexCount);
+            endUpdateResource(&indexUpdate);
+            gIndexedDrawCount[gFrameIndex] = gStreamIndexCount;
+        }
+        else if (gLodActive)
+        {
+            // merged nodes follow the splats in the vertex buffers, cut ids index both
+            BufferUpdateDesc indexUpdate = { pSplatIndexBuffer[gFrameIndex] };
+            beginUpdateResource(&indexUpdate);
+            memcpy(indexUpdate.pMappedData, pLodCut, sizeof(uint32_t) * gLodCutSize);
+            endUpdateResource(&indexUpdate);
+            gIndexedDrawCount[gFrameIndex] = gLodCutSize;
+        }
+        else if (gFrustumCullActive)
+        {
+            // the visible set changes every frame, keep the sorted order of the visible splats
+            BufferUpdateDesc indexUpdate = { pSplatIndexBuffer[gFrameIndex] };
+            beginUpdateResource(&indexUpdate);
+            uint32_t* indices = (uint32_t*)indexUpdate.pMappedData;
+            uint64_t  numIndices = 0;
+            if (sortedOrder)
+            {
+                for (uint64_t i = 0; i < mNumOfPoints; i++)
+                {
+                    indices[numIndices] = sortedOrder[i];
+                    numIndices += pVisibleMask[sortedOrder[i]];
+                }
+            }
+            else
+            {
+                memcpy(indices, pVisibleSplats, sizeof(uint32_t) * gNumVisibleSplats);
+                numIndices = gNumVisibleSplats;
+            }
+            endUpdateResource(&indexUpdate);
+            gIndexedDrawCount[gFrameIndex] = numIndices;
+        }
+        else if (sortedOrder && sortedVersion != gSortedIndexVersion[gFrameIndex])
+        {
+            BufferUpdateDesc indexUpdate = { pSplatIndexBuffer[gFrameIndex] };
+            beginUpdateResource(&indexUpdate);
+            memcpy(indexUpdate.pMappedData, sortedOrder, sizeof(uint32_t) * mNumOfPoints);
+            endUpdateResource(&indexUpdate);
+            gSortedIndexVersion[gFrameIndex] = sortedVersion;
+            gIndexedDrawCount[gFrameIndex] = mNumOfPoints;
+        }
+
+        if (gShEvalActive && !gShEvalGpu)
+        {
+            BufferUpdateDesc colorUpdate = { pShColorBuffer[gFrameIndex] };
+            beginUpdateResource(&colorUpdate);
+            Tf32x3_s* colors = (Tf32x3_s*)colorUpdate.pMappedData;
+            syncShColors(&gShCache, colors, 0, &gShColorStamps[gFrameIndex][0]);
+            if (gLodActive)
+                syncShColors(&gShMergedCache, colors, mNumOfPoints, &gShColorStamps[gFrameIndex][1]);
+            endUpdateResource(&colorUpdate);
+        }
+
         // Reset cmd pool for this frame
         resetCmdPool(pRenderer, elem.pCmdPool);
 
@@ -908,6 +1592,8 @@ public:
             QueryData data2D = {};
             getQueryData(pRenderer, pPipelineStatsQueryPool[gFrameIndex], 0, &data3D);
             getQueryData(pRenderer, pPipelineStatsQueryPool[gFrameIndex], 1, &data2D);
+            // every splat fragment is shaded, the ones the falloff discards included
+            const float overdraw = (float)data3D.mPipelineStats.mPSInvocations / (float)(mSettings.mWidth * mSettings.mHeight);
             bformat(&gPipelineStats,
                     "\n"
                     "Pipeline Stats 3D:\n"
@@ -916,6 +1602,7 @@ public:
                     "    Clipper invocations: %u\n"
                     "    IA primitives:       %u\n"
                     "    Clipper primitives:  %u\n"
+                    "    Overdraw:            %.2f fragments per pixel\n"
                     "\n"
                     "Pipeline Stats 2D UI:\n"
                     "    VS invocations:      %u\n"
@@ -924,7 +1611,7 @@ public:
                     "    IA primitives:       %u\n"
                     "    Clipper primitives:  %u\n",
                     data3D.mPipelineStats.mVSInvocations, data3D.mPipelineStats.mPSInvocations, data3D.mPipelineStats.mCInvocations,
-                    data3D.mPipelineStats.mIAPrimitives, data3D.mPipelineStats.mCPrimitives, data2D.mPipelineStats.mVSInvocations,
+                    data3D.mPipelineStats.mIAPrimitives, data3D.mPipelineStats.mCPrimitives, overdraw, data2D.mPipelineStats.mVSInvocations,
                     data2D.mPipelineStats.mPSInvocations, data2D.mPipelineStats.mCInvocations, data2D.mPipelineStats.mIAPrimitives,
                     data2D.mPipelineStats.mCPrimitives);
         }
@@ -940,6 +1627,123 @@ public:
             cmdBeginQuery(cmd, pPipelineStatsQueryPool[gFrameIndex], &queryDesc);
         }
 
+        // the color stream is shared by the frames in flight, it is only rewritten when the view or the degree changes
+        const uint64_t numShNodes = mNumOfPoints + (gLodActive ? gSceneLod.mNumMerged : 0);
+        if (gShEvalActive && gShEvalGpu &&
+            (gShDegree != gShDispatchedDegree || (gShDegree > 0 && lengthSqr(gShEvalEye - gShDispatchedEye) > 0.0f)))
+        {
+            BufferUpdateDesc shEvalCbv = { pShEvalUniformBuffer[gFrameIndex] };
+            beginUpdateResource(&shEvalCbv);
+            ShEvalBlock* block = (ShEvalBlock*)shEvalCbv.pMappedData;
+            block->mEye = vec4(gShEvalEye, 1.0f);
+            block->mParams[0] = (uint32_t)numShNodes;
+            block->mParams[1] = gShDegree;
+            block->mParams[2] = 0;
+            block->mParams[3] = 0;
+            endUpdateResource(&shEvalCbv);
+
+            cmdBeginGpuTimestampQuery(cmd, gGpuProfileToken, "SH Eval");
+            BufferBarrier shBarriers[] = {
+                { pPositionBuffer, RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER, RESOURCE_STATE_SHADER_RESOURCE },
+                { pShsBuffer, RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER, RESOURCE_STATE_SHADER_RESOURCE },
+                { pColorBuffer, RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER, RESOURCE_STATE_UNORDERED_ACCESS },
+            };
+            cmdResourceBarrier(cmd, TF_ARRAY_COUNT(shBarriers), shBarriers, 0, NULL, 0, NULL);
+            cmdBindPipeline(cmd, pShEvalPipeline);
+            cmdBindDescriptorSet(cmd, gSceneSet, pDescriptorSetShEval);
+            cmdBindDescriptorSet(cmd, gFrameIndex, pDescriptorSetShEvalUniforms);
+            cmdDispatch(cmd, (uint32_t)((numShNodes + 63) / 64), 1, 1);
+            for (uint32_t i = 0; i < TF_ARRAY_COUNT(shBarriers); ++i)
+            {
+                const ResourceState state = shBarriers[i].mCurrentState;
+                shBarriers[i].mCurrentState = shBarriers[i].mNewState;
+                shBarriers[i].mNewState = state;
+            }
+            cmdResourceBarrier(cmd, TF_ARRAY_COUNT(shBarriers), shBarriers, 0, NULL, 0, NULL);
+            cmdEndGpuTimestampQuery(cmd, gGpuProfileToken);
+            gShDispatchedDegree = gShDegree;
+            gShDispatchedEye = gShEvalEye;
+        }
+
+        // one set of outputs per scene, the frames in flight run the pass and the draw one after the other
+        const uint32_t numPreprocessed = gPreprocessData.mParams[0];
+        if (gPreprocessActive && numPreprocessed)
+        {
+            BufferUpdateDesc preprocessCbv = { pPreprocessUniformBuffer[gFrameIndex] };
+            beginUpdateResource(&preprocessCbv);
+            memcpy(preprocessCbv.pMappedData, &gPreprocessData, sizeof(gPreprocessData));
+            endUpdateResource(&preprocessCbv);
+
+            cmdBeginGpuTimestampQuery(cmd, gGpuProfileToken, "Preprocess");
+            // the packed inputs stay shader resources
+            Buffer* drawArgs = pPreprocessBuffers[SPLAT_PREPROCESS_DRAW_ARGS];
+            BufferBarrier preprocessBarriers[] = {
+                { pPreprocessBuffers[SPLAT_PREPROCESS_RECORDS], RESOURCE_STATE_SHADER_RESOURCE, RESOURCE_STATE_UNORDERED_ACCESS },
+                { pPreprocessBuffers[SPLAT_PREPROCESS_VISIBLE], RESOURCE_STATE_SHADER_RESOURCE, RESOURCE_STATE_UNORDERED_ACCESS },
+                { pPreprocessBuffers[SPLAT_PREPROCESS_KEYS], RESOURCE_STATE_SHADER_RESOURCE, RESOURCE_STATE_UNORDERED_ACCESS },
+                { drawArgs, RESOURCE_STATE_INDIRECT_ARGUMENT, RESOURCE_STATE_COPY_DEST },
+            };
+            const uint32_t numPreprocessBarriers = TF_ARRAY_COUNT(preprocessBarriers);
+            cmdResourceBarrier(cmd, numPreprocessBarriers, preprocessBarriers, 0, NULL, 0, NULL);
+            cmdUpdateBuffer(cmd, drawArgs, 0, pDrawArgsResetBuffer, 0, sizeof(SplatPreprocessDrawArgs));
+            BufferBarrier drawArgsBarrier = { drawArgs, RESOURCE_STATE_COPY_DEST, RESOURCE_STATE_UNORDERED_ACCESS };
+            cmdResourceBarrier(cmd, 1, &drawArgsBarrier, 0, NULL, 0, NULL);
+
+            cmdBindPipeline(cmd, pPreprocessPipeline);
+            cmdBindDescriptorSet(cmd, gSceneSet, pDescriptorSetPreprocess);
+            cmdBindDescriptorSet(cmd, gFrameIndex, pDescriptorSetPreprocessUniforms);
+            cmdDispatch(cmd, (numPreprocessed + SPLAT_PREPROCESS_THREADS - 1) / SPLAT_PREPROCESS_THREADS, 1, 1);
+            cmdEndGpuTimestampQuery(cmd, gGpuProfileToken);
+
+            // back to front, the steps cover the splat count and the appended count sizes their dispatches
+            cmdBeginGpuTimestampQuery(cmd, gGpuProfileToken, "Sort");
+            SplatPreprocessSortStep sortSteps[SPLAT_PREPROCESS_SORT_MAX_STEPS];
+            uint32_t                numSortThreads = 0;
+            const uint32_t          numSortSteps = splatPreprocessSortSteps(numPreprocessed, sortSteps, &numSortThreads);
+            Buffer*                 sortArgs = pPreprocessBuffers[SPLAT_PREPROCESS_SORT_ARGS];
+            BufferBarrier           sortArgsBarriers[] = {
+                { drawArgs, RESOURCE_STATE_UNORDERED_ACCESS, RESOURCE_STATE_UNORDERED_ACCESS },
+                { sortArgs, RESOURCE_STATE_INDIRECT_ARGUMENT, RESOURCE_STATE_UNORDERED_ACCESS },
+            };
+            cmdResourceBarrier(cmd, TF_ARRAY_COUNT(sortArgsBarriers), sortArgsBarriers, 0, NULL, 0, NULL);
+            cmdBindPipeline(cmd, pSortArgsPipeline);
+            cmdBindDescriptorSet(cmd, gSceneSet, pDescriptorSetSort);
+            cmdDispatch(cmd, (numSortSteps + SPLAT_PREPROCESS_SORT_ARGS_THREADS - 1) / SPLAT_PREPROCESS_SORT_ARGS_THREADS, 1, 1);
+            sortArgsBarriers[1] = { sortArgs, RESOURCE_STATE_UNORDERED_ACCESS, RESOURCE_STATE_INDIRECT_ARGUMENT };
+            cmdResourceBarrier(cmd, 1, &sortArgsBarriers[1], 0, NULL, 0, NULL);
+
+            BufferBarrier sortBarriers[] = {
+                { pPreprocessBuffers[SPLAT_PREPROCESS_VISIBLE], RESOURCE_STATE_UNORDERED_ACCESS, RESOURCE_STATE_UNORDERED_ACCESS },
+                { pPreprocessBuffers[SPLAT_PREPROCESS_KEYS], RESOURCE_STATE_UNORDERED_ACCESS, RESOURCE_STATE_UNORDERED_ACCESS },
+                { drawArgs, RESOURCE_STATE_UNORDERED_ACCESS, RESOURCE_STATE_UNORDERED_ACCESS },
+            };
+            cmdBindPipeline(cmd, pSortPipeline);
+            cmdBindDescriptorSet(cmd, gSceneSet, pDescriptorSetSort);
+            for (uint32_t i = 0; i < numSortSteps; ++i)
+            {
+                // steps past the network over the appended count run no groups
+                cmdResourceBarrier(cmd, TF_ARRAY_COUNT(sortBarriers), sortBarriers, 0, NULL, 0, NULL);
+                cmdBindPushConstants(cmd, pSortRootSignature, gSortStepIndex, &sortSteps[i]);
+                cmdExecuteIndirect(cmd, INDIRECT_DISPATCH, 1, sortArgs, i * sizeof(SplatPreprocessDispatchArgs), NULL, 0);
+            }
+
+            // the outputs are read by the quad draw
+            for (uint32_t i = 0; i < numPreprocessBarriers; ++i)
+            {
+                const ResourceState state = preprocessBarriers[i].mCurrentState;
+                preprocessBarriers[i].mCurrentState = preprocessBarriers[i].mNewState;
+                preprocessBarriers[i].mNewState = state;
+            }
+            preprocessBarriers[numPreprocessBarriers - 1].mCurrentState = RESOURCE_STATE_UNORDERED_ACCESS;
+            preprocessBarriers[numPreprocessBarriers - 1].mNewState = RESOURCE_STATE_INDIRECT_ARGUMENT;
+            cmdResourceBarrier(cmd, numPreprocessBarriers, preprocessBarriers, 0, NULL, 0, NULL);
+            cmdEndGpuTimestampQuery(cmd, gGpuProfileToken);
+
+            if (gSplatPreprocessCheckInterval && gPreprocessCheckSlot == UINT32_MAX &&
+                ++gPreprocessCheckFrames % gSplatPreprocessCheckInterval == 0)
+                copyPreprocessReadback(cmd, numPreprocessed);
+        }
+
         RenderTargetBarrier barriers[] = {
             { pRenderTarget, RESOURCE_STATE_PRESENT, RESOURCE_STATE_RENDER_TARGET },
         };
@@ -959,15 +1763,43 @@ public:
         //const uint32_t skyboxVbStride = sizeof(float) * 4;
         //// draw skybox
         cmdBeginGpuTimestampQuery(cmd, gGpuProfileToken, "Draw Gaussian Points");
-        cmdSetViewport(cmd, 0.0f, 0.0f, (float)pRenderTarget->mWidth, (float)pRenderTarget->mHeight, 1.0f, 1.0f);
-        cmdBindDescriptorSet(cmd, gFrameIndex, pDescriptorSetUniforms);
+        uint64_t numDrawn = 0;
+        if (gPreprocessActive)
         {
-            Buffer*  bufferArgs[2] = { pPositionBuffer, pColorBuffer };
+            // one quad per visible splat, the sorted visible list back to front
+            if (numPreprocessed)
+            {
+                cmdBindPipeline(cmd, pSplatQuadPipeline);
+                cmdBindDescriptorSet(cmd, gFrameIndex, pDescriptorSetSplatQuadUniforms);
+                cmdBindDescriptorSet(cmd, gSceneSet, pDescriptorSetSplatQuad);
+                cmdExecuteIndirect(cmd, INDIRECT_DRAW, 1, pPreprocessBuffers[SPLAT_PREPROCESS_DRAW_ARGS], 0, NULL, 0);
+            }
+            numDrawn = numPreprocessed;
+        }
+        else
+        {
+            cmdSetViewport(cmd, 0.0f, 0.0f, (float)pRenderTarget->mWidth, (float)pRenderTarget->mHeight, 1.0f, 1.0f);
+            cmdBindDescriptorSet(cmd, gFrameIndex, pDescriptorSetUniforms);
+            Buffer*  colorBuffer = gShEvalActive && !gShEvalGpu ? pShColorBuffer[gFrameIndex] : pColorBuffer;
+            Buffer*  bufferArgs[2] = { pPositionBuffer, colorBuffer };
             uint32_t strideArgs[2] = { sizeof(struct Tf32x3_s), sizeof(struct Tf32x3_s) };
             cmdBindVertexBuffer(cmd, 2, bufferArgs, strideArgs, NULL);
+            cmdBindPipeline(cmd, pParticlePipeline);
+            if (gIndexedDrawCount[gFrameIndex])
+            {
+                cmdBindIndexBuffer(cmd, pSplatIndexBuffer[gFrameIndex], INDEX_TYPE_UINT32, 0);
+                cmdDrawIndexed(cmd, (uint32_t)gIndexedDrawCount[gFrameIndex], 0, 0);
+                numDrawn = gIndexedDrawCount[gFrameIndex];
+            }
+            else if (!gFrustumCullActive && !gLodActive && !gStreamingActive)
+            {
+                // a progressive load draws the prefix that has landed, unsorted
+                numDrawn = gProgressiveLoadActive ? gProgressiveDrawable : mNumOfPoints;
+                if (numDrawn)
+                    cmdDraw(cmd, (uint32_t)numDrawn, 0);
+            }
         }
-        cmdBindPipeline(cmd, pParticlePipeline);
-        cmdDraw(cmd, mNumOfPoints, 0);
+        recordLoadTimes(numDrawn);
         
         cmdSetViewport(cmd, 0.0f, 0.0f, (float)pRenderTarget->mWidth, (float)pRenderTarget->mHeight, 0.0f, 1.0f);
         cmdEndGpuTimestampQuery(cmd, gGpuProfileToken);
@@ -1042,11 +1874,881 @@ public:
         queuePresent(pGraphicsQueue, &presentDesc);
         flipProfiler();
 
+        checkFrameAllocations();
         gFrameIndex = (gFrameIndex + 1) % gDataBufferCount;
     }
 
+    // Steady frames must not touch the heap, anything transient belongs in the frame arena.
+    void checkFrameAllocations()
+    {
+        gFrameHeapCalls = splatHeapCallCount() - gFrameHeapCallsStart;
+        gSteadyFrames = gFrameMayAllocate ? 0 : gSteadyFrames + 1;
+        if (gSteadyFrames > gSteadyFrameWarmup && gFrameHeapCalls)
+        {
+            LOGF(eERROR, "Steady frame made %llu splat heap calls", (unsigned long long)gFrameHeapCalls);
+            ASSERT(gFrameHeapCalls == 0);
+        }
+    }
+
     const char* GetName() { return "01_Transformations"; }
 
+    // Camera of the splat projection for the current view, it matches the projection of the point draw.
+    void splatCameraFromView(const mat4& viewMat, float horizontalFov, SplatCamera* outCamera)
+    {
+        // TF views look down +z with +y up, the projection expects +y down
+        for (uint32_t row = 0; row < 3; row++)
+        {
+            const vec4  viewRow = viewMat.getRow(row);
+            const float sign = row == 1 ? -1.0f : 1.0f;
+            outCamera->mView[row * 4 + 0] = sign * viewRow.getX();
+            outCamera->mView[row * 4 + 1] = sign * viewRow.getY();
+            outCamera->mView[row * 4 + 2] = sign * viewRow.getZ();
+            outCamera->mView[row * 4 + 3] = sign * viewRow.getW();
+        }
+        const vec3 cameraPosition = pCameraController->getViewPosition();
+        outCamera->mPosition = { cameraPosition.getX(), cameraPosition.getY(), cameraPosition.getZ() };
+        outCamera->mWidth = mSettings.mWidth;
+        outCamera->mHeight = mSettings.mHeight;
+        outCamera->mFocalX = (float)mSettings.mWidth * 0.5f / tanf(horizontalFov * 0.5f);
+        outCamera->mFocalY = outCamera->mFocalX;
+        outCamera->mCenterX = (float)mSettings.mWidth * 0.5f;
+        outCamera->mCenterY = (float)mSettings.mHeight * 0.5f;
+        outCamera->mNear = 0.1f;
+    }
+
+    // Records copies of the preprocess outputs of this frame for checkPreprocessReadback, once the
+    // frame's fence has passed. The outputs are back in their draw states afterwards.
+    void copyPreprocessReadback(Cmd* cmd, uint32_t numSplats)
+    {
+        if (numSplats > gPreprocessReadbackCapacity)
+        {
+            // no copy is in flight, a larger scene was swapped in
+            removePreprocessReadback();
+            const uint64_t sizes[SPLAT_PREPROCESS_NUM_BUFFERS] = { sizeof(SplatPreprocessRecord) * numSplats, sizeof(uint32_t) * numSplats,
+                                                                   sizeof(uint32_t) * numSplats, sizeof(SplatPreprocessDrawArgs),
+                                                                   sizeof(SplatPreprocessDispatchArgs) * SPLAT_PREPROCESS_SORT_MAX_STEPS };
+            BufferLoadDesc readbackDesc = {};
+            readbackDesc.mDesc.pName = "PreprocessReadback";
+            readbackDesc.mDesc.mDescriptors = DESCRIPTOR_TYPE_UNDEFINED;
+            readbackDesc.mDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_GPU_TO_CPU;
+            readbackDesc.mDesc.mFlags = BUFFER_CREATION_FLAG_PERSISTENT_MAP_BIT;
+            readbackDesc.mDesc.mStartState = RESOURCE_STATE_COPY_DEST;
+            for (uint32_t i = 0; i < SPLAT_PREPROCESS_NUM_BUFFERS; ++i)
+            {
+                readbackDesc.mDesc.mSize = sizes[i];
+                readbackDesc.ppBuffer = &pPreprocessReadback[i];
+                addResource(&readbackDesc, NULL);
+            }
+            gPreprocessReadbackCapacity = numSplats;
+            gFrameMayAllocate = true;
+        }
+
+        const ResourceState states[SPLAT_PREPROCESS_NUM_BUFFERS] = { RESOURCE_STATE_SHADER_RESOURCE, RESOURCE_STATE_SHADER_RESOURCE,
+                                                                     RESOURCE_STATE_SHADER_RESOURCE, RESOURCE_STATE_INDIRECT_ARGUMENT,
+                                                                     RESOURCE_STATE_INDIRECT_ARGUMENT };
+        const uint64_t      sizes[SPLAT_PREPROCESS_NUM_BUFFERS] = { sizeof(SplatPreprocessRecord) * numSplats, sizeof(uint32_t) * numSplats,
+                                                                    sizeof(uint32_t) * numSplats, sizeof(SplatPreprocessDrawArgs),
+                                                                    sizeof(SplatPreprocessDispatchArgs) * SPLAT_PREPROCESS_SORT_MAX_STEPS };
+        BufferBarrier       barriers[SPLAT_PREPROCESS_NUM_BUFFERS];
+        for (uint32_t i = 0; i < SPLAT_PREPROCESS_NUM_BUFFERS; ++i)
+            barriers[i] = { pPreprocessBuffers[i], states[i], RESOURCE_STATE_COPY_SOURCE };
+        cmdResourceBarrier(cmd, SPLAT_PREPROCESS_NUM_BUFFERS, barriers, 0, NULL, 0, NULL);
+        for (uint32_t i = 0; i < SPLAT_PREPROCESS_NUM_BUFFERS; ++i)
+        {
+            cmdUpdateBuffer(cmd, pPreprocessReadback[i], 0, pPreprocessBuffers[i], 0, sizes[i]);
+            barriers[i] = { pPreprocessBuffers[i], RESOURCE_STATE_COPY_SOURCE, states[i] };
+        }
+        cmdResourceBarrier(cmd, SPLAT_PREPROCESS_NUM_BUFFERS, barriers, 0, NULL, 0, NULL);
+
+        gPreprocessCheckBlock = gPreprocessData;
+        gPreprocessCheckSceneSet = gSceneSet;
+        gPreprocessCheckSlot = gFrameIndex;
+    }
+
+    // Compares the read back outputs of the preprocess pass with the CPU twin, see gSplatPreprocessCheckInterval.
+    void checkPreprocessReadback()
+    {
+        gPreprocessCheckSlot = UINT32_MAX;
+        if (gPreprocessCheckSceneSet != gSceneSet)
+            return; // read back from a scene swapped out since
+        gFrameMayAllocate = true;
+
+        const SplatPreprocessBlock* block = &gPreprocessCheckBlock;
+        const uint32_t              numSplats = block->mParams[0];
+        SplatGpuSplat*              splats = (SplatGpuSplat*)splatMalloc(sizeof(SplatGpuSplat) * numSplats);
+        const uint32_t              numWords = splatGpuShRestWords(block->mParams[2]);
+        uint32_t*                   shWords = (uint32_t*)splatMalloc(sizeof(uint32_t) * numWords * numSplats);
+        float*                      shTable = (float*)splatMalloc(sizeof(float) * splatGpuShRestTableSize(&gSplatQuantized));
+        SplatPreprocessRecord*      records = (SplatPreprocessRecord*)splatMalloc(sizeof(SplatPreprocessRecord) * numSplats);
+        uint32_t*                   visible = (uint32_t*)splatMalloc(sizeof(uint32_t) * numSplats);
+        uint32_t*                   keys = (uint32_t*)splatMalloc(sizeof(uint32_t) * numSplats);
+        // the inputs as the uploads laid them out
+        const bool compressed = block->mParams[2] != SPLAT_GPU_SH_REST_F32;
+        splatPackGpuSplats(&gSceneStreams, 0, numSplats, splats, compressed ? NULL : (SplatGpuShRest*)shWords);
+        if (compressed)
+            splatPackGpuShRest(&gSplatQuantized, 0, numSplats, shWords);
+        splatPackGpuShRestTable(&gSplatQuantized, shTable);
+        const SplatGpuShRestInput shRest = { shWords, shTable };
+        const uint32_t            numVisible = splatPreprocess(block, splats, &shRest, records, visible, keys);
+        splatPreprocessSort(numSplats, numVisible, visible, keys);
+
+        Buffer**                       readback = pPreprocessReadback;
+        const SplatPreprocessRecord*   gpuRecords = (const SplatPreprocessRecord*)readback[SPLAT_PREPROCESS_RECORDS]->pCpuMappedAddress;
+        const uint32_t*                gpuVisible = (const uint32_t*)readback[SPLAT_PREPROCESS_VISIBLE]->pCpuMappedAddress;
+        const uint32_t*                gpuKeys = (const uint32_t*)readback[SPLAT_PREPROCESS_KEYS]->pCpuMappedAddress;
+        const SplatPreprocessDrawArgs* gpuArgs = (const SplatPreprocessDrawArgs*)readback[SPLAT_PREPROCESS_DRAW_ARGS]->pCpuMappedAddress;
+        const SplatPreprocessDispatchArgs* gpuSortArgs =
+            (const SplatPreprocessDispatchArgs*)readback[SPLAT_PREPROCESS_SORT_ARGS]->pCpuMappedAddress;
+        const uint64_t recordMismatches = splatPreprocessCountMismatches(records, gpuRecords, numSplats);
+        // the sort steps recorded for the scene, sized from the count the GPU appended
+        SplatPreprocessSortStep steps[SPLAT_PREPROCESS_SORT_MAX_STEPS];
+        uint32_t                numSortThreads = 0;
+        const uint32_t          numSortSteps = splatPreprocessSortSteps(numSplats, steps, &numSortThreads);
+        uint32_t                sortArgsMismatches = 0;
+        for (uint32_t i = 0; i < numSortSteps; ++i)
+        {
+            SplatPreprocessDispatchArgs args;
+            splatPreprocessSortArgs(gpuArgs->mInstanceCount, i, &args);
+            sortArgsMismatches += memcmp(&args, &gpuSortArgs[i], sizeof(args)) ? 1 : 0;
+        }
+        // the lists are compared as far as both go
+        const uint32_t numCompared = gpuArgs->mInstanceCount < numVisible ? gpuArgs->mInstanceCount : numVisible;
+        uint64_t       orderMismatches = 0;
+        for (uint32_t i = 0; i < numCompared; ++i)
+            orderMismatches += gpuVisible[i] != visible[i] || gpuKeys[i] != keys[i] ? 1 : 0;
+        if (recordMismatches || orderMismatches || sortArgsMismatches || gpuArgs->mInstanceCount != numVisible)
+        {
+            LOGF(eERROR,
+                 "Preprocess check: %llu of %u records, %llu of %u sorted entries and %u of %u sort dispatches differ from the twin, "
+                 "%u visible on the GPU, %u on the CPU",
+                 (unsigned long long)recordMismatches, numSplats, (unsigned long long)orderMismatches, numCompared, sortArgsMismatches,
+                 numSortSteps, gpuArgs->mInstanceCount, numVisible);
+        }
+        else
+            LOGF(eINFO, "Preprocess check: %u records and %u sorted entries match the twin", numSplats, numVisible);
+
+        splatFree(splats);
+        splatFree(shWords);
+        splatFree(shTable);
+        splatFree(records);
+        splatFree(visible);
+        splatFree(keys);
+    }
+
+    void removePreprocessReadback()
+    {
+        for (uint32_t i = 0; i < SPLAT_PREPROCESS_NUM_BUFFERS; ++i)
+        {
+            if (pPreprocessReadback[i])
+                removeResource(pPreprocessReadback[i]);
+            pPreprocessReadback[i] = NULL;
+        }
+        gPreprocessReadbackCapacity = 0;
+        gPreprocessCheckSlot = UINT32_MAX;
+    }
+
+    // Renders the current view with the CPU reference rasterizer and writes it to the screenshot directory.
+    void referenceRender(const mat4& viewMat, float horizontalFov)
+    {
+        SplatCamera camera = {};
+        splatCameraFromView(viewMat, horizontalFov, &camera);
+
+        SplatRasterStats stats = {};
+        gReferenceRasterizer.mShDegree = gShDegree;
+        gReferenceRasterizer.pCovariances = &gSceneCovariances;
+        if (!splatRasterize(&gJobSystem, &gReferenceRasterizer, &camera, mNumOfPoints, &gSceneStreams, &stats))
+            return;
+        LOGF(eINFO,
+             "Reference render: %llu visible splats, %llu tile pairs, cull %.2f ms, project %.2f ms, SH %.2f ms, bin %.2f ms, "
+             "sort %.2f ms, blend %.2f ms on %u workers",
+             (unsigned long long)stats.mNumVisible, (unsigned long long)stats.mNumTilePairs, stats.mCullUs / 1000.0f,
+             stats.mProjectUs / 1000.0f, stats.mShUs / 1000.0f, stats.mBinUs / 1000.0f, stats.mSortUs / 1000.0f, stats.mBlendUs / 1000.0f,
+             stats.mJobs.mNumWorkers);
+        const float blendImbalance = stats.mBlendMeanThreadUs ? (float)stats.mBlendMaxThreadUs / stats.mBlendMeanThreadUs : 1.0f;
+        LOGF(eINFO, "Reference render blend: %u jobs, %u split tiles, heaviest tile %u pairs, thread max %.2f ms, mean %.2f ms (%.2fx)",
+             stats.mNumBlendJobs, stats.mNumSplitTiles, stats.mMaxTilePairs, stats.mBlendMaxThreadUs / 1000.0f,
+             stats.mBlendMeanThreadUs / 1000.0f, blendImbalance);
+        splatWriteImage(RD_SCREENSHOTS, "ReferenceRender.png", camera.mWidth, camera.mHeight, gReferenceRasterizer.pImage);
+        splatWriteImage(RD_SCREENSHOTS, "ReferenceRender.exr", camera.mWidth, camera.mHeight, gReferenceRasterizer.pImage);
+    }
+
+    // Creates the vertex buffers for numVertices splats and merged nodes, indexed by SplatUploadBuffer. The
+    // pass reads the SH above the dc band in the layout of quantized, which may be NULL for floats.
+    void addSplatVertexBuffers(uint64_t numVertices, const SplatQuantized* quantized, Buffer** ppBuffers)
+    {
+        if (gPreprocessActive)
+        {
+            // 48 byte records in uint4s, the SH above the dc band apart since degree 0 never reads it
+            BufferLoadDesc bufferDesc = {};
+            bufferDesc.mDesc.pName = "SplatBuffer";
+            bufferDesc.mDesc.mDescriptors = DESCRIPTOR_TYPE_BUFFER;
+            bufferDesc.mDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_GPU_ONLY;
+            bufferDesc.mDesc.mStartState = RESOURCE_STATE_SHADER_RESOURCE;
+            bufferDesc.mDesc.mSize = sizeof(SplatGpuSplat) * numVertices;
+            bufferDesc.mDesc.mFormat = TinyImageFormat_R32G32B32A32_UINT;
+            bufferDesc.mDesc.mElementCount = numVertices * SPLAT_GPU_SPLAT_VECTORS;
+            bufferDesc.mDesc.mStructStride = sizeof(uint32_t) * 4;
+            bufferDesc.ppBuffer = &ppBuffers[SPLAT_UPLOAD_SPLATS];
+            addResource(&bufferDesc, NULL);
+
+            const uint32_t encoding = quantized ? splatGpuShRestEncoding(quantized) : SPLAT_GPU_SH_REST_F32;
+            const uint32_t numWords = splatGpuShRestWords(encoding);
+            bufferDesc.mDesc.pName = "ShRestBuffer";
+            bufferDesc.mDesc.mSize = sizeof(uint32_t) * numWords * numVertices;
+            bufferDesc.mDesc.mFormat = TinyImageFormat_R32_UINT;
+            bufferDesc.mDesc.mElementCount = numVertices * numWords;
+            bufferDesc.mDesc.mStructStride = sizeof(uint32_t);
+            bufferDesc.ppBuffer = &ppBuffers[SPLAT_UPLOAD_SHS];
+            addResource(&bufferDesc, NULL);
+
+            // the table is copied out before addResource returns
+            const uint64_t tableSize = quantized ? splatGpuShRestTableSize(quantized) : 1;
+            float*         table = (float*)splatMalloc(sizeof(float) * tableSize);
+            if (quantized)
+                splatPackGpuShRestTable(quantized, table);
+            else
+                table[0] = 0.0f;
+            bufferDesc.mDesc.pName = "ShTableBuffer";
+            bufferDesc.mDesc.mSize = sizeof(float) * tableSize;
+            bufferDesc.mDesc.mFormat = TinyImageFormat_R32_SFLOAT;
+            bufferDesc.mDesc.mElementCount = tableSize;
+            bufferDesc.mDesc.mStructStride = sizeof(float);
+            bufferDesc.pData = table;
+            bufferDesc.ppBuffer = &ppBuffers[SPLAT_UPLOAD_SH_TABLE];
+            addResource(&bufferDesc, NULL);
+            splatFree(table);
+            return;
+        }
+
+        // the SH compute pass reads positions and coefficients and writes colors as float buffers
+        const bool shEvalGpu = gShEvalMode == SH_EVAL_GPU;
+        {
+            BufferLoadDesc positionVbDesc = {};
+            positionVbDesc.mDesc.mDescriptors =
+                shEvalGpu ? (DescriptorType)(DESCRIPTOR_TYPE_VERTEX_BUFFER | DESCRIPTOR_TYPE_BUFFER) : DESCRIPTOR_TYPE_VERTEX_BUFFER;
+            positionVbDesc.mDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_GPU_ONLY;
+            positionVbDesc.mDesc.mSize = sizeof(struct Tf32x3_s) * numVertices;
+            positionVbDesc.mDesc.mFormat = TinyImageFormat_R32_SFLOAT;
+            positionVbDesc.mDesc.mElementCount = numVertices * 3;
+            positionVbDesc.mDesc.mStructStride = sizeof(float);
+            positionVbDesc.ppBuffer = &ppBuffers[SPLAT_UPLOAD_POSITIONS];
+            addResource(&positionVbDesc, NULL);
+        }
+        {
+            BufferLoadDesc positionShDesc = {};
+            positionShDesc.mDesc.mDescriptors =
+                shEvalGpu ? (DescriptorType)(DESCRIPTOR_TYPE_VERTEX_BUFFER | DESCRIPTOR_TYPE_BUFFER) : DESCRIPTOR_TYPE_VERTEX_BUFFER;
+            positionShDesc.mDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_GPU_ONLY;
+            positionShDesc.mDesc.mSize = sizeof(struct SphericalHarmonics)* numVertices;
+            positionShDesc.mDesc.mFormat = TinyImageFormat_R32_SFLOAT;
+            positionShDesc.mDesc.mElementCount = numVertices * (sizeof(struct SphericalHarmonics) / sizeof(float));
+            positionShDesc.mDesc.mStructStride = sizeof(float);
+            positionShDesc.ppBuffer = &ppBuffers[SPLAT_UPLOAD_SHS];
+            addResource(&positionShDesc, NULL);
+        }
+        {
+            BufferLoadDesc colorVbDesc = {};
+            colorVbDesc.mDesc.mDescriptors =
+                shEvalGpu ? (DescriptorType)(DESCRIPTOR_TYPE_VERTEX_BUFFER | DESCRIPTOR_TYPE_RW_BUFFER) : DESCRIPTOR_TYPE_VERTEX_BUFFER;
+            colorVbDesc.mDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_GPU_ONLY;
+            colorVbDesc.mDesc.mSize = sizeof(struct Tf32x3_s) * numVertices;
+            colorVbDesc.mDesc.mFormat = TinyImageFormat_R32_SFLOAT;
+            colorVbDesc.mDesc.mElementCount = numVertices * 3;
+            colorVbDesc.mDesc.mStructStride = sizeof(float);
+            colorVbDesc.ppBuffer = &ppBuffers[SPLAT_UPLOAD_COLORS];
+            addResource(&colorVbDesc, NULL);
+        }
+    }
+
+    // Creates the outputs of the preprocess pass for numSplats splats, indexed by SplatPreprocessBuffer.
+    void addPreprocessBuffers(uint64_t numSplats, Buffer** ppBuffers)
+    {
+        // written by the pass, read by the quad draw, the sort arguments by the sort
+        const uint32_t elementCounts[SPLAT_PREPROCESS_NUM_BUFFERS] = {
+            (uint32_t)numSplats * SPLAT_PREPROCESS_RECORD_FLOATS, (uint32_t)numSplats, (uint32_t)numSplats,
+            sizeof(SplatPreprocessDrawArgs) / sizeof(uint32_t),
+            SPLAT_PREPROCESS_SORT_MAX_STEPS * sizeof(SplatPreprocessDispatchArgs) / sizeof(uint32_t)
+        };
+        const char*    names[SPLAT_PREPROCESS_NUM_BUFFERS] = { "PreprocessRecords", "PreprocessVisible", "PreprocessKeys",
+                                                            "PreprocessDrawArgs", "PreprocessSortArgs" };
+        for (uint32_t i = 0; i < SPLAT_PREPROCESS_NUM_BUFFERS; ++i)
+        {
+            const bool     indirectArgs = i == SPLAT_PREPROCESS_DRAW_ARGS || i == SPLAT_PREPROCESS_SORT_ARGS;
+            BufferLoadDesc bufferDesc = {};
+            bufferDesc.mDesc.pName = names[i];
+            bufferDesc.mDesc.mDescriptors = (DescriptorType)(DESCRIPTOR_TYPE_RW_BUFFER | DESCRIPTOR_TYPE_BUFFER |
+                                                             (indirectArgs ? DESCRIPTOR_TYPE_INDIRECT_ARGUMENT : 0));
+            bufferDesc.mDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_GPU_ONLY;
+            bufferDesc.mDesc.mStartState = indirectArgs ? RESOURCE_STATE_INDIRECT_ARGUMENT : RESOURCE_STATE_SHADER_RESOURCE;
+            bufferDesc.mDesc.mSize = sizeof(uint32_t) * (uint64_t)elementCounts[i];
+            bufferDesc.mDesc.mFormat = i == SPLAT_PREPROCESS_RECORDS ? TinyImageFormat_R32_SFLOAT : TinyImageFormat_R32_UINT;
+            bufferDesc.mDesc.mElementCount = elementCounts[i];
+            bufferDesc.mDesc.mStructStride = sizeof(uint32_t);
+            bufferDesc.ppBuffer = &ppBuffers[i];
+            addResource(&bufferDesc, NULL);
+        }
+    }
+
+    // Load settings of a whole scene, from the configuration above.
+    void sceneDescFromConfig(SplatSceneDesc* desc)
+    {
+        *desc = {};
+        desc->mSourceDir = RD_OTHER_FILES;
+        desc->mCacheDir = RD_DEBUG;
+        desc->mUseCache = gSplatCacheEnabled;
+        desc->mPrune = gSplatPruneEnabled;
+        splatPruneDescDefaults(&desc->mPruneDesc);
+        desc->mMortonOrder = gSplatMortonOrderEnabled;
+        desc->mMortonWideCodes = gSplatMortonWideCodes;
+        desc->mProgressiveOrder = gSplatProgressiveLoadEnabled;
+        desc->mQuality = gSplatQuality;
+        // only the reference rasterizer reads them, it needs the system copy
+        desc->mCovarianceMode = gSplatKeepSystemCopy ? gSplatCovarianceMode : SPLAT_COVARIANCE_ON_THE_FLY;
+        desc->mLod = gSplatLodEnabled;
+        // the LOD cut and the preprocess pass replace the BVH cull
+        desc->mBvh = gFrustumCullEnabled && !gSplatLodEnabled && !gPreprocessActive;
+        desc->pDecodeFallback = plyDecodeSceneFallback;
+    }
+
+    bool loadSplatScene(const char* path)
+    {
+        SplatSceneDesc desc;
+        sceneDescFromConfig(&desc);
+        SplatScene scene = {};
+        if (!splatSceneLoad(gThreadSystem, path, &desc, &scene))
+            return false;
+
+        // merged LOD nodes follow the splats in the vertex buffers
+        Buffer* vertexBuffers[SPLAT_UPLOAD_NUM_BUFFERS] = {};
+        addSplatVertexBuffers(scene.mNumSplats + scene.mLod.mNumMerged, &scene.mQuantized, vertexBuffers);
+        uploadSplatRange(vertexBuffers, 0, &scene.mStreams, &scene.mQuantized, 0, scene.mNumSplats, NULL);
+        if (scene.mLod.mNumMerged)
+            uploadSplatRange(vertexBuffers, scene.mNumSplats, &scene.mLod.mMerged, NULL, 0, scene.mLod.mNumMerged, NULL);
+        setActiveVertexBuffers(vertexBuffers);
+        adoptScene(&scene);
+        return true;
+    }
+
+    // The globals take over the allocations of scene.
+    void adoptScene(SplatScene* scene)
+    {
+        mNumOfPoints = scene->mNumSplats;
+        gSceneStreams = scene->mStreams;
+        gSceneLod = scene->mLod;
+        gSplatQuantized = scene->mQuantized;
+        gSceneBvh = scene->mBvh;
+        gSceneCovariances = scene->mCovariances;
+        if (!gSplatKeepSystemCopy)
+            splatFreeStreams(&gSceneStreams);
+        *scene = {};
+    }
+
+    // Moves the active scene out of the globals.
+    void releaseActiveScene(SplatScene* outScene)
+    {
+        outScene->mNumSplats = mNumOfPoints;
+        outScene->mStreams = gSceneStreams;
+        outScene->mLod = gSceneLod;
+        outScene->mQuantized = gSplatQuantized;
+        outScene->mBvh = gSceneBvh;
+        outScene->mCovariances = gSceneCovariances;
+        gSceneStreams = {};
+        gSceneLod = {};
+        gSplatQuantized = {};
+        gSceneBvh = {};
+        gSceneCovariances = {};
+    }
+
+    void setActiveVertexBuffers(Buffer* const* vertexBuffers)
+    {
+        pSplatBuffer = vertexBuffers[SPLAT_UPLOAD_SPLATS];
+        pShsBuffer = vertexBuffers[SPLAT_UPLOAD_SHS];
+        pPositionBuffer = vertexBuffers[SPLAT_UPLOAD_POSITIONS];
+        pColorBuffer = vertexBuffers[SPLAT_UPLOAD_COLORS];
+        pShTableBuffer = vertexBuffers[SPLAT_UPLOAD_SH_TABLE];
+    }
+
+    void getActiveSceneBuffers(SceneBuffers* outBuffers)
+    {
+        outBuffers->pVertexBuffers[SPLAT_UPLOAD_SPLATS] = pSplatBuffer;
+        outBuffers->pVertexBuffers[SPLAT_UPLOAD_SHS] = pShsBuffer;
+        outBuffers->pVertexBuffers[SPLAT_UPLOAD_POSITIONS] = pPositionBuffer;
+        outBuffers->pVertexBuffers[SPLAT_UPLOAD_COLORS] = pColorBuffer;
+        outBuffers->pVertexBuffers[SPLAT_UPLOAD_SH_TABLE] = pShTableBuffer;
+        for (uint32_t i = 0; i < gDataBufferCount; ++i)
+        {
+            outBuffers->pIndexBuffers[i] = pSplatIndexBuffer[i];
+            outBuffers->pShColorBuffers[i] = pShColorBuffer[i];
+        }
+        for (uint32_t i = 0; i < SPLAT_PREPROCESS_NUM_BUFFERS; ++i)
+            outBuffers->pPreprocessBuffers[i] = pPreprocessBuffers[i];
+    }
+
+    void setActiveSceneBuffers(const SceneBuffers* buffers)
+    {
+        setActiveVertexBuffers(buffers->pVertexBuffers);
+        for (uint32_t i = 0; i < gDataBufferCount; ++i)
+        {
+            pSplatIndexBuffer[i] = buffers->pIndexBuffers[i];
+            pShColorBuffer[i] = buffers->pShColorBuffers[i];
+        }
+        for (uint32_t i = 0; i < SPLAT_PREPROCESS_NUM_BUFFERS; ++i)
+            pPreprocessBuffers[i] = buffers->pPreprocessBuffers[i];
+    }
+
+    void removeSceneBuffers(SceneBuffers* buffers)
+    {
+        for (uint32_t i = 0; i < SPLAT_UPLOAD_NUM_BUFFERS; ++i)
+        {
+            if (buffers->pVertexBuffers[i])
+                removeResource(buffers->pVertexBuffers[i]);
+        }
+        for (uint32_t i = 0; i < gDataBufferCount; ++i)
+        {
+            if (buffers->pIndexBuffers[i])
+                removeResource(buffers->pIndexBuffers[i]);
+            if (buffers->pShColorBuffers[i])
+                removeResource(buffers->pShColorBuffers[i]);
+        }
+        for (uint32_t i = 0; i < SPLAT_PREPROCESS_NUM_BUFFERS; ++i)
+        {
+            if (buffers->pPreprocessBuffers[i])
+                removeResource(buffers->pPreprocessBuffers[i]);
+        }
+        *buffers = {};
+    }
+
+    // Per frame buffers sized for numNodes splats and merged nodes: the colors
+    // the CPU SH evaluation writes and the draw indices.
+    void addSceneFrameBuffers(uint64_t numNodes, bool shColors, bool indices, Buffer** ppShColorBuffers, Buffer** ppIndexBuffers)
+    {
+        if (shColors)
+        {
+            // written by the CPU while older frames draw the other copy
+            BufferLoadDesc vbDesc = {};
+            vbDesc.mDesc.pName = "ShColorBuffer";
+            vbDesc.mDesc.mDescriptors = DESCRIPTOR_TYPE_VERTEX_BUFFER;
+            vbDesc.mDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_CPU_TO_GPU;
+            vbDesc.mDesc.mFlags = BUFFER_CREATION_FLAG_PERSISTENT_MAP_BIT;
+            vbDesc.mDesc.mSize = sizeof(struct Tf32x3_s) * numNodes;
+            for (uint32_t i = 0; i < gDataBufferCount; ++i)
+            {
+                vbDesc.ppBuffer = &ppShColorBuffers[i];
+                addResource(&vbDesc, NULL);
+            }
+        }
+        if (indices)
+        {
+            BufferLoadDesc ibDesc = {};
+            ibDesc.mDesc.mDescriptors = DESCRIPTOR_TYPE_INDEX_BUFFER;
+            ibDesc.mDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_CPU_TO_GPU;
+            ibDesc.mDesc.mFlags = BUFFER_CREATION_FLAG_PERSISTENT_MAP_BIT;
+            ibDesc.mDesc.mSize = sizeof(uint32_t) * numNodes;
+            ibDesc.pData = NULL;
+            for (uint32_t i = 0; i < gDataBufferCount; ++i)
+            {
+                ibDesc.mDesc.pName = "SortedIndexBuffer";
+                ibDesc.ppBuffer = &ppIndexBuffers[i];
+                addResource(&ibDesc, NULL);
+            }
+        }
+    }
+
+    void initSceneAcceleration()
+    {
+        if (gLodActive)
+        {
+            // sized for the whole hierarchy so a growing cut does not allocate mid frame
+            splatSortScratchInit(&gLodSortScratch);
+            splatSortScratchReserve(&gLodSortScratch, mNumOfPoints + gSceneLod.mNumMerged);
+        }
+        // the preprocess pass sorts its visible list on the GPU
+        gDepthSorterActive = gDepthSortEnabled && !gLodActive && !gPreprocessActive && gSceneStreams.pPositions;
+        if (gDepthSorterActive)
+            splatDepthSorterInit(&gDepthSorter, gThreadSystem, mNumOfPoints, gSceneStreams.pPositions);
+        gFrustumCullActive = gFrustumCullEnabled && !gLodActive && !gPreprocessActive && gSceneStreams.pPositions;
+        if (gFrustumCullActive)
+        {
+            // a scene load builds it on its worker, a progressive load here once complete
+            if (!gSceneBvh.mNumNodes)
+            {
+                SplatBvhBuildStats bvhStats = {};
+                splatBvhBuild(gThreadSystem, mNumOfPoints, &gSceneStreams, &gSceneBvh, &bvhStats);
+                LOGF(eINFO, "Splat BVH: %llu nodes, morton %.2f ms, leaves %.2f ms, nodes %.2f ms", (unsigned long long)gSceneBvh.mNumNodes,
+                     bvhStats.mMortonUs / 1000.0f, bvhStats.mLeavesUs / 1000.0f, bvhStats.mNodesUs / 1000.0f);
+            }
+            pVisibleSplats = (uint32_t*)splatMalloc(sizeof(uint32_t) * mNumOfPoints);
+            pVisibleMask = (uint8_t*)splatCalloc(mNumOfPoints, sizeof(uint8_t));
+        }
+        // the CPU path evaluates from the system copy
+        gShEvalActive = gShEvalGpu || (gShEvalMode == SH_EVAL_CPU && !gStreamingActive && !gPreprocessActive && gSceneStreams.pPositions);
+        if (gShEvalActive && !gShEvalGpu)
+        {
+            splatShCacheInit(&gShCache, gSceneStreams.pPositions, mNumOfPoints);
+            if (gLodActive)
+                splatShCacheInit(&gShMergedCache, gSceneLod.mMerged.pPositions, gSceneLod.mNumMerged);
+            pShColors = (Tf32x3_s*)splatMalloc(sizeof(Tf32x3_s) * (mNumOfPoints + (gLodActive ? gSceneLod.mNumMerged : 0)));
+        }
+    }
+
+    // Copies the colors of the clusters evaluated since the buffer was last written.
+    void syncShColors(const SplatShCache* cache, Tf32x3_s* colors, uint64_t offset, uint64_t* stamp)
+    {
+        uint64_t cluster = 0;
+        while (cluster < cache->mNumClusters)
+        {
+            if (cache->pEvalFrames[cluster] <= *stamp)
+            {
+                cluster++;
+                continue;
+            }
+            uint64_t end = cluster + 1;
+            while (end < cache->mNumClusters && cache->pEvalFrames[end] > *stamp)
+                end++;
+            const uint64_t first = cluster * SPLAT_SH_CLUSTER_SIZE;
+            const uint64_t last = end * SPLAT_SH_CLUSTER_SIZE < cache->mNumSplats ? end * SPLAT_SH_CLUSTER_SIZE : cache->mNumSplats;
+            memcpy(colors + offset + first, pShColors + offset + first, sizeof(Tf32x3_s) * (last - first));
+            cluster = end;
+        }
+        *stamp = cache->mFrame;
+    }
+
+    // Time to first frame and time to full quality, from the start of Init to
+    // the first frame drawing any splat and the first drawing the whole scene.
+    void recordLoadTimes(uint64_t numDrawn)
+    {
+        if (gTimeToFullQualityUs || !numDrawn)
+            return;
+        const int64_t elapsedUs = getUSec(false) - gInitStartUs;
+        if (!gTimeToFirstFrameUs)
+        {
+            gTimeToFirstFrameUs = elapsedUs;
+            LOGF(eINFO, "Time to first frame: %.2f ms, %llu splats", gTimeToFirstFrameUs / 1000.0f, (unsigned long long)numDrawn);
+        }
+        if (!gProgressiveLoadActive)
+        {
+            gTimeToFullQualityUs = elapsedUs;
+            LOGF(eINFO, "Time to full quality: %.2f ms", gTimeToFullQualityUs / 1000.0f);
+        }
+        bformat(&gLoadStats, "Load: first frame %.2f ms, full quality %.2f ms\n", gTimeToFirstFrameUs / 1000.0f,
+                gTimeToFullQualityUs / 1000.0f);
+    }
+
+    bool startProgressiveLoad(const char* path)
+    {
+        FileStream fh = {};
+        if (!gSplatCacheEnabled || !fsOpenStreamFromPath(RD_OTHER_FILES, path, FM_READ, &fh))
+            return false;
+        char cachePath[FS_MAX_PATH] = {};
+        splatCacheMakePath(path, cachePath, sizeof(cachePath));
+        SplatSceneDesc desc;
+        sceneDescFromConfig(&desc);
+        const uint64_t sourceHash = splatSceneCacheHash(RD_OTHER_FILES, path, &fh, &desc);
+        fsCloseStream(&fh);
+        struct SplatCache cache = {};
+        if (!splatCacheOpen(RD_DEBUG, cachePath, sourceHash, &cache))
+            return false;
+        if (!(cache.mHeader.mFlags & SPLAT_CACHE_FLAG_PROGRESSIVE_ORDER))
+        {
+            // the synchronous load rewrites the cache coarse to fine for the next launch
+            splatCacheClose(&cache);
+            return false;
+        }
+
+        mNumOfPoints = cache.mHeader.mNumSplats;
+        Buffer* vertexBuffers[SPLAT_UPLOAD_NUM_BUFFERS] = {};
+        addSplatVertexBuffers(mNumOfPoints, NULL, vertexBuffers);
+        setActiveVertexBuffers(vertexBuffers);
+        splatFreeStreams(&gSceneStreams);
+        splatCovariancesFree(&gSceneCovariances);
+        splatAllocStreams(&gSceneStreams, mNumOfPoints);
+        gProgressiveUploaded = 0;
+        gProgressiveDrawable = 0;
+        gProgressiveToken = {};
+        splatProgressiveLoaderStart(&gProgressiveLoader, gThreadSystem, &cache, &gSceneStreams, gSplatProgressiveBatchSplats);
+        gProgressiveLoadActive = true;
+        return true;
+    }
+
+    // Copies count splats of src from first on to the vertex buffers, from dstFirst on: packed for the preprocess
+    // pass, the SH above the dc band from quantized when it is not NULL and holds a compressed copy, as streams
+    // for the point draw. pToken, if not NULL, completes once the copies have landed.
+    void uploadSplatRange(Buffer* const* vertexBuffers, uint64_t dstFirst, const SplatStreams* src, const SplatQuantized* quantized,
+                          uint64_t first, uint64_t count, SyncToken* pToken)
+    {
+        const uint32_t encoding = quantized ? splatGpuShRestEncoding(quantized) : SPLAT_GPU_SH_REST_F32;
+        const uint64_t shSize = gPreprocessActive ? sizeof(uint32_t) * splatGpuShRestWords(encoding) : sizeof(struct SphericalHarmonics);
+        // the table is written when the buffer is created
+        const uint64_t   elementSizes[SPLAT_UPLOAD_NUM_BUFFERS] = { sizeof(SplatGpuSplat), shSize, sizeof(struct Tf32x3_s),
+                                                                    sizeof(struct Tf32x3_s), 0 };
+        BufferUpdateDesc updateDescs[SPLAT_UPLOAD_NUM_BUFFERS] = {};
+        for (uint32_t i = 0; i < SPLAT_UPLOAD_NUM_BUFFERS; i++)
+        {
+            if (!vertexBuffers[i] || !elementSizes[i])
+                continue;
+            updateDescs[i] = { vertexBuffers[i], dstFirst * elementSizes[i], count * elementSizes[i] };
+            beginUpdateResource(&updateDescs[i]);
+        }
+
+        if (gPreprocessActive)
+        {
+            const bool compressed = encoding != SPLAT_GPU_SH_REST_F32;
+            splatPackGpuSplats(src, first, count, (SplatGpuSplat*)updateDescs[SPLAT_UPLOAD_SPLATS].pMappedData,
+                               compressed ? NULL : (SplatGpuShRest*)updateDescs[SPLAT_UPLOAD_SHS].pMappedData);
+            if (compressed)
+                splatPackGpuShRest(quantized, first, count, (uint32_t*)updateDescs[SPLAT_UPLOAD_SHS].pMappedData);
+        }
+        else
+        {
+            struct SplatStreams uploadStreams = {};
+            uploadStreams.pPositions = (struct Tf32x3_s*)updateDescs[SPLAT_UPLOAD_POSITIONS].pMappedData;
+            uploadStreams.pColors = (struct Tf32x3_s*)updateDescs[SPLAT_UPLOAD_COLORS].pMappedData;
+            uploadStreams.pShs = (struct SphericalHarmonics*)updateDescs[SPLAT_UPLOAD_SHS].pMappedData;
+            struct SplatStreams batchStreams = {};
+            batchStreams.pPositions = src->pPositions + first;
+            batchStreams.pColors = src->pColors ? src->pColors + first : NULL;
+            batchStreams.pShs = src->pShs + first;
+            splatCopyStreams(&uploadStreams, &batchStreams, 0, count);
+        }
+
+        for (uint32_t i = 0; i < SPLAT_UPLOAD_NUM_BUFFERS; i++)
+        {
+            if (vertexBuffers[i] && elementSizes[i])
+                endUpdateResource(&updateDescs[i], pToken);
+        }
+    }
+
+    void updateProgressiveLoad()
+    {
+        // batches are drawn once the token of their copies completes, the frame never waits on the loader; the
+        // next ones are submitted only then so the token covers every batch in flight
+        if (gProgressiveUploaded > gProgressiveDrawable && isTokenCompleted(&gProgressiveToken))
+            gProgressiveDrawable = gProgressiveUploaded;
+
+        const bool     finished = splatProgressiveLoaderFinished(&gProgressiveLoader);
+        const uint64_t numLoaded = splatProgressiveLoaderLoaded(&gProgressiveLoader);
+        const bool     landed = gProgressiveUploaded == gProgressiveDrawable;
+        const int64_t  startUs = getUSec(false);
+        while (landed && gProgressiveUploaded < numLoaded && getUSec(false) - startUs < gSplatProgressiveUploadUsPerFrame)
+        {
+            const uint64_t count = numLoaded - gProgressiveUploaded < gSplatProgressiveBatchSplats ? numLoaded - gProgressiveUploaded
+                                                                                                   : gSplatProgressiveBatchSplats;
+            Buffer* const vertexBuffers[SPLAT_UPLOAD_NUM_BUFFERS] = { pSplatBuffer, pShsBuffer, pPositionBuffer, pColorBuffer,
+                                                                      pShTableBuffer };
+            uploadSplatRange(vertexBuffers, gProgressiveUploaded, &gSceneStreams, NULL, gProgressiveUploaded, count, &gProgressiveToken);
+            gProgressiveUploaded += count;
+        }
+        bformat(&gLoadStats, "Load: %llu of %llu splats drawn, %llu read, first frame %.2f ms\n", (unsigned long long)gProgressiveDrawable,
+                (unsigned long long)mNumOfPoints, (unsigned long long)numLoaded, gTimeToFirstFrameUs / 1000.0f);
+
+        if (finished && gProgressiveDrawable == numLoaded)
+        {
+            LOGF(eINFO, "Splat progressive load: %llu splats read in %.2f ms", (unsigned long long)numLoaded,
+                 gProgressiveLoader.mDurationUs / 1000.0f);
+            // a failed read leaves the prefix that arrived
+            mNumOfPoints = numLoaded;
+            splatProgressiveLoaderExit(&gProgressiveLoader);
+            gProgressiveLoadActive = false;
+            initSceneAcceleration();
+        }
+    }
+
+    // Starts loading the scene at path on a worker, it replaces the current
+    // one at the start of a frame once uploaded, see updateSceneSwap. One swap
+    // at a time, the streamed and the progressive scenes are not replaced.
+    bool requestSceneLoad(const char* path)
+    {
+        if (gStreamingActive || gProgressiveLoadActive || gSceneSwapState != SCENE_SWAP_IDLE || gRetiredSceneFrames)
+        {
+            LOGF(eWARNING, "Scene load of %s ignored, the current scene is still loading or swapping.", path);
+            return false;
+        }
+        SplatSceneDesc desc;
+        sceneDescFromConfig(&desc);
+        splatSceneLoaderStart(&gSceneLoader, gThreadSystem, path, &desc);
+        gSceneSwapState = SCENE_SWAP_LOADING;
+        gSceneSwapStartUs = getUSec(false);
+        gFrameMayAllocate = true;
+        bformat(&gSceneStats, "Scene: loading %s\n", path);
+        return true;
+    }
+
+    // Advances a scene swap, at the start of Update before the frame looks at the scene.
+    void updateSceneSwap()
+    {
+        if (gRetiredSceneFrames && --gRetiredSceneFrames == 0)
+        {
+            // the last frame drawing the retired scene is done
+            removeSceneBuffers(&gRetiredSceneBuffers);
+            splatSceneFree(&gRetiredScene);
+            gFrameMayAllocate = true;
+        }
+
+        if (gSceneSwapState == SCENE_SWAP_LOADING && splatSceneLoaderFinished(&gSceneLoader))
+        {
+            if (!splatSceneLoaderTake(&gSceneLoader, &gNextScene) || !gNextScene.mNumSplats)
+            {
+                LOGF(eERROR, "Failed to load scene %s, keeping the current one.", gSceneLoader.mPath);
+                bformat(&gSceneStats, "Scene: %s failed to load\n", gSceneLoader.mPath);
+                splatSceneFree(&gNextScene);
+                gFrameMayAllocate = true;
+                gSceneSwapState = SCENE_SWAP_IDLE;
+                return;
+            }
+            // the buffers of the next scene are separate, frames in flight keep drawing the current ones
+            const uint64_t numNodes = gNextScene.mNumSplats + gNextScene.mLod.mNumMerged;
+            addSplatVertexBuffers(numNodes, &gNextScene.mQuantized, gNextSceneBuffers.pVertexBuffers);
+            addSceneFrameBuffers(numNodes, pShColorBuffer[0] != NULL, pSplatIndexBuffer[0] != NULL || gNextScene.mLod.mNumSplats > 0,
+                                 gNextSceneBuffers.pShColorBuffers, gNextSceneBuffers.pIndexBuffers);
+            if (gPreprocessActive)
+                addPreprocessBuffers(numNodes, gNextSceneBuffers.pPreprocessBuffers);
+            gNextSceneUploaded = 0;
+            gSceneSwapState = SCENE_SWAP_UPLOADING;
+        }
+        else if (gSceneSwapState == SCENE_SWAP_UPLOADING)
+        {
+            // merged LOD nodes follow the splats, a batch holds either
+            const uint64_t numSplats = gNextScene.mNumSplats;
+            const uint64_t numNodes = numSplats + gNextScene.mLod.mNumMerged;
+            const int64_t  startUs = getUSec(false);
+            while (gNextSceneUploaded < numNodes && getUSec(false) - startUs < gSceneSwapUploadUsPerFrame)
+            {
+                const bool     merged = gNextSceneUploaded >= numSplats;
+                const uint64_t first = merged ? gNextSceneUploaded - numSplats : gNextSceneUploaded;
+                const uint64_t end = merged ? numNodes - numSplats : numSplats;
+                const uint64_t count = end - first < gSceneSwapBatchSplats ? end - first : gSceneSwapBatchSplats;
+                const SplatStreams* src = merged ? &gNextScene.mLod.mMerged : &gNextScene.mStreams;
+                const SplatQuantized* quantized = merged ? NULL : &gNextScene.mQuantized;
+                uploadSplatRange(gNextSceneBuffers.pVertexBuffers, gNextSceneUploaded, src, quantized, first, count, NULL);
+                gNextSceneUploaded += count;
+            }
+            bformat(&gSceneStats, "Scene: uploading %s, %llu of %llu splats\n", gSceneLoader.mPath,
+                    (unsigned long long)gNextSceneUploaded, (unsigned long long)numNodes);
+            // the copies are submitted by this frame's Draw
+            if (gNextSceneUploaded == numNodes)
+                gSceneSwapState = SCENE_SWAP_FLUSHING;
+        }
+        else if (gSceneSwapState == SCENE_SWAP_FLUSHING && allResourceLoadsCompleted())
+        {
+            swapScene();
+        }
+    }
+
+    // Makes the next scene the active one. The frames in flight draw the
+    // retired one, it is released once gDataBufferCount more frames started.
+    void swapScene()
+    {
+        const int64_t startUs = getUSec(false);
+        if (gDepthSorterActive)
+            splatDepthSorterExit(&gDepthSorter);
+        if (gLodActive)
+            splatSortScratchExit(&gLodSortScratch);
+        splatFree(pVisibleSplats);
+        splatFree(pVisibleMask);
+        pVisibleSplats = NULL;
+        pVisibleMask = NULL;
+        gNumVisibleSplats = 0;
+        pLodCut = NULL;
+        gLodCutSize = 0;
+        splatShCacheExit(&gShCache);
+        splatShCacheExit(&gShMergedCache);
+        splatFree(pShColors);
+        pShColors = NULL;
+
+        const int64_t loadUs = gNextScene.mDurationUs;
+        getActiveSceneBuffers(&gRetiredSceneBuffers);
+        releaseActiveScene(&gRetiredScene);
+        setActiveSceneBuffers(&gNextSceneBuffers);
+        adoptScene(&gNextScene);
+        gNextSceneBuffers = {};
+        gRetiredSceneFrames = gDataBufferCount;
+
+        // the index and color buffers of the new scene start empty
+        for (uint32_t i = 0; i < gDataBufferCount; ++i)
+        {
+            gIndexedDrawCount[i] = 0;
+            gSortedIndexVersion[i] = 0;
+            gShColorStamps[i][0] = 0;
+            gShColorStamps[i][1] = 0;
+        }
+        gLodActive = gSplatLodEnabled && gSceneLod.mNumSplats > 0;
+        initSceneAcceleration();
+        // the other set was last bound before the previous swap retired
+        gSceneSet = (gSceneSet + 1) % 2;
+        if (gShEvalGpu)
+        {
+            updateShEvalDescriptorSet(gSceneSet, pPositionBuffer, pShsBuffer, pColorBuffer);
+            gShDispatchedDegree = UINT32_MAX;
+        }
+        if (gPreprocessActive)
+        {
+            SceneBuffers buffers = {};
+            getActiveSceneBuffers(&buffers);
+            updatePreprocessDescriptorSets(gSceneSet, &buffers);
+        }
+        gFrameMayAllocate = true;
+        gSceneSwapState = SCENE_SWAP_IDLE;
+
+        const int64_t endUs = getUSec(false);
+        LOGF(eINFO, "Scene swap: %s, %llu splats, loaded in %.2f ms, swapped %.2f ms after the request in %.2f ms", gSceneLoader.mPath,
+             (unsigned long long)mNumOfPoints, loadUs / 1000.0f, (endUs - gSceneSwapStartUs) / 1000.0f,
+             (endUs - startUs) / 1000.0f);
+        bformat(&gSceneStats, "Scene: %s, %llu splats, swapped in %.2f ms\n", gSceneLoader.mPath, (unsigned long long)mNumOfPoints,
+                (endUs - gSceneSwapStartUs) / 1000.0f);
+    }
+
+    bool loadSplatStreamer(const char* path)
+    {
+        SplatStreamerDesc desc = {};
+        desc.mBudgetBytes = (uint64_t)gSplatStreamingBudgetMB * 1024 * 1024;
+        desc.mMaxInFlight = 4;
+        // Update writes new slots before Draw waits for the oldest frame in flight
+        desc.mEvictDelayFrames = gDataBufferCount + 1;
+        desc.mPrefetchSeconds = 0.5f;
+        desc.mMaxStallUs = 0;
+        if (!splatStreamerInit(&gStreamer, gThreadSystem, RD_OTHER_FILES, path, &desc))
+            return false;
+        const SplatChunkFileHeader* header = &gStreamer.mFile.mHeader;
+        gStreamer.mDesc.mPrefetchRadius = 0.1f * (header->mBoundsMax[0] - header->mBoundsMin[0]);
+        mNumOfPoints = (uint64_t)gStreamer.mNumSlots * header->mChunkCapacity;
+
+        // only the streams the draw binds are mirrored, written in place as slots become resident
+        BufferLoadDesc vbDesc = {};
+        vbDesc.mDesc.mDescriptors = DESCRIPTOR_TYPE_VERTEX_BUFFER;
+        vbDesc.mDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_CPU_TO_GPU;
+        vbDesc.mDesc.mFlags = BUFFER_CREATION_FLAG_PERSISTENT_MAP_BIT;
+        vbDesc.mDesc.mSize = sizeof(struct Tf32x3_s) * mNumOfPoints;
+        vbDesc.ppBuffer = &pPositionBuffer;
+        addResource(&vbDesc, NULL);
+        vbDesc.ppBuffer = &pColorBuffer;
+        addResource(&vbDesc, NULL);
+
+        splatSortScratchInit(&gStreamSortScratch);
+        splatSortScratchReserve(&gStreamSortScratch, mNumOfPoints);
+        gStreamingActive = true;
+        return true;
+    }
+
+    void uploadStreamedSlots()
+    {
+        const uint32_t capacity = gStreamer.mFile.mHeader.mChunkCapacity;
+        for (uint32_t i = 0; i < gStreamer.mNumNewSlots; i++)
+        {
+            const uint32_t   slot = gStreamer.pNewSlots[i];
+            const uint64_t   size = sizeof(struct Tf32x3_s) * capacity;
+            BufferUpdateDesc positionUpdate = { pPositionBuffer, slot * size, size };
+            BufferUpdateDesc colorUpdate = { pColorBuffer, slot * size, size };
+            beginUpdateResource(&positionUpdate);
+            beginUpdateResource(&colorUpdate);
+            SplatStreams uploadStreams = {};
+            uploadStreams.pPositions = (struct Tf32x3_s*)positionUpdate.pMappedData;
+            uploadStreams.pColors = (struct Tf32x3_s*)colorUpdate.pMappedData;
+            splatCopyStreams(&uploadStreams, &gStreamer.pSlots[slot].mStreams, 0, capacity);
+            endUpdateResource(&colorUpdate);
+            endUpdateResource(&positionUpdate);
+        }
+    }
+
     bool addSwapChain()
     {
         SwapChainDesc swapChainDesc = {};
@@ -1089,11 +2791,97 @@ public:
     {
         DescriptorSetDesc desc = { pRootSignature, DESCRIPTOR_UPDATE_FREQ_PER_FRAME, gDataBufferCount * 2 };
         addDescriptorSet(pRenderer, &desc, &pDescriptorSetUniforms);
+        if (gShEvalGpu)
+        {
+            // one per scene, the next one is written while frames in flight still bind the active one
+            desc = { pShEvalRootSignature, DESCRIPTOR_UPDATE_FREQ_NONE, 2 };
+            addDescriptorSet(pRenderer, &desc, &pDescriptorSetShEval);
+            desc = { pShEvalRootSignature, DESCRIPTOR_UPDATE_FREQ_PER_FRAME, gDataBufferCount };
+            addDescriptorSet(pRenderer, &desc, &pDescriptorSetShEvalUniforms);
+        }
+        if (gPreprocessActive)
+        {
+            // one per scene like the SH eval sets
+            desc = { pPreprocessRootSignature, DESCRIPTOR_UPDATE_FREQ_NONE, 2 };
+            addDescriptorSet(pRenderer, &desc, &pDescriptorSetPreprocess);
+            desc = { pPreprocessRootSignature, DESCRIPTOR_UPDATE_FREQ_PER_FRAME, gDataBufferCount };
+            addDescriptorSet(pRenderer, &desc, &pDescriptorSetPreprocessUniforms);
+            desc = { pSortRootSignature, DESCRIPTOR_UPDATE_FREQ_NONE, 2 };
+            addDescriptorSet(pRenderer, &desc, &pDescriptorSetSort);
+            desc = { pSplatQuadRootSignature, DESCRIPTOR_UPDATE_FREQ_NONE, 2 };
+            addDescriptorSet(pRenderer, &desc, &pDescriptorSetSplatQuad);
+            desc = { pSplatQuadRootSignature, DESCRIPTOR_UPDATE_FREQ_PER_FRAME, gDataBufferCount };
+            addDescriptorSet(pRenderer, &desc, &pDescriptorSetSplatQuadUniforms);
+        }
+    }
+
+    void updateShEvalDescriptorSet(uint32_t set, Buffer* positionBuffer, Buffer* shsBuffer, Buffer* colorBuffer)
+    {
+        DescriptorData params[3] = {};
+        params[0].pName = "positions";
+        params[0].ppBuffers = &positionBuffer;
+        params[1].pName = "shs";
+        params[1].ppBuffers = &shsBuffer;
+        params[2].pName = "colors";
+        params[2].ppBuffers = &colorBuffer;
+        updateDescriptorSet(pRenderer, set, pDescriptorSetShEval, 3, params);
+    }
+
+    // Points the preprocess pass, the sort and the quad draw at the vertex and output buffers of a scene.
+    void updatePreprocessDescriptorSets(uint32_t set, SceneBuffers* buffers)
+    {
+        DescriptorData params[7] = {};
+        params[0].pName = "splats";
+        params[0].ppBuffers = &buffers->pVertexBuffers[SPLAT_UPLOAD_SPLATS];
+        params[1].pName = "shRest";
+        params[1].ppBuffers = &buffers->pVertexBuffers[SPLAT_UPLOAD_SHS];
+        params[2].pName = "records";
+        params[2].ppBuffers = &buffers->pPreprocessBuffers[SPLAT_PREPROCESS_RECORDS];
+        params[3].pName = "visible";
+        params[3].ppBuffers = &buffers->pPreprocessBuffers[SPLAT_PREPROCESS_VISIBLE];
+        params[4].pName = "keys";
+        params[4].ppBuffers = &buffers->pPreprocessBuffers[SPLAT_PREPROCESS_KEYS];
+        params[5].pName = "drawArgs";
+        params[5].ppBuffers = &buffers->pPreprocessBuffers[SPLAT_PREPROCESS_DRAW_ARGS];
+        params[6].pName = "shTable";
+        params[6].ppBuffers = &buffers->pVertexBuffers[SPLAT_UPLOAD_SH_TABLE];
+        updateDescriptorSet(pRenderer, set, pDescriptorSetPreprocess, 7, params);
+
+        DescriptorData sortParams[4] = {};
+        sortParams[0].pName = "visible";
+        sortParams[0].ppBuffers = &buffers->pPreprocessBuffers[SPLAT_PREPROCESS_VISIBLE];
+        sortParams[1].pName = "keys";
+        sortParams[1].ppBuffers = &buffers->pPreprocessBuffers[SPLAT_PREPROCESS_KEYS];
+        sortParams[2].pName = "drawArgs";
+        sortParams[2].ppBuffers = &buffers->pPreprocessBuffers[SPLAT_PREPROCESS_DRAW_ARGS];
+        sortParams[3].pName = "sortArgs";
+        sortParams[3].ppBuffers = &buffers->pPreprocessBuffers[SPLAT_PREPROCESS_SORT_ARGS];
+        updateDescriptorSet(pRenderer, set, pDescriptorSetSort, 4, sortParams);
+
+        DescriptorData quadParams[2] = {};
+        quadParams[0].pName = "records";
+        quadParams[0].ppBuffers = &buffers->pPreprocessBuffers[SPLAT_PREPROCESS_RECORDS];
+        quadParams[1].pName = "order";
+        quadParams[1].ppBuffers = &buffers->pPreprocessBuffers[SPLAT_PREPROCESS_VISIBLE];
+        updateDescriptorSet(pRenderer, set, pDescriptorSetSplatQuad, 2, quadParams);
     }
 
     void removeDescriptorSets()
     {
         removeDescriptorSet(pRenderer, pDescriptorSetUniforms);
+        if (gShEvalGpu)
+        {
+            removeDescriptorSet(pRenderer, pDescriptorSetShEval);
+            removeDescriptorSet(pRenderer, pDescriptorSetShEvalUniforms);
+        }
+        if (gPreprocessActive)
+        {
+            removeDescriptorSet(pRenderer, pDescriptorSetPreprocess);
+            removeDescriptorSet(pRenderer, pDescriptorSetPreprocessUniforms);
+            removeDescriptorSet(pRenderer, pDescriptorSetSort);
+            removeDescriptorSet(pRenderer, pDescriptorSetSplatQuad);
+            removeDescriptorSet(pRenderer, pDescriptorSetSplatQuadUniforms);
+        }
     }
 
     void addRootSignatures()
@@ -1106,9 +2894,42 @@ public:
         rootDesc.mShaderCount = shadersCount;
         rootDesc.ppShaders = shaders;
         addRootSignature(pRenderer, &rootDesc, &pRootSignature);
+
+        if (gShEvalGpu)
+        {
+            rootDesc.mShaderCount = 1;
+            rootDesc.ppShaders = &pShEvalShader;
+            addRootSignature(pRenderer, &rootDesc, &pShEvalRootSignature);
+        }
+        if (gPreprocessActive)
+        {
+            rootDesc.mShaderCount = 1;
+            rootDesc.ppShaders = &pPreprocessShader;
+            addRootSignature(pRenderer, &rootDesc, &pPreprocessRootSignature);
+            // the sort and its dispatch arguments share the set
+            Shader* sortShaders[2] = { pSortShader, pSortArgsShader };
+            rootDesc.mShaderCount = 2;
+            rootDesc.ppShaders = sortShaders;
+            addRootSignature(pRenderer, &rootDesc, &pSortRootSignature);
+            gSortStepIndex = getDescriptorIndexFromName(pSortRootSignature, "sortStep");
+            rootDesc.mShaderCount = 1;
+            rootDesc.ppShaders = &pSplatQuadShader;
+            addRootSignature(pRenderer, &rootDesc, &pSplatQuadRootSignature);
+        }
     }
 
-    void removeRootSignatures() { removeRootSignature(pRenderer, pRootSignature); }
+    void removeRootSignatures()
+    {
+        removeRootSignature(pRenderer, pRootSignature);
+        if (gShEvalGpu)
+            removeRootSignature(pRenderer, pShEvalRootSignature);
+        if (gPreprocessActive)
+        {
+            removeRootSignature(pRenderer, pPreprocessRootSignature);
+            removeRootSignature(pRenderer, pSortRootSignature);
+            removeRootSignature(pRenderer, pSplatQuadRootSignature);
+        }
+    }
 
     void addShaders()
     {
@@ -1117,9 +2938,48 @@ public:
         particleShader.mStages[0].pFileName = "particle.vert";
         particleShader.mStages[1].pFileName = "particle.frag";
         addShader(pRenderer, &particleShader, &pParticleShader);
+
+        if (gShEvalGpu)
+        {
+            ShaderLoadDesc shEvalShader = {};
+            shEvalShader.mStages[0].pFileName = "sh_eval.comp";
+            addShader(pRenderer, &shEvalShader, &pShEvalShader);
+        }
+
+        if (gPreprocessActive)
+        {
+            ShaderLoadDesc preprocessShader = {};
+            preprocessShader.mStages[0].pFileName = "splat_preprocess.comp";
+            addShader(pRenderer, &preprocessShader, &pPreprocessShader);
+
+            ShaderLoadDesc sortShader = {};
+            sortShader.mStages[0].pFileName = "splat_sort.comp";
+            addShader(pRenderer, &sortShader, &pSortShader);
+
+            ShaderLoadDesc sortArgsShader = {};
+            sortArgsShader.mStages[0].pFileName = "splat_sort_args.comp";
+            addShader(pRenderer, &sortArgsShader, &pSortArgsShader);
+
+            ShaderLoadDesc quadShader = {};
+            quadShader.mStages[0].pFileName = "splat_quad.vert";
+            quadShader.mStages[1].pFileName = "splat_quad.frag";
+            addShader(pRenderer, &quadShader, &pSplatQuadShader);
+        }
     }
 
-    void removeShaders() { removeShader(pRenderer, pParticleShader); }
+    void removeShaders()
+    {
+        removeShader(pRenderer, pParticleShader);
+        if (gShEvalGpu)
+            removeShader(pRenderer, pShEvalShader);
+        if (gPreprocessActive)
+        {
+            removeShader(pRenderer, pPreprocessShader);
+            removeShader(pRenderer, pSortShader);
+            removeShader(pRenderer, pSortArgsShader);
+            removeShader(pRenderer, pSplatQuadShader);
+        }
+    }
 
     void addPipelines() {
 
@@ -1168,12 +3028,81 @@ public:
             addPipeline(pRenderer, &desc, &pParticlePipeline);
         }
 
+        if (gShEvalGpu)
+        {
+            PipelineDesc desc = {};
+            desc.mType = PIPELINE_TYPE_COMPUTE;
+            ComputePipelineDesc& pipelineSettings = desc.mComputeDesc;
+            pipelineSettings.pRootSignature = pShEvalRootSignature;
+            pipelineSettings.pShaderProgram = pShEvalShader;
+            addPipeline(pRenderer, &desc, &pShEvalPipeline);
+        }
+
+        if (gPreprocessActive)
+        {
+            PipelineDesc desc = {};
+            desc.mType = PIPELINE_TYPE_COMPUTE;
+            ComputePipelineDesc& computeSettings = desc.mComputeDesc;
+            computeSettings.pRootSignature = pPreprocessRootSignature;
+            computeSettings.pShaderProgram = pPreprocessShader;
+            addPipeline(pRenderer, &desc, &pPreprocessPipeline);
+            computeSettings.pRootSignature = pSortRootSignature;
+            computeSettings.pShaderProgram = pSortShader;
+            addPipeline(pRenderer, &desc, &pSortPipeline);
+            computeSettings.pShaderProgram = pSortArgsShader;
+            addPipeline(pRenderer, &desc, &pSortArgsPipeline);
+
+            // the quads fetch their records, there is no vertex input
+            RasterizerStateDesc rasterizerStateDesc = {};
+            rasterizerStateDesc.mCullMode = CULL_MODE_NONE;
+
+            // drawn back to front, the blending resolves the visibility
+            DepthStateDesc depthStateDesc = {};
+            depthStateDesc.mDepthTest = false;
+            depthStateDesc.mDepthWrite = false;
+
+            // premultiplied over
+            BlendStateDesc blendStateDesc = {};
+            blendStateDesc.mSrcFactors[0] = BC_ONE;
+            blendStateDesc.mDstFactors[0] = BC_ONE_MINUS_SRC_ALPHA;
+            blendStateDesc.mBlendModes[0] = BM_ADD;
+            blendStateDesc.mSrcAlphaFactors[0] = BC_ONE;
+            blendStateDesc.mDstAlphaFactors[0] = BC_ONE_MINUS_SRC_ALPHA;
+            blendStateDesc.mBlendAlphaModes[0] = BM_ADD;
+            blendStateDesc.mColorWriteMasks[0] = COLOR_MASK_ALL;
+            blendStateDesc.mRenderTargetMask = BLEND_STATE_TARGET_0;
+
+            desc = {};
+            desc.mType = PIPELINE_TYPE_GRAPHICS;
+            GraphicsPipelineDesc& pipelineSettings = desc.mGraphicsDesc;
+            pipelineSettings.mPrimitiveTopo = PRIMITIVE_TOPO_TRI_STRIP;
+            pipelineSettings.mRenderTargetCount = 1;
+            pipelineSettings.pDepthState = &depthStateDesc;
+            pipelineSettings.pColorFormats = &pSwapChain->ppRenderTargets[0]->mFormat;
+            pipelineSettings.mSampleCount = pSwapChain->ppRenderTargets[0]->mSampleCount;
+            pipelineSettings.mSampleQuality = pSwapChain->ppRenderTargets[0]->mSampleQuality;
+            pipelineSettings.mDepthStencilFormat = pDepthBuffer->mFormat;
+            pipelineSettings.pRootSignature = pSplatQuadRootSignature;
+            pipelineSettings.pShaderProgram = pSplatQuadShader;
+            pipelineSettings.pRasterizerState = &rasterizerStateDesc;
+            pipelineSettings.pBlendState = &blendStateDesc;
+            addPipeline(pRenderer, &desc, &pSplatQuadPipeline);
+        }
     }
 
     void removePipelines()
     {
         //removePipeline(pRenderer, pSkyBoxDrawPipeline);
         removePipeline(pRenderer, pParticlePipeline);
+        if (gShEvalGpu)
+            removePipeline(pRenderer, pShEvalPipeline);
+        if (gPreprocessActive)
+        {
+            removePipeline(pRenderer, pPreprocessPipeline);
+            removePipeline(pRenderer, pSortPipeline);
+            removePipeline(pRenderer, pSortArgsPipeline);
+            removePipeline(pRenderer, pSplatQuadPipeline);
+        }
     }
 };
 DEFINE_APPLICATION_MAIN(Transformations)
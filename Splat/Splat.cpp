@@ -0,0 +1,277 @@
+/*
+ * Copyright (c) 2017-2024 The Forge Interactive Inc.
+ *
+ * This file is part of The-Forge
+ * (see https://github.com/ConfettiFX/The-Forge).
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#include "Splat.h"
+
+#include <atomic>
+#include <math.h>
+#include <string.h>
+
+#include "Forge/TF_Log.h"
+#include "Forge/Mem/TF_Memory.h"
+
+static std::atomic<uint64_t> gSplatHeapCalls{ 0 };
+static std::atomic<uint64_t> gSplatHeapBytes{ 0 };
+static std::atomic<uint64_t> gSplatHeapPeakBytes{ 0 };
+
+// Every block starts with its size so frees know how much they release. The
+// header keeps the 16 byte alignment of tf_malloc.
+static const size_t gSplatHeapHeaderSize = 16;
+
+static void* splatHeapTrack(void* block, size_t size) {
+    if (!block)
+        return NULL;
+    *(size_t*)block = size;
+    const uint64_t bytes = gSplatHeapBytes.fetch_add(size, std::memory_order_relaxed) + size;
+    uint64_t       peak = gSplatHeapPeakBytes.load(std::memory_order_relaxed);
+    while (bytes > peak && !gSplatHeapPeakBytes.compare_exchange_weak(peak, bytes, std::memory_order_relaxed)) {
+    }
+    return (uint8_t*)block + gSplatHeapHeaderSize;
+}
+
+static void* splatHeapBlock(void* ptr, size_t* outSize) {
+    void* block = (uint8_t*)ptr - gSplatHeapHeaderSize;
+    *outSize = *(size_t*)block;
+    return block;
+}
+
+void* splatMalloc(size_t size) {
+    gSplatHeapCalls.fetch_add(1, std::memory_order_relaxed);
+    return splatHeapTrack(tf_malloc(gSplatHeapHeaderSize + size), size);
+}
+
+void* splatCalloc(size_t count, size_t size) {
+    gSplatHeapCalls.fetch_add(1, std::memory_order_relaxed);
+    if (size && count > (SIZE_MAX - gSplatHeapHeaderSize) / size)
+        return NULL;
+    return splatHeapTrack(tf_calloc(1, gSplatHeapHeaderSize + count * size), count * size);
+}
+
+void* splatRealloc(void* ptr, size_t size) {
+    if (!ptr)
+        return splatMalloc(size);
+    gSplatHeapCalls.fetch_add(1, std::memory_order_relaxed);
+    size_t oldSize;
+    void*  block = tf_realloc(splatHeapBlock(ptr, &oldSize), gSplatHeapHeaderSize + size);
+    // a failed realloc keeps the old block
+    if (!block)
+        return NULL;
+    gSplatHeapBytes.fetch_sub(oldSize, std::memory_order_relaxed);
+    return splatHeapTrack(block, size);
+}
+
+void splatFree(void* ptr) {
+    // freeing NULL is not a heap call, exit paths free unused buffers freely
+    if (!ptr)
+        return;
+    gSplatHeapCalls.fetch_add(1, std::memory_order_relaxed);
+    size_t size;
+    void*  block = splatHeapBlock(ptr, &size);
+    gSplatHeapBytes.fetch_sub(size, std::memory_order_relaxed);
+    tf_free(block);
+}
+
+uint64_t splatHeapCallCount(void) { return gSplatHeapCalls.load(std::memory_order_relaxed); }
+
+uint64_t splatHeapBytes(void) { return gSplatHeapBytes.load(std::memory_order_relaxed); }
+
+uint64_t splatHeapPeakBytes(void) { return gSplatHeapPeakBytes.load(std::memory_order_relaxed); }
+
+void splatHeapResetPeak(void) { gSplatHeapPeakBytes.store(gSplatHeapBytes.load(std::memory_order_relaxed), std::memory_order_relaxed); }
+
+void splatAllocStreams(struct SplatStreams* streams, uint64_t numSplats) {
+    memset(streams, 0, sizeof(struct SplatStreams));
+    streams->pPositions = (struct Tf32x3_s*)splatMalloc(sizeof(struct Tf32x3_s) * numSplats);
+    streams->pNormals = (struct Tf32x3_s*)splatMalloc(sizeof(struct Tf32x3_s) * numSplats);
+    streams->pScales = (struct Tf32x3_s*)splatMalloc(sizeof(struct Tf32x3_s) * numSplats);
+    streams->pRotations = (struct Tf32x4_s*)splatMalloc(sizeof(struct Tf32x4_s) * numSplats);
+    streams->pOpacities = (float*)splatMalloc(sizeof(float) * numSplats);
+    streams->pShs = (struct SphericalHarmonics*)splatMalloc(sizeof(struct SphericalHarmonics) * numSplats);
+}
+
+void splatFreeStreams(struct SplatStreams* streams) {
+    splatFree(streams->pPositions);
+    splatFree(streams->pColors);
+    splatFree(streams->pNormals);
+    splatFree(streams->pScales);
+    splatFree(streams->pRotations);
+    splatFree(streams->pOpacities);
+    splatFree(streams->pShs);
+    memset(streams, 0, sizeof(struct SplatStreams));
+}
+
+void splatCopyStreams(const struct SplatStreams* dst, const struct SplatStreams* src, uint64_t first, uint64_t count) {
+    if (dst->pPositions && src->pPositions)
+        memcpy(dst->pPositions + first, src->pPositions + first, sizeof(struct Tf32x3_s) * count);
+    if (dst->pColors && (src->pColors || src->pPositions))
+        memcpy(dst->pColors + first, (src->pColors ? src->pColors : src->pPositions) + first, sizeof(struct Tf32x3_s) * count);
+    if (dst->pNormals && src->pNormals)
+        memcpy(dst->pNormals + first, src->pNormals + first, sizeof(struct Tf32x3_s) * count);
+    if (dst->pScales && src->pScales)
+        memcpy(dst->pScales + first, src->pScales + first, sizeof(struct Tf32x3_s) * count);
+    if (dst->pRotations && src->pRotations)
+        memcpy(dst->pRotations + first, src->pRotations + first, sizeof(struct Tf32x4_s) * count);
+    if (dst->pOpacities && src->pOpacities)
+        memcpy(dst->pOpacities + first, src->pOpacities + first, sizeof(float) * count);
+    if (dst->pShs && src->pShs)
+        memcpy(dst->pShs + first, src->pShs + first, sizeof(struct SphericalHarmonics) * count);
+}
+
+void splatShrinkStreams(struct SplatStreams* streams, uint64_t numSplats) {
+    // a failed shrink keeps the larger block
+    void** const   datas[] = { (void**)&streams->pPositions, (void**)&streams->pColors,    (void**)&streams->pNormals,
+                               (void**)&streams->pScales,    (void**)&streams->pRotations, (void**)&streams->pOpacities,
+                               (void**)&streams->pShs };
+    const uint32_t elementSizes[] = { sizeof(struct Tf32x3_s), sizeof(struct Tf32x3_s), sizeof(struct Tf32x3_s), sizeof(struct Tf32x3_s),
+                                      sizeof(struct Tf32x4_s), sizeof(float),           sizeof(struct SphericalHarmonics) };
+    for (size_t i = 0; i < TF_ARRAY_COUNT(datas); i++) {
+        void* data = *datas[i] && numSplats ? splatRealloc(*datas[i], (size_t)elementSizes[i] * numSplats) : NULL;
+        if (data)
+            *datas[i] = data;
+    }
+}
+
+struct SplatPermuteContext {
+    const uint32_t* pOrder;
+    const uint8_t*  pSrc;
+    uint8_t*        pDst;
+    uint32_t        mElementSize;
+};
+
+template <typename T> static void splatGather(const struct SplatPermuteContext* ctx, uint64_t begin, uint64_t end) {
+    const T* src = (const T*)ctx->pSrc;
+    T*       dst = (T*)ctx->pDst;
+    for (uint64_t i = begin; i < end; i++)
+        dst[i] = src[ctx->pOrder[i]];
+}
+
+static void splatPermuteRange(void* user, uint64_t begin, uint64_t end) {
+    const struct SplatPermuteContext* ctx = (const struct SplatPermuteContext*)user;
+    switch (ctx->mElementSize) {
+    case sizeof(float):
+        splatGather<float>(ctx, begin, end);
+        break;
+    case sizeof(struct Tf32x3_s):
+        splatGather<struct Tf32x3_s>(ctx, begin, end);
+        break;
+    case sizeof(struct Tf32x4_s):
+        splatGather<struct Tf32x4_s>(ctx, begin, end);
+        break;
+    default:
+        splatGather<struct SphericalHarmonics>(ctx, begin, end);
+        break;
+    }
+}
+
+static void splatCopyRange(void* user, uint64_t begin, uint64_t end) {
+    const struct SplatPermuteContext* ctx = (const struct SplatPermuteContext*)user;
+    memcpy(ctx->pDst + begin * ctx->mElementSize, ctx->pSrc + begin * ctx->mElementSize, (end - begin) * ctx->mElementSize);
+}
+
+void splatPermuteStreams(ThreadSystem threadSystem, const struct SplatStreams* streams, const uint32_t* order, uint64_t count) {
+    void* const    datas[] = { streams->pPositions, streams->pColors,    streams->pNormals, streams->pScales,
+                               streams->pRotations, streams->pOpacities, streams->pShs };
+    const uint32_t elementSizes[] = { sizeof(struct Tf32x3_s), sizeof(struct Tf32x3_s), sizeof(struct Tf32x3_s), sizeof(struct Tf32x3_s),
+                                      sizeof(struct Tf32x4_s), sizeof(float),           sizeof(struct SphericalHarmonics) };
+    uint32_t       maxElementSize = 0;
+    for (size_t i = 0; i < TF_ARRAY_COUNT(datas); i++)
+        maxElementSize = datas[i] && elementSizes[i] > maxElementSize ? elementSizes[i] : maxElementSize;
+    if (maxElementSize == 0 || count == 0)
+        return;
+
+    uint8_t* scratch = (uint8_t*)splatMalloc((size_t)maxElementSize * count);
+    for (size_t i = 0; i < TF_ARRAY_COUNT(datas); i++) {
+        if (!datas[i])
+            continue;
+        struct SplatPermuteContext gather = { order, (const uint8_t*)datas[i], scratch, elementSizes[i] };
+        splatParallelFor(threadSystem, count, 65536, splatPermuteRange, &gather);
+        struct SplatPermuteContext copy = { NULL, scratch, (uint8_t*)datas[i], elementSizes[i] };
+        splatParallelFor(threadSystem, count, 65536, splatCopyRange, &copy);
+    }
+    splatFree(scratch);
+}
+
+static float splatRandomFloat(uint32_t* state, float minValue, float maxValue) {
+    *state = *state * 1664525u + 1013904223u;
+    return minValue + (maxValue - minValue) * (float)(*state >> 8) / (float)(1u << 24);
+}
+
+void splatGenerateRandomScene(uint64_t numSplats, float extent, uint32_t seed, struct SplatStreams* outStreams) {
+    splatAllocStreams(outStreams, numSplats);
+    uint32_t    state = seed;
+    // a few thousandths to a few hundredths of the scene size, in log space
+    const float scaleMin = logf(extent) - 7.4f;
+    const float scaleMax = logf(extent) - 3.4f;
+    for (uint64_t i = 0; i < numSplats; i++) {
+        outStreams->pPositions[i] = { splatRandomFloat(&state, -extent, extent), splatRandomFloat(&state, -extent, extent),
+                                      splatRandomFloat(&state, -extent, extent) };
+        outStreams->pNormals[i] = { 0.0f, 0.0f, 0.0f };
+        outStreams->pScales[i] = { splatRandomFloat(&state, scaleMin, scaleMax), splatRandomFloat(&state, scaleMin, scaleMax),
+                                   splatRandomFloat(&state, scaleMin, scaleMax) };
+        outStreams->pRotations[i] = { splatRandomFloat(&state, -1.0f, 1.0f), splatRandomFloat(&state, -1.0f, 1.0f),
+                                      splatRandomFloat(&state, -1.0f, 1.0f), splatRandomFloat(&state, -1.0f, 1.0f) };
+        outStreams->pOpacities[i] = splatRandomFloat(&state, -4.0f, 4.0f);
+        struct SphericalHarmonics* sh = &outStreams->pShs[i];
+        sh->dc = { splatRandomFloat(&state, -1.0f, 1.0f), splatRandomFloat(&state, -1.0f, 1.0f), splatRandomFloat(&state, -1.0f, 1.0f) };
+        for (uint32_t k = 0; k < 45; k++)
+            sh->rest[k] = splatRandomFloat(&state, -0.2f, 0.2f);
+    }
+}
+
+struct SplatParallelForTask {
+    SplatRangeFunc mFunc;
+    void*          pUser;
+    uint64_t       mCount;
+    uint64_t       mGrainSize;
+};
+
+static void splatParallelForTaskFunc(void* user, uint64_t index) {
+    const struct SplatParallelForTask* task = (const struct SplatParallelForTask*)user;
+    const uint64_t begin = index * task->mGrainSize;
+    const uint64_t end = begin + task->mGrainSize < task->mCount ? begin + task->mGrainSize : task->mCount;
+    task->mFunc(task->pUser, begin, end);
+}
+
+void splatParallelFor(ThreadSystem threadSystem, uint64_t count, uint64_t grainSize, SplatRangeFunc func, void* user) {
+    if (count == 0)
+        return;
+    if (grainSize == 0)
+        grainSize = 1;
+    const uint64_t numTasks = (count + grainSize - 1) / grainSize;
+    if (!threadSystem || numTasks == 1) {
+        func(user, 0, count);
+        return;
+    }
+    struct SplatParallelForTask task = { func, user, count, grainSize };
+    threadSystemAddTaskGroup(threadSystem, splatParallelForTaskFunc, (uint32_t)numTasks, &task);
+    threadSystemWaitIdle(threadSystem);
+}
+
+void splatLogLoadStats(const char* label, const struct SplatLoadStats* stats) {
+    const double seconds = stats->mDurationUs > 0 ? (double)stats->mDurationUs / 1000000.0 : 1e-6;
+    const double megabytes = (double)stats->mNumBytes / (1024.0 * 1024.0);
+    LOGF(eINFO, "%s: %llu splats, %.1f MB in %.3f s (%.1f MB/s, %.0f splats/s)", label, (unsigned long long)stats->mNumSplats, megabytes,
+         seconds, megabytes / seconds, (double)stats->mNumSplats / seconds);
+}
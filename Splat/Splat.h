@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) 2017-2024 The Forge Interactive Inc.
+ *
+ * This file is part of The-Forge
+ * (see https://github.com/ConfettiFX/The-Forge).
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#pragma once
+
+#include <cstdint>
+#include <string.h>
+
+#include "Forge/Math/TF_Types.h"
+#include "Common_3/Utilities/Threading/ThreadSystem.h"
+
+// Spherical harmonics as stored per splat. The rest coefficients keep the
+// order they have in the PLY file (f_rest_0 .. f_rest_44), which is channel
+// major: 15 coefficients for red, then green, then blue.
+struct SphericalHarmonics {
+   Tf32x3_s dc;
+   union {
+       Tf32x3_s rest_32x3[15];
+       float rest[15 * 3];
+   };
+};
+
+// Destination of a splat decode. Every pointer is optional, streams left NULL
+// are skipped. Each stream holds one entry per splat starting at index 0.
+struct SplatStreams {
+    struct Tf32x3_s* pPositions;
+    struct Tf32x3_s* pColors; // debug point color, mirrors the position
+    struct Tf32x3_s* pNormals;
+    struct Tf32x3_s* pScales;
+    struct Tf32x4_s* pRotations;
+    float* pOpacities;
+    struct SphericalHarmonics* pShs;
+};
+
+static inline uint16_t splatFloatToHalf(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    const uint32_t sign = (bits >> 16) & 0x8000u;
+    const int32_t  exponent = (int32_t)((bits >> 23) & 0xffu) - 127 + 15;
+    uint32_t       mantissa = bits & 0x7fffffu;
+    if (((bits >> 23) & 0xffu) == 0xffu) // inf and nan
+        return (uint16_t)(sign | 0x7c00u | (mantissa ? 0x200u : 0u));
+    if (exponent >= 31)
+        return (uint16_t)(sign | 0x7c00u);
+    if (exponent <= 0) {
+        if (exponent < -10)
+            return (uint16_t)sign;
+        mantissa |= 0x800000u;
+        const uint32_t shift = (uint32_t)(14 - exponent);
+        uint32_t       half = mantissa >> shift;
+        if ((mantissa >> (shift - 1)) & 1u)
+            half++;
+        return (uint16_t)(sign | half);
+    }
+    uint32_t half = sign | ((uint32_t)exponent << 10) | (mantissa >> 13);
+    if (mantissa & 0x1000u) // round to nearest, may carry into the exponent
+        half++;
+    return (uint16_t)half;
+}
+
+static inline float splatHalfToFloat(uint16_t half) {
+    const uint32_t sign = (uint32_t)(half & 0x8000u) << 16;
+    uint32_t       exponent = (half >> 10) & 0x1fu;
+    uint32_t       mantissa = half & 0x3ffu;
+    uint32_t       bits;
+    if (exponent == 0x1fu) {
+        bits = sign | 0x7f800000u | (mantissa << 13);
+    } else if (exponent == 0) {
+        if (mantissa == 0) {
+            bits = sign;
+        } else {
+            exponent = 127 - 15 + 1;
+            while ((mantissa & 0x400u) == 0) {
+                mantissa <<= 1;
+                exponent--;
+            }
+            bits = sign | (exponent << 23) | ((mantissa & 0x3ffu) << 13);
+        }
+    } else {
+        bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+    }
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// Heap allocation for splat code and the app, on top of tf_malloc. Every
+// call that allocates or frees memory bumps a counter, so the frame loop can
+// check that its steady state does not touch the heap. The bytes held are
+// counted as well, with their high-water mark, for benchmarks. Memory from
+// these calls must not be freed with tf_free and the other way round.
+void*    splatMalloc(size_t size);
+void*    splatCalloc(size_t count, size_t size);
+void*    splatRealloc(void* ptr, size_t size);
+void     splatFree(void* ptr);
+uint64_t splatHeapCallCount(void);
+uint64_t splatHeapBytes(void);
+uint64_t splatHeapPeakBytes(void);
+// Restarts the high-water mark at the bytes held now.
+void     splatHeapResetPeak(void);
+
+// Allocates every stream except pColors for numSplats splats.
+void splatAllocStreams(struct SplatStreams* streams, uint64_t numSplats);
+void splatFreeStreams(struct SplatStreams* streams);
+// Copies count splats of every stream present in both src and dst, a NULL
+// src pColors is filled from the src positions.
+void splatCopyStreams(const struct SplatStreams* dst, const struct SplatStreams* src, uint64_t first, uint64_t count);
+// Reallocates every stream of splatAllocStreams to hold numSplats splats,
+// to give back the tail after streams were compacted.
+void splatShrinkStreams(struct SplatStreams* streams, uint64_t numSplats);
+
+// Reorders every non NULL stream so that splat i afterwards holds what was
+// splat order[i], order must be a permutation of [0, count). Streams are
+// gathered one at a time through a scratch buffer the size of the largest.
+void splatPermuteStreams(ThreadSystem threadSystem, const struct SplatStreams* streams, const uint32_t* order, uint64_t count);
+
+// Allocates streams with splatAllocStreams and fills them with a
+// deterministic random cloud in [-extent, extent]^3, for tools and
+// benchmarks that run without a capture.
+void splatGenerateRandomScene(uint64_t numSplats, float extent, uint32_t seed, struct SplatStreams* outStreams);
+
+// Runs func over [0, count) split into ranges of grainSize on the thread
+// system and waits for completion. threadSystem may be NULL to run inline.
+// Waits for the whole thread system, so it must not be called from a task.
+typedef void (*SplatRangeFunc)(void* user, uint64_t begin, uint64_t end);
+void splatParallelFor(ThreadSystem threadSystem, uint64_t count, uint64_t grainSize, SplatRangeFunc func, void* user);
+
+struct SplatLoadStats {
+    uint64_t mNumSplats;
+    uint64_t mNumBytes;
+    int64_t  mDurationUs;
+};
+
+void splatLogLoadStats(const char* label, const struct SplatLoadStats* stats);
@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) 2017-2024 The Forge Interactive Inc.
+ *
+ * This file is part of The-Forge
+ * (see https://github.com/ConfettiFX/The-Forge).
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "SplatArena.h"
+
+#include <atomic>
+#include <string.h>
+
+// Heap block of an allocation that did not fit, the data follows.
+struct SplatArenaBlock {
+    struct SplatArenaBlock* pNext;
+};
+
+// sub-arenas grow in whole cache lines with some headroom over the mark
+static const uint64_t gSplatArenaGranularity = 64;
+
+static std::atomic<uint32_t> gSplatArenaNextThreadSlot{ 0 };
+
+uint32_t splatArenaThreadSlot(void) {
+    static thread_local uint32_t slot = UINT32_MAX;
+    if (slot == UINT32_MAX)
+        slot = gSplatArenaNextThreadSlot.fetch_add(1);
+    return slot;
+}
+
+static void splatArenaReleaseOverflow(struct SplatArena* subArena) {
+    while (subArena->pOverflow) {
+        struct SplatArenaBlock* next = subArena->pOverflow->pNext;
+        splatFree(subArena->pOverflow);
+        subArena->pOverflow = next;
+    }
+    subArena->mOverflowBytes = 0;
+}
+
+static void splatArenaReserve(struct SplatArena* subArena, uint64_t size) {
+    const uint64_t capacity = (size + size / 4 + gSplatArenaGranularity - 1) & ~(gSplatArenaGranularity - 1);
+    splatFree(subArena->pBase);
+    subArena->pBase = (uint8_t*)splatMalloc(capacity);
+    subArena->mCapacity = capacity;
+}
+
+void splatFrameArenaInit(struct SplatFrameArena* arena, uint32_t numFrames, uint64_t reserveBytes) {
+    memset(arena, 0, sizeof(struct SplatFrameArena));
+    arena->mNumFrames = numFrames < 1 ? 1 : (numFrames > SPLAT_FRAME_ARENA_MAX_FRAMES ? SPLAT_FRAME_ARENA_MAX_FRAMES : numFrames);
+    const uint32_t slot = splatArenaThreadSlot();
+    if (reserveBytes && slot < SPLAT_FRAME_ARENA_MAX_THREADS) {
+        arena->mHighWater[slot] = reserveBytes;
+        for (uint32_t frame = 0; frame < arena->mNumFrames; frame++)
+            splatArenaReserve(&arena->mArenas[frame][slot], reserveBytes);
+    }
+}
+
+void splatFrameArenaExit(struct SplatFrameArena* arena) {
+    for (uint32_t frame = 0; frame < arena->mNumFrames; frame++) {
+        for (uint32_t slot = 0; slot < SPLAT_FRAME_ARENA_MAX_THREADS; slot++) {
+            splatArenaReleaseOverflow(&arena->mArenas[frame][slot]);
+            splatFree(arena->mArenas[frame][slot].pBase);
+        }
+    }
+    memset(arena, 0, sizeof(struct SplatFrameArena));
+}
+
+void splatFrameArenaBeginFrame(struct SplatFrameArena* arena, uint32_t frameIndex) {
+    arena->mFrame = frameIndex % arena->mNumFrames;
+    for (uint32_t slot = 0; slot < SPLAT_FRAME_ARENA_MAX_THREADS; slot++) {
+        struct SplatArena* subArena = &arena->mArenas[arena->mFrame][slot];
+        splatArenaReleaseOverflow(subArena);
+        subArena->mOffset = 0;
+        if (arena->mHighWater[slot] > subArena->mCapacity) {
+            splatArenaReserve(subArena, arena->mHighWater[slot]);
+            arena->mNumGrowths++;
+        }
+    }
+}
+
+void* splatFrameArenaAlloc(struct SplatFrameArena* arena, uint64_t size, uint64_t alignment) {
+    const uint32_t slot = splatArenaThreadSlot();
+    if (slot >= SPLAT_FRAME_ARENA_MAX_THREADS)
+        return NULL;
+    struct SplatArena* subArena = &arena->mArenas[arena->mFrame][slot];
+
+    const uintptr_t base = (uintptr_t)subArena->pBase;
+    const uint64_t  offset = ((base + subArena->mOffset + alignment - 1) & ~(uintptr_t)(alignment - 1)) - base;
+    if (subArena->pBase && offset + size <= subArena->mCapacity) {
+        subArena->mOffset = offset + size;
+        const uint64_t used = subArena->mOffset + subArena->mOverflowBytes;
+        if (used > arena->mHighWater[slot])
+            arena->mHighWater[slot] = used;
+        return subArena->pBase + offset;
+    }
+
+    // does not fit this frame, the next time the set is begun it will
+    struct SplatArenaBlock* block = (struct SplatArenaBlock*)splatMalloc(sizeof(struct SplatArenaBlock) + size + alignment);
+    if (!block)
+        return NULL;
+    block->pNext = subArena->pOverflow;
+    subArena->pOverflow = block;
+    subArena->mOverflowBytes += size + alignment;
+    subArena->mNumOverflows++;
+    const uint64_t used = subArena->mOffset + subArena->mOverflowBytes;
+    if (used > arena->mHighWater[slot])
+        arena->mHighWater[slot] = used;
+    const uintptr_t data = (uintptr_t)(block + 1);
+    return (void*)((data + alignment - 1) & ~(uintptr_t)(alignment - 1));
+}
+
+void splatFrameArenaGetStats(const struct SplatFrameArena* arena, struct SplatFrameArenaStats* outStats) {
+    memset(outStats, 0, sizeof(struct SplatFrameArenaStats));
+    outStats->mNumGrowths = arena->mNumGrowths;
+    for (uint32_t slot = 0; slot < SPLAT_FRAME_ARENA_MAX_THREADS; slot++) {
+        outStats->mHighWater += arena->mHighWater[slot];
+        for (uint32_t frame = 0; frame < arena->mNumFrames; frame++) {
+            outStats->mCapacity += arena->mArenas[frame][slot].mCapacity;
+            outStats->mNumOverflows += arena->mArenas[frame][slot].mNumOverflows;
+        }
+        const struct SplatArena* subArena = &arena->mArenas[arena->mFrame][slot];
+        const uint64_t           used = subArena->mOffset + subArena->mOverflowBytes;
+        outStats->mUsed += used;
+        outStats->mNumThreads += used ? 1 : 0;
+    }
+}
@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2017-2024 The Forge Interactive Inc.
+ *
+ * This file is part of The-Forge
+ * (see https://github.com/ConfettiFX/The-Forge).
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#pragma once
+
+#include "Splat.h"
+
+// Frame scoped linear allocator for transient per frame data (visible lists,
+// sort keys, projected splats). There is one set of sub-arenas per frame in
+// flight so data of a frame stays valid while the next one is built, and one
+// sub-arena per thread in each set so workers allocate without locking.
+//
+// Memory only grows in splatFrameArenaBeginFrame, between frames. A frame
+// that asks for more than its sub-arena holds is served from the heap and
+// the sub-arena grows to the high-water mark when its set comes around, so
+// after a warm-up a steady frame does not touch the heap.
+
+#define SPLAT_FRAME_ARENA_MAX_FRAMES 4
+#define SPLAT_FRAME_ARENA_MAX_THREADS 64
+
+struct SplatArenaBlock;
+
+struct SplatArena {
+    uint8_t*                pBase;
+    uint64_t                mCapacity;
+    uint64_t                mOffset;
+    uint64_t                mOverflowBytes; // served by the heap this frame
+    uint64_t                mNumOverflows;  // since init
+    struct SplatArenaBlock* pOverflow;
+};
+
+struct SplatFrameArena {
+    uint32_t          mNumFrames;
+    uint32_t          mFrame;
+    uint64_t          mNumGrowths;
+    uint64_t          mHighWater[SPLAT_FRAME_ARENA_MAX_THREADS]; // per thread slot, over every frame
+    struct SplatArena mArenas[SPLAT_FRAME_ARENA_MAX_FRAMES][SPLAT_FRAME_ARENA_MAX_THREADS];
+};
+
+struct SplatFrameArenaStats {
+    uint64_t mCapacity;     // every sub-arena of every set
+    uint64_t mUsed;         // by the current frame
+    uint64_t mHighWater;    // sum of the per thread high-water marks
+    uint64_t mNumOverflows; // allocations served by the heap
+    uint64_t mNumGrowths;
+    uint32_t mNumThreads;   // sub-arenas used so far in the current set
+};
+
+// Index of the calling thread's sub-arena, assigned on first use. The thread
+// calling splatFrameArenaInit first gets 0.
+uint32_t splatArenaThreadSlot(void);
+
+// reserveBytes is given to the calling thread's sub-arena of every set, other
+// threads start empty and grow after their first frame.
+void splatFrameArenaInit(struct SplatFrameArena* arena, uint32_t numFrames, uint64_t reserveBytes);
+void splatFrameArenaExit(struct SplatFrameArena* arena);
+
+// Makes set frameIndex % numFrames current: releases the heap blocks of its
+// last frame, grows its sub-arenas to their high-water mark and rewinds
+// them. Nothing allocated from that set may still be in use, and no thread
+// may allocate from the arena during the call.
+void splatFrameArenaBeginFrame(struct SplatFrameArena* arena, uint32_t frameIndex);
+
+// Allocates from the calling thread's sub-arena of the current set. The
+// memory is valid until the set is begun again, alignment is a power of two.
+void* splatFrameArenaAlloc(struct SplatFrameArena* arena, uint64_t size, uint64_t alignment);
+
+void splatFrameArenaGetStats(const struct SplatFrameArena* arena, struct SplatFrameArenaStats* outStats);
@@ -0,0 +1,432 @@
+/*
+ * Copyright (c) 2017-2024 The Forge Interactive Inc.
+ *
+ * This file is part of The-Forge
+ * (see https://github.com/ConfettiFX/The-Forge).
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#include "SplatBvh.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "Forge/Core/TF_Time.h"
+
+#include "SplatMorton.h"
+
+static const uint32_t gSplatBvhMaxDepth = 40;
+
+static void splatPlaneNormalize(float plane[4]) {
+    const float len = sqrtf(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+    const float inv = len > 0.0f ? 1.0f / len : 0.0f;
+    for (uint32_t i = 0; i < 4; i++)
+        plane[i] *= inv;
+}
+
+void splatFrustumFromCamera(const struct SplatCamera* camera, float farDistance, struct SplatFrustum* outFrustum) {
+    // camera space planes, +z forward, +x right, +y down
+    const float left = camera->mCenterX / camera->mFocalX;
+    const float right = ((float)camera->mWidth - camera->mCenterX) / camera->mFocalX;
+    const float top = camera->mCenterY / camera->mFocalY;
+    const float bottom = ((float)camera->mHeight - camera->mCenterY) / camera->mFocalY;
+    float       planes[6][4] = {
+        { 0.0f, 0.0f, 1.0f, -camera->mNear }, { 0.0f, 0.0f, -1.0f, farDistance }, { 1.0f, 0.0f, left, 0.0f },
+        { -1.0f, 0.0f, right, 0.0f },         { 0.0f, 1.0f, top, 0.0f },          { 0.0f, -1.0f, bottom, 0.0f },
+    };
+    const float* v = camera->mView;
+    for (uint32_t i = 0; i < 6; i++) {
+        splatPlaneNormalize(planes[i]);
+        const float* n = planes[i];
+        // n . (R p + t) + d = (R^T n) . p + (n . t + d)
+        outFrustum->mPlanes[i][0] = n[0] * v[0] + n[1] * v[4] + n[2] * v[8];
+        outFrustum->mPlanes[i][1] = n[0] * v[1] + n[1] * v[5] + n[2] * v[9];
+        outFrustum->mPlanes[i][2] = n[0] * v[2] + n[1] * v[6] + n[2] * v[10];
+        outFrustum->mPlanes[i][3] = n[0] * v[3] + n[1] * v[7] + n[2] * v[11] + n[3];
+    }
+}
+
+void splatFrustumFromMatrix(const float matrix[16], struct SplatFrustum* outFrustum) {
+    const float* r0 = &matrix[0];
+    const float* r1 = &matrix[4];
+    const float* r2 = &matrix[8];
+    const float* r3 = &matrix[12];
+    for (uint32_t i = 0; i < 4; i++) {
+        outFrustum->mPlanes[0][i] = r3[i] + r0[i];
+        outFrustum->mPlanes[1][i] = r3[i] - r0[i];
+        outFrustum->mPlanes[2][i] = r3[i] + r1[i];
+        outFrustum->mPlanes[3][i] = r3[i] - r1[i];
+        outFrustum->mPlanes[4][i] = r2[i];
+        outFrustum->mPlanes[5][i] = r3[i] - r2[i];
+    }
+    for (uint32_t i = 0; i < 6; i++)
+        splatPlaneNormalize(outFrustum->mPlanes[i]);
+}
+
+struct SplatBvhBuildContext {
+    struct SplatBvh*           pBvh;
+    const struct SplatStreams* pStreams;
+    uint64_t                   mFirstNode; // first node of the level being built
+};
+
+static void splatBvhSlotsRange(void* user, uint64_t begin, uint64_t end) {
+    const struct SplatBvhBuildContext* ctx = (const struct SplatBvhBuildContext*)user;
+    struct SplatBvh*                   bvh = ctx->pBvh;
+    for (uint64_t slot = begin; slot < end; slot++) {
+        const uint32_t        splat = bvh->pOrder[slot];
+        const struct Tf32x3_s p = ctx->pStreams->pPositions[splat];
+        bvh->pCenters[slot * 3 + 0] = p.x;
+        bvh->pCenters[slot * 3 + 1] = p.y;
+        bvh->pCenters[slot * 3 + 2] = p.z;
+        float radius = 0.0f;
+        if (ctx->pStreams->pScales) {
+            const struct Tf32x3_s s = ctx->pStreams->pScales[splat];
+            radius = 3.0f * expf(fmaxf(s.x, fmaxf(s.y, s.z)));
+        }
+        bvh->pRadii[slot] = radius;
+    }
+}
+
+static void splatBvhLeavesRange(void* user, uint64_t begin, uint64_t end) {
+    const struct SplatBvhBuildContext* ctx = (const struct SplatBvhBuildContext*)user;
+    struct SplatBvh*                   bvh = ctx->pBvh;
+    for (uint64_t leaf = begin; leaf < end; leaf++) {
+        float          boundsMin[3] = { INFINITY, INFINITY, INFINITY };
+        float          boundsMax[3] = { -INFINITY, -INFINITY, -INFINITY };
+        const uint64_t first = leaf * SPLAT_BVH_LEAF_SIZE;
+        const uint64_t last = first + SPLAT_BVH_LEAF_SIZE < bvh->mNumSplats ? first + SPLAT_BVH_LEAF_SIZE : bvh->mNumSplats;
+        for (uint64_t slot = first; slot < last; slot++) {
+            const float radius = bvh->pRadii[slot];
+            for (uint32_t axis = 0; axis < 3; axis++) {
+                // fminf and fmaxf drop NaN centers
+                boundsMin[axis] = fminf(boundsMin[axis], bvh->pCenters[slot * 3 + axis] - radius);
+                boundsMax[axis] = fmaxf(boundsMax[axis], bvh->pCenters[slot * 3 + axis] + radius);
+            }
+        }
+        const uint64_t node = bvh->mNumLeaves - 1 + leaf;
+        bvh->pMinX[node] = boundsMin[0];
+        bvh->pMinY[node] = boundsMin[1];
+        bvh->pMinZ[node] = boundsMin[2];
+        bvh->pMaxX[node] = boundsMax[0];
+        bvh->pMaxY[node] = boundsMax[1];
+        bvh->pMaxZ[node] = boundsMax[2];
+    }
+}
+
+static void splatBvhNodesRange(void* user, uint64_t begin, uint64_t end) {
+    const struct SplatBvhBuildContext* ctx = (const struct SplatBvhBuildContext*)user;
+    struct SplatBvh*                   bvh = ctx->pBvh;
+    for (uint64_t node = ctx->mFirstNode + begin; node < ctx->mFirstNode + end; node++) {
+        const uint64_t left = node * 2 + 1;
+        const uint64_t right = node * 2 + 2;
+        bvh->pMinX[node] = fminf(bvh->pMinX[left], bvh->pMinX[right]);
+        bvh->pMinY[node] = fminf(bvh->pMinY[left], bvh->pMinY[right]);
+        bvh->pMinZ[node] = fminf(bvh->pMinZ[left], bvh->pMinZ[right]);
+        bvh->pMaxX[node] = fmaxf(bvh->pMaxX[left], bvh->pMaxX[right]);
+        bvh->pMaxY[node] = fmaxf(bvh->pMaxY[left], bvh->pMaxY[right]);
+        bvh->pMaxZ[node] = fmaxf(bvh->pMaxZ[left], bvh->pMaxZ[right]);
+    }
+}
+
+bool splatBvhBuild(ThreadSystem threadSystem, uint64_t numSplats, const struct SplatStreams* streams, struct SplatBvh* outBvh,
+                   struct SplatBvhBuildStats* outStats) {
+    memset(outBvh, 0, sizeof(struct SplatBvh));
+    if (!streams->pPositions || numSplats == 0 || numSplats > UINT32_MAX)
+        return false;
+
+    struct SplatBvh* bvh = outBvh;
+    bvh->mNumSplats = numSplats;
+    const uint64_t numUsedLeaves = (numSplats + SPLAT_BVH_LEAF_SIZE - 1) / SPLAT_BVH_LEAF_SIZE;
+    bvh->mNumLeaves = 1;
+    bvh->mNumLevels = 1;
+    while (bvh->mNumLeaves < numUsedLeaves) {
+        bvh->mNumLeaves *= 2;
+        bvh->mNumLevels++;
+    }
+    bvh->mNumNodes = bvh->mNumLeaves * 2 - 1;
+
+    bvh->pOrder = (uint32_t*)splatMalloc(sizeof(uint32_t) * numSplats);
+    bvh->pCenters = (float*)splatMalloc(sizeof(float) * 3 * numSplats);
+    bvh->pRadii = (float*)splatMalloc(sizeof(float) * numSplats);
+    float** bounds[6] = { &bvh->pMinX, &bvh->pMinY, &bvh->pMinZ, &bvh->pMaxX, &bvh->pMaxY, &bvh->pMaxZ };
+    for (uint32_t i = 0; i < 6; i++)
+        *bounds[i] = (float*)splatMalloc(sizeof(float) * bvh->mNumNodes);
+
+    struct SplatBvhBuildStats stats = {};
+    int64_t                   timeUs = getUSec(false);
+    splatMortonOrder(threadSystem, streams->pPositions, numSplats, false, bvh->pOrder);
+    stats.mMortonUs = getUSec(false) - timeUs;
+
+    timeUs = getUSec(false);
+    struct SplatBvhBuildContext ctx = { bvh, streams, 0 };
+    splatParallelFor(threadSystem, numSplats, 16384, splatBvhSlotsRange, &ctx);
+    splatParallelFor(threadSystem, bvh->mNumLeaves, 256, splatBvhLeavesRange, &ctx);
+    stats.mLeavesUs = getUSec(false) - timeUs;
+
+    timeUs = getUSec(false);
+    for (int32_t level = (int32_t)bvh->mNumLevels - 2; level >= 0; level--) {
+        ctx.mFirstNode = (1ull << level) - 1;
+        splatParallelFor(threadSystem, 1ull << level, 4096, splatBvhNodesRange, &ctx);
+    }
+    stats.mNodesUs = getUSec(false) - timeUs;
+
+    if (outStats)
+        *outStats = stats;
+    return true;
+}
+
+void splatBvhFree(struct SplatBvh* bvh) {
+    splatFree(bvh->pOrder);
+    splatFree(bvh->pCenters);
+    splatFree(bvh->pRadii);
+    splatFree(bvh->pMinX);
+    splatFree(bvh->pMinY);
+    splatFree(bvh->pMinZ);
+    splatFree(bvh->pMaxX);
+    splatFree(bvh->pMaxY);
+    splatFree(bvh->pMaxZ);
+    memset(bvh, 0, sizeof(struct SplatBvh));
+}
+
+// Sorted slots covered by a node.
+static inline void splatBvhNodeSlots(const struct SplatBvh* bvh, uint64_t node, uint32_t level, uint64_t* outFirst, uint64_t* outLast) {
+    const uint64_t leavesPerNode = bvh->mNumLeaves >> level;
+    const uint64_t indexInLevel = node - ((1ull << level) - 1);
+    const uint64_t first = indexInLevel * leavesPerNode * SPLAT_BVH_LEAF_SIZE;
+    const uint64_t last = first + leavesPerNode * SPLAT_BVH_LEAF_SIZE;
+    *outFirst = first < bvh->mNumSplats ? first : bvh->mNumSplats;
+    *outLast = last < bvh->mNumSplats ? last : bvh->mNumSplats;
+}
+
+enum SplatBvhClassify {
+    SPLAT_BVH_OUTSIDE = 0,
+    SPLAT_BVH_INTERSECTS,
+    SPLAT_BVH_INSIDE,
+};
+
+static inline uint32_t splatBvhClassifyNode(const struct SplatBvh* bvh, uint64_t node, const struct SplatFrustum* frustum) {
+    const float boundsMin[3] = { bvh->pMinX[node], bvh->pMinY[node], bvh->pMinZ[node] };
+    const float boundsMax[3] = { bvh->pMaxX[node], bvh->pMaxY[node], bvh->pMaxZ[node] };
+    if (boundsMin[0] > boundsMax[0])
+        return SPLAT_BVH_OUTSIDE; // empty
+    uint32_t result = SPLAT_BVH_INSIDE;
+    for (uint32_t i = 0; i < 6; i++) {
+        const float* plane = frustum->mPlanes[i];
+        // the corners furthest along and against the plane normal
+        float positive = plane[3];
+        float negative = plane[3];
+        for (uint32_t axis = 0; axis < 3; axis++) {
+            positive += plane[axis] * (plane[axis] >= 0.0f ? boundsMax[axis] : boundsMin[axis]);
+            negative += plane[axis] * (plane[axis] >= 0.0f ? boundsMin[axis] : boundsMax[axis]);
+        }
+        if (positive < 0.0f)
+            return SPLAT_BVH_OUTSIDE;
+        if (negative < 0.0f)
+            result = SPLAT_BVH_INTERSECTS;
+    }
+    return result;
+}
+
+static inline bool splatBvhSlotInFrustum(const struct SplatBvh* bvh, uint64_t slot, const struct SplatFrustum* frustum) {
+    const float* c = &bvh->pCenters[slot * 3];
+    const float  radius = bvh->pRadii[slot];
+    for (uint32_t i = 0; i < 6; i++) {
+        const float* plane = frustum->mPlanes[i];
+        // negated so that NaN centers are rejected
+        if (!(plane[0] * c[0] + plane[1] * c[1] + plane[2] * c[2] + plane[3] >= -radius))
+            return false;
+    }
+    return true;
+}
+
+static uint64_t splatBvhCullSubtree(const struct SplatBvh* bvh, uint64_t root, uint32_t rootLevel, const struct SplatFrustum* frustum,
+                                    uint32_t* outIndices) {
+    uint64_t stackNodes[gSplatBvhMaxDepth * 2];
+    uint32_t stackLevels[gSplatBvhMaxDepth * 2];
+    uint32_t stackSize = 0;
+    uint64_t count = 0;
+    stackNodes[stackSize] = root;
+    stackLevels[stackSize++] = rootLevel;
+    while (stackSize) {
+        const uint64_t node = stackNodes[--stackSize];
+        const uint32_t level = stackLevels[stackSize];
+        const uint32_t classify = splatBvhClassifyNode(bvh, node, frustum);
+        if (classify == SPLAT_BVH_OUTSIDE)
+            continue;
+        uint64_t first, last;
+        splatBvhNodeSlots(bvh, node, level, &first, &last);
+        if (classify == SPLAT_BVH_INSIDE) {
+            memcpy(&outIndices[count], &bvh->pOrder[first], sizeof(uint32_t) * (last - first));
+            count += last - first;
+        } else if (level + 1 == bvh->mNumLevels) {
+            for (uint64_t slot = first; slot < last; slot++) {
+                if (splatBvhSlotInFrustum(bvh, slot, frustum))
+                    outIndices[count++] = bvh->pOrder[slot];
+            }
+        } else {
+            stackNodes[stackSize] = node * 2 + 2;
+            stackLevels[stackSize++] = level + 1;
+            stackNodes[stackSize] = node * 2 + 1;
+            stackLevels[stackSize++] = level + 1;
+        }
+    }
+    return count;
+}
+
+static void splatBvhCullRange(void* user, uint64_t begin, uint64_t end) {
+    struct SplatBvhCullJob* job = (struct SplatBvhCullJob*)user;
+    for (uint64_t subtree = begin; subtree < end; subtree++) {
+        // a subtree writes at most its own slot count, so it can use the output range of its slots
+        const uint64_t root = (1ull << job->mSplitLevel) - 1 + subtree;
+        uint64_t       first, last;
+        splatBvhNodeSlots(job->pBvh, root, job->mSplitLevel, &first, &last);
+        job->mCounts[subtree] = splatBvhCullSubtree(job->pBvh, root, job->mSplitLevel, job->pFrustum, &job->pIndices[first]);
+    }
+}
+
+// Compacts the per subtree results, they are in slot order so memmove never overwrites pending data.
+static void splatBvhCullCompact(void* user, uint64_t, uint64_t) {
+    struct SplatBvhCullJob* job = (struct SplatBvhCullJob*)user;
+    const uint64_t          numSubtrees = 1ull << job->mSplitLevel;
+    uint64_t                count = 0;
+    for (uint64_t subtree = 0; subtree < numSubtrees; subtree++) {
+        uint64_t first, last;
+        splatBvhNodeSlots(job->pBvh, numSubtrees - 1 + subtree, job->mSplitLevel, &first, &last);
+        if (count != first && job->mCounts[subtree])
+            memmove(&job->pIndices[count], &job->pIndices[first], sizeof(uint32_t) * job->mCounts[subtree]);
+        count += job->mCounts[subtree];
+    }
+    job->mNumVisible = count;
+}
+
+static void splatBvhCullJobInit(struct SplatBvhCullJob* job, const struct SplatBvh* bvh, const struct SplatFrustum* frustum,
+                                uint32_t* outIndices) {
+    job->pBvh = bvh;
+    job->pFrustum = frustum;
+    job->pIndices = outIndices;
+    job->mSplitLevel = bvh->mNumLevels - 1 < SPLAT_BVH_CULL_SPLIT_LEVEL ? bvh->mNumLevels - 1 : SPLAT_BVH_CULL_SPLIT_LEVEL;
+    job->mNumVisible = 0;
+}
+
+uint64_t splatBvhCullFrustum(ThreadSystem threadSystem, const struct SplatBvh* bvh, const struct SplatFrustum* frustum,
+                             uint32_t* outIndices) {
+    if (!bvh->mNumSplats)
+        return 0;
+    struct SplatBvhCullJob job;
+    splatBvhCullJobInit(&job, bvh, frustum, outIndices);
+    splatParallelFor(threadSystem, 1ull << job.mSplitLevel, 1, splatBvhCullRange, &job);
+    splatBvhCullCompact(&job, 0, 1);
+    return job.mNumVisible;
+}
+
+uint32_t splatBvhCullFrustumStages(struct SplatJobGraph* graph, struct SplatBvhCullJob* job, const struct SplatBvh* bvh,
+                                   const struct SplatFrustum* frustum, uint32_t* outIndices) {
+    splatBvhCullJobInit(job, bvh, frustum, outIndices);
+    const uint64_t numSubtrees = bvh->mNumSplats ? 1ull << job->mSplitLevel : 0;
+    const uint32_t cull = splatJobGraphAddStage(graph, "Cull", numSubtrees, 1, splatBvhCullRange, job);
+    const uint32_t compact = splatJobGraphAddStage(graph, "Cull Compact", numSubtrees ? 1 : 0, 1, splatBvhCullCompact, job);
+    splatJobGraphAddDependency(graph, compact, cull);
+    return compact;
+}
+
+typedef bool (*SplatBvhNodeTest)(const struct SplatBvh* bvh, uint64_t node, const float* shape);
+typedef bool (*SplatBvhSlotTest)(const struct SplatBvh* bvh, uint64_t slot, const float* shape);
+
+static uint64_t splatBvhQuery(const struct SplatBvh* bvh, SplatBvhNodeTest nodeTest, SplatBvhSlotTest slotTest, const float* shape,
+                              uint32_t* outIndices, uint64_t maxIndices) {
+    if (!bvh->mNumSplats)
+        return 0;
+    uint64_t stackNodes[gSplatBvhMaxDepth * 2];
+    uint32_t stackLevels[gSplatBvhMaxDepth * 2];
+    uint32_t stackSize = 0;
+    uint64_t count = 0;
+    stackNodes[stackSize] = 0;
+    stackLevels[stackSize++] = 0;
+    while (stackSize) {
+        const uint64_t node = stackNodes[--stackSize];
+        const uint32_t level = stackLevels[stackSize];
+        if (bvh->pMinX[node] > bvh->pMaxX[node] || !nodeTest(bvh, node, shape))
+            continue;
+        if (level + 1 < bvh->mNumLevels) {
+            stackNodes[stackSize] = node * 2 + 2;
+            stackLevels[stackSize++] = level + 1;
+            stackNodes[stackSize] = node * 2 + 1;
+            stackLevels[stackSize++] = level + 1;
+            continue;
+        }
+        uint64_t first, last;
+        splatBvhNodeSlots(bvh, node, level, &first, &last);
+        for (uint64_t slot = first; slot < last; slot++) {
+            if (!slotTest(bvh, slot, shape))
+                continue;
+            if (count < maxIndices)
+                outIndices[count] = bvh->pOrder[slot];
+            count++;
+        }
+    }
+    return count;
+}
+
+// shape: min xyz, max xyz
+static bool splatBvhBoxNodeTest(const struct SplatBvh* bvh, uint64_t node, const float* box) {
+    return bvh->pMinX[node] <= box[3] && bvh->pMaxX[node] >= box[0] && bvh->pMinY[node] <= box[4] && bvh->pMaxY[node] >= box[1] &&
+           bvh->pMinZ[node] <= box[5] && bvh->pMaxZ[node] >= box[2];
+}
+
+static bool splatBvhBoxSlotTest(const struct SplatBvh* bvh, uint64_t slot, const float* box) {
+    const float* c = &bvh->pCenters[slot * 3];
+    float        distanceSq = 0.0f;
+    for (uint32_t axis = 0; axis < 3; axis++) {
+        const float d = c[axis] < box[axis] ? box[axis] - c[axis] : (c[axis] > box[axis + 3] ? c[axis] - box[axis + 3] : 0.0f);
+        distanceSq += d * d;
+    }
+    return distanceSq <= bvh->pRadii[slot] * bvh->pRadii[slot];
+}
+
+// shape: center xyz, radius
+static bool splatBvhSphereNodeTest(const struct SplatBvh* bvh, uint64_t node, const float* sphere) {
+    const float boundsMin[3] = { bvh->pMinX[node], bvh->pMinY[node], bvh->pMinZ[node] };
+    const float boundsMax[3] = { bvh->pMaxX[node], bvh->pMaxY[node], bvh->pMaxZ[node] };
+    float       distanceSq = 0.0f;
+    for (uint32_t axis = 0; axis < 3; axis++) {
+        const float c = sphere[axis];
+        const float d = c < boundsMin[axis] ? boundsMin[axis] - c : (c > boundsMax[axis] ? c - boundsMax[axis] : 0.0f);
+        distanceSq += d * d;
+    }
+    return distanceSq <= sphere[3] * sphere[3];
+}
+
+static bool splatBvhSphereSlotTest(const struct SplatBvh* bvh, uint64_t slot, const float* sphere) {
+    const float* c = &bvh->pCenters[slot * 3];
+    const float  dx = c[0] - sphere[0], dy = c[1] - sphere[1], dz = c[2] - sphere[2];
+    const float  reach = sphere[3] + bvh->pRadii[slot];
+    return dx * dx + dy * dy + dz * dz <= reach * reach;
+}
+
+uint64_t splatBvhQueryBox(const struct SplatBvh* bvh, struct Tf32x3_s boxMin, struct Tf32x3_s boxMax, uint32_t* outIndices,
+                          uint64_t maxIndices) {
+    const float box[6] = { boxMin.x, boxMin.y, boxMin.z, boxMax.x, boxMax.y, boxMax.z };
+    return splatBvhQuery(bvh, splatBvhBoxNodeTest, splatBvhBoxSlotTest, box, outIndices, maxIndices);
+}
+
+uint64_t splatBvhQuerySphere(const struct SplatBvh* bvh, struct Tf32x3_s center, float radius, uint32_t* outIndices, uint64_t maxIndices) {
+    const float sphere[4] = { center.x, center.y, center.z, radius };
+    return splatBvhQuery(bvh, splatBvhSphereNodeTest, splatBvhSphereSlotTest, sphere, outIndices, maxIndices);
+}
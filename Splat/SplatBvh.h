@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2017-2024 The Forge Interactive Inc.
+ *
+ * This file is part of The-Forge
+ * (see https://github.com/ConfettiFX/The-Forge).
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#pragma once
+
+#include "Splat.h"
+#include "SplatJobs.h"
+#include "SplatRaster.h"
+
+// Bounding volume hierarchy over splat centers plus their 3 sigma extent.
+//
+// Splats are sorted by Morton code and cut into leaves of
+// SPLAT_BVH_LEAF_SIZE consecutive splats. The leaves form the last level of
+// an implicit complete binary tree stored level by level (children of node i
+// are 2i + 1 and 2i + 2), so no child pointers are stored and every node
+// covers a contiguous range of sorted slots. Node bounds are kept as six
+// float arrays to make the plane tests stream through memory.
+
+#define SPLAT_BVH_LEAF_SIZE 64
+// subtrees at this level are culled as independent tasks
+#define SPLAT_BVH_CULL_SPLIT_LEVEL 6
+
+struct SplatBvh {
+    uint64_t  mNumSplats;
+    uint32_t  mNumLevels; // leaves are at level mNumLevels - 1
+    uint64_t  mNumLeaves; // power of two, trailing leaves may be empty
+    uint64_t  mNumNodes;
+    uint32_t* pOrder; // splat index of every sorted slot
+    float*    pCenters; // xyz of every sorted slot
+    float*    pRadii; // 3 sigma radius of every sorted slot
+    float*    pMinX; // node bounds, empty nodes have min > max
+    float*    pMinY;
+    float*    pMinZ;
+    float*    pMaxX;
+    float*    pMaxY;
+    float*    pMaxZ;
+};
+
+struct SplatBvhBuildStats {
+    int64_t mMortonUs; // bounds, codes and sort
+    int64_t mLeavesUs;
+    int64_t mNodesUs;
+};
+
+// Six planes with normals pointing inside, a point p is inside a plane when
+// dot(n, p) + d >= 0.
+struct SplatFrustum {
+    float mPlanes[6][4];
+};
+
+// Planes of the reference rasterizer camera, from mNear up to farDistance.
+void splatFrustumFromCamera(const struct SplatCamera* camera, float farDistance, struct SplatFrustum* outFrustum);
+// Planes of a row major world to clip matrix with 0 <= z <= w, either z
+// direction (reverse Z included).
+void splatFrustumFromMatrix(const float matrix[16], struct SplatFrustum* outFrustum);
+
+bool splatBvhBuild(ThreadSystem threadSystem, uint64_t numSplats, const struct SplatStreams* streams, struct SplatBvh* outBvh,
+                   struct SplatBvhBuildStats* outStats);
+void splatBvhFree(struct SplatBvh* bvh);
+
+// Writes the indices of the splats that intersect the frustum to
+// outIndices, which needs room for every splat, in Morton order. Subtrees are
+// culled in parallel. Returns the number of visible splats.
+uint64_t splatBvhCullFrustum(ThreadSystem threadSystem, const struct SplatBvh* bvh, const struct SplatFrustum* frustum,
+                             uint32_t* outIndices);
+
+// State of a frustum cull that runs as stages of a job graph. It has to
+// live until the graph ran.
+struct SplatBvhCullJob {
+    const struct SplatBvh*     pBvh;
+    const struct SplatFrustum* pFrustum;
+    uint32_t*                  pIndices;
+    uint32_t                   mSplitLevel;
+    uint64_t                   mCounts[1 << SPLAT_BVH_CULL_SPLIT_LEVEL]; // visible splats per subtree
+    uint64_t                   mNumVisible; // the result, once the compaction stage ran
+};
+
+// Adds splatBvhCullFrustum to graph as a stage culling the subtrees and a
+// stage compacting their results, returns the compaction stage.
+uint32_t splatBvhCullFrustumStages(struct SplatJobGraph* graph, struct SplatBvhCullJob* job, const struct SplatBvh* bvh,
+                                   const struct SplatFrustum* frustum, uint32_t* outIndices);
+
+// Splats whose 3 sigma sphere intersects the box or sphere. At most
+// maxIndices indices are written, the return value is the total count.
+uint64_t splatBvhQueryBox(const struct SplatBvh* bvh, struct Tf32x3_s boxMin, struct Tf32x3_s boxMax, uint32_t* outIndices,
+                          uint64_t maxIndices);
+uint64_t splatBvhQuerySphere(const struct SplatBvh* bvh, struct Tf32x3_s center, float radius, uint32_t* outIndices, uint64_t maxIndices);
@@ -0,0 +1,291 @@
+/*
+ * Copyright (c) 2017-2024 The Forge Interactive Inc.
+ *
+ * This file is part of The-Forge
+ * (see https://github.com/ConfettiFX/The-Forge).
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#include "SplatCache.h"
+
+#include <string.h>
+
+#include "Forge/TF_Log.h"
+#include "Forge/Core/TF_Time.h"
+
+static const size_t   gSplatCacheHashBlock = 64 * 1024;
+static const uint64_t gSplatCacheShChunk = 16 * 1024;
+static const uint32_t gSplatCacheShRestSize = sizeof(float) * 45;
+
+static const uint32_t gSplatCacheElementSizes[SPLAT_CACHE_STREAM_COUNT] = {
+    sizeof(struct Tf32x3_s), // SPLAT_CACHE_STREAM_POSITION
+    sizeof(struct Tf32x3_s), // SPLAT_CACHE_STREAM_SCALE
+    sizeof(struct Tf32x4_s), // SPLAT_CACHE_STREAM_ROTATION
+    sizeof(float),           // SPLAT_CACHE_STREAM_OPACITY
+    sizeof(struct Tf32x3_s), // SPLAT_CACHE_STREAM_SH_DC
+    gSplatCacheShRestSize,   // SPLAT_CACHE_STREAM_SH_REST
+};
+
+static uint64_t splatCacheFnv1a(uint64_t hash, const void* data, size_t size) {
+    const uint8_t* bytes = (const uint8_t*)data;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+static inline uint64_t splatCacheAlign(uint64_t value) {
+    return (value + SPLAT_CACHE_STREAM_ALIGNMENT - 1) & ~(uint64_t)(SPLAT_CACHE_STREAM_ALIGNMENT - 1);
+}
+
+uint64_t splatCacheHashSource(ResourceDirectory dir, const char* path, FileStream* fs) {
+    uint64_t      hash = 0xcbf29ce484222325ull;
+    const ssize_t fileSize = fsGetStreamFileSize(fs);
+    hash = splatCacheFnv1a(hash, &fileSize, sizeof(fileSize));
+    const int64_t modifiedTime = (int64_t)fsGetLastModifiedTime(dir, path);
+    hash = splatCacheFnv1a(hash, &modifiedTime, sizeof(modifiedTime));
+
+    // the first block covers the PLY header
+    uint8_t*      block = (uint8_t*)splatMalloc(gSplatCacheHashBlock);
+    const ssize_t offsets[] = { 0, fileSize / 2, fileSize - (ssize_t)gSplatCacheHashBlock };
+    for (size_t i = 0; i < TF_ARRAY_COUNT(offsets); i++) {
+        const ssize_t offset = offsets[i] > 0 ? offsets[i] : 0;
+        fsSeekStream(fs, SBO_START_OF_FILE, offset);
+        const size_t numRead = fsReadFromStream(fs, block, gSplatCacheHashBlock);
+        hash = splatCacheFnv1a(hash, block, numRead);
+    }
+    splatFree(block);
+    fsSeekStream(fs, SBO_START_OF_FILE, 0);
+    return hash;
+}
+
+void splatCacheMakePath(const char* sourcePath, char* outPath, size_t outSize) {
+    if (outSize == 0)
+        return;
+    size_t      len = 0;
+    const char* ext = strrchr(sourcePath, '.');
+    for (const char* c = sourcePath; *c && c != ext && len + 1 < outSize; c++)
+        outPath[len++] = (*c == '/' || *c == '\\' || *c == ':') ? '_' : *c;
+    outPath[len] = '\0';
+    strncat(outPath, ".splatcache", outSize - len - 1);
+}
+
+bool splatCacheOpen(ResourceDirectory dir, const char* path, uint64_t sourceHash, struct SplatCache* cache) {
+    memset(cache, 0, sizeof(struct SplatCache));
+    if (!fsOpenStreamFromPath(dir, path, FM_READ, &cache->mStream))
+        return false;
+
+    struct SplatCacheHeader* header = &cache->mHeader;
+    bool valid = fsReadFromStream(&cache->mStream, header, sizeof(struct SplatCacheHeader)) == sizeof(struct SplatCacheHeader) &&
+                 header->mMagic == SPLAT_CACHE_MAGIC && header->mVersion == SPLAT_CACHE_VERSION && header->mSourceHash == sourceHash &&
+                 header->mNumSplats > 0;
+    const uint64_t fileSize = (uint64_t)fsGetStreamFileSize(&cache->mStream);
+    for (uint32_t i = 0; valid && i < SPLAT_CACHE_STREAM_COUNT; i++) {
+        // bounded by the file size first, a corrupt count or offset must not wrap the products and sums
+        const struct SplatCacheStream* stream = &header->mStreams[i];
+        valid = stream->mElementSize == gSplatCacheElementSizes[i] && header->mNumSplats <= fileSize / stream->mElementSize &&
+                stream->mSize == stream->mElementSize * header->mNumSplats && stream->mOffset <= fileSize &&
+                stream->mSize <= fileSize - stream->mOffset;
+    }
+    if (!valid) {
+        LOGF(eINFO, "Splat cache '%s' is stale, the PLY will be parsed.", path);
+        fsCloseStream(&cache->mStream);
+        memset(cache, 0, sizeof(struct SplatCache));
+        return false;
+    }
+    return true;
+}
+
+void splatCacheClose(struct SplatCache* cache) {
+    fsCloseStream(&cache->mStream);
+    memset(cache, 0, sizeof(struct SplatCache));
+}
+
+static void splatCacheScatterSh(const struct SplatStreams* streams, const uint8_t* dc, const uint8_t* rest, uint64_t first,
+                                uint64_t count) {
+    for (uint64_t i = 0; i < count; i++) {
+        struct SphericalHarmonics* harmonics = &streams->pShs[first + i];
+        memcpy(&harmonics->dc, dc + i * sizeof(struct Tf32x3_s), sizeof(struct Tf32x3_s));
+        memcpy(harmonics->rest, rest + i * gSplatCacheShRestSize, gSplatCacheShRestSize);
+    }
+}
+
+// Reads splats [first, first + count) of every stream with seeks, into the same indices of streams.
+static bool splatCacheReadRangeSeek(struct SplatCache* cache, const struct SplatStreams* streams, uint64_t first, uint64_t count) {
+    const struct SplatCacheHeader* header = &cache->mHeader;
+    void* const dsts[SPLAT_CACHE_STREAM_COUNT] = { streams->pPositions, streams->pScales, streams->pRotations, streams->pOpacities,
+                                                   NULL, NULL };
+    bool        result = true;
+    for (uint32_t i = 0; result && i < SPLAT_CACHE_STREAM_COUNT; i++) {
+        if (!dsts[i])
+            continue;
+        const struct SplatCacheStream* stream = &header->mStreams[i];
+        result = fsSeekStream(&cache->mStream, SBO_START_OF_FILE, (ssize_t)(stream->mOffset + first * stream->mElementSize)) &&
+                 fsReadFromStream(&cache->mStream, (uint8_t*)dsts[i] + first * stream->mElementSize, count * stream->mElementSize) ==
+                     count * stream->mElementSize;
+    }
+    if (result && streams->pShs) {
+        // the SH record interleaves dc and rest, so those go through a scratch buffer
+        const struct SplatCacheStream* dcStream = &header->mStreams[SPLAT_CACHE_STREAM_SH_DC];
+        const struct SplatCacheStream* restStream = &header->mStreams[SPLAT_CACHE_STREAM_SH_REST];
+        uint8_t* dc = (uint8_t*)splatMalloc(sizeof(struct Tf32x3_s) * gSplatCacheShChunk);
+        uint8_t* rest = (uint8_t*)splatMalloc(gSplatCacheShRestSize * gSplatCacheShChunk);
+        for (uint64_t offset = 0; result && offset < count; offset += gSplatCacheShChunk) {
+            const uint64_t chunkFirst = first + offset;
+            const uint64_t chunkCount = count - offset < gSplatCacheShChunk ? count - offset : gSplatCacheShChunk;
+            const uint64_t dcBytes = chunkCount * dcStream->mElementSize;
+            const uint64_t restBytes = chunkCount * restStream->mElementSize;
+            const ssize_t  dcOffset = (ssize_t)(dcStream->mOffset + chunkFirst * dcStream->mElementSize);
+            const ssize_t  restOffset = (ssize_t)(restStream->mOffset + chunkFirst * restStream->mElementSize);
+            result = fsSeekStream(&cache->mStream, SBO_START_OF_FILE, dcOffset) &&
+                     fsReadFromStream(&cache->mStream, dc, dcBytes) == dcBytes &&
+                     fsSeekStream(&cache->mStream, SBO_START_OF_FILE, restOffset) &&
+                     fsReadFromStream(&cache->mStream, rest, restBytes) == restBytes;
+            if (result)
+                splatCacheScatterSh(streams, dc, rest, chunkFirst, chunkCount);
+        }
+        splatFree(dc);
+        splatFree(rest);
+    }
+    if (result && streams->pColors && streams->pPositions)
+        memcpy(streams->pColors + first, streams->pPositions + first, sizeof(struct Tf32x3_s) * count);
+    if (result && streams->pNormals)
+        memset(streams->pNormals + first, 0, sizeof(struct Tf32x3_s) * count);
+    return result;
+}
+
+bool splatCacheRead(struct SplatCache* cache, const struct SplatStreams* streams, struct SplatLoadStats* outStats) {
+    const int64_t                  startUs = getUSec(false);
+    const struct SplatCacheHeader* header = &cache->mHeader;
+    const uint64_t                 numSplats = header->mNumSplats;
+    void* const                    dsts[SPLAT_CACHE_STREAM_COUNT] = { streams->pPositions, streams->pScales, streams->pRotations,
+                                                                      streams->pOpacities, NULL, NULL };
+
+    size_t      mappedSize = 0;
+    const void* mapped = NULL;
+    bool        result = true;
+    if (fsStreamMemoryMap(&cache->mStream, &mappedSize, &mapped) && mapped) {
+        const uint8_t* base = (const uint8_t*)mapped;
+        for (uint32_t i = 0; i < SPLAT_CACHE_STREAM_COUNT; i++) {
+            if (dsts[i])
+                memcpy(dsts[i], base + header->mStreams[i].mOffset, header->mStreams[i].mSize);
+        }
+        if (streams->pShs) {
+            splatCacheScatterSh(streams, base + header->mStreams[SPLAT_CACHE_STREAM_SH_DC].mOffset,
+                                base + header->mStreams[SPLAT_CACHE_STREAM_SH_REST].mOffset, 0, numSplats);
+        }
+        if (streams->pColors && streams->pPositions)
+            memcpy(streams->pColors, streams->pPositions, sizeof(struct Tf32x3_s) * numSplats);
+        if (streams->pNormals)
+            memset(streams->pNormals, 0, sizeof(struct Tf32x3_s) * numSplats);
+    } else {
+        result = splatCacheReadRangeSeek(cache, streams, 0, numSplats);
+    }
+    if (!result) {
+        LOGF(eERROR, "Failed to read splat cache streams.");
+        return false;
+    }
+
+    if (outStats) {
+        outStats->mNumSplats = numSplats;
+        outStats->mNumBytes = 0;
+        for (uint32_t i = 0; i < SPLAT_CACHE_STREAM_COUNT; i++)
+            outStats->mNumBytes += header->mStreams[i].mSize;
+        outStats->mDurationUs = getUSec(false) - startUs;
+    }
+    return true;
+}
+
+bool splatCacheReadRange(struct SplatCache* cache, uint64_t first, uint64_t count, const struct SplatStreams* streams) {
+    if (first > cache->mHeader.mNumSplats || count > cache->mHeader.mNumSplats - first)
+        return false;
+    return splatCacheReadRangeSeek(cache, streams, first, count);
+}
+
+static bool splatCacheWritePadding(FileStream* fs, uint64_t* offset) {
+    static const uint8_t zeros[SPLAT_CACHE_STREAM_ALIGNMENT] = {};
+    const uint64_t       padding = splatCacheAlign(*offset) - *offset;
+    *offset += padding;
+    return padding == 0 || fsWriteToStream(fs, zeros, padding) == padding;
+}
+
+bool splatCacheWrite(ResourceDirectory dir, const char* path, uint64_t sourceHash, uint64_t numSplats, uint32_t flags,
+                     const struct SplatStreams* streams) {
+    if (!streams->pPositions || !streams->pScales || !streams->pRotations || !streams->pOpacities || !streams->pShs)
+        return false;
+
+    FileStream fs = {};
+    if (!fsOpenStreamFromPath(dir, path, FM_WRITE, &fs)) {
+        LOGF(eWARNING, "Failed to create splat cache '%s'.", path);
+        return false;
+    }
+
+    struct SplatCacheHeader header = {};
+    header.mVersion = SPLAT_CACHE_VERSION;
+    header.mSourceHash = sourceHash;
+    header.mNumSplats = numSplats;
+    header.mFlags = flags;
+    uint64_t offset = splatCacheAlign(sizeof(struct SplatCacheHeader));
+    for (uint32_t i = 0; i < SPLAT_CACHE_STREAM_COUNT; i++) {
+        header.mStreams[i].mElementSize = gSplatCacheElementSizes[i];
+        header.mStreams[i].mSize = gSplatCacheElementSizes[i] * numSplats;
+        header.mStreams[i].mOffset = offset;
+        offset = splatCacheAlign(offset + header.mStreams[i].mSize);
+    }
+
+    // the magic is only written once every stream landed, a partial cache is never valid
+    bool     result = fsWriteToStream(&fs, &header, sizeof(header)) == sizeof(header);
+    uint64_t written = sizeof(header);
+    const void* const srcs[SPLAT_CACHE_STREAM_COUNT] = { streams->pPositions, streams->pScales, streams->pRotations, streams->pOpacities,
+                                                         NULL, NULL };
+    for (uint32_t i = 0; result && i < SPLAT_CACHE_STREAM_COUNT; i++) {
+        result = splatCacheWritePadding(&fs, &written);
+        if (!result)
+            break;
+        if (srcs[i]) {
+            result = fsWriteToStream(&fs, srcs[i], header.mStreams[i].mSize) == header.mStreams[i].mSize;
+        } else {
+            // gather the SH components out of the interleaved record
+            const uint32_t elementSize = header.mStreams[i].mElementSize;
+            uint8_t*       scratch = (uint8_t*)splatMalloc(elementSize * gSplatCacheShChunk);
+            for (uint64_t first = 0; result && first < numSplats; first += gSplatCacheShChunk) {
+                const uint64_t count = numSplats - first < gSplatCacheShChunk ? numSplats - first : gSplatCacheShChunk;
+                for (uint64_t s = 0; s < count; s++) {
+                    const struct SphericalHarmonics* harmonics = &streams->pShs[first + s];
+                    const void* src = i == SPLAT_CACHE_STREAM_SH_DC ? (const void*)&harmonics->dc : (const void*)harmonics->rest;
+                    memcpy(scratch + s * elementSize, src, elementSize);
+                }
+                result = fsWriteToStream(&fs, scratch, count * elementSize) == count * elementSize;
+            }
+            splatFree(scratch);
+        }
+        written += header.mStreams[i].mSize;
+    }
+
+    if (result) {
+        header.mMagic = SPLAT_CACHE_MAGIC;
+        result = fsSeekStream(&fs, SBO_START_OF_FILE, 0) && fsWriteToStream(&fs, &header, sizeof(header)) == sizeof(header);
+    }
+    fsCloseStream(&fs);
+    if (!result)
+        LOGF(eWARNING, "Failed to write splat cache '%s'.", path);
+    return result;
+}
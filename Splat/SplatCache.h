@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2017-2024 The Forge Interactive Inc.
+ *
+ * This file is part of The-Forge
+ * (see https://github.com/ConfettiFX/The-Forge).
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#pragma once
+
+#include "Splat.h"
+
+#include "Forge/TF_FileSystem.h"
+
+// Native splat cache written after the first load of a PLY. It stores the
+// already deinterleaved streams, each aligned for direct upload, so a later
+// launch reads every stream with one read instead of parsing the PLY.
+#define SPLAT_CACHE_MAGIC 0x48435053u // "SPCH"
+#define SPLAT_CACHE_VERSION 3u
+#define SPLAT_CACHE_STREAM_ALIGNMENT 256u
+
+enum SplatCacheFlags {
+    // streams are stored in Morton order of the positions, see splatMortonReorderStreams
+    SPLAT_CACHE_FLAG_MORTON_ORDER = 1u << 0,
+    // streams are stored coarse to fine, see splatProgressiveOrder, Morton order holds within each level
+    SPLAT_CACHE_FLAG_PROGRESSIVE_ORDER = 1u << 1,
+};
+
+enum SplatCacheStreamType {
+    SPLAT_CACHE_STREAM_POSITION = 0,
+    SPLAT_CACHE_STREAM_SCALE,
+    SPLAT_CACHE_STREAM_ROTATION,
+    SPLAT_CACHE_STREAM_OPACITY,
+    SPLAT_CACHE_STREAM_SH_DC,
+    SPLAT_CACHE_STREAM_SH_REST,
+    SPLAT_CACHE_STREAM_COUNT
+};
+
+struct SplatCacheStream {
+    uint64_t mOffset;
+    uint64_t mSize;
+    uint32_t mElementSize;
+    uint32_t mPadding;
+};
+
+struct SplatCacheHeader {
+    uint32_t mMagic;
+    uint32_t mVersion;
+    uint64_t mSourceHash;
+    uint64_t mNumSplats;
+    uint32_t mFlags; // SplatCacheFlags
+    uint32_t mPadding;
+    struct SplatCacheStream mStreams[SPLAT_CACHE_STREAM_COUNT];
+};
+
+struct SplatCache {
+    FileStream              mStream;
+    struct SplatCacheHeader mHeader;
+};
+
+// Hash identifying the source file fs opened from path in dir: its size and
+// modification time, the PLY header and a few payload blocks sampled from the
+// start, middle and end. The time catches edits in place that keep the size,
+// without reading the whole payload. Leaves the stream at offset 0.
+uint64_t splatCacheHashSource(ResourceDirectory dir, const char* path, FileStream* fs);
+
+// Builds the cache file name for a source path, "a/b/point_cloud.ply" becomes
+// "a_b_point_cloud.splatcache".
+void splatCacheMakePath(const char* sourcePath, char* outPath, size_t outSize);
+
+// Opens a cache and validates it against sourceHash. Returns false for a
+// missing, stale or corrupt cache, the caller then parses the PLY.
+bool splatCacheOpen(ResourceDirectory dir, const char* path, uint64_t sourceHash, struct SplatCache* cache);
+// Reads every stream of an open cache into streams, pNormals are zero filled
+// as 3DGS exports carry no normal data.
+bool splatCacheRead(struct SplatCache* cache, const struct SplatStreams* streams, struct SplatLoadStats* outStats);
+// Reads splats [first, first + count) into the same indices of streams, for
+// loading a cache in batches.
+bool splatCacheReadRange(struct SplatCache* cache, uint64_t first, uint64_t count, const struct SplatStreams* streams);
+void splatCacheClose(struct SplatCache* cache);
+
+// flags describe the streams as passed in (SplatCacheFlags), a later open
+// reports them in mHeader.mFlags.
+bool splatCacheWrite(ResourceDirectory dir, const char* path, uint64_t sourceHash, uint64_t numSplats, uint32_t flags,
+                     const struct SplatStreams* streams);
@@ -0,0 +1,129 @@
+/*
+ * Copyright (c) 2017-2024 The Forge Interactive Inc.
+ *
+ * This file is part of The-Forge
+ * (see https://github.com/ConfettiFX/The-Forge).
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#include "SplatCameraPath.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Forge/TF_Log.h"
+
+void splatCameraKeyFromOrientation(struct Tf32x3_s eye, struct Tf32x4_s orientation, struct SplatCameraKey* outKey) {
+    const float w = orientation.x, x = orientation.y, y = orientation.z, z = orientation.w;
+    const float length = sqrtf(w * w + x * x + y * y + z * z);
+    const float s = length > 0.0f ? 2.0f / (length * length) : 0.0f;
+    // third and second column of the rotation matrix: camera +z and +y in world space
+    const struct Tf32x3_s forward = { s * (x * z + w * y), s * (y * z - w * x), 1.0f - s * (x * x + y * y) };
+    const struct Tf32x3_s down = { s * (x * y - w * z), 1.0f - s * (x * x + z * z), s * (y * z + w * x) };
+    outKey->mEye = eye;
+    outKey->mTarget = { eye.x + forward.x, eye.y + forward.y, eye.z + forward.z };
+    outKey->mUp = { -down.x, -down.y, -down.z };
+}
+
+bool splatCameraPathLoad(ResourceDirectory resourceDir, const char* path, float defaultFovY, struct SplatCameraPath* outPath) {
+    memset(outPath, 0, sizeof(struct SplatCameraPath));
+    FileStream fh = {};
+    if (!fsOpenStreamFromPath(resourceDir, path, FM_READ, &fh)) {
+        LOGF(eERROR, "Failed to open camera path %s.", path);
+        return false;
+    }
+    const ssize_t fileSize = fsGetStreamFileSize(&fh);
+    char*         text = (char*)splatMalloc(fileSize > 0 ? (size_t)fileSize + 1 : 1);
+    const size_t  textSize = fileSize > 0 ? fsReadFromStream(&fh, text, (size_t)fileSize) : 0;
+    text[textSize] = '\0';
+    fsCloseStream(&fh);
+
+    uint32_t capacity = 0;
+    for (size_t i = 0; i < textSize; i++)
+        capacity += text[i] == '\n' ? 1 : 0;
+    outPath->pKeys = (struct SplatCameraKey*)splatMalloc(sizeof(struct SplatCameraKey) * (capacity + 1));
+
+    bool  success = true;
+    char* line = text;
+    for (uint32_t lineIdx = 1; line && *line; lineIdx++) {
+        char* next = strchr(line, '\n');
+        if (next)
+            *next++ = '\0';
+        while (*line == ' ' || *line == '\t')
+            line++;
+        if (*line && *line != '#' && *line != '\r') {
+            struct SplatCameraKey* key = &outPath->pKeys[outPath->mNumKeys];
+            float                  fovDegrees = 0.0f;
+            int                    numValues;
+            if (*line == 'q') {
+                struct Tf32x4_s q; // w in x like the splat rotations
+                numValues = sscanf(line + 1, "%f %f %f %f %f %f %f %f", &key->mEye.x, &key->mEye.y, &key->mEye.z, &q.x, &q.y, &q.z, &q.w,
+                                   &fovDegrees);
+                if (numValues < 7) {
+                    LOGF(eERROR, "%s:%u: expected eye and orientation.", path, lineIdx);
+                    success = false;
+                    break;
+                }
+                splatCameraKeyFromOrientation(key->mEye, q, key);
+                numValues--;
+            } else {
+                numValues = sscanf(line, "%f %f %f %f %f %f %f", &key->mEye.x, &key->mEye.y, &key->mEye.z, &key->mTarget.x, &key->mTarget.y,
+                                   &key->mTarget.z, &fovDegrees);
+                if (numValues < 6) {
+                    LOGF(eERROR, "%s:%u: expected eye and target.", path, lineIdx);
+                    success = false;
+                    break;
+                }
+                key->mUp = { 0.0f, -1.0f, 0.0f };
+            }
+            key->mFovY = numValues == 7 ? fovDegrees * 3.14159265f / 180.0f : defaultFovY;
+            outPath->mNumKeys++;
+        }
+        line = next;
+    }
+    splatFree(text);
+    if (!success || !outPath->mNumKeys) {
+        if (success)
+            LOGF(eERROR, "Camera path %s has no frames.", path);
+        splatCameraPathFree(outPath);
+        return false;
+    }
+    return true;
+}
+
+void splatCameraPathOrbit(struct Tf32x3_s center, float radius, float height, float fovY, uint32_t numKeys,
+                          struct SplatCameraPath* outPath) {
+    outPath->pKeys = (struct SplatCameraKey*)splatMalloc(sizeof(struct SplatCameraKey) * numKeys);
+    outPath->mNumKeys = numKeys;
+    for (uint32_t i = 0; i < numKeys; i++) {
+        const float angle = 2.0f * 3.14159265f * (float)i / (float)numKeys;
+        outPath->pKeys[i].mEye = { center.x + radius * cosf(angle), center.y + height, center.z + radius * sinf(angle) };
+        outPath->pKeys[i].mTarget = center;
+        outPath->pKeys[i].mUp = { 0.0f, -1.0f, 0.0f };
+        outPath->pKeys[i].mFovY = fovY;
+    }
+}
+
+void splatCameraPathFree(struct SplatCameraPath* path) {
+    splatFree(path->pKeys);
+    memset(path, 0, sizeof(struct SplatCameraPath));
+}
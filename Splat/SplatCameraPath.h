@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2017-2024 The Forge Interactive Inc.
+ *
+ * This file is part of The-Forge
+ * (see https://github.com/ConfettiFX/The-Forge).
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#pragma once
+
+#include "Splat.h"
+
+#include "Forge/TF_FileSystem.h"
+
+// Recorded camera paths for benchmarks. A path file is plain text with one
+// frame per line, either
+//
+//   eye x y z, target x y z [, vertical fov in degrees]
+//   q eye x y z, orientation w x y z [, vertical fov in degrees]
+//
+// where the orientation is the camera to world rotation of a camera looking
+// down +z with +y down, the SplatCamera convention. Look-at frames have +y
+// down as up vector. Empty lines and lines starting with # are skipped.
+
+struct SplatCameraKey {
+    struct Tf32x3_s mEye;
+    struct Tf32x3_s mTarget;
+    struct Tf32x3_s mUp;
+    float           mFovY; // radians
+};
+
+struct SplatCameraPath {
+    struct SplatCameraKey* pKeys;
+    uint32_t               mNumKeys;
+};
+
+// Look-at frame of a camera at eye with the camera to world rotation
+// orientation (w in x like the splat rotations).
+void splatCameraKeyFromOrientation(struct Tf32x3_s eye, struct Tf32x4_s orientation, struct SplatCameraKey* outKey);
+bool splatCameraPathLoad(ResourceDirectory resourceDir, const char* path, float defaultFovY, struct SplatCameraPath* outPath);
+// numKeys frames on a circle around center, looking at it.
+void splatCameraPathOrbit(struct Tf32x3_s center, float radius, float height, float fovY, uint32_t numKeys,
+                          struct SplatCameraPath* outPath);
+void splatCameraPathFree(struct SplatCameraPath* path);
@@ -0,0 +1,174 @@
+/*
+ * Copyright (c) 2017-2024 The Forge Interactive Inc.
+ *
+ * This file is part of The-Forge
+ * (see https://github.com/ConfettiFX/The-Forge).
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "SplatChunk.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "Forge/TF_Log.h"
+#include "Forge/Core/TF_Time.h"
+
+#include "SplatMorton.h"
+
+void splatChunkBlockStreams(void* block, uint32_t chunkCapacity, struct SplatStreams* outStreams) {
+    uint8_t* cursor = (uint8_t*)block;
+    memset(outStreams, 0, sizeof(struct SplatStreams));
+    outStreams->pPositions = (struct Tf32x3_s*)cursor;
+    cursor += sizeof(struct Tf32x3_s) * chunkCapacity;
+    outStreams->pScales = (struct Tf32x3_s*)cursor;
+    cursor += sizeof(struct Tf32x3_s) * chunkCapacity;
+    outStreams->pRotations = (struct Tf32x4_s*)cursor;
+    cursor += sizeof(struct Tf32x4_s) * chunkCapacity;
+    outStreams->pOpacities = (float*)cursor;
+    cursor += sizeof(float) * chunkCapacity;
+    outStreams->pShs = (struct SphericalHarmonics*)cursor;
+}
+
+static void splatChunkBounds(const struct SplatStreams* streams, uint64_t first, uint64_t count, float outMin[3], float outMax[3]) {
+    for (uint32_t axis = 0; axis < 3; axis++) {
+        outMin[axis] = INFINITY;
+        outMax[axis] = -INFINITY;
+    }
+    for (uint64_t i = first; i < first + count; i++) {
+        const struct Tf32x3_s p = streams->pPositions[i];
+        const struct Tf32x3_s s = streams->pScales[i];
+        const float           radius = 3.0f * expf(fmaxf(s.x, fmaxf(s.y, s.z)));
+        // fminf and fmaxf drop NaN
+        for (uint32_t axis = 0; axis < 3; axis++) {
+            outMin[axis] = fminf(outMin[axis], p.v[axis] - radius);
+            outMax[axis] = fmaxf(outMax[axis], p.v[axis] + radius);
+        }
+    }
+}
+
+bool splatChunkWriteFile(ThreadSystem threadSystem, ResourceDirectory dir, const char* path, uint32_t chunkCapacity, uint64_t numSplats,
+                         const struct SplatStreams* streams, struct SplatChunkWriteStats* outStats) {
+    if (!streams->pPositions || !streams->pScales || !streams->pRotations || !streams->pOpacities || !streams->pShs || numSplats == 0 ||
+        chunkCapacity == 0 || (numSplats + chunkCapacity - 1) / chunkCapacity > UINT32_MAX)
+        return false;
+
+    const int64_t startUs = getUSec(false);
+    if (!splatMortonReorderStreams(threadSystem, streams, numSplats, false))
+        return false;
+
+    FileStream fs = {};
+    if (!fsOpenStreamFromPath(dir, path, FM_WRITE, &fs)) {
+        LOGF(eERROR, "Failed to create splat chunk file '%s'.", path);
+        return false;
+    }
+
+    struct SplatChunkFileHeader header = {};
+    header.mVersion = SPLAT_CHUNK_VERSION;
+    header.mNumChunks = (uint32_t)((numSplats + chunkCapacity - 1) / chunkCapacity);
+    header.mChunkCapacity = chunkCapacity;
+    header.mNumSplats = numSplats;
+    splatChunkBounds(streams, 0, numSplats, header.mBoundsMin, header.mBoundsMax);
+
+    const uint64_t          blockSize = splatChunkBlockSize(chunkCapacity);
+    struct SplatChunkInfo*  chunks = (struct SplatChunkInfo*)splatCalloc(header.mNumChunks, sizeof(struct SplatChunkInfo));
+    uint8_t*                block = (uint8_t*)splatCalloc(1, blockSize);
+    struct SplatStreams     blockStreams;
+    splatChunkBlockStreams(block, chunkCapacity, &blockStreams);
+
+    // the header block is rewritten with the magic once everything landed
+    bool     result = fsWriteToStream(&fs, block, SPLAT_CHUNK_BLOCK_ALIGNMENT) == SPLAT_CHUNK_BLOCK_ALIGNMENT;
+    uint64_t offset = SPLAT_CHUNK_BLOCK_ALIGNMENT;
+    for (uint32_t chunk = 0; result && chunk < header.mNumChunks; chunk++) {
+        const uint64_t first = (uint64_t)chunk * chunkCapacity;
+        const uint64_t count = numSplats - first < chunkCapacity ? numSplats - first : chunkCapacity;
+        struct SplatChunkInfo* info = &chunks[chunk];
+        info->mNumSplats = (uint32_t)count;
+        info->mOffset = offset;
+        splatChunkBounds(streams, first, count, info->mBoundsMin, info->mBoundsMax);
+
+        if (count < chunkCapacity)
+            memset(block, 0, blockSize);
+        memcpy(blockStreams.pPositions, streams->pPositions + first, sizeof(struct Tf32x3_s) * count);
+        memcpy(blockStreams.pScales, streams->pScales + first, sizeof(struct Tf32x3_s) * count);
+        memcpy(blockStreams.pRotations, streams->pRotations + first, sizeof(struct Tf32x4_s) * count);
+        memcpy(blockStreams.pOpacities, streams->pOpacities + first, sizeof(float) * count);
+        memcpy(blockStreams.pShs, streams->pShs + first, sizeof(struct SphericalHarmonics) * count);
+        result = fsWriteToStream(&fs, block, blockSize) == blockSize;
+        offset += blockSize;
+    }
+
+    header.mTableOffset = offset;
+    const uint64_t tableSize = sizeof(struct SplatChunkInfo) * header.mNumChunks;
+    result = result && fsWriteToStream(&fs, chunks, tableSize) == tableSize;
+    if (result) {
+        header.mMagic = SPLAT_CHUNK_MAGIC;
+        result = fsSeekStream(&fs, SBO_START_OF_FILE, 0) && fsWriteToStream(&fs, &header, sizeof(header)) == sizeof(header);
+    }
+    fsCloseStream(&fs);
+    splatFree(block);
+    splatFree(chunks);
+    if (!result) {
+        LOGF(eERROR, "Failed to write splat chunk file '%s'.", path);
+        return false;
+    }
+
+    if (outStats) {
+        outStats->mNumChunks = header.mNumChunks;
+        outStats->mNumBytes = offset + tableSize;
+        outStats->mDurationUs = getUSec(false) - startUs;
+    }
+    return true;
+}
+
+bool splatChunkOpenFile(ResourceDirectory dir, const char* path, struct SplatChunkFile* outFile) {
+    memset(outFile, 0, sizeof(struct SplatChunkFile));
+    FileStream fs = {};
+    if (!fsOpenStreamFromPath(dir, path, FM_READ, &fs))
+        return false;
+
+    struct SplatChunkFileHeader* header = &outFile->mHeader;
+    const uint64_t               fileSize = (uint64_t)fsGetStreamFileSize(&fs);
+    bool valid = fsReadFromStream(&fs, header, sizeof(struct SplatChunkFileHeader)) == sizeof(struct SplatChunkFileHeader) &&
+                 header->mMagic == SPLAT_CHUNK_MAGIC && header->mVersion == SPLAT_CHUNK_VERSION && header->mNumChunks > 0 &&
+                 header->mChunkCapacity > 0 && header->mTableOffset + sizeof(struct SplatChunkInfo) * header->mNumChunks <= fileSize;
+    if (valid) {
+        const uint64_t tableSize = sizeof(struct SplatChunkInfo) * header->mNumChunks;
+        outFile->pChunks = (struct SplatChunkInfo*)splatMalloc(tableSize);
+        valid = fsSeekStream(&fs, SBO_START_OF_FILE, (ssize_t)header->mTableOffset) &&
+                fsReadFromStream(&fs, outFile->pChunks, tableSize) == tableSize;
+        const uint64_t blockSize = splatChunkBlockSize(header->mChunkCapacity);
+        for (uint32_t chunk = 0; valid && chunk < header->mNumChunks; chunk++) {
+            const struct SplatChunkInfo* info = &outFile->pChunks[chunk];
+            valid = info->mNumSplats <= header->mChunkCapacity && info->mOffset + blockSize <= fileSize;
+        }
+    }
+    fsCloseStream(&fs);
+    if (!valid) {
+        LOGF(eERROR, "Splat chunk file '%s' is missing or corrupt.", path);
+        splatChunkCloseFile(outFile);
+        return false;
+    }
+    return true;
+}
+
+void splatChunkCloseFile(struct SplatChunkFile* file) {
+    splatFree(file->pChunks);
+    memset(file, 0, sizeof(struct SplatChunkFile));
+}
@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2017-2024 The Forge Interactive Inc.
+ *
+ * This file is part of The-Forge
+ * (see https://github.com/ConfettiFX/The-Forge).
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#pragma once
+
+#include "Splat.h"
+
+#include "Forge/TF_FileSystem.h"
+
+// Chunked scene file for out of core streaming. The splats are sorted by
+// Morton code and cut into runs of mChunkCapacity splats, so every chunk is
+// spatially compact. A chunk is stored as one block laid out like a
+// resident slot of SplatStreamer (positions, scales, rotations, opacities,
+// then shs, each mChunkCapacity entries long), so loading a chunk is a single
+// read straight into its slot. Blocks are aligned to
+// SPLAT_CHUNK_BLOCK_ALIGNMENT.
+#define SPLAT_CHUNK_MAGIC 0x4b4e4853u // "SHNK"
+#define SPLAT_CHUNK_VERSION 1u
+#define SPLAT_CHUNK_BLOCK_ALIGNMENT 4096u
+#define SPLAT_CHUNK_DEFAULT_CAPACITY 16384u
+
+struct SplatChunkFileHeader {
+    uint32_t mMagic;
+    uint32_t mVersion;
+    uint32_t mNumChunks;
+    uint32_t mChunkCapacity; // splats per chunk block
+    uint64_t mNumSplats;
+    uint64_t mTableOffset; // array of mNumChunks SplatChunkInfo
+    float    mBoundsMin[3];
+    float    mBoundsMax[3];
+};
+
+struct SplatChunkInfo {
+    float    mBoundsMin[3]; // splat centers widened by their 3 sigma radius
+    float    mBoundsMax[3];
+    uint32_t mNumSplats;
+    uint32_t mPadding;
+    uint64_t mOffset;
+};
+
+struct SplatChunkFile {
+    struct SplatChunkFileHeader mHeader;
+    struct SplatChunkInfo*      pChunks;
+};
+
+struct SplatChunkWriteStats {
+    uint64_t mNumChunks;
+    uint64_t mNumBytes;
+    int64_t  mDurationUs;
+};
+
+// Bytes of one chunk block and of a resident slot.
+static inline uint64_t splatChunkBlockSize(uint32_t chunkCapacity) {
+    const uint64_t size = (uint64_t)chunkCapacity * (sizeof(struct Tf32x3_s) * 2 + sizeof(struct Tf32x4_s) + sizeof(float) +
+                                                     sizeof(struct SphericalHarmonics));
+    return (size + SPLAT_CHUNK_BLOCK_ALIGNMENT - 1) & ~(uint64_t)(SPLAT_CHUNK_BLOCK_ALIGNMENT - 1);
+}
+
+// Points streams at the arrays of a chunk block or slot.
+void splatChunkBlockStreams(void* block, uint32_t chunkCapacity, struct SplatStreams* outStreams);
+
+// Partitions the scene and writes it. Reorders streams in place by Morton code.
+bool splatChunkWriteFile(ThreadSystem threadSystem, ResourceDirectory dir, const char* path, uint32_t chunkCapacity, uint64_t numSplats,
+                         const struct SplatStreams* streams, struct SplatChunkWriteStats* outStats);
+
+// Reads and validates the header and chunk table.
+bool splatChunkOpenFile(ResourceDirectory dir, const char* path, struct SplatChunkFile* outFile);
+void splatChunkCloseFile(struct SplatChunkFile* file);
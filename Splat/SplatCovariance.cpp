@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) 2017-2024 The Forge Interactive Inc.
+ *
+ * This file is part of The-Forge
+ * (see https://github.com/ConfettiFX/The-Forge).
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "SplatCovariance.h"
+
+#include <math.h>
+#include <string.h>
+
+// largest finite half, larger entries would turn into infinities
+static const float gSplatCovarianceHalfMax = 65504.0f;
+// 2^112, moves the exponent of a half shifted into float position to the float bias
+static const float gSplatCovarianceHalfRebias = 5.192296858534828e33f;
+
+void splatCovarianceCompute(struct Tf32x3_s logScale, struct Tf32x4_s rotation, float outSigma[6]) {
+    const struct Tf32x4_s q = rotation;
+    const float qLen = sqrtf(q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w);
+    const float qInv = qLen > 0.0f ? 1.0f / qLen : 0.0f;
+    const float r = q.x * qInv, x = q.y * qInv, y = q.z * qInv, z = q.w * qInv;
+    const float s[3] = { expf(logScale.x), expf(logScale.y), expf(logScale.z) };
+    const float rot[9] = {
+        1.0f - 2.0f * (y * y + z * z), 2.0f * (x * y - r * z),        2.0f * (x * z + r * y),
+        2.0f * (x * y + r * z),        1.0f - 2.0f * (x * x + z * z), 2.0f * (y * z - r * x),
+        2.0f * (x * z - r * y),        2.0f * (y * z + r * x),        1.0f - 2.0f * (x * x + y * y),
+    };
+    float m[9];
+    for (uint32_t row = 0; row < 3; row++) {
+        for (uint32_t col = 0; col < 3; col++)
+            m[row * 3 + col] = rot[row * 3 + col] * s[col];
+    }
+    outSigma[0] = m[0] * m[0] + m[1] * m[1] + m[2] * m[2];
+    outSigma[1] = m[0] * m[3] + m[1] * m[4] + m[2] * m[5];
+    outSigma[2] = m[0] * m[6] + m[1] * m[7] + m[2] * m[8];
+    outSigma[3] = m[3] * m[3] + m[4] * m[4] + m[5] * m[5];
+    outSigma[4] = m[3] * m[6] + m[4] * m[7] + m[5] * m[8];
+    outSigma[5] = m[6] * m[6] + m[7] * m[7] + m[8] * m[8];
+}
+
+bool splatCovariancesBuild(const struct SplatStreams* streams, uint64_t numSplats, uint32_t mode, struct SplatCovariances* outCovariances) {
+    memset(outCovariances, 0, sizeof(struct SplatCovariances));
+    if (mode == SPLAT_COVARIANCE_ON_THE_FLY)
+        return true;
+    if (!streams->pScales || !streams->pRotations || numSplats == 0)
+        return false;
+
+    if (mode == SPLAT_COVARIANCE_F32) {
+        outCovariances->pF32 = (float*)splatMalloc(sizeof(float) * 6 * numSplats);
+        if (!outCovariances->pF32)
+            return false;
+        for (uint64_t i = 0; i < numSplats; i++)
+            splatCovarianceCompute(streams->pScales[i], streams->pRotations[i], &outCovariances->pF32[i * 6]);
+    } else {
+        outCovariances->pF16 = (uint16_t*)splatMalloc(sizeof(uint16_t) * 6 * numSplats);
+        if (!outCovariances->pF16)
+            return false;
+        // sigma of 3DGS splats sits far below 1, a half would flush most of it to subnormals: scale the largest
+        // diagonal of the scene (which bounds every entry) up to the top of the half range, by a power of two
+        float maxDiagonal = 0.0f;
+        for (uint64_t i = 0; i < numSplats; i++) {
+            float sigma[6];
+            splatCovarianceCompute(streams->pScales[i], streams->pRotations[i], sigma);
+            maxDiagonal = fmaxf(maxDiagonal, fmaxf(sigma[0], fmaxf(sigma[3], sigma[5])));
+        }
+        int exponent = 0;
+        frexpf(maxDiagonal > 0.0f && isfinite(maxDiagonal) ? maxDiagonal : 1.0f, &exponent);
+        const float scale = ldexpf(1.0f, 15 - exponent);
+        for (uint64_t i = 0; i < numSplats; i++) {
+            float sigma[6];
+            splatCovarianceCompute(streams->pScales[i], streams->pRotations[i], sigma);
+            for (uint32_t k = 0; k < 6; k++) {
+                const float value = fminf(gSplatCovarianceHalfMax, fmaxf(-gSplatCovarianceHalfMax, sigma[k] * scale));
+                outCovariances->pF16[i * 6 + k] = splatFloatToHalf(value);
+            }
+        }
+        outCovariances->mF16Scale = gSplatCovarianceHalfRebias / scale;
+    }
+    outCovariances->mMode = mode;
+    outCovariances->mNumSplats = numSplats;
+    return true;
+}
+
+void splatCovariancesFree(struct SplatCovariances* covariances) {
+    splatFree(covariances->pF32);
+    splatFree(covariances->pF16);
+    memset(covariances, 0, sizeof(struct SplatCovariances));
+}
+
+uint32_t splatCovarianceStride(uint32_t mode) {
+    switch (mode) {
+    case SPLAT_COVARIANCE_F32:
+        return sizeof(float) * 6;
+    case SPLAT_COVARIANCE_F16:
+        return sizeof(uint16_t) * 6;
+    default:
+        return 0;
+    }
+}
@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2017-2024 The Forge Interactive Inc.
+ *
+ * This file is part of The-Forge
+ * (see https://github.com/ConfettiFX/The-Forge).
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#pragma once
+
+#include "Splat.h"
+
+// Load time stage that stores the activated 3D covariance of every splat,
+// sigma = R S S^T R^T with exp applied to the log scales and the quaternion
+// normalized. Projection then fetches six floats and only does the
+// J W sigma W^T J^T sandwich per frame instead of rebuilding sigma from the
+// scale and rotation streams. The streams are kept, so the stage trades 24
+// (f32) or 12 (f16) bytes per splat for the exp, normalize and R S products.
+
+enum SplatCovarianceMode {
+    SPLAT_COVARIANCE_ON_THE_FLY, // nothing stored, projection builds sigma
+    SPLAT_COVARIANCE_F32,
+    // scaled by a power of two so the largest entry of the scene fits a half, about 1e-3 relative
+    // error per entry, which the conic of a needle thin splat amplifies
+    SPLAT_COVARIANCE_F16,
+};
+
+// Upper triangle of sigma, xx xy xz yy yz zz, per splat.
+struct SplatCovariances {
+    uint32_t  mMode; // SplatCovarianceMode
+    uint64_t  mNumSplats;
+    float*    pF32; // 6 per splat with SPLAT_COVARIANCE_F32
+    uint16_t* pF16; // 6 per splat with SPLAT_COVARIANCE_F16
+    float     mF16Scale; // a stored half times this is sigma
+};
+
+// The on the fly path, shared by the stage and the projection so both agree.
+void splatCovarianceCompute(struct Tf32x3_s logScale, struct Tf32x4_s rotation, float outSigma[6]);
+
+// Builds outCovariances from the scales and rotations of streams. Leaves it
+// empty and returns true for SPLAT_COVARIANCE_ON_THE_FLY.
+bool splatCovariancesBuild(const struct SplatStreams* streams, uint64_t numSplats, uint32_t mode, struct SplatCovariances* outCovariances);
+void splatCovariancesFree(struct SplatCovariances* covariances);
+
+// Bytes per splat of mode.
+uint32_t splatCovarianceStride(uint32_t mode);
+
+// True when covariances holds a stored sigma for every splat a projection may fetch.
+static inline bool splatCovariancesStored(const struct SplatCovariances* covariances) {
+    return covariances && (covariances->pF32 || covariances->pF16);
+}
+
+static inline void splatCovarianceFetch(const struct SplatCovariances* covariances, uint64_t i, float outSigma[6]) {
+    if (covariances->pF32) {
+        memcpy(outSigma, &covariances->pF32[i * 6], sizeof(float) * 6);
+    } else {
+        // the build never stores infinities or NaNs, so a half widens by moving its bits up and rebiasing the
+        // exponent with one multiply, which also gets subnormals right; the rebias is folded into mF16Scale
+        const uint16_t* halves = &covariances->pF16[i * 6];
+        for (uint32_t k = 0; k < 6; k++) {
+            const uint32_t bits = ((uint32_t)(halves[k] & 0x8000u) << 16) | ((uint32_t)(halves[k] & 0x7fffu) << 13);
+            float          value;
+            memcpy(&value, &bits, sizeof(value));
+            outSigma[k] = value * covariances->mF16Scale;
+        }
+    }
+}
@@ -0,0 +1,181 @@
+/*
+ * Copyright (c) 2017-2024 The Forge Interactive Inc.
+ *
+ * This file is part of The-Forge
+ * (see https://github.com/ConfettiFX/The-Forge).
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#include "SplatDepthSort.h"
+
+#include <string.h>
+
+#include "Forge/Core/TF_Time.h"
+
+void splatDepthSorterInit(struct SplatDepthSorter* sorter, ThreadSystem threadSystem, uint64_t numSplats,
+                          const struct Tf32x3_s* positions) {
+    sorter->mNumSplats = numSplats;
+    sorter->pPositions = positions;
+    sorter->mThreadSystem = threadSystem;
+    sorter->mDisorderThreshold = 4.0f;
+    sorter->mMaxMovesPerSplat = 8;
+    sorter->pOrder = (uint32_t*)splatMalloc(sizeof(uint32_t) * numSplats);
+    sorter->pDepths = (float*)splatMalloc(sizeof(float) * numSplats);
+    sorter->pKeys = (uint64_t*)splatMalloc(sizeof(uint64_t) * numSplats);
+    splatSortScratchInit(&sorter->mScratch);
+    splatSortScratchReserve(&sorter->mScratch, numSplats);
+    sorter->mHasOrder = false;
+    memset(sorter->mDepthRow, 0, sizeof(sorter->mDepthRow));
+    sorter->pPublished[0] = (uint32_t*)splatMalloc(sizeof(uint32_t) * numSplats);
+    sorter->pPublished[1] = (uint32_t*)splatMalloc(sizeof(uint32_t) * numSplats);
+    sorter->mPublishedIndex.store(0);
+    sorter->mPublishedVersion.store(0);
+    sorter->mBusy.store(false);
+    memset(&sorter->mStats, 0, sizeof(sorter->mStats));
+    for (uint64_t i = 0; i < numSplats; i++)
+        sorter->pOrder[i] = (uint32_t)i;
+}
+
+void splatDepthSorterExit(struct SplatDepthSorter* sorter) {
+    if (sorter->mThreadSystem && sorter->mBusy.load(std::memory_order_acquire))
+        threadSystemWaitIdle(sorter->mThreadSystem);
+    splatFree(sorter->pOrder);
+    splatFree(sorter->pDepths);
+    splatFree(sorter->pKeys);
+    splatFree(sorter->pPublished[0]);
+    splatFree(sorter->pPublished[1]);
+    splatSortScratchExit(&sorter->mScratch);
+    sorter->pOrder = NULL;
+    sorter->pDepths = NULL;
+    sorter->pKeys = NULL;
+    sorter->pPublished[0] = NULL;
+    sorter->pPublished[1] = NULL;
+    sorter->mNumSplats = 0;
+}
+
+// Estimates how many slots an insertion pass moves every splat: the moves
+// equal the number of inversions, which are counted against a window of
+// preceding splats at evenly spaced samples. The window caps the cost for
+// orders that are far from sorted.
+static float splatDepthMeasureDisorder(const float* depths, uint64_t count) {
+    const uint64_t numSamples = count < 4096 ? count : 4096;
+    const uint64_t window = 64;
+    uint64_t       inversions = 0;
+    for (uint64_t sample = 0; sample < numSamples; sample++) {
+        const uint64_t i = sample * count / numSamples;
+        for (uint64_t j = i > window ? i - window : 0; j < i; j++)
+            inversions += depths[j] < depths[i] ? 1 : 0;
+    }
+    return numSamples ? (float)inversions / (float)numSamples : 0.0f;
+}
+
+// Insertion pass over the nearly sorted order, far to near. Returns false
+// when it ran out of moves; the order is still a valid permutation then.
+static bool splatDepthRepair(uint32_t* order, float* depths, uint64_t count, uint64_t maxMoves) {
+    uint64_t moves = 0;
+    for (uint64_t i = 1; i < count; i++) {
+        const float    depth = depths[i];
+        const uint32_t splat = order[i];
+        uint64_t       j = i;
+        while (j > 0 && depths[j - 1] < depth) {
+            depths[j] = depths[j - 1];
+            order[j] = order[j - 1];
+            j--;
+        }
+        depths[j] = depth;
+        order[j] = splat;
+        moves += i - j;
+        if (moves > maxMoves)
+            return false;
+    }
+    return true;
+}
+
+void splatDepthSort(struct SplatDepthSorter* sorter, const float depthRow[4]) {
+    const int64_t  startUs = getUSec(false);
+    const uint64_t count = sorter->mNumSplats;
+    uint32_t*      order = sorter->pOrder;
+    float*         depths = sorter->pDepths;
+
+    // depths in the order of the previous frame, so both paths read them linearly
+    for (uint64_t i = 0; i < count; i++) {
+        const struct Tf32x3_s p = sorter->pPositions[order[i]];
+        depths[i] = depthRow[0] * p.x + depthRow[1] * p.y + depthRow[2] * p.z + depthRow[3];
+    }
+    const float disorder = splatDepthMeasureDisorder(depths, count);
+
+    bool full = !sorter->mHasOrder || disorder > sorter->mDisorderThreshold;
+    if (sorter->mHasOrder && full)
+        sorter->mStats.mNumDisorderFallbacks++;
+    if (!full) {
+        full = !splatDepthRepair(order, depths, count, count * sorter->mMaxMovesPerSplat);
+        if (full)
+            sorter->mStats.mNumBudgetFallbacks++;
+        else
+            sorter->mStats.mNumIncremental++;
+    }
+    if (full) {
+        for (uint64_t i = 0; i < count; i++)
+            sorter->pKeys[i] = splatDepthKey(depths[i]);
+        // this may run on a worker, which must not wait on its own thread system
+        splatRadixSort(NULL, &sorter->mScratch, sorter->pKeys, order, count, NULL);
+        sorter->mStats.mNumFull++;
+    }
+    sorter->mHasOrder = true;
+
+    const uint32_t target = sorter->mPublishedIndex.load(std::memory_order_relaxed) ^ 1u;
+    memcpy(sorter->pPublished[target], order, sizeof(uint32_t) * count);
+    sorter->mPublishedIndex.store(target, std::memory_order_release);
+    sorter->mPublishedVersion.fetch_add(1, std::memory_order_release);
+
+    sorter->mStats.mNumSorts++;
+    sorter->mStats.mLastDisorder = disorder;
+    sorter->mStats.mLastDurationUs = getUSec(false) - startUs;
+}
+
+static void splatDepthSortTaskFunc(void* user, uint64_t) {
+    struct SplatDepthSorter* sorter = (struct SplatDepthSorter*)user;
+    splatDepthSort(sorter, sorter->mDepthRow);
+    sorter->mBusy.store(false, std::memory_order_release);
+}
+
+bool splatDepthSorterKick(struct SplatDepthSorter* sorter, const float depthRow[4]) {
+    if (sorter->mBusy.load(std::memory_order_acquire)) {
+        sorter->mStats.mNumSkippedKicks++;
+        return false;
+    }
+    memcpy(sorter->mDepthRow, depthRow, sizeof(sorter->mDepthRow));
+    if (!sorter->mThreadSystem) {
+        splatDepthSort(sorter, sorter->mDepthRow);
+        return true;
+    }
+    sorter->mBusy.store(true, std::memory_order_release);
+    threadSystemAddTask(sorter->mThreadSystem, splatDepthSortTaskFunc, sorter);
+    return true;
+}
+
+bool splatDepthSorterIsBusy(const struct SplatDepthSorter* sorter) { return sorter->mBusy.load(std::memory_order_acquire); }
+
+const uint32_t* splatDepthSorterAcquire(const struct SplatDepthSorter* sorter, uint64_t* outVersion) {
+    const uint64_t version = sorter->mPublishedVersion.load(std::memory_order_acquire);
+    if (outVersion)
+        *outVersion = version;
+    return version ? sorter->pPublished[sorter->mPublishedIndex.load(std::memory_order_acquire)] : NULL;
+}
@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2017-2024 The Forge Interactive Inc.
+ *
+ * This file is part of The-Forge
+ * (see https://github.com/ConfettiFX/The-Forge).
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+
+#include "Splat.h"
+#include "SplatSort.h"
+
+// Back to front depth order of all splats that exploits frame to frame
+// coherence. The permutation of the previous frame is kept; when the camera
+// moved a little it is repaired with an insertion pass, when the measured
+// disorder (sampled insertion distance) is above a threshold, or the repair
+// runs over its move budget, it is rebuilt with splatRadixSort.
+//
+// Sorting can run on a worker of the thread system. splatDepthSorterKick
+// starts a sort for a view unless one is still in flight and the finished
+// order is published double buffered, so the renderer draws with the order
+// of an earlier frame and never waits for the sort.
+
+// Maps a float to a key that sorts ascending like the float, then inverts it
+// so the radix sort yields far to near.
+static inline uint64_t splatDepthKey(float depth) {
+    uint32_t bits;
+    memcpy(&bits, &depth, sizeof(bits));
+    bits ^= (bits & 0x80000000u) ? 0xffffffffu : 0x80000000u;
+    return (uint64_t)~bits;
+}
+
+struct SplatDepthSortStats {
+    uint64_t mNumSorts;
+    uint64_t mNumIncremental; // repaired with the insertion pass
+    uint64_t mNumFull; // rebuilt with the radix sort, for any reason
+    uint64_t mNumDisorderFallbacks; // full because the disorder was above the threshold
+    uint64_t mNumBudgetFallbacks; // full because the insertion pass ran over its budget
+    uint64_t mNumSkippedKicks; // kicks dropped while a sort was in flight
+    float    mLastDisorder; // estimated insertion moves per splat before the last sort
+    int64_t  mLastDurationUs;
+};
+
+struct SplatDepthSorter {
+    uint64_t               mNumSplats;
+    const struct Tf32x3_s* pPositions;
+    ThreadSystem           mThreadSystem;
+
+    // estimated insertion moves per splat above which the order is rebuilt
+    float mDisorderThreshold;
+    // insertion moves per splat the repair may spend before it gives up
+    uint32_t mMaxMovesPerSplat;
+
+    // working state, owned by the sort while it runs
+    uint32_t*               pOrder;
+    float*                  pDepths; // depth of pOrder[i]
+    uint64_t*               pKeys;
+    struct SplatSortScratch mScratch;
+    bool                    mHasOrder;
+    float                   mDepthRow[4]; // camera forward row of the view being sorted
+
+    uint32_t*             pPublished[2];
+    std::atomic<uint32_t> mPublishedIndex;
+    std::atomic<uint64_t> mPublishedVersion; // 0 until the first sort finished
+    std::atomic<bool>     mBusy;
+
+    struct SplatDepthSortStats mStats;
+};
+
+void splatDepthSorterInit(struct SplatDepthSorter* sorter, ThreadSystem threadSystem, uint64_t numSplats, const struct Tf32x3_s* positions);
+// Waits for a sort in flight before freeing.
+void splatDepthSorterExit(struct SplatDepthSorter* sorter);
+
+// Sorts for the view on the calling thread and publishes the result.
+// depthRow is the row of the world to view matrix that yields view depth.
+void splatDepthSort(struct SplatDepthSorter* sorter, const float depthRow[4]);
+// Starts splatDepthSort on a worker. Returns false and drops the view when
+// the previous sort is still running.
+bool splatDepthSorterKick(struct SplatDepthSorter* sorter, const float depthRow[4]);
+bool splatDepthSorterIsBusy(const struct SplatDepthSorter* sorter);
+
+// Latest published back to front order, NULL before the first sort. The
+// buffer stays valid until the sort after the next one is kicked, callers
+// copy it out before kicking again.
+const uint32_t* splatDepthSorterAcquire(const struct SplatDepthSorter* sorter, uint64_t* outVersion);
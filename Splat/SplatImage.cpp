@@ -0,0 +1,233 @@
+/*
+ * Copyright (c) 2017-2024 The Forge Interactive Inc.
+ *
+ * This file is part of The-Forge
+ * (see https://github.com/ConfettiFX/The-Forge).
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#include "SplatImage.h"
+
+#include <string.h>
+
+#include "Forge/TF_Log.h"
+
+static uint32_t splatCrc32(uint32_t crc, const uint8_t* data, size_t size) {
+    static uint32_t table[256];
+    static bool     tableReady = false;
+    if (!tableReady) {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (uint32_t k = 0; k < 8; k++)
+                c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            table[i] = c;
+        }
+        tableReady = true;
+    }
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++)
+        crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    return ~crc;
+}
+
+static inline void splatStoreBe32(uint8_t* dst, uint32_t value) {
+    dst[0] = (uint8_t)(value >> 24);
+    dst[1] = (uint8_t)(value >> 16);
+    dst[2] = (uint8_t)(value >> 8);
+    dst[3] = (uint8_t)value;
+}
+
+static bool splatWritePngChunk(FileStream* fs, const char* type, const uint8_t* data, uint32_t size) {
+    uint8_t header[8];
+    splatStoreBe32(header, size);
+    memcpy(header + 4, type, 4);
+    uint32_t crc = splatCrc32(0, header + 4, 4);
+    crc = splatCrc32(crc, data, size);
+    uint8_t footer[4];
+    splatStoreBe32(footer, crc);
+    return fsWriteToStream(fs, header, sizeof(header)) == sizeof(header) && (size == 0 || fsWriteToStream(fs, data, size) == size) &&
+           fsWriteToStream(fs, footer, sizeof(footer)) == sizeof(footer);
+}
+
+static inline uint8_t splatToUnorm8(float value) {
+    value = value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);
+    return (uint8_t)(value * 255.0f + 0.5f);
+}
+
+bool splatWritePng(ResourceDirectory dir, const char* path, uint32_t width, uint32_t height, const float* rgb) {
+    // raw scanlines with a filter byte each, wrapped in a zlib stream of stored blocks
+    const size_t rowBytes = (size_t)width * 3 + 1;
+    const size_t rawSize = rowBytes * height;
+    const size_t maxBlock = 65535;
+    const size_t numBlocks = rawSize / maxBlock + 1;
+    const size_t zlibSize = 2 + numBlocks * 5 + rawSize + 4;
+    uint8_t*     zlib = (uint8_t*)splatMalloc(zlibSize);
+
+    uint8_t* raw = (uint8_t*)splatMalloc(rawSize);
+    for (uint32_t y = 0; y < height; y++) {
+        uint8_t* row = raw + y * rowBytes;
+        row[0] = 0;
+        for (uint32_t x = 0; x < width * 3; x++)
+            row[1 + x] = splatToUnorm8(rgb[(size_t)y * width * 3 + x]);
+    }
+
+    size_t   cursor = 0;
+    uint32_t adlerA = 1, adlerB = 0;
+    zlib[cursor++] = 0x78;
+    zlib[cursor++] = 0x01;
+    for (size_t offset = 0, block = 0; block < numBlocks; block++) {
+        const size_t size = rawSize - offset < maxBlock ? rawSize - offset : maxBlock;
+        zlib[cursor++] = block + 1 == numBlocks ? 1 : 0;
+        zlib[cursor++] = (uint8_t)(size & 0xff);
+        zlib[cursor++] = (uint8_t)(size >> 8);
+        zlib[cursor++] = (uint8_t)(~size & 0xff);
+        zlib[cursor++] = (uint8_t)((~size >> 8) & 0xff);
+        memcpy(zlib + cursor, raw + offset, size);
+        for (size_t i = 0; i < size; i++) {
+            adlerA = (adlerA + raw[offset + i]) % 65521;
+            adlerB = (adlerB + adlerA) % 65521;
+        }
+        cursor += size;
+        offset += size;
+    }
+    splatStoreBe32(zlib + cursor, (adlerB << 16) | adlerA);
+    cursor += 4;
+    splatFree(raw);
+
+    uint8_t ihdr[13];
+    splatStoreBe32(ihdr, width);
+    splatStoreBe32(ihdr + 4, height);
+    ihdr[8] = 8; // bit depth
+    ihdr[9] = 2; // truecolor
+    ihdr[10] = 0;
+    ihdr[11] = 0;
+    ihdr[12] = 0;
+
+    FileStream fs = {};
+    bool       result = fsOpenStreamFromPath(dir, path, FM_WRITE, &fs);
+    if (result) {
+        static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+        result = fsWriteToStream(&fs, signature, sizeof(signature)) == sizeof(signature) &&
+                 splatWritePngChunk(&fs, "IHDR", ihdr, sizeof(ihdr)) && splatWritePngChunk(&fs, "IDAT", zlib, (uint32_t)cursor) &&
+                 splatWritePngChunk(&fs, "IEND", NULL, 0);
+        fsCloseStream(&fs);
+    }
+    splatFree(zlib);
+    if (!result)
+        LOGF(eERROR, "Failed to write '%s'.", path);
+    return result;
+}
+
+static void splatExrAttribute(uint8_t** cursor, const char* name, const char* type, const void* value, uint32_t size) {
+    const size_t nameLen = strlen(name) + 1;
+    const size_t typeLen = strlen(type) + 1;
+    memcpy(*cursor, name, nameLen);
+    *cursor += nameLen;
+    memcpy(*cursor, type, typeLen);
+    *cursor += typeLen;
+    memcpy(*cursor, &size, sizeof(size));
+    *cursor += sizeof(size);
+    memcpy(*cursor, value, size);
+    *cursor += size;
+}
+
+bool splatWriteExr(ResourceDirectory dir, const char* path, uint32_t width, uint32_t height, const float* rgb) {
+    uint8_t  header[512];
+    uint8_t* cursor = header;
+    const uint32_t magic = 20000630;
+    const uint32_t version = 2;
+    memcpy(cursor, &magic, 4);
+    memcpy(cursor + 4, &version, 4);
+    cursor += 8;
+
+    // channels are stored in alphabetical order
+    uint8_t  channels[3 * 18 + 1];
+    uint8_t* channel = channels;
+    const char* names[3] = { "B", "G", "R" };
+    for (uint32_t c = 0; c < 3; c++) {
+        const int32_t pixelType = 2; // FLOAT
+        const int32_t sampling = 1;
+        *channel++ = (uint8_t)names[c][0];
+        *channel++ = 0;
+        memcpy(channel, &pixelType, 4);
+        channel += 4;
+        memset(channel, 0, 4); // pLinear and reserved
+        channel += 4;
+        memcpy(channel, &sampling, 4);
+        memcpy(channel + 4, &sampling, 4);
+        channel += 8;
+    }
+    *channel++ = 0;
+    splatExrAttribute(&cursor, "channels", "chlist", channels, (uint32_t)(channel - channels));
+    const uint8_t compression = 0;
+    splatExrAttribute(&cursor, "compression", "compression", &compression, 1);
+    const int32_t window[4] = { 0, 0, (int32_t)width - 1, (int32_t)height - 1 };
+    splatExrAttribute(&cursor, "dataWindow", "box2i", window, sizeof(window));
+    splatExrAttribute(&cursor, "displayWindow", "box2i", window, sizeof(window));
+    const uint8_t lineOrder = 0;
+    splatExrAttribute(&cursor, "lineOrder", "lineOrder", &lineOrder, 1);
+    const float one = 1.0f;
+    splatExrAttribute(&cursor, "pixelAspectRatio", "float", &one, sizeof(one));
+    const float center[2] = { 0.0f, 0.0f };
+    splatExrAttribute(&cursor, "screenWindowCenter", "v2f", center, sizeof(center));
+    splatExrAttribute(&cursor, "screenWindowWidth", "float", &one, sizeof(one));
+    *cursor++ = 0;
+
+    const size_t headerSize = (size_t)(cursor - header);
+    const size_t lineBytes = (size_t)width * 3 * sizeof(float);
+    const size_t lineChunk = 8 + lineBytes;
+    uint64_t*    offsets = (uint64_t*)splatMalloc(sizeof(uint64_t) * height);
+    for (uint32_t y = 0; y < height; y++)
+        offsets[y] = headerSize + sizeof(uint64_t) * height + (uint64_t)y * lineChunk;
+
+    uint8_t* line = (uint8_t*)splatMalloc(lineChunk);
+    FileStream fs = {};
+    bool       result = fsOpenStreamFromPath(dir, path, FM_WRITE, &fs);
+    if (result) {
+        result = fsWriteToStream(&fs, header, headerSize) == headerSize &&
+                 fsWriteToStream(&fs, offsets, sizeof(uint64_t) * height) == sizeof(uint64_t) * height;
+        for (uint32_t y = 0; result && y < height; y++) {
+            const int32_t lineY = (int32_t)y;
+            const int32_t size = (int32_t)lineBytes;
+            memcpy(line, &lineY, 4);
+            memcpy(line + 4, &size, 4);
+            float* dst = (float*)(line + 8);
+            for (uint32_t c = 0; c < 3; c++) {
+                const uint32_t srcChannel = 2 - c;
+                for (uint32_t x = 0; x < width; x++)
+                    dst[c * width + x] = rgb[((size_t)y * width + x) * 3 + srcChannel];
+            }
+            result = fsWriteToStream(&fs, line, lineChunk) == lineChunk;
+        }
+        fsCloseStream(&fs);
+    }
+    splatFree(line);
+    splatFree(offsets);
+    if (!result)
+        LOGF(eERROR, "Failed to write '%s'.", path);
+    return result;
+}
+
+bool splatWriteImage(ResourceDirectory dir, const char* path, uint32_t width, uint32_t height, const float* rgb) {
+    const char* ext = strrchr(path, '.');
+    if (ext && (strcmp(ext, ".exr") == 0 || strcmp(ext, ".EXR") == 0))
+        return splatWriteExr(dir, path, width, height, rgb);
+    return splatWritePng(dir, path, width, height, rgb);
+}
@@ -0,0 +1,38 @@
+/*
+ * Copyright (c) 2017-2024 The Forge Interactive Inc.
+ *
+ * This file is part of The-Forge
+ * (see https://github.com/ConfettiFX/The-Forge).
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#pragma once
+
+#include "Splat.h"
+
+#include "Forge/TF_FileSystem.h"
+
+// Writers for linear float RGB images (width * height * 3 floats, rows top to
+// bottom). PNG is written as 8 bit RGB with stored deflate blocks, EXR as
+// uncompressed 32 bit float scanlines.
+bool splatWritePng(ResourceDirectory dir, const char* path, uint32_t width, uint32_t height, const float* rgb);
+bool splatWriteExr(ResourceDirectory dir, const char* path, uint32_t width, uint32_t height, const float* rgb);
+// Picks the writer from the extension of path.
+bool splatWriteImage(ResourceDirectory dir, const char* path, uint32_t width, uint32_t height, const float* rgb);
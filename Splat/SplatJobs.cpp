@@ -0,0 +1,356 @@
+/*
+ * Copyright (c) 2017-2024 The Forge Interactive Inc.
+ *
+ * This file is part of The-Forge
+ * (see https://github.com/ConfettiFX/The-Forge).
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "SplatJobs.h"
+
+#include <string.h>
+#include <thread>
+
+#include "Forge/TF_Log.h"
+#include "Forge/Core/TF_Time.h"
+#include "Common_3/Application/Interfaces/IProfiler.h"
+
+// A job is a stage index and a span of its ranges packed into 64 bits.
+#define SPLAT_JOB_RANGE_BITS 28
+#define SPLAT_JOB_MAX_RANGES ((1ull << SPLAT_JOB_RANGE_BITS) - 1)
+
+// failed steal rounds before an idle worker yields its time slice
+static const uint32_t gSplatJobSpinRounds = 64;
+
+static inline uint64_t splatJobEncode(uint32_t stage, uint64_t begin, uint64_t end) {
+    return ((uint64_t)stage << (2 * SPLAT_JOB_RANGE_BITS)) | (begin << SPLAT_JOB_RANGE_BITS) | end;
+}
+
+static inline void splatJobDecode(uint64_t job, uint32_t* outStage, uint64_t* outBegin, uint64_t* outEnd) {
+    *outStage = (uint32_t)(job >> (2 * SPLAT_JOB_RANGE_BITS));
+    *outBegin = (job >> SPLAT_JOB_RANGE_BITS) & SPLAT_JOB_MAX_RANGES;
+    *outEnd = job & SPLAT_JOB_MAX_RANGES;
+}
+
+// Fixed size Chase-Lev deque, see "Correct and Efficient Work-Stealing for
+// Weak Memory Models" (Le et al.). The owner pushes and pops at the bottom,
+// thieves take from the top.
+static bool splatJobPush(struct SplatJobWorker* worker, uint64_t job) {
+    const int64_t bottom = worker->mBottom.load(std::memory_order_relaxed);
+    const int64_t top = worker->mTop.load(std::memory_order_acquire);
+    if (bottom - top >= SPLAT_JOB_DEQUE_SIZE)
+        return false;
+    worker->mJobs[bottom & (SPLAT_JOB_DEQUE_SIZE - 1)].store(job, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    worker->mBottom.store(bottom + 1, std::memory_order_relaxed);
+    return true;
+}
+
+static bool splatJobPop(struct SplatJobWorker* worker, uint64_t* outJob) {
+    const int64_t bottom = worker->mBottom.load(std::memory_order_relaxed) - 1;
+    worker->mBottom.store(bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t top = worker->mTop.load(std::memory_order_relaxed);
+    if (top > bottom) {
+        worker->mBottom.store(bottom + 1, std::memory_order_relaxed);
+        return false;
+    }
+    *outJob = worker->mJobs[bottom & (SPLAT_JOB_DEQUE_SIZE - 1)].load(std::memory_order_relaxed);
+    if (top == bottom) {
+        // last job, race the thieves for it
+        const bool won = worker->mTop.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+        worker->mBottom.store(bottom + 1, std::memory_order_relaxed);
+        return won;
+    }
+    return true;
+}
+
+static bool splatJobSteal(struct SplatJobWorker* victim, uint64_t* outJob) {
+    int64_t top = victim->mTop.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const int64_t bottom = victim->mBottom.load(std::memory_order_acquire);
+    if (top >= bottom)
+        return false;
+    *outJob = victim->mJobs[top & (SPLAT_JOB_DEQUE_SIZE - 1)].load(std::memory_order_relaxed);
+    return victim->mTop.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+}
+
+static bool splatJobStealAny(struct SplatJobSystem* system, uint32_t thiefIdx, uint64_t* outJob) {
+    struct SplatJobWorker* thief = &system->mWorkers[thiefIdx];
+    // xorshift, so thieves do not all start at the same victim
+    thief->mRandom ^= thief->mRandom << 13;
+    thief->mRandom ^= thief->mRandom >> 17;
+    thief->mRandom ^= thief->mRandom << 5;
+    const uint32_t first = thief->mRandom % system->mNumWorkers;
+    for (uint32_t i = 0; i < system->mNumWorkers; i++) {
+        const uint32_t victimIdx = (first + i) % system->mNumWorkers;
+        if (victimIdx != thiefIdx && splatJobSteal(&system->mWorkers[victimIdx], outJob)) {
+            thief->mNumSteals++;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Resolves the count and the ranges of a stage whose dependencies are done.
+static void splatJobPrepareStage(struct SplatJobStage* stage, int64_t runStartUs) {
+    stage->mReadyUs = getUSec(false) - runStartUs;
+    if (stage->mCountFunc)
+        stage->mCount = stage->mCountFunc(stage->pUser);
+    if (stage->mGrainSize == 0)
+        stage->mGrainSize = 1;
+    if ((stage->mCount + stage->mGrainSize - 1) / stage->mGrainSize > SPLAT_JOB_MAX_RANGES)
+        stage->mGrainSize = (stage->mCount + SPLAT_JOB_MAX_RANGES - 1) / SPLAT_JOB_MAX_RANGES;
+    stage->mNumRanges = (stage->mCount + stage->mGrainSize - 1) / stage->mGrainSize;
+}
+
+// Runs ranges [first, last) of a stage, returns the time spent.
+static int64_t splatJobStageRun(struct SplatJobStage* stage, uint64_t first, uint64_t last) {
+    const bool    profiled = stage->mProfileToken != SPLAT_JOB_NO_PROFILE;
+    const int64_t startUs = getUSec(false);
+    for (uint64_t range = first; range < last; range++) {
+        const uint64_t begin = range * stage->mGrainSize;
+        const uint64_t end = begin + stage->mGrainSize < stage->mCount ? begin + stage->mGrainSize : stage->mCount;
+        const uint64_t tick = profiled ? cpuProfileEnter((ProfileToken)stage->mProfileToken) : 0;
+        stage->mFunc(stage->pUser, begin, end);
+        if (profiled)
+            cpuProfileLeave((ProfileToken)stage->mProfileToken, tick);
+    }
+    const int64_t busyUs = getUSec(false) - startUs;
+    stage->mBusyUs.fetch_add(busyUs, std::memory_order_relaxed);
+    return busyUs;
+}
+
+static void splatJobRunRanges(struct SplatJobSystem* system, struct SplatJobWorker* worker, uint32_t stageIdx, uint64_t first,
+                              uint64_t last);
+
+// Hands the ranges of a stage whose dependencies are done to worker, or runs
+// them right away when its deque is full.
+static void splatJobStageReady(struct SplatJobSystem* system, struct SplatJobWorker* worker, uint32_t stageIdx);
+
+static void splatJobStageDone(struct SplatJobSystem* system, struct SplatJobWorker* worker, uint32_t stageIdx) {
+    struct SplatJobGraph* graph = system->pGraph;
+    struct SplatJobStage* stage = &graph->mStages[stageIdx];
+    stage->mDoneUs = getUSec(false) - system->mRunStartUs;
+    for (uint32_t i = 0; i < stage->mNumDependents; i++) {
+        struct SplatJobStage* dependent = &graph->mStages[stage->mDependents[i]];
+        if (dependent->mPendingDeps.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            splatJobStageReady(system, worker, stage->mDependents[i]);
+    }
+    // after the dependents are queued, so the run cannot end in between
+    system->mPendingStages.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+static void splatJobStageReady(struct SplatJobSystem* system, struct SplatJobWorker* worker, uint32_t stageIdx) {
+    struct SplatJobStage* stage = &system->pGraph->mStages[stageIdx];
+    splatJobPrepareStage(stage, system->mRunStartUs);
+    if (stage->mNumRanges == 0) {
+        splatJobStageDone(system, worker, stageIdx);
+        return;
+    }
+    stage->mPendingRanges.store(stage->mNumRanges, std::memory_order_relaxed);
+    if (!splatJobPush(worker, splatJobEncode(stageIdx, 0, stage->mNumRanges)))
+        splatJobRunRanges(system, worker, stageIdx, 0, stage->mNumRanges);
+}
+
+static void splatJobRunRanges(struct SplatJobSystem* system, struct SplatJobWorker* worker, uint32_t stageIdx, uint64_t first,
+                              uint64_t last) {
+    struct SplatJobStage* stage = &system->pGraph->mStages[stageIdx];
+    const int64_t         busyUs = splatJobStageRun(stage, first, last);
+    worker->mBusyUs += busyUs;
+    worker->mNumRanges += last - first;
+    if (stage->mPendingRanges.fetch_sub(last - first, std::memory_order_acq_rel) == last - first)
+        splatJobStageDone(system, worker, stageIdx);
+}
+
+static void splatJobExecute(struct SplatJobSystem* system, struct SplatJobWorker* worker, uint64_t job) {
+    uint32_t stageIdx;
+    uint64_t begin, end;
+    splatJobDecode(job, &stageIdx, &begin, &end);
+    // keep the lower half, offer the upper half to thieves
+    while (end - begin > 1) {
+        const uint64_t mid = begin + (end - begin) / 2;
+        if (!splatJobPush(worker, splatJobEncode(stageIdx, mid, end)))
+            break;
+        end = mid;
+    }
+    splatJobRunRanges(system, worker, stageIdx, begin, end);
+}
+
+static void splatJobWorkerLoop(struct SplatJobSystem* system, uint32_t workerIdx) {
+    struct SplatJobWorker* worker = &system->mWorkers[workerIdx];
+    uint32_t               idleRounds = 0;
+    while (system->mPendingStages.load(std::memory_order_acquire)) {
+        uint64_t job;
+        if (splatJobPop(worker, &job) || splatJobStealAny(system, workerIdx, &job)) {
+            splatJobExecute(system, worker, job);
+            idleRounds = 0;
+        } else if (++idleRounds > gSplatJobSpinRounds) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+static void splatJobWorkerTask(void* user, uint64_t) {
+    struct SplatJobSystem* system = (struct SplatJobSystem*)user;
+    // a task that starts after its run ended joins the next one or leaves, the run
+    // waits for active workers after closing so it never frees state under one
+    system->mActiveWorkers.fetch_add(1, std::memory_order_seq_cst);
+    system->mQueuedTasks.fetch_sub(1, std::memory_order_relaxed);
+    if (system->mOpen.load(std::memory_order_seq_cst)) {
+        const uint32_t workerIdx = system->mNextWorker.fetch_add(1, std::memory_order_relaxed);
+        if (workerIdx < system->mNumWorkers)
+            splatJobWorkerLoop(system, workerIdx);
+    }
+    system->mActiveWorkers.fetch_sub(1, std::memory_order_release);
+}
+
+void splatJobSystemInit(struct SplatJobSystem* system, ThreadSystem threadSystem, uint32_t numWorkers) {
+    memset((void*)system, 0, sizeof(struct SplatJobSystem));
+    const uint32_t maxWorkers = threadSystem ? threadSystemGetNumThreads(threadSystem) + 1 : 1;
+    if (numWorkers > maxWorkers)
+        numWorkers = maxWorkers;
+    if (numWorkers > SPLAT_JOB_MAX_WORKERS)
+        numWorkers = SPLAT_JOB_MAX_WORKERS;
+    system->mThreadSystem = threadSystem;
+    system->mNumWorkers = numWorkers ? numWorkers : 1;
+    for (uint32_t i = 0; i < SPLAT_JOB_MAX_WORKERS; i++)
+        system->mWorkers[i].mRandom = 0x9e3779b9u * (i + 1);
+}
+
+void splatJobSystemExit(struct SplatJobSystem* system) {
+    // tasks of the last run that did not start yet still point at the system
+    while (system->mQueuedTasks.load(std::memory_order_acquire) || system->mActiveWorkers.load(std::memory_order_acquire))
+        std::this_thread::yield();
+    system->mNumWorkers = 0;
+}
+
+void splatJobGraphReset(struct SplatJobGraph* graph) { graph->mNumStages = 0; }
+
+uint32_t splatJobGraphAddStage(struct SplatJobGraph* graph, const char* name, uint64_t count, uint64_t grainSize, SplatRangeFunc func,
+                               void* user) {
+    ASSERT(graph->mNumStages < SPLAT_JOB_MAX_STAGES);
+    const uint32_t        stageIdx = graph->mNumStages++;
+    struct SplatJobStage* stage = &graph->mStages[stageIdx];
+    stage->pName = name;
+    stage->mFunc = func;
+    stage->mCountFunc = NULL;
+    stage->pUser = user;
+    stage->mCount = count;
+    stage->mGrainSize = grainSize;
+    stage->mNumDeps = 0;
+    stage->mProfileToken = SPLAT_JOB_NO_PROFILE;
+    return stageIdx;
+}
+
+uint32_t splatJobGraphAddDeferredStage(struct SplatJobGraph* graph, const char* name, SplatJobCountFunc countFunc, uint64_t grainSize,
+                                       SplatRangeFunc func, void* user) {
+    const uint32_t stageIdx = splatJobGraphAddStage(graph, name, 0, grainSize, func, user);
+    graph->mStages[stageIdx].mCountFunc = countFunc;
+    return stageIdx;
+}
+
+void splatJobGraphAddDependency(struct SplatJobGraph* graph, uint32_t stage, uint32_t dependency) {
+    ASSERT(dependency < stage && stage < graph->mNumStages);
+    ASSERT(graph->mStages[stage].mNumDeps < SPLAT_JOB_MAX_DEPS);
+    graph->mStages[stage].mDeps[graph->mStages[stage].mNumDeps++] = dependency;
+}
+
+void splatJobGraphRun(struct SplatJobSystem* system, struct SplatJobGraph* graph, struct SplatJobStats* outStats) {
+    const int64_t startUs = getUSec(false);
+    for (uint32_t stageIdx = 0; stageIdx < graph->mNumStages; stageIdx++) {
+        struct SplatJobStage* stage = &graph->mStages[stageIdx];
+        stage->mNumDependents = 0;
+        stage->mNumRanges = 0;
+        stage->mPendingDeps.store(stage->mNumDeps, std::memory_order_relaxed);
+        stage->mBusyUs.store(0, std::memory_order_relaxed);
+        stage->mReadyUs = 0;
+        stage->mDoneUs = 0;
+    }
+    for (uint32_t stageIdx = 0; stageIdx < graph->mNumStages; stageIdx++) {
+        for (uint32_t dep = 0; dep < graph->mStages[stageIdx].mNumDeps; dep++) {
+            struct SplatJobStage* dependency = &graph->mStages[graph->mStages[stageIdx].mDeps[dep]];
+            dependency->mDependents[dependency->mNumDependents++] = stageIdx;
+        }
+    }
+
+    if (!system || !system->mThreadSystem || system->mNumWorkers < 2) {
+        // stages were added after their dependencies, so the add order is a valid order
+        for (uint32_t stageIdx = 0; stageIdx < graph->mNumStages; stageIdx++) {
+            struct SplatJobStage* stage = &graph->mStages[stageIdx];
+            splatJobPrepareStage(stage, startUs);
+            splatJobStageRun(stage, 0, stage->mNumRanges);
+            stage->mDoneUs = getUSec(false) - startUs;
+        }
+        if (outStats) {
+            memset(outStats, 0, sizeof(struct SplatJobStats));
+            outStats->mNumWorkers = 1;
+            for (uint32_t stageIdx = 0; stageIdx < graph->mNumStages; stageIdx++) {
+                outStats->mNumRanges += graph->mStages[stageIdx].mNumRanges;
+                outStats->mBusyUs += graph->mStages[stageIdx].mBusyUs.load(std::memory_order_relaxed);
+            }
+            outStats->mDurationUs = getUSec(false) - startUs;
+        }
+        return;
+    }
+
+    system->pGraph = graph;
+    system->mRunStartUs = startUs;
+    for (uint32_t workerIdx = 0; workerIdx < system->mNumWorkers; workerIdx++) {
+        struct SplatJobWorker* worker = &system->mWorkers[workerIdx];
+        worker->mTop.store(0, std::memory_order_relaxed);
+        worker->mBottom.store(0, std::memory_order_relaxed);
+        worker->mNumRanges = 0;
+        worker->mNumSteals = 0;
+        worker->mBusyUs = 0;
+    }
+    system->mPendingStages.store(graph->mNumStages, std::memory_order_relaxed);
+    system->mNextWorker.store(1, std::memory_order_relaxed);
+    system->mOpen.store(true, std::memory_order_seq_cst);
+
+    // tasks still queued from an earlier run join this one
+    const uint32_t queued = system->mQueuedTasks.load(std::memory_order_relaxed);
+    if (queued < system->mNumWorkers - 1) {
+        const uint32_t numTasks = system->mNumWorkers - 1 - queued;
+        system->mQueuedTasks.fetch_add(numTasks, std::memory_order_relaxed);
+        threadSystemAddTaskGroup(system->mThreadSystem, splatJobWorkerTask, numTasks, system);
+    }
+
+    for (uint32_t stageIdx = 0; stageIdx < graph->mNumStages; stageIdx++) {
+        if (graph->mStages[stageIdx].mNumDeps == 0)
+            splatJobStageReady(system, &system->mWorkers[0], stageIdx);
+    }
+    splatJobWorkerLoop(system, 0);
+
+    system->mOpen.store(false, std::memory_order_seq_cst);
+    while (system->mActiveWorkers.load(std::memory_order_seq_cst))
+        std::this_thread::yield();
+
+    if (outStats) {
+        memset(outStats, 0, sizeof(struct SplatJobStats));
+        const uint32_t joined = system->mNextWorker.load(std::memory_order_relaxed);
+        outStats->mNumWorkers = joined < system->mNumWorkers ? joined : system->mNumWorkers;
+        for (uint32_t workerIdx = 0; workerIdx < system->mNumWorkers; workerIdx++) {
+            outStats->mNumRanges += system->mWorkers[workerIdx].mNumRanges;
+            outStats->mNumSteals += system->mWorkers[workerIdx].mNumSteals;
+            outStats->mBusyUs += system->mWorkers[workerIdx].mBusyUs;
+        }
+        outStats->mDurationUs = getUSec(false) - startUs;
+    }
+}
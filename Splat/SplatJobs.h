@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2017-2024 The Forge Interactive Inc.
+ *
+ * This file is part of The-Forge
+ * (see https://github.com/ConfettiFX/The-Forge).
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+
+#include "Splat.h"
+
+// Work stealing scheduler for the per frame splat pipeline. A frame is a
+// graph of stages (cull, project, SH, bin, sort, ...), each a parallel for
+// over [0, count) in ranges of grainSize, with explicit dependencies between
+// stages. A stage becomes ready when the last range of everything it
+// depends on finished, so independent stages overlap and a stage never
+// waits on a global barrier.
+//
+// Every worker owns a fixed size deque of jobs. A job covers a span of
+// ranges of one stage; the worker that pops it pushes back its upper half
+// until a single range is left, which it runs, so idle workers steal large
+// spans from the top of busy deques. Workers run as tasks of the TF thread
+// system and the calling thread works as worker 0. Unlike splatParallelFor
+// a run does not wait for the thread system to go idle, so other tasks in
+// flight (the depth sort) do not stall it. Running a graph does not
+// allocate.
+
+#define SPLAT_JOB_MAX_WORKERS 64
+#define SPLAT_JOB_MAX_STAGES 32
+#define SPLAT_JOB_MAX_DEPS 4
+#define SPLAT_JOB_DEQUE_SIZE 256
+// mProfileToken of a stage that is not profiled
+#define SPLAT_JOB_NO_PROFILE UINT64_MAX
+
+// Called once when the dependencies of a stage are done, returns the count
+// of the stage, for stages whose size depends on an earlier one.
+typedef uint64_t (*SplatJobCountFunc)(void* user);
+
+struct SplatJobStage {
+    const char*       pName;
+    SplatRangeFunc    mFunc;
+    SplatJobCountFunc mCountFunc; // optional, replaces mCount
+    void*             pUser;
+    uint64_t          mCount;
+    uint64_t          mGrainSize;
+    uint32_t          mDeps[SPLAT_JOB_MAX_DEPS]; // stages added earlier
+    uint32_t          mNumDeps;
+    uint64_t          mProfileToken; // ProfileToken every range is timed with, or SPLAT_JOB_NO_PROFILE
+
+    // set by the run
+    uint32_t              mDependents[SPLAT_JOB_MAX_STAGES];
+    uint32_t              mNumDependents;
+    uint64_t              mNumRanges;
+    std::atomic<uint32_t> mPendingDeps;
+    std::atomic<uint64_t> mPendingRanges;
+    std::atomic<int64_t>  mBusyUs; // summed over workers
+    int64_t               mReadyUs; // from the start of the run
+    int64_t               mDoneUs;
+};
+
+struct SplatJobGraph {
+    uint32_t             mNumStages;
+    struct SplatJobStage mStages[SPLAT_JOB_MAX_STAGES];
+};
+
+struct alignas(64) SplatJobWorker {
+    std::atomic<int64_t>  mTop;
+    std::atomic<int64_t>  mBottom;
+    std::atomic<uint64_t> mJobs[SPLAT_JOB_DEQUE_SIZE];
+    uint64_t              mNumRanges;
+    uint64_t              mNumSteals;
+    int64_t               mBusyUs;
+    uint32_t              mRandom;
+};
+
+struct SplatJobSystem {
+    ThreadSystem          mThreadSystem;
+    uint32_t              mNumWorkers;
+    struct SplatJobGraph* pGraph;
+    int64_t               mRunStartUs;
+    std::atomic<uint32_t> mPendingStages;
+    std::atomic<bool>     mOpen; // workers may join the run
+    std::atomic<uint32_t> mNextWorker;
+    std::atomic<uint32_t> mActiveWorkers;
+    std::atomic<uint32_t> mQueuedTasks; // handed to the thread system, not started yet
+    struct SplatJobWorker mWorkers[SPLAT_JOB_MAX_WORKERS];
+};
+
+struct SplatJobStats {
+    uint32_t mNumWorkers; // workers that joined the run, the caller included
+    uint64_t mNumRanges;
+    uint64_t mNumSteals;
+    int64_t  mDurationUs;
+    int64_t  mBusyUs; // summed over workers, mBusyUs / (mDurationUs * mNumWorkers) is the utilization
+};
+
+// numWorkers counts the calling thread and is clamped to the thread system
+// threads + 1. threadSystem may be NULL, or numWorkers 1, to run graphs
+// inline in stage order.
+void splatJobSystemInit(struct SplatJobSystem* system, ThreadSystem threadSystem, uint32_t numWorkers);
+void splatJobSystemExit(struct SplatJobSystem* system);
+
+void     splatJobGraphReset(struct SplatJobGraph* graph);
+// Returns the index of the new stage, func gets ranges of [0, count).
+uint32_t splatJobGraphAddStage(struct SplatJobGraph* graph, const char* name, uint64_t count, uint64_t grainSize, SplatRangeFunc func,
+                               void* user);
+// Like splatJobGraphAddStage, the count comes from countFunc once the
+// dependencies are done.
+uint32_t splatJobGraphAddDeferredStage(struct SplatJobGraph* graph, const char* name, SplatJobCountFunc countFunc, uint64_t grainSize,
+                                       SplatRangeFunc func, void* user);
+// stage runs after dependency, which must have been added before it.
+void     splatJobGraphAddDependency(struct SplatJobGraph* graph, uint32_t stage, uint32_t dependency);
+
+// Runs every stage of the graph and returns when all are done. system may be
+// NULL to run inline. Must not be called from a thread system task. Stage
+// timings are left in the stages of the graph.
+void splatJobGraphRun(struct SplatJobSystem* system, struct SplatJobGraph* graph, struct SplatJobStats* outStats);
+
+// Wall time of a stage in the last run, from ready to done.
+static inline int64_t splatJobStageUs(const struct SplatJobStage* stage) { return stage->mDoneUs - stage->mReadyUs; }
@@ -0,0 +1,468 @@
+/*
+ * Copyright (c) 2017-2024 The Forge Interactive Inc.
+ *
+ * This file is part of The-Forge
+ * (see https://github.com/ConfettiFX/The-Forge).
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "SplatLod.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "Forge/Core/TF_Time.h"
+
+#include "SplatDepthSort.h"
+#include "SplatMorton.h"
+
+static const float gSplatLodMinOpacity = 1e-4f;
+static const float gSplatLodMaxOpacity = 0.999f;
+
+uint64_t splatLodMergedCount(uint64_t numSplats) {
+    uint64_t count = 0;
+    for (uint64_t level = numSplats; level > 1; level = (level + SPLAT_LOD_BRANCHING - 1) / SPLAT_LOD_BRANCHING)
+        count += (level + SPLAT_LOD_BRANCHING - 1) / SPLAT_LOD_BRANCHING;
+    return count;
+}
+
+// Node attributes, for a splat from the source streams, for a merged node from the LOD.
+struct SplatLodNode {
+    struct Tf32x3_s                  mPosition;
+    struct Tf32x3_s                  mScale; // log space
+    struct Tf32x4_s                  mRotation;
+    float                            mOpacity; // logit
+    const struct SphericalHarmonics* pSh;
+    float                            mError;
+    uint32_t                         mNumLeaves;
+};
+
+static void splatLodGetNode(const struct SplatLod* lod, const struct SplatStreams* streams, uint32_t id, struct SplatLodNode* out) {
+    const bool                 merged = id >= lod->mNumSplats;
+    const struct SplatStreams* src = merged ? &lod->mMerged : streams;
+    const uint64_t             index = merged ? id - lod->mNumSplats : id;
+    out->mPosition = src->pPositions[index];
+    out->mScale = src->pScales[index];
+    out->mRotation = src->pRotations[index];
+    out->mOpacity = src->pOpacities[index];
+    out->pSh = &src->pShs[index];
+    out->mError = merged ? lod->pErrors[index] : 0.0f;
+    out->mNumLeaves = merged ? lod->pNumLeaves[index] : 1;
+}
+
+// sigma = R S S^T R^T as xx xy xz yy yz zz, same convention as the rasterizer
+static void splatLodCovariance(const struct SplatLodNode* node, double outSigma[6]) {
+    const struct Tf32x4_s q = node->mRotation;
+    const float           qLen = sqrtf(q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w);
+    const float           qInv = qLen > 0.0f ? 1.0f / qLen : 0.0f;
+    const float           r = q.x * qInv, x = q.y * qInv, y = q.z * qInv, z = q.w * qInv;
+    const float           s[3] = { expf(node->mScale.x), expf(node->mScale.y), expf(node->mScale.z) };
+    const float           rot[9] = {
+        1.0f - 2.0f * (y * y + z * z), 2.0f * (x * y - r * z),        2.0f * (x * z + r * y),
+        2.0f * (x * y + r * z),        1.0f - 2.0f * (x * x + z * z), 2.0f * (y * z - r * x),
+        2.0f * (x * z - r * y),        2.0f * (y * z + r * x),        1.0f - 2.0f * (x * x + y * y),
+    };
+    double m[9];
+    for (uint32_t row = 0; row < 3; row++) {
+        for (uint32_t col = 0; col < 3; col++)
+            m[row * 3 + col] = (double)rot[row * 3 + col] * s[col];
+    }
+    outSigma[0] = m[0] * m[0] + m[1] * m[1] + m[2] * m[2];
+    outSigma[1] = m[0] * m[3] + m[1] * m[4] + m[2] * m[5];
+    outSigma[2] = m[0] * m[6] + m[1] * m[7] + m[2] * m[8];
+    outSigma[3] = m[3] * m[3] + m[4] * m[4] + m[5] * m[5];
+    outSigma[4] = m[3] * m[6] + m[4] * m[7] + m[5] * m[8];
+    outSigma[5] = m[6] * m[6] + m[7] * m[7] + m[8] * m[8];
+}
+
+// Cyclic Jacobi eigen decomposition of a symmetric 3x3 matrix, the
+// eigenvectors end up in the columns of outVectors (row major).
+static void splatLodEigen(const double sigma[6], double outValues[3], double outVectors[9]) {
+    double a[3][3] = { { sigma[0], sigma[1], sigma[2] }, { sigma[1], sigma[3], sigma[4] }, { sigma[2], sigma[4], sigma[5] } };
+    double v[3][3] = { { 1.0, 0.0, 0.0 }, { 0.0, 1.0, 0.0 }, { 0.0, 0.0, 1.0 } };
+    const double scale = fabs(a[0][0]) + fabs(a[1][1]) + fabs(a[2][2]);
+    for (uint32_t sweep = 0; sweep < 16; sweep++) {
+        const double off = a[0][1] * a[0][1] + a[0][2] * a[0][2] + a[1][2] * a[1][2];
+        if (off <= 1e-24 * scale * scale)
+            break;
+        for (uint32_t p = 0; p < 2; p++) {
+            for (uint32_t q = p + 1; q < 3; q++) {
+                if (a[p][q] == 0.0)
+                    continue;
+                const double theta = (a[q][q] - a[p][p]) / (2.0 * a[p][q]);
+                const double t = (theta >= 0.0 ? 1.0 : -1.0) / (fabs(theta) + sqrt(theta * theta + 1.0));
+                const double c = 1.0 / sqrt(t * t + 1.0);
+                const double s = t * c;
+                for (uint32_t k = 0; k < 3; k++) {
+                    const double akp = a[k][p], akq = a[k][q];
+                    a[k][p] = c * akp - s * akq;
+                    a[k][q] = s * akp + c * akq;
+                }
+                for (uint32_t k = 0; k < 3; k++) {
+                    const double apk = a[p][k], aqk = a[q][k];
+                    a[p][k] = c * apk - s * aqk;
+                    a[q][k] = s * apk + c * aqk;
+                }
+                for (uint32_t k = 0; k < 3; k++) {
+                    const double vkp = v[k][p], vkq = v[k][q];
+                    v[k][p] = c * vkp - s * vkq;
+                    v[k][q] = s * vkp + c * vkq;
+                }
+            }
+        }
+    }
+    for (uint32_t i = 0; i < 3; i++) {
+        outValues[i] = a[i][i];
+        for (uint32_t j = 0; j < 3; j++)
+            outVectors[i * 3 + j] = v[i][j];
+    }
+}
+
+// Quaternion (rot_0 = w in x) of a proper rotation matrix, row major.
+static struct Tf32x4_s splatLodQuaternion(const double m[9]) {
+    const double trace = m[0] + m[4] + m[8];
+    double       w, x, y, z;
+    if (trace > 0.0) {
+        const double s = 2.0 * sqrt(trace + 1.0);
+        w = 0.25 * s;
+        x = (m[7] - m[5]) / s;
+        y = (m[2] - m[6]) / s;
+        z = (m[3] - m[1]) / s;
+    } else if (m[0] > m[4] && m[0] > m[8]) {
+        const double s = 2.0 * sqrt(1.0 + m[0] - m[4] - m[8]);
+        w = (m[7] - m[5]) / s;
+        x = 0.25 * s;
+        y = (m[1] + m[3]) / s;
+        z = (m[2] + m[6]) / s;
+    } else if (m[4] > m[8]) {
+        const double s = 2.0 * sqrt(1.0 + m[4] - m[0] - m[8]);
+        w = (m[2] - m[6]) / s;
+        x = (m[1] + m[3]) / s;
+        y = 0.25 * s;
+        z = (m[5] + m[7]) / s;
+    } else {
+        const double s = 2.0 * sqrt(1.0 + m[8] - m[0] - m[4]);
+        w = (m[3] - m[1]) / s;
+        x = (m[2] + m[6]) / s;
+        y = (m[5] + m[7]) / s;
+        z = 0.25 * s;
+    }
+    return { (float)w, (float)x, (float)y, (float)z };
+}
+
+// Product of the two largest of three scales, proportional to the largest projected area.
+static inline double splatLodFootprint(double s0, double s1, double s2) {
+    const double smallest = fmin(s0, fmin(s1, s2));
+    return smallest > 0.0 ? s0 * s1 * s2 / smallest : 0.0;
+}
+
+static inline bool splatLodIsFinite(struct Tf32x3_s p) { return isfinite(p.x) && isfinite(p.y) && isfinite(p.z); }
+
+struct SplatLodBuildContext {
+    struct SplatLod*           pLod;
+    const struct SplatStreams* pStreams;
+    uint64_t                   mLevelOffset; // first id of the level in pChildren
+    uint64_t                   mLevelCount;
+    uint64_t                   mFirstMerged; // merged index of the first group
+};
+
+static void splatLodLeafBoundsRange(void* user, uint64_t begin, uint64_t end) {
+    const struct SplatLodBuildContext* ctx = (const struct SplatLodBuildContext*)user;
+    for (uint64_t i = begin; i < end; i++) {
+        const struct Tf32x3_s p = ctx->pStreams->pPositions[i];
+        const struct Tf32x3_s s = ctx->pStreams->pScales[i];
+        float*                bounds = &ctx->pLod->pBounds[i * 4];
+        bounds[0] = p.x;
+        bounds[1] = p.y;
+        bounds[2] = p.z;
+        bounds[3] = splatLodIsFinite(p) ? 3.0f * expf(fmaxf(s.x, fmaxf(s.y, s.z))) : 0.0f;
+    }
+}
+
+static void splatLodMergeRange(void* user, uint64_t begin, uint64_t end) {
+    const struct SplatLodBuildContext* ctx = (const struct SplatLodBuildContext*)user;
+    struct SplatLod*                   lod = ctx->pLod;
+    for (uint64_t group = begin; group < end; group++) {
+        const uint64_t  first = group * SPLAT_LOD_BRANCHING;
+        const uint32_t  numChildren =
+            (uint32_t)(ctx->mLevelCount - first < SPLAT_LOD_BRANCHING ? ctx->mLevelCount - first : SPLAT_LOD_BRANCHING);
+        const uint32_t* ids = lod->pChildren + ctx->mLevelOffset + first;
+
+        struct SplatLodNode children[SPLAT_LOD_BRANCHING];
+        double              weights[SPLAT_LOD_BRANCHING];
+        double              coverage = 0.0; // sum of alpha times footprint
+        double              totalWeight = 0.0;
+        uint32_t            numLeaves = 0;
+        for (uint32_t c = 0; c < numChildren; c++) {
+            splatLodGetNode(lod, ctx->pStreams, ids[c], &children[c]);
+            numLeaves += children[c].mNumLeaves;
+            const double alpha = 1.0 / (1.0 + exp(-(double)children[c].mOpacity));
+            const double area = splatLodFootprint(exp(children[c].mScale.x), exp(children[c].mScale.y), exp(children[c].mScale.z));
+            weights[c] = splatLodIsFinite(children[c].mPosition) && isfinite(alpha * area) ? alpha * area : 0.0;
+            coverage += weights[c];
+            totalWeight += weights[c];
+        }
+        // fully transparent or degenerate children still get a mean
+        if (!(totalWeight > 0.0)) {
+            totalWeight = 0.0;
+            for (uint32_t c = 0; c < numChildren; c++) {
+                weights[c] = splatLodIsFinite(children[c].mPosition) ? 1.0 : 0.0;
+                totalWeight += weights[c];
+            }
+        }
+        const double invWeight = totalWeight > 0.0 ? 1.0 / totalWeight : 0.0;
+
+        double mean[3] = {};
+        for (uint32_t c = 0; c < numChildren; c++) {
+            mean[0] += weights[c] * children[c].mPosition.x;
+            mean[1] += weights[c] * children[c].mPosition.y;
+            mean[2] += weights[c] * children[c].mPosition.z;
+        }
+        for (uint32_t axis = 0; axis < 3; axis++)
+            mean[axis] *= invWeight;
+
+        // second moment about the new mean
+        double sigma[6] = {};
+        for (uint32_t c = 0; c < numChildren; c++) {
+            if (weights[c] == 0.0)
+                continue;
+            double childSigma[6];
+            splatLodCovariance(&children[c], childSigma);
+            const double d[3] = { children[c].mPosition.x - mean[0], children[c].mPosition.y - mean[1], children[c].mPosition.z - mean[2] };
+            sigma[0] += weights[c] * (childSigma[0] + d[0] * d[0]);
+            sigma[1] += weights[c] * (childSigma[1] + d[0] * d[1]);
+            sigma[2] += weights[c] * (childSigma[2] + d[0] * d[2]);
+            sigma[3] += weights[c] * (childSigma[3] + d[1] * d[1]);
+            sigma[4] += weights[c] * (childSigma[4] + d[1] * d[2]);
+            sigma[5] += weights[c] * (childSigma[5] + d[2] * d[2]);
+        }
+        for (uint32_t i = 0; i < 6; i++)
+            sigma[i] *= invWeight;
+
+        double values[3], vectors[9];
+        splatLodEigen(sigma, values, vectors);
+        const double det = vectors[0] * (vectors[4] * vectors[8] - vectors[5] * vectors[7]) -
+                           vectors[1] * (vectors[3] * vectors[8] - vectors[5] * vectors[6]) +
+                           vectors[2] * (vectors[3] * vectors[7] - vectors[4] * vectors[6]);
+        if (det < 0.0) {
+            vectors[2] = -vectors[2];
+            vectors[5] = -vectors[5];
+            vectors[8] = -vectors[8];
+        }
+        const double scales[3] = { sqrt(fmax(values[0], 1e-14)), sqrt(fmax(values[1], 1e-14)), sqrt(fmax(values[2], 1e-14)) };
+        double alpha = coverage / splatLodFootprint(scales[0], scales[1], scales[2]);
+        alpha = fmin(fmax(alpha, (double)gSplatLodMinOpacity), (double)gSplatLodMaxOpacity);
+
+        const uint64_t        merged = ctx->mFirstMerged + group;
+        const struct Tf32x3_s position = { (float)mean[0], (float)mean[1], (float)mean[2] };
+        lod->mMerged.pPositions[merged] = position;
+        lod->mMerged.pScales[merged] = { (float)log(scales[0]), (float)log(scales[1]), (float)log(scales[2]) };
+        lod->mMerged.pRotations[merged] = splatLodQuaternion(vectors);
+        lod->mMerged.pOpacities[merged] = (float)log(alpha / (1.0 - alpha));
+
+        struct SphericalHarmonics* sh = &lod->mMerged.pShs[merged];
+        memset(sh, 0, sizeof(struct SphericalHarmonics));
+        for (uint32_t c = 0; c < numChildren; c++) {
+            const float w = (float)(weights[c] * invWeight);
+            if (w == 0.0f)
+                continue;
+            sh->dc.x += w * children[c].pSh->dc.x;
+            sh->dc.y += w * children[c].pSh->dc.y;
+            sh->dc.z += w * children[c].pSh->dc.z;
+            for (uint32_t k = 0; k < 45; k++)
+                sh->rest[k] += w * children[c].pSh->rest[k];
+        }
+
+        // every splat below stays within error of the mean, and the bounds hold every child sphere
+        float error = 0.0f;
+        float radius = 3.0f * (float)fmax(scales[0], fmax(scales[1], scales[2]));
+        for (uint32_t c = 0; c < numChildren; c++) {
+            if (weights[c] == 0.0 && !splatLodIsFinite(children[c].mPosition))
+                continue;
+            const float* childBounds = &lod->pBounds[(uint64_t)ids[c] * 4];
+            const float  dx = children[c].mPosition.x - position.x;
+            const float  dy = children[c].mPosition.y - position.y;
+            const float  dz = children[c].mPosition.z - position.z;
+            error = fmaxf(error, sqrtf(dx * dx + dy * dy + dz * dz) + children[c].mError);
+            const float bx = childBounds[0] - position.x;
+            const float by = childBounds[1] - position.y;
+            const float bz = childBounds[2] - position.z;
+            radius = fmaxf(radius, sqrtf(bx * bx + by * by + bz * bz) + childBounds[3]);
+        }
+
+        lod->pFirstChild[merged] = (uint32_t)(ctx->mLevelOffset + first);
+        lod->pNumChildren[merged] = (uint8_t)numChildren;
+        lod->pNumLeaves[merged] = numLeaves;
+        lod->pErrors[merged] = error;
+        float* bounds = &lod->pBounds[(lod->mNumSplats + merged) * 4];
+        bounds[0] = position.x;
+        bounds[1] = position.y;
+        bounds[2] = position.z;
+        bounds[3] = radius;
+        // the merged nodes of this level are the next level
+        if (ctx->mLevelCount > SPLAT_LOD_BRANCHING)
+            lod->pChildren[ctx->mLevelOffset + ctx->mLevelCount + group] = (uint32_t)(lod->mNumSplats + merged);
+    }
+}
+
+bool splatLodBuild(ThreadSystem threadSystem, uint64_t numSplats, const struct SplatStreams* streams, struct SplatLod* outLod,
+                   struct SplatLodBuildStats* outStats) {
+    memset(outLod, 0, sizeof(struct SplatLod));
+    const uint64_t numMerged = splatLodMergedCount(numSplats);
+    if (!streams->pPositions || !streams->pScales || !streams->pRotations || !streams->pOpacities || !streams->pShs || numSplats == 0 ||
+        numSplats + numMerged > UINT32_MAX)
+        return false;
+
+    outLod->mNumSplats = numSplats;
+    outLod->mNumMerged = numMerged;
+    outLod->mMerged.pPositions = (struct Tf32x3_s*)splatMalloc(sizeof(struct Tf32x3_s) * numMerged);
+    outLod->mMerged.pScales = (struct Tf32x3_s*)splatMalloc(sizeof(struct Tf32x3_s) * numMerged);
+    outLod->mMerged.pRotations = (struct Tf32x4_s*)splatMalloc(sizeof(struct Tf32x4_s) * numMerged);
+    outLod->mMerged.pOpacities = (float*)splatMalloc(sizeof(float) * numMerged);
+    outLod->mMerged.pShs = (struct SphericalHarmonics*)splatMalloc(sizeof(struct SphericalHarmonics) * numMerged);
+    // every node but the root is the child of one merged node
+    outLod->pChildren = (uint32_t*)splatMalloc(sizeof(uint32_t) * (numSplats + numMerged));
+    outLod->pFirstChild = (uint32_t*)splatMalloc(sizeof(uint32_t) * numMerged);
+    outLod->pNumChildren = (uint8_t*)splatMalloc(sizeof(uint8_t) * numMerged);
+    outLod->pNumLeaves = (uint32_t*)splatMalloc(sizeof(uint32_t) * numMerged);
+    outLod->pErrors = (float*)splatMalloc(sizeof(float) * numMerged);
+    outLod->pBounds = (float*)splatMalloc(sizeof(float) * 4 * (numSplats + numMerged));
+
+    // the splats in Morton order are the first level
+    int64_t startUs = getUSec(false);
+    splatMortonOrder(threadSystem, streams->pPositions, numSplats, false, outLod->pChildren);
+    struct SplatLodBuildContext ctx = { outLod, streams, 0, numSplats, 0 };
+    splatParallelFor(threadSystem, numSplats, 65536, splatLodLeafBoundsRange, &ctx);
+    if (outStats)
+        outStats->mMortonUs = getUSec(false) - startUs;
+
+    startUs = getUSec(false);
+    while (ctx.mLevelCount > 1) {
+        const uint64_t numGroups = (ctx.mLevelCount + SPLAT_LOD_BRANCHING - 1) / SPLAT_LOD_BRANCHING;
+        splatParallelFor(threadSystem, numGroups, 4096, splatLodMergeRange, &ctx);
+        ctx.mLevelOffset += ctx.mLevelCount;
+        ctx.mLevelCount = numGroups;
+        ctx.mFirstMerged += numGroups;
+        outLod->mNumLevels++;
+    }
+    outLod->mRoot = (uint32_t)(numSplats + numMerged - 1);
+    if (outStats)
+        outStats->mMergeUs = getUSec(false) - startUs;
+    return true;
+}
+
+void splatLodFree(struct SplatLod* lod) {
+    splatFreeStreams(&lod->mMerged);
+    splatFree(lod->pChildren);
+    splatFree(lod->pFirstChild);
+    splatFree(lod->pNumChildren);
+    splatFree(lod->pNumLeaves);
+    splatFree(lod->pErrors);
+    splatFree(lod->pBounds);
+    memset(lod, 0, sizeof(struct SplatLod));
+}
+
+uint64_t splatLodCut(const struct SplatLod* lod, const struct SplatLodCutDesc* desc, uint32_t* outNodes,
+                     struct SplatLodCutStats* outStats) {
+    const int64_t           startUs = getUSec(false);
+    struct SplatLodCutStats stats = {};
+    double                  errorSum = 0.0;
+    if (lod->mNumSplats > 0) {
+        // depth first, children pushed last to first so the cut keeps the Morton order
+        uint32_t stack[64 * SPLAT_LOD_BRANCHING];
+        uint32_t stackSize = 0;
+        stack[stackSize++] = lod->mRoot;
+        while (stackSize > 0) {
+            const uint32_t id = stack[--stackSize];
+            const float*   bounds = &lod->pBounds[(uint64_t)id * 4];
+            if (desc->pFrustum) {
+                bool inside = true;
+                for (uint32_t plane = 0; plane < 6 && inside; plane++) {
+                    const float* n = desc->pFrustum->mPlanes[plane];
+                    inside = n[0] * bounds[0] + n[1] * bounds[1] + n[2] * bounds[2] + n[3] >= -bounds[3];
+                }
+                if (!inside) {
+                    stats.mNumCulled++;
+                    continue;
+                }
+            }
+            if (id < lod->mNumSplats) {
+                outNodes[stats.mNumNodes++] = id;
+                stats.mNumRepresented++;
+                continue;
+            }
+
+            const uint64_t merged = id - lod->mNumSplats;
+            const float    dx = bounds[0] - desc->mEye.x;
+            const float    dy = bounds[1] - desc->mEye.y;
+            const float    dz = bounds[2] - desc->mEye.z;
+            // distance to the closest point of the subtree, refine when the eye is inside
+            const float distance = sqrtf(dx * dx + dy * dy + dz * dz) - bounds[3];
+            const float errorPixels = distance > 0.0f ? lod->pErrors[merged] * desc->mFocalPixels / distance : INFINITY;
+            if (errorPixels <= desc->mMaxErrorPixels) {
+                outNodes[stats.mNumNodes++] = id;
+                stats.mNumMerged++;
+                stats.mNumRepresented += lod->pNumLeaves[merged];
+                stats.mMaxErrorPixels = fmaxf(stats.mMaxErrorPixels, errorPixels);
+                errorSum += errorPixels;
+                continue;
+            }
+            const uint32_t* children = lod->pChildren + lod->pFirstChild[merged];
+            for (uint32_t c = lod->pNumChildren[merged]; c > 0; c--)
+                stack[stackSize++] = children[c - 1];
+        }
+    }
+    stats.mMeanErrorPixels = stats.mNumMerged ? (float)(errorSum / (double)stats.mNumMerged) : 0.0f;
+    stats.mDurationUs = getUSec(false) - startUs;
+    if (outStats)
+        *outStats = stats;
+    return stats.mNumNodes;
+}
+
+void splatLodSortBackToFront(const struct SplatLod* lod, const float depthRow[4], uint32_t* nodes, uint64_t count, uint64_t* keys,
+                             struct SplatSortScratch* scratch) {
+    for (uint64_t i = 0; i < count; i++) {
+        const float* center = &lod->pBounds[(uint64_t)nodes[i] * 4];
+        keys[i] = splatDepthKey(depthRow[0] * center[0] + depthRow[1] * center[1] + depthRow[2] * center[2] + depthRow[3]);
+    }
+    splatRadixSort(NULL, scratch, keys, nodes, count, NULL);
+}
+
+void splatLodGatherStreams(const struct SplatLod* lod, const struct SplatStreams* streams, const uint32_t* nodes, uint64_t count,
+                           const struct SplatStreams* dst) {
+    for (uint64_t i = 0; i < count; i++) {
+        const bool                 merged = nodes[i] >= lod->mNumSplats;
+        const struct SplatStreams* src = merged ? &lod->mMerged : streams;
+        const uint64_t             index = merged ? nodes[i] - lod->mNumSplats : nodes[i];
+        if (dst->pPositions)
+            dst->pPositions[i] = src->pPositions[index];
+        if (dst->pColors)
+            dst->pColors[i] = src->pPositions[index];
+        if (dst->pNormals)
+            dst->pNormals[i] = src->pNormals ? src->pNormals[index] : Tf32x3_s{ 0.0f, 0.0f, 0.0f };
+        if (dst->pScales)
+            dst->pScales[i] = src->pScales[index];
+        if (dst->pRotations)
+            dst->pRotations[i] = src->pRotations[index];
+        if (dst->pOpacities)
+            dst->pOpacities[i] = src->pOpacities[index];
+        if (dst->pShs)
+            dst->pShs[i] = src->pShs[index];
+    }
+}
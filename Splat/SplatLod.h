@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2017-2024 The Forge Interactive Inc.
+ *
+ * This file is part of The-Forge
+ * (see https://github.com/ConfettiFX/The-Forge).
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#pragma once
+
+#include "Splat.h"
+#include "SplatBvh.h"
+#include "SplatSort.h"
+
+// Level of detail hierarchy of merged Gaussians.
+//
+// The splats are sorted by Morton code and every run of SPLAT_LOD_BRANCHING
+// consecutive nodes is merged into a parent, level by level up to a single
+// root. A parent matches the first two moments of its children weighted by
+// opacity times footprint: mean and covariance (the children covariances
+// plus the spread of their means), the SH coefficients are the weighted
+// average and the opacity keeps the summed footprint coverage.
+//
+// Node ids below mNumSplats are splats of the source streams, merged node i
+// has id mNumSplats + i and its data in mMerged at index i, so the source
+// and merged streams can be uploaded back to back and indexed by node id.
+//
+// A cut walks down from the root and stops at the first node whose
+// geometric error projects to at most mMaxErrorPixels, so the cut size
+// follows the screen resolution instead of the scene size.
+
+#define SPLAT_LOD_BRANCHING 4
+
+struct SplatLod {
+    uint64_t            mNumSplats; // leaf node ids are splat indices
+    uint64_t            mNumMerged;
+    uint32_t            mNumLevels; // merged levels above the splats
+    uint32_t            mRoot; // node id
+    struct SplatStreams mMerged; // positions, scales, rotations, opacities and shs of the merged nodes
+    uint32_t*           pChildren; // child node ids, the children of a merged node are contiguous
+    uint32_t*           pFirstChild; // per merged node, offset into pChildren
+    uint8_t*            pNumChildren; // per merged node
+    uint32_t*           pNumLeaves; // per merged node, splats below it
+    float*              pErrors; // per merged node, world space distance of any splat below it from its mean
+    float*              pBounds; // per node id, xyz and radius of a sphere holding the 3 sigma extent of the subtree
+};
+
+struct SplatLodBuildStats {
+    int64_t mMortonUs;
+    int64_t mMergeUs;
+};
+
+struct SplatLodCutDesc {
+    struct Tf32x3_s            mEye;
+    float                      mFocalPixels; // focal length in pixels
+    float                      mMaxErrorPixels;
+    const struct SplatFrustum* pFrustum; // optional, subtrees outside are dropped
+};
+
+struct SplatLodCutStats {
+    uint64_t mNumNodes; // cut size
+    uint64_t mNumMerged; // merged nodes in the cut, the rest are splats
+    uint64_t mNumRepresented; // splats below the nodes of the cut
+    uint64_t mNumCulled; // subtrees dropped by the frustum
+    float    mMaxErrorPixels; // of the merged nodes in the cut
+    float    mMeanErrorPixels;
+    int64_t  mDurationUs;
+};
+
+// Number of merged nodes splatLodBuild creates for numSplats splats, to size
+// buffers before the build.
+uint64_t splatLodMergedCount(uint64_t numSplats);
+
+// streams needs positions, scales, rotations, opacities and shs.
+bool splatLodBuild(ThreadSystem threadSystem, uint64_t numSplats, const struct SplatStreams* streams, struct SplatLod* outLod,
+                   struct SplatLodBuildStats* outStats);
+void splatLodFree(struct SplatLod* lod);
+
+// Writes the node ids of the cut to outNodes, which needs room for
+// mNumSplats + mNumMerged ids. Returns the cut size.
+uint64_t splatLodCut(const struct SplatLod* lod, const struct SplatLodCutDesc* desc, uint32_t* outNodes, struct SplatLodCutStats* outStats);
+
+// Sorts the node ids of a cut back to front by the depth of the node means.
+// depthRow is the row of the world to view matrix that yields view depth,
+// keys needs room for count keys.
+void splatLodSortBackToFront(const struct SplatLod* lod, const float depthRow[4], uint32_t* nodes, uint64_t count, uint64_t* keys,
+                             struct SplatSortScratch* scratch);
+
+// Copies the splat or merged node data of count node ids into the streams
+// of dst that are not NULL, dst entry i receives nodes[i].
+void splatLodGatherStreams(const struct SplatLod* lod, const struct SplatStreams* streams, const uint32_t* nodes, uint64_t count,
+                           const struct SplatStreams* dst);
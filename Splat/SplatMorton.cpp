@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2017-2024 The Forge Interactive Inc.
+ *
+ * This file is part of The-Forge
+ * (see https://github.com/ConfettiFX/The-Forge).
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#include "SplatMorton.h"
+
+#include <math.h>
+
+#include "SplatSort.h"
+
+#define SPLAT_BOUNDS_MAX_RANGES 256
+
+struct SplatBoundsContext {
+    const struct Tf32x3_s* pPositions;
+    uint64_t               mGrainSize;
+    struct Tf32x3_s        mMin[SPLAT_BOUNDS_MAX_RANGES];
+    struct Tf32x3_s        mMax[SPLAT_BOUNDS_MAX_RANGES];
+};
+
+static void splatBoundsRange(void* user, uint64_t begin, uint64_t end) {
+    struct SplatBoundsContext* ctx = (struct SplatBoundsContext*)user;
+    struct Tf32x3_s            boundsMin = { INFINITY, INFINITY, INFINITY };
+    struct Tf32x3_s            boundsMax = { -INFINITY, -INFINITY, -INFINITY };
+    for (uint64_t i = begin; i < end; i++) {
+        const struct Tf32x3_s p = ctx->pPositions[i];
+        if (!isfinite(p.x) || !isfinite(p.y) || !isfinite(p.z))
+            continue;
+        boundsMin = { fminf(boundsMin.x, p.x), fminf(boundsMin.y, p.y), fminf(boundsMin.z, p.z) };
+        boundsMax = { fmaxf(boundsMax.x, p.x), fmaxf(boundsMax.y, p.y), fmaxf(boundsMax.z, p.z) };
+    }
+    const uint64_t range = begin / ctx->mGrainSize;
+    ctx->mMin[range] = boundsMin;
+    ctx->mMax[range] = boundsMax;
+}
+
+void splatComputeBounds(ThreadSystem threadSystem, const struct Tf32x3_s* positions, uint64_t count, struct Tf32x3_s* outMin,
+                        struct Tf32x3_s* outMax, struct Tf32x3_s* outInvExtent) {
+    struct SplatBoundsContext* ctx = (struct SplatBoundsContext*)splatMalloc(sizeof(struct SplatBoundsContext));
+    ctx->pPositions = positions;
+    ctx->mGrainSize = (count + SPLAT_BOUNDS_MAX_RANGES - 1) / SPLAT_BOUNDS_MAX_RANGES;
+    if (ctx->mGrainSize < 16384)
+        ctx->mGrainSize = 16384;
+    const uint64_t numRanges = (count + ctx->mGrainSize - 1) / ctx->mGrainSize;
+    splatParallelFor(threadSystem, count, ctx->mGrainSize, splatBoundsRange, ctx);
+
+    struct Tf32x3_s boundsMin = { INFINITY, INFINITY, INFINITY };
+    struct Tf32x3_s boundsMax = { -INFINITY, -INFINITY, -INFINITY };
+    for (uint64_t range = 0; range < numRanges; range++) {
+        boundsMin = { fminf(boundsMin.x, ctx->mMin[range].x), fminf(boundsMin.y, ctx->mMin[range].y),
+                      fminf(boundsMin.z, ctx->mMin[range].z) };
+        boundsMax = { fmaxf(boundsMax.x, ctx->mMax[range].x), fmaxf(boundsMax.y, ctx->mMax[range].y),
+                      fmaxf(boundsMax.z, ctx->mMax[range].z) };
+    }
+    splatFree(ctx);
+    if (boundsMin.x > boundsMax.x) { // no finite position
+        boundsMin = { 0.0f, 0.0f, 0.0f };
+        boundsMax = { 0.0f, 0.0f, 0.0f };
+    }
+
+    *outMin = boundsMin;
+    *outMax = boundsMax;
+    if (outInvExtent) {
+        for (uint32_t axis = 0; axis < 3; axis++) {
+            const float extent = boundsMax.v[axis] - boundsMin.v[axis];
+            outInvExtent->v[axis] = extent > 0.0f ? 1.0f / extent : 0.0f;
+        }
+    }
+}
+
+struct SplatMortonContext {
+    const struct Tf32x3_s* pPositions;
+    uint64_t*              pKeys;
+    uint32_t*              pOrder;
+    struct Tf32x3_s        mMin;
+    struct Tf32x3_s        mInvExtent;
+    bool                   mWide;
+};
+
+static void splatMortonRange(void* user, uint64_t begin, uint64_t end) {
+    const struct SplatMortonContext* ctx = (const struct SplatMortonContext*)user;
+    for (uint64_t i = begin; i < end; i++) {
+        const struct Tf32x3_s p = ctx->pPositions[i];
+        ctx->pKeys[i] =
+            ctx->mWide ? splatMortonEncode63(p, ctx->mMin, ctx->mInvExtent) : splatMortonEncode30(p, ctx->mMin, ctx->mInvExtent);
+        ctx->pOrder[i] = (uint32_t)i;
+    }
+}
+
+void splatMortonOrder(ThreadSystem threadSystem, const struct Tf32x3_s* positions, uint64_t count, bool wide, uint32_t* outOrder) {
+    struct SplatMortonContext ctx = {};
+    struct Tf32x3_s           boundsMax;
+    splatComputeBounds(threadSystem, positions, count, &ctx.mMin, &boundsMax, &ctx.mInvExtent);
+    ctx.pPositions = positions;
+    ctx.pKeys = (uint64_t*)splatMalloc(sizeof(uint64_t) * count);
+    ctx.pOrder = outOrder;
+    ctx.mWide = wide;
+    splatParallelFor(threadSystem, count, 16384, splatMortonRange, &ctx);
+
+    struct SplatSortScratch scratch;
+    splatSortScratchInit(&scratch);
+    splatRadixSort(threadSystem, &scratch, ctx.pKeys, outOrder, count, NULL);
+    splatSortScratchExit(&scratch);
+    splatFree(ctx.pKeys);
+}
+
+bool splatMortonReorderStreams(ThreadSystem threadSystem, const struct SplatStreams* streams, uint64_t count, bool wide) {
+    if (!streams->pPositions || count > UINT32_MAX)
+        return false;
+    uint32_t* order = (uint32_t*)splatMalloc(sizeof(uint32_t) * count);
+    splatMortonOrder(threadSystem, streams->pPositions, count, wide, order);
+    splatPermuteStreams(threadSystem, streams, order, count);
+    splatFree(order);
+    return true;
+}
@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2017-2024 The Forge Interactive Inc.
+ *
+ * This file is part of The-Forge
+ * (see https://github.com/ConfettiFX/The-Forge).
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#pragma once
+
+#include "Splat.h"
+
+// Z-order (Morton) codes of splat centers. Positions are quantized to a grid
+// over the scene bounds and the bits of the three axes are interleaved, so
+// sorting by code groups splats that are close in space.
+
+static inline uint32_t splatMortonExpand10(uint32_t value) {
+    value &= 0x3ffu;
+    value = (value | (value << 16)) & 0x030000ffu;
+    value = (value | (value << 8)) & 0x0300f00fu;
+    value = (value | (value << 4)) & 0x030c30c3u;
+    value = (value | (value << 2)) & 0x09249249u;
+    return value;
+}
+
+static inline uint64_t splatMortonExpand21(uint64_t value) {
+    value &= 0x1fffffull;
+    value = (value | (value << 32)) & 0x1f00000000ffffull;
+    value = (value | (value << 16)) & 0x1f0000ff0000ffull;
+    value = (value | (value << 8)) & 0x100f00f00f00f00full;
+    value = (value | (value << 4)) & 0x10c30c30c30c30c3ull;
+    value = (value | (value << 2)) & 0x1249249249249249ull;
+    return value;
+}
+
+// Quantizes p in [boundsMin, boundsMin + 1 / invExtent] to bits per axis.
+static inline uint32_t splatMortonQuantize(float p, float boundsMin, float invExtent, uint32_t bits) {
+    const float maxValue = (float)((1u << bits) - 1u);
+    const float value = (p - boundsMin) * invExtent * maxValue;
+    // written so that NaN lands in cell 0
+    if (!(value > 0.0f))
+        return 0;
+    return value < maxValue ? (uint32_t)value : (uint32_t)maxValue;
+}
+
+// 10 bits per axis.
+static inline uint32_t splatMortonEncode30(struct Tf32x3_s p, struct Tf32x3_s boundsMin, struct Tf32x3_s invExtent) {
+    return (splatMortonExpand10(splatMortonQuantize(p.x, boundsMin.x, invExtent.x, 10)) << 2) |
+           (splatMortonExpand10(splatMortonQuantize(p.y, boundsMin.y, invExtent.y, 10)) << 1) |
+           splatMortonExpand10(splatMortonQuantize(p.z, boundsMin.z, invExtent.z, 10));
+}
+
+// 21 bits per axis, for scenes where 1024 cells per axis are too coarse.
+static inline uint64_t splatMortonEncode63(struct Tf32x3_s p, struct Tf32x3_s boundsMin, struct Tf32x3_s invExtent) {
+    return (splatMortonExpand21(splatMortonQuantize(p.x, boundsMin.x, invExtent.x, 21)) << 2) |
+           (splatMortonExpand21(splatMortonQuantize(p.y, boundsMin.y, invExtent.y, 21)) << 1) |
+           splatMortonExpand21(splatMortonQuantize(p.z, boundsMin.z, invExtent.z, 21));
+}
+
+// Bounds of the positions, ignoring non finite ones. outInvExtent is 1 / size
+// per axis, 0 for flat axes.
+void splatComputeBounds(ThreadSystem threadSystem, const struct Tf32x3_s* positions, uint64_t count, struct Tf32x3_s* outMin,
+                        struct Tf32x3_s* outMax, struct Tf32x3_s* outInvExtent);
+
+// Sorts the splats by 30 bit (or 63 bit when wide) Morton code of their
+// position. outOrder receives the splat index for every sorted slot.
+void splatMortonOrder(ThreadSystem threadSystem, const struct Tf32x3_s* positions, uint64_t count, bool wide, uint32_t* outOrder);
+
+// Sorts the splats by Morton code and applies that order to every stream,
+// SH included, so splats that are close in space are close in memory.
+// Returns false when count does not fit the 32 bit splat indices.
+bool splatMortonReorderStreams(ThreadSystem threadSystem, const struct SplatStreams* streams, uint64_t count, bool wide);
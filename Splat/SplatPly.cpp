@@ -0,0 +1,729 @@
+/*
+ * Copyright (c) 2017-2024 The Forge Interactive Inc.
+ *
+ * This file is part of The-Forge
+ * (see https://github.com/ConfettiFX/The-Forge).
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#include "SplatPly.h"
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "Forge/TF_Log.h"
+#include "Forge/Core/TF_Time.h"
+
+// Size of one read from the file, the worker pool decodes one chunk while the
+// next is read into the second buffer.
+static const uint64_t gSplatPlyChunkBytes = 16 * 1024 * 1024;
+static const uint64_t gSplatPlySplatsPerTask = 4096;
+static const size_t   gSplatPlyMaxHeaderBytes = 64 * 1024;
+
+static uint32_t splatPlyTypeSize(uint32_t type) {
+    switch (type) {
+    case SPLAT_PLY_TYPE_I8:
+    case SPLAT_PLY_TYPE_U8:
+        return 1;
+    case SPLAT_PLY_TYPE_I16:
+    case SPLAT_PLY_TYPE_U16:
+        return 2;
+    case SPLAT_PLY_TYPE_I32:
+    case SPLAT_PLY_TYPE_U32:
+    case SPLAT_PLY_TYPE_F32:
+        return 4;
+    case SPLAT_PLY_TYPE_F64:
+        return 8;
+    default:
+        return 0;
+    }
+}
+
+static uint32_t splatPlyParseType(const char* name) {
+    static const struct {
+        const char* mName;
+        uint32_t    mType;
+    } types[] = {
+        { "char", SPLAT_PLY_TYPE_I8 },    { "int8", SPLAT_PLY_TYPE_I8 },     { "uchar", SPLAT_PLY_TYPE_U8 },
+        { "uint8", SPLAT_PLY_TYPE_U8 },   { "short", SPLAT_PLY_TYPE_I16 },   { "int16", SPLAT_PLY_TYPE_I16 },
+        { "ushort", SPLAT_PLY_TYPE_U16 }, { "uint16", SPLAT_PLY_TYPE_U16 },  { "int", SPLAT_PLY_TYPE_I32 },
+        { "int32", SPLAT_PLY_TYPE_I32 },  { "uint", SPLAT_PLY_TYPE_U32 },    { "uint32", SPLAT_PLY_TYPE_U32 },
+        { "float", SPLAT_PLY_TYPE_F32 },  { "float32", SPLAT_PLY_TYPE_F32 }, { "double", SPLAT_PLY_TYPE_F64 },
+        { "float64", SPLAT_PLY_TYPE_F64 },
+    };
+    for (size_t i = 0; i < TF_ARRAY_COUNT(types); i++) {
+        if (strcmp(types[i].mName, name) == 0)
+            return types[i].mType;
+    }
+    return SPLAT_PLY_TYPE_NONE;
+}
+
+static const struct SplatPlySchemaEntry gSplatPlyDefaultEntries[] = {
+    { "x", SPLAT_PLY_STREAM_POSITION, 0, false },       { "y", SPLAT_PLY_STREAM_POSITION, 1, false },
+    { "z", SPLAT_PLY_STREAM_POSITION, 2, false },       { "nx", SPLAT_PLY_STREAM_NORMAL, 0, false },
+    { "ny", SPLAT_PLY_STREAM_NORMAL, 1, false },        { "nz", SPLAT_PLY_STREAM_NORMAL, 2, false },
+    { "f_dc_", SPLAT_PLY_STREAM_SH_DC, 0, true },       { "f_rest_", SPLAT_PLY_STREAM_SH_REST, 0, true },
+    { "opacity", SPLAT_PLY_STREAM_OPACITY, 0, false },  { "scale_", SPLAT_PLY_STREAM_SCALE, 0, true },
+    { "rot_", SPLAT_PLY_STREAM_ROTATION, 0, true },
+};
+static const struct SplatPlySchema gSplatPlyDefaultSchema = { gSplatPlyDefaultEntries, TF_ARRAY_COUNT(gSplatPlyDefaultEntries) };
+
+static const uint32_t gSplatPlyStreamSizes[SPLAT_PLY_NUM_STREAMS] = { 3, 3, 3, 4, 1, 3, SPLAT_PLY_MAX_REST };
+
+const struct SplatPlySchema* splatPlyDefaultSchema(void) { return &gSplatPlyDefaultSchema; }
+
+// Coefficients per channel the bands up to degree hold, besides dc.
+static inline uint32_t splatPlyRestPerChannel(uint32_t degree) { return (degree + 1) * (degree + 1) - 1; }
+
+uint32_t splatPlySchemaBindings(const struct SplatPlySchema* schema, uint32_t numRest, struct SplatPlyBinding* outBindings,
+                                uint32_t maxBindings) {
+    // the file stores the channels one after the other, numRest / 3 each; coefficients past degree 3 in a channel
+    // and extra ones that do not fill a channel are left unbound
+    const uint32_t fileStride = numRest / 3;
+    const uint32_t perChannel = fileStride < SPLAT_PLY_MAX_REST / 3 ? fileStride : SPLAT_PLY_MAX_REST / 3;
+    uint32_t       numBindings = 0;
+    for (uint32_t entryIdx = 0; entryIdx < schema->mNumEntries; entryIdx++) {
+        const struct SplatPlySchemaEntry* entry = &schema->pEntries[entryIdx];
+        if (entry->mStream >= SPLAT_PLY_NUM_STREAMS || entry->mComponent >= gSplatPlyStreamSizes[entry->mStream])
+            continue;
+        // a numbered rest run is split over the channels, any other run fills the stream from mComponent
+        const bool splitChannels = entry->mNumbered && entry->mStream == SPLAT_PLY_STREAM_SH_REST && entry->mComponent == 0;
+        uint32_t   count = 1;
+        if (entry->mNumbered)
+            count = splitChannels ? 3 * perChannel : gSplatPlyStreamSizes[entry->mStream] - entry->mComponent;
+        for (uint32_t i = 0; i < count && numBindings < maxBindings; i++) {
+            struct SplatPlyBinding* binding = &outBindings[numBindings++];
+            binding->mStream = entry->mStream;
+            binding->mComponent = splitChannels ? (i / perChannel) * 15 + i % perChannel : entry->mComponent + i;
+            const uint32_t number = splitChannels ? (i / perChannel) * fileStride + i % perChannel : i;
+            if (entry->mNumbered)
+                snprintf(binding->mName, sizeof(binding->mName), "%s%u", entry->mName, number);
+            else
+                snprintf(binding->mName, sizeof(binding->mName), "%s", entry->mName);
+        }
+    }
+    return numBindings;
+}
+
+void splatPlyStoreBinding(const struct SplatStreams* streams, uint64_t splat, const struct SplatPlyBinding* binding, float value) {
+    switch (binding->mStream) {
+    case SPLAT_PLY_STREAM_POSITION:
+        if (streams->pPositions)
+            streams->pPositions[splat].v[binding->mComponent] = value;
+        if (streams->pColors)
+            streams->pColors[splat].v[binding->mComponent] = value;
+        break;
+    case SPLAT_PLY_STREAM_NORMAL:
+        if (streams->pNormals)
+            streams->pNormals[splat].v[binding->mComponent] = value;
+        break;
+    case SPLAT_PLY_STREAM_SCALE:
+        if (streams->pScales)
+            streams->pScales[splat].v[binding->mComponent] = value;
+        break;
+    case SPLAT_PLY_STREAM_ROTATION:
+        if (streams->pRotations)
+            streams->pRotations[splat].v[binding->mComponent] = value;
+        break;
+    case SPLAT_PLY_STREAM_OPACITY:
+        if (streams->pOpacities)
+            streams->pOpacities[splat] = value;
+        break;
+    case SPLAT_PLY_STREAM_SH_DC:
+        if (streams->pShs)
+            streams->pShs[splat].dc.v[binding->mComponent] = value;
+        break;
+    case SPLAT_PLY_STREAM_SH_REST:
+        if (streams->pShs)
+            streams->pShs[splat].rest[binding->mComponent] = value;
+        break;
+    default:
+        break;
+    }
+}
+
+static uint32_t splatPlyFindProperty(const struct SplatPlyLayout* layout, const char* name) {
+    for (uint32_t i = 0; i < layout->mNumProperties; i++) {
+        if (strcmp(layout->mPropertyNames[i], name) == 0)
+            return i;
+    }
+    return UINT32_MAX;
+}
+
+static struct SplatPlyField* splatPlyLayoutTarget(struct SplatPlyLayout* layout, uint32_t stream, uint32_t component) {
+    switch (stream) {
+    case SPLAT_PLY_STREAM_POSITION:
+        return &layout->mPosition[component];
+    case SPLAT_PLY_STREAM_NORMAL:
+        return &layout->mNormal[component];
+    case SPLAT_PLY_STREAM_SCALE:
+        return &layout->mScale[component];
+    case SPLAT_PLY_STREAM_ROTATION:
+        return &layout->mRotation[component];
+    case SPLAT_PLY_STREAM_OPACITY:
+        return &layout->mOpacity;
+    case SPLAT_PLY_STREAM_SH_DC:
+        return &layout->mDc[component];
+    case SPLAT_PLY_STREAM_SH_REST:
+        return &layout->mRest[component];
+    default:
+        return NULL;
+    }
+}
+
+// Consumes the next float of a 3DGS record, false when field is not it.
+static inline bool splatPlyExpectF32(struct SplatPlyField field, uint32_t* floatIdx) {
+    return field.mType == SPLAT_PLY_TYPE_F32 && field.mOffset == sizeof(float) * (*floatIdx)++;
+}
+
+// x y z [nx ny nz] f_dc_0..2 f_rest_0..N-1 opacity scale_0..2 rot_0..3 as
+// little endian floats and nothing else.
+static bool splatPlyIs3dgsRecord(const struct SplatPlyLayout* layout) {
+    const uint32_t perChannel = splatPlyRestPerChannel(layout->mShDegree);
+    if (layout->mFormat != SPLAT_PLY_FORMAT_BINARY_LE || !layout->mAllFloat32 || layout->mNumExtra || layout->mNumRest != 3 * perChannel)
+        return false;
+
+    uint32_t floatIdx = 0;
+    bool     match = true;
+    for (uint32_t i = 0; i < 3; i++)
+        match &= splatPlyExpectF32(layout->mPosition[i], &floatIdx);
+    for (uint32_t i = 0; i < 3 && layout->mHasNormals; i++)
+        match &= splatPlyExpectF32(layout->mNormal[i], &floatIdx);
+    for (uint32_t i = 0; i < 3; i++)
+        match &= splatPlyExpectF32(layout->mDc[i], &floatIdx);
+    for (uint32_t c = 0; c < 3; c++) {
+        for (uint32_t k = 0; k < perChannel; k++)
+            match &= splatPlyExpectF32(layout->mRest[c * 15 + k], &floatIdx);
+    }
+    match &= splatPlyExpectF32(layout->mOpacity, &floatIdx);
+    for (uint32_t i = 0; i < 3; i++)
+        match &= splatPlyExpectF32(layout->mScale[i], &floatIdx);
+    for (uint32_t i = 0; i < 4; i++)
+        match &= splatPlyExpectF32(layout->mRotation[i], &floatIdx);
+    return match && layout->mStride == sizeof(float) * floatIdx;
+}
+
+static void splatPlyResolveFields(struct SplatPlyLayout* layout, const struct SplatPlySchema* schema) {
+    // the rest run is counted first, its length decides how it is split over the channels
+    layout->mNumRest = 0;
+    for (uint32_t entryIdx = 0; entryIdx < schema->mNumEntries; entryIdx++) {
+        const struct SplatPlySchemaEntry* entry = &schema->pEntries[entryIdx];
+        if (entry->mStream != SPLAT_PLY_STREAM_SH_REST || !entry->mNumbered)
+            continue;
+        char name[32];
+        while (layout->mNumRest < SPLAT_PLY_MAX_PROPERTIES) {
+            snprintf(name, sizeof(name), "%s%u", entry->mName, layout->mNumRest);
+            if (splatPlyFindProperty(layout, name) == UINT32_MAX)
+                break;
+            layout->mNumRest++;
+        }
+        break;
+    }
+
+    struct SplatPlyBinding bindings[SPLAT_PLY_MAX_BINDINGS];
+    const uint32_t         numBindings = splatPlySchemaBindings(schema, layout->mNumRest, bindings, SPLAT_PLY_MAX_BINDINGS);
+    bool                   bound[SPLAT_PLY_MAX_PROPERTIES] = {};
+    for (uint32_t i = 0; i < numBindings; i++) {
+        const uint32_t        property = splatPlyFindProperty(layout, bindings[i].mName);
+        struct SplatPlyField* target = splatPlyLayoutTarget(layout, bindings[i].mStream, bindings[i].mComponent);
+        if (property == UINT32_MAX || !target)
+            continue;
+        *target = layout->mProperties[property];
+        bound[property] = true;
+    }
+    layout->mNumExtra = 0;
+    for (uint32_t i = 0; i < layout->mNumProperties; i++)
+        layout->mNumExtra += bound[i] ? 0 : 1;
+
+    const uint32_t perChannel = layout->mNumRest / 3;
+    if (layout->mNumRest != 3 * perChannel || perChannel > SPLAT_PLY_MAX_REST / 3)
+        LOGF(eWARNING, "Splat PLY has %u SH rest coefficients, only the first 15 of each whole channel are used.", layout->mNumRest);
+    layout->mShDegree = 0;
+    while (layout->mShDegree < 3 && splatPlyRestPerChannel(layout->mShDegree + 1) <= perChannel)
+        layout->mShDegree++;
+    layout->mHasNormals = true;
+    for (uint32_t i = 0; i < 3; i++)
+        layout->mHasNormals &= layout->mNormal[i].mType != SPLAT_PLY_TYPE_NONE;
+}
+
+bool splatPlyReadLayout(FileStream* fs, const struct SplatPlySchema* schema, struct SplatPlyLayout* layout) {
+    memset(layout, 0, sizeof(struct SplatPlyLayout));
+
+    char*  header = (char*)splatMalloc(gSplatPlyMaxHeaderBytes + 1);
+    size_t headerSize = fsReadFromStream(fs, header, gSplatPlyMaxHeaderBytes);
+    header[headerSize] = '\0';
+
+    bool   result = false;
+    bool   inVertex = false;
+    size_t elementIndex = 0;
+    char*  line = header;
+    while (line < header + headerSize) {
+        char* end = strchr(line, '\n');
+        if (!end)
+            break;
+        *end = '\0';
+        if (end > line && end[-1] == '\r')
+            end[-1] = '\0';
+
+        char  keyword[32] = {};
+        char  arg0[32] = {};
+        char  arg1[32] = {};
+        char  arg2[32] = {};
+        const int args = sscanf(line, "%31s %31s %31s %31s", keyword, arg0, arg1, arg2);
+        const char* next = end + 1;
+
+        if (line == header) {
+            if (strcmp(keyword, "ply") != 0)
+                break;
+        } else if (strcmp(keyword, "format") == 0) {
+            if (strcmp(arg0, "binary_little_endian") == 0)
+                layout->mFormat = SPLAT_PLY_FORMAT_BINARY_LE;
+            else if (strcmp(arg0, "binary_big_endian") == 0)
+                layout->mFormat = SPLAT_PLY_FORMAT_BINARY_BE;
+            else
+                layout->mFormat = SPLAT_PLY_FORMAT_ASCII;
+        } else if (strcmp(keyword, "element") == 0) {
+            inVertex = strcmp(arg0, "vertex") == 0;
+            if (inVertex) {
+                // the payload offset is only known when vertices come first
+                if (elementIndex != 0)
+                    break;
+                layout->mNumVertices = strtoull(arg1, NULL, 10);
+            }
+            elementIndex++;
+        } else if (strcmp(keyword, "property") == 0 && inVertex) {
+            if (args < 3 || strcmp(arg0, "list") == 0)
+                break;
+            const uint32_t type = splatPlyParseType(arg0);
+            if (type == SPLAT_PLY_TYPE_NONE || layout->mNumProperties >= SPLAT_PLY_MAX_PROPERTIES)
+                break;
+            struct SplatPlyField* field = &layout->mProperties[layout->mNumProperties];
+            field->mOffset = layout->mStride;
+            field->mType = type;
+            strncpy(layout->mPropertyNames[layout->mNumProperties], arg1, sizeof(layout->mPropertyNames[0]) - 1);
+            layout->mStride += splatPlyTypeSize(type);
+            layout->mNumProperties++;
+        } else if (strcmp(keyword, "end_header") == 0) {
+            layout->mDataOffset = (uint64_t)(next - header);
+            result = layout->mFormat != SPLAT_PLY_FORMAT_ASCII && layout->mStride > 0 && layout->mNumVertices > 0;
+            break;
+        }
+        line = (char*)next;
+    }
+    splatFree(header);
+
+    if (!result)
+        return false;
+
+    splatPlyResolveFields(layout, schema ? schema : &gSplatPlyDefaultSchema);
+    layout->mAllFloat32 = true;
+    for (uint32_t i = 0; i < layout->mNumProperties; i++)
+        layout->mAllFloat32 &= layout->mProperties[i].mType == SPLAT_PLY_TYPE_F32;
+    for (size_t i = 0; i < 3; i++) {
+        if (layout->mPosition[i].mType == SPLAT_PLY_TYPE_NONE) {
+            LOGF(eWARNING, "Splat PLY is missing position properties.");
+            return false;
+        }
+    }
+
+    layout->mDecoder = SPLAT_PLY_DECODER_GENERIC;
+    if (splatPlyIs3dgsRecord(layout))
+        layout->mDecoder = SPLAT_PLY_DECODER_3DGS;
+    else if (layout->mAllFloat32 && layout->mFormat == SPLAT_PLY_FORMAT_BINARY_LE)
+        layout->mDecoder = SPLAT_PLY_DECODER_F32;
+    static const char* decoderNames[] = { "generic", "float", "3dgs" };
+    LOGF(eINFO, "Splat PLY: SH degree %u, %s, %u unmapped properties, %s decoder.", layout->mShDegree,
+         layout->mHasNormals ? "normals" : "no normals", layout->mNumExtra, decoderNames[layout->mDecoder]);
+    return true;
+}
+
+static inline float splatPlyReadField(const uint8_t* vertex, struct SplatPlyField field, bool swap) {
+    uint8_t bytes[8];
+    const uint32_t size = splatPlyTypeSize(field.mType);
+    if (swap) {
+        for (uint32_t i = 0; i < size; i++)
+            bytes[i] = vertex[field.mOffset + size - 1 - i];
+    } else {
+        memcpy(bytes, vertex + field.mOffset, size);
+    }
+    switch (field.mType) {
+    case SPLAT_PLY_TYPE_I8: { int8_t v; memcpy(&v, bytes, sizeof(v)); return (float)v; }
+    case SPLAT_PLY_TYPE_U8: { uint8_t v; memcpy(&v, bytes, sizeof(v)); return (float)v; }
+    case SPLAT_PLY_TYPE_I16: { int16_t v; memcpy(&v, bytes, sizeof(v)); return (float)v; }
+    case SPLAT_PLY_TYPE_U16: { uint16_t v; memcpy(&v, bytes, sizeof(v)); return (float)v; }
+    case SPLAT_PLY_TYPE_I32: { int32_t v; memcpy(&v, bytes, sizeof(v)); return (float)v; }
+    case SPLAT_PLY_TYPE_U32: { uint32_t v; memcpy(&v, bytes, sizeof(v)); return (float)v; }
+    case SPLAT_PLY_TYPE_F32: { float v; memcpy(&v, bytes, sizeof(v)); return v; }
+    case SPLAT_PLY_TYPE_F64: { double v; memcpy(&v, bytes, sizeof(v)); return (float)v; }
+    default:
+        return 0.0f;
+    }
+}
+
+static inline float splatPlyLoadF32(const uint8_t* vertex, struct SplatPlyField field) {
+    float v = 0.0f;
+    if (field.mType != SPLAT_PLY_TYPE_NONE)
+        memcpy(&v, vertex + field.mOffset, sizeof(v));
+    return v;
+}
+
+// Little endian float only records are the common case, every property is a
+// plain load from its offset.
+static void splatPlyDecodeRangeF32(const struct SplatPlyLayout* layout, const uint8_t* data, uint64_t first, uint64_t count,
+                                   const struct SplatStreams* streams) {
+    for (uint64_t i = 0; i < count; i++) {
+        const uint8_t* vertex = data + i * layout->mStride;
+        const uint64_t idx = first + i;
+        if (streams->pPositions || streams->pColors) {
+            const struct Tf32x3_s pos = { splatPlyLoadF32(vertex, layout->mPosition[0]), splatPlyLoadF32(vertex, layout->mPosition[1]),
+                                          splatPlyLoadF32(vertex, layout->mPosition[2]) };
+            if (streams->pPositions)
+                streams->pPositions[idx] = pos;
+            if (streams->pColors)
+                streams->pColors[idx] = pos;
+        }
+        if (streams->pNormals) {
+            streams->pNormals[idx] = { splatPlyLoadF32(vertex, layout->mNormal[0]), splatPlyLoadF32(vertex, layout->mNormal[1]),
+                                       splatPlyLoadF32(vertex, layout->mNormal[2]) };
+        }
+        if (streams->pScales) {
+            streams->pScales[idx] = { splatPlyLoadF32(vertex, layout->mScale[0]), splatPlyLoadF32(vertex, layout->mScale[1]),
+                                      splatPlyLoadF32(vertex, layout->mScale[2]) };
+        }
+        if (streams->pRotations) {
+            streams->pRotations[idx] = { splatPlyLoadF32(vertex, layout->mRotation[0]), splatPlyLoadF32(vertex, layout->mRotation[1]),
+                                         splatPlyLoadF32(vertex, layout->mRotation[2]), splatPlyLoadF32(vertex, layout->mRotation[3]) };
+        }
+        if (streams->pOpacities)
+            streams->pOpacities[idx] = splatPlyLoadF32(vertex, layout->mOpacity);
+        if (streams->pShs) {
+            struct SphericalHarmonics* harmonics = &streams->pShs[idx];
+            harmonics->dc = { splatPlyLoadF32(vertex, layout->mDc[0]), splatPlyLoadF32(vertex, layout->mDc[1]),
+                              splatPlyLoadF32(vertex, layout->mDc[2]) };
+            for (uint32_t fIdx = 0; fIdx < SPLAT_PLY_MAX_REST; fIdx++)
+                harmonics->rest[fIdx] = splatPlyLoadF32(vertex, layout->mRest[fIdx]);
+        }
+    }
+}
+
+// One kernel per 3DGS record layout. Every offset and size is a compile time
+// constant, so each stream is filled with fixed size copies and the per
+// property field lookups of the other decoders go away.
+template <uint32_t Degree, bool HasNormals>
+static void splatPlyDecodeRange3dgs(const uint8_t* data, uint64_t first, uint64_t count, const struct SplatStreams* streams) {
+    const uint32_t perChannel = (Degree + 1) * (Degree + 1) - 1;
+    const uint32_t dcOffset = sizeof(float) * (HasNormals ? 6 : 3);
+    const uint32_t restOffset = dcOffset + sizeof(float) * 3;
+    const uint32_t opacityOffset = restOffset + sizeof(float) * 3 * perChannel;
+    const uint32_t scaleOffset = opacityOffset + sizeof(float);
+    const uint32_t rotationOffset = scaleOffset + sizeof(float) * 3;
+    const uint32_t stride = rotationOffset + sizeof(float) * 4;
+    for (uint64_t i = 0; i < count; i++) {
+        const uint8_t* vertex = data + i * stride;
+        const uint64_t idx = first + i;
+        if (streams->pPositions)
+            memcpy(&streams->pPositions[idx], vertex, sizeof(float) * 3);
+        if (streams->pColors)
+            memcpy(&streams->pColors[idx], vertex, sizeof(float) * 3);
+        if (streams->pNormals) {
+            if (HasNormals)
+                memcpy(&streams->pNormals[idx], vertex + sizeof(float) * 3, sizeof(float) * 3);
+            else
+                streams->pNormals[idx] = { 0.0f, 0.0f, 0.0f };
+        }
+        if (streams->pScales)
+            memcpy(&streams->pScales[idx], vertex + scaleOffset, sizeof(float) * 3);
+        if (streams->pRotations)
+            memcpy(&streams->pRotations[idx], vertex + rotationOffset, sizeof(float) * 4);
+        if (streams->pOpacities)
+            memcpy(&streams->pOpacities[idx], vertex + opacityOffset, sizeof(float));
+        if (streams->pShs) {
+            struct SphericalHarmonics* harmonics = &streams->pShs[idx];
+            memcpy(&harmonics->dc, vertex + dcOffset, sizeof(float) * 3);
+            if (perChannel == 15) {
+                memcpy(harmonics->rest, vertex + restOffset, sizeof(float) * SPLAT_PLY_MAX_REST);
+            } else {
+                memset(harmonics->rest, 0, sizeof(harmonics->rest));
+                memcpy(&harmonics->rest[0], vertex + restOffset, sizeof(float) * perChannel);
+                memcpy(&harmonics->rest[15], vertex + restOffset + sizeof(float) * perChannel, sizeof(float) * perChannel);
+                memcpy(&harmonics->rest[30], vertex + restOffset + sizeof(float) * 2 * perChannel, sizeof(float) * perChannel);
+            }
+        }
+    }
+}
+
+typedef void (*SplatPlyDecodeFunc)(const uint8_t* data, uint64_t first, uint64_t count, const struct SplatStreams* streams);
+
+// [degree][has normals]
+static const SplatPlyDecodeFunc gSplatPly3dgsDecoders[4][2] = {
+    { splatPlyDecodeRange3dgs<0, false>, splatPlyDecodeRange3dgs<0, true> },
+    { splatPlyDecodeRange3dgs<1, false>, splatPlyDecodeRange3dgs<1, true> },
+    { splatPlyDecodeRange3dgs<2, false>, splatPlyDecodeRange3dgs<2, true> },
+    { splatPlyDecodeRange3dgs<3, false>, splatPlyDecodeRange3dgs<3, true> },
+};
+
+// Decodes count vertices starting at data into streams at splat index first.
+static void splatPlyDecodeRange(const struct SplatPlyLayout* layout, const uint8_t* data, uint64_t first, uint64_t count,
+                                const struct SplatStreams* streams) {
+    if (layout->mDecoder == SPLAT_PLY_DECODER_3DGS) {
+        gSplatPly3dgsDecoders[layout->mShDegree][layout->mHasNormals ? 1 : 0](data, first, count, streams);
+        return;
+    }
+    if (layout->mDecoder == SPLAT_PLY_DECODER_F32) {
+        splatPlyDecodeRangeF32(layout, data, first, count, streams);
+        return;
+    }
+
+    // the payload byte order only differs from ours for big endian files
+    const bool swap = layout->mFormat == SPLAT_PLY_FORMAT_BINARY_BE;
+    for (uint64_t i = 0; i < count; i++) {
+        const uint8_t* vertex = data + i * layout->mStride;
+        const uint64_t idx = first + i;
+        if (streams->pPositions || streams->pColors) {
+            const struct Tf32x3_s pos = { splatPlyReadField(vertex, layout->mPosition[0], swap),
+                                          splatPlyReadField(vertex, layout->mPosition[1], swap),
+                                          splatPlyReadField(vertex, layout->mPosition[2], swap) };
+            if (streams->pPositions)
+                streams->pPositions[idx] = pos;
+            if (streams->pColors)
+                streams->pColors[idx] = pos;
+        }
+        if (streams->pNormals) {
+            streams->pNormals[idx] = { splatPlyReadField(vertex, layout->mNormal[0], swap),
+                                       splatPlyReadField(vertex, layout->mNormal[1], swap),
+                                       splatPlyReadField(vertex, layout->mNormal[2], swap) };
+        }
+        if (streams->pScales) {
+            streams->pScales[idx] = { splatPlyReadField(vertex, layout->mScale[0], swap),
+                                      splatPlyReadField(vertex, layout->mScale[1], swap),
+                                      splatPlyReadField(vertex, layout->mScale[2], swap) };
+        }
+        if (streams->pRotations) {
+            streams->pRotations[idx] = { splatPlyReadField(vertex, layout->mRotation[0], swap),
+                                         splatPlyReadField(vertex, layout->mRotation[1], swap),
+                                         splatPlyReadField(vertex, layout->mRotation[2], swap),
+                                         splatPlyReadField(vertex, layout->mRotation[3], swap) };
+        }
+        if (streams->pOpacities)
+            streams->pOpacities[idx] = splatPlyReadField(vertex, layout->mOpacity, swap);
+        if (streams->pShs) {
+            struct SphericalHarmonics* harmonics = &streams->pShs[idx];
+            harmonics->dc = { splatPlyReadField(vertex, layout->mDc[0], swap), splatPlyReadField(vertex, layout->mDc[1], swap),
+                              splatPlyReadField(vertex, layout->mDc[2], swap) };
+            for (uint32_t fIdx = 0; fIdx < SPLAT_PLY_MAX_REST; fIdx++)
+                harmonics->rest[fIdx] = splatPlyReadField(vertex, layout->mRest[fIdx], swap);
+        }
+    }
+}
+
+struct SplatPlyDecodeTask {
+    const struct SplatPlyLayout* pLayout;
+    const struct SplatStreams*   pStreams;
+    const uint8_t*               pData;
+    uint64_t                     mFirstSplat;
+    uint64_t                     mNumSplats;
+};
+
+static void splatPlyDecodeTaskFunc(void* user, uint64_t index) {
+    const struct SplatPlyDecodeTask* task = (const struct SplatPlyDecodeTask*)user;
+    const uint64_t begin = index * gSplatPlySplatsPerTask;
+    const uint64_t end = begin + gSplatPlySplatsPerTask < task->mNumSplats ? begin + gSplatPlySplatsPerTask : task->mNumSplats;
+    splatPlyDecodeRange(task->pLayout, task->pData + begin * task->pLayout->mStride, task->mFirstSplat + begin, end - begin,
+                        task->pStreams);
+}
+
+bool splatPlyLoad(ThreadSystem threadSystem, FileStream* fs, const struct SplatPlyLayout* layout, const struct SplatStreams* streams,
+                  struct SplatLoadStats* outStats) {
+    const int64_t startUs = getUSec(false);
+    if (!fsSeekStream(fs, SBO_START_OF_FILE, (ssize_t)layout->mDataOffset)) {
+        LOGF(eERROR, "Failed to seek to the splat payload.");
+        return false;
+    }
+
+    const uint64_t splatsPerChunk = gSplatPlyChunkBytes / layout->mStride > 0 ? gSplatPlyChunkBytes / layout->mStride : 1;
+    const uint64_t chunkBytes = splatsPerChunk * layout->mStride;
+    uint8_t*       chunks[2] = { (uint8_t*)splatMalloc(chunkBytes), (uint8_t*)splatMalloc(chunkBytes) };
+
+    bool     result = true;
+    uint64_t numRead = splatsPerChunk < layout->mNumVertices ? splatsPerChunk : layout->mNumVertices;
+    if (fsReadFromStream(fs, chunks[0], numRead * layout->mStride) != numRead * layout->mStride)
+        result = false;
+
+    struct SplatPlyDecodeTask task = {};
+    task.pLayout = layout;
+    task.pStreams = streams;
+    for (uint64_t first = 0, chunkIdx = 0; result && first < layout->mNumVertices; first += task.mNumSplats, chunkIdx++) {
+        task.pData = chunks[chunkIdx & 1];
+        task.mFirstSplat = first;
+        task.mNumSplats = numRead;
+        const uint32_t numTasks = (uint32_t)((task.mNumSplats + gSplatPlySplatsPerTask - 1) / gSplatPlySplatsPerTask);
+        if (threadSystem)
+            threadSystemAddTaskGroup(threadSystem, splatPlyDecodeTaskFunc, numTasks, &task);
+
+        // read the next chunk while the current one is being decoded
+        const uint64_t nextFirst = first + task.mNumSplats;
+        numRead = layout->mNumVertices - nextFirst < splatsPerChunk ? layout->mNumVertices - nextFirst : splatsPerChunk;
+        if (numRead > 0 && fsReadFromStream(fs, chunks[(chunkIdx + 1) & 1], numRead * layout->mStride) != numRead * layout->mStride)
+            result = false;
+
+        if (threadSystem) {
+            threadSystemWaitIdle(threadSystem);
+        } else {
+            for (uint32_t taskIdx = 0; taskIdx < numTasks; taskIdx++)
+                splatPlyDecodeTaskFunc(&task, taskIdx);
+        }
+    }
+    splatFree(chunks[0]);
+    splatFree(chunks[1]);
+
+    if (!result) {
+        LOGF(eERROR, "Splat PLY payload is truncated.");
+        return false;
+    }
+    if (outStats) {
+        outStats->mNumSplats = layout->mNumVertices;
+        outStats->mNumBytes = layout->mNumVertices * layout->mStride;
+        outStats->mDurationUs = getUSec(false) - startUs;
+    }
+    return true;
+}
+
+bool splatPlyLoadMapped(ThreadSystem threadSystem, FileStream* fs, const struct SplatPlyLayout* layout, const struct SplatStreams* streams,
+                        struct SplatLoadStats* outStats) {
+    if (layout->mFormat != SPLAT_PLY_FORMAT_BINARY_LE || !layout->mAllFloat32)
+        return false;
+
+    const int64_t startUs = getUSec(false);
+    size_t        mappedSize = 0;
+    const void*   mapped = NULL;
+    if (!fsStreamMemoryMap(fs, &mappedSize, &mapped) || !mapped) {
+        LOGF(eINFO, "Splat PLY can not be memory mapped, using buffered reads.");
+        return false;
+    }
+    const uint64_t payloadBytes = layout->mNumVertices * layout->mStride;
+    if (layout->mDataOffset + payloadBytes > mappedSize) {
+        LOGF(eERROR, "Splat PLY payload is truncated.");
+        return false;
+    }
+
+    struct SplatPlyDecodeTask task = {};
+    task.pLayout = layout;
+    task.pStreams = streams;
+    task.pData = (const uint8_t*)mapped + layout->mDataOffset;
+    task.mFirstSplat = 0;
+    task.mNumSplats = layout->mNumVertices;
+    const uint32_t numTasks = (uint32_t)((task.mNumSplats + gSplatPlySplatsPerTask - 1) / gSplatPlySplatsPerTask);
+    if (threadSystem) {
+        threadSystemAddTaskGroup(threadSystem, splatPlyDecodeTaskFunc, numTasks, &task);
+        threadSystemWaitIdle(threadSystem);
+    } else {
+        for (uint32_t taskIdx = 0; taskIdx < numTasks; taskIdx++)
+            splatPlyDecodeTaskFunc(&task, taskIdx);
+    }
+
+    if (outStats) {
+        outStats->mNumSplats = layout->mNumVertices;
+        outStats->mNumBytes = payloadBytes;
+        outStats->mDurationUs = getUSec(false) - startUs;
+    }
+    return true;
+}
+
+bool splatPlyLoadFile(ThreadSystem threadSystem, ResourceDirectory resourceDir, const char* path, struct SplatStreams* outStreams,
+                      uint64_t* outNumSplats) {
+    FileStream fh = {};
+    if (!fsOpenStreamFromPath(resourceDir, path, FM_READ, &fh)) {
+        LOGF(eERROR, "Failed to open splat PLY %s.", path);
+        return false;
+    }
+
+    struct SplatPlyLayout* layout = (struct SplatPlyLayout*)splatMalloc(sizeof(struct SplatPlyLayout));
+    bool                   success = splatPlyReadLayout(&fh, NULL, layout);
+    if (!success) {
+        LOGF(eERROR, "Unsupported splat PLY layout in %s.", path);
+    } else {
+        splatAllocStreams(outStreams, layout->mNumVertices);
+        struct SplatLoadStats stats = {};
+        success = splatPlyLoadMapped(threadSystem, &fh, layout, outStreams, &stats) ||
+                  splatPlyLoad(threadSystem, &fh, layout, outStreams, &stats);
+        if (success) {
+            splatLogLoadStats(path, &stats);
+            *outNumSplats = layout->mNumVertices;
+        } else {
+            splatFreeStreams(outStreams);
+        }
+    }
+    splatFree(layout);
+    fsCloseStream(&fh);
+    return success;
+}
+
+// vertices per write of splatPlyWriteFile
+static const uint64_t gSplatPlyWriteBatch = 4096;
+static const uint32_t gSplatPlyWriteFloats = 3 + 3 + 3 + SPLAT_PLY_MAX_REST + 1 + 3 + 4;
+
+bool splatPlyWriteFile(ResourceDirectory resourceDir, const char* path, const struct SplatStreams* streams, uint64_t numSplats) {
+    FileStream fh = {};
+    if (!fsOpenStreamFromPath(resourceDir, path, FM_WRITE, &fh)) {
+        LOGF(eERROR, "Failed to create splat PLY %s.", path);
+        return false;
+    }
+
+    char header[4096];
+    int  headerSize = snprintf(header, sizeof(header),
+                               "ply\nformat binary_little_endian 1.0\nelement vertex %llu\n"
+                               "property float x\nproperty float y\nproperty float z\n"
+                               "property float nx\nproperty float ny\nproperty float nz\n"
+                               "property float f_dc_0\nproperty float f_dc_1\nproperty float f_dc_2\n",
+                               (unsigned long long)numSplats);
+    for (uint32_t i = 0; i < SPLAT_PLY_MAX_REST; i++)
+        headerSize += snprintf(header + headerSize, sizeof(header) - headerSize, "property float f_rest_%u\n", i);
+    headerSize += snprintf(header + headerSize, sizeof(header) - headerSize,
+                           "property float opacity\nproperty float scale_0\nproperty float scale_1\nproperty float scale_2\n"
+                           "property float rot_0\nproperty float rot_1\nproperty float rot_2\nproperty float rot_3\nend_header\n");
+    bool success = fsWriteToStream(&fh, header, (size_t)headerSize) == (size_t)headerSize;
+
+    // interleaved in file order, the rotations keep w in x which is rot_0
+    float* batch = (float*)splatMalloc(sizeof(float) * gSplatPlyWriteFloats * gSplatPlyWriteBatch);
+    for (uint64_t first = 0; success && first < numSplats; first += gSplatPlyWriteBatch) {
+        const uint64_t count = numSplats - first < gSplatPlyWriteBatch ? numSplats - first : gSplatPlyWriteBatch;
+        for (uint64_t i = 0; i < count; i++) {
+            const uint64_t                   splat = first + i;
+            float*                           out = batch + i * gSplatPlyWriteFloats;
+            const struct Tf32x3_s            normal = streams->pNormals ? streams->pNormals[splat] : Tf32x3_s{ 0.0f, 0.0f, 0.0f };
+            const struct SphericalHarmonics* sh = &streams->pShs[splat];
+            memcpy(out, &streams->pPositions[splat], sizeof(float) * 3);
+            memcpy(out + 3, &normal, sizeof(float) * 3);
+            memcpy(out + 6, &sh->dc, sizeof(float) * 3);
+            memcpy(out + 9, sh->rest, sizeof(float) * SPLAT_PLY_MAX_REST);
+            out[9 + SPLAT_PLY_MAX_REST] = streams->pOpacities[splat];
+            memcpy(out + 10 + SPLAT_PLY_MAX_REST, &streams->pScales[splat], sizeof(float) * 3);
+            memcpy(out + 13 + SPLAT_PLY_MAX_REST, &streams->pRotations[splat], sizeof(float) * 4);
+        }
+        const size_t bytes = sizeof(float) * gSplatPlyWriteFloats * count;
+        success = fsWriteToStream(&fh, batch, bytes) == bytes;
+    }
+    splatFree(batch);
+    if (!success)
+        LOGF(eERROR, "Failed to write splat PLY %s.", path);
+    fsCloseStream(&fh);
+    return success;
+}
@@ -0,0 +1,174 @@
+/*
+ * Copyright (c) 2017-2024 The Forge Interactive Inc.
+ *
+ * This file is part of The-Forge
+ * (see https://github.com/ConfettiFX/The-Forge).
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#pragma once
+
+#include "Splat.h"
+
+#include "Forge/TF_FileSystem.h"
+#include "Common_3/Utilities/Threading/ThreadSystem.h"
+
+#define SPLAT_PLY_MAX_PROPERTIES 128
+#define SPLAT_PLY_MAX_REST 45
+#define SPLAT_PLY_MAX_BINDINGS 64
+
+enum SplatPlyFormat {
+    SPLAT_PLY_FORMAT_ASCII = 0,
+    SPLAT_PLY_FORMAT_BINARY_LE,
+    SPLAT_PLY_FORMAT_BINARY_BE,
+};
+
+enum SplatPlyType {
+    SPLAT_PLY_TYPE_NONE = 0,
+    SPLAT_PLY_TYPE_I8,
+    SPLAT_PLY_TYPE_U8,
+    SPLAT_PLY_TYPE_I16,
+    SPLAT_PLY_TYPE_U16,
+    SPLAT_PLY_TYPE_I32,
+    SPLAT_PLY_TYPE_U32,
+    SPLAT_PLY_TYPE_F32,
+    SPLAT_PLY_TYPE_F64,
+};
+
+// Destination of a decoded property, see SplatPlySchemaEntry.
+enum SplatPlyStream {
+    SPLAT_PLY_STREAM_POSITION = 0, // also written to SplatStreams::pColors
+    SPLAT_PLY_STREAM_NORMAL,
+    SPLAT_PLY_STREAM_SCALE,
+    SPLAT_PLY_STREAM_ROTATION,     // component 0 is w
+    SPLAT_PLY_STREAM_OPACITY,
+    SPLAT_PLY_STREAM_SH_DC,
+    SPLAT_PLY_STREAM_SH_REST,      // channel major, 15 coefficients per channel
+    SPLAT_PLY_NUM_STREAMS
+};
+
+// How splatPlyDecodeRange reads the vertex records of a layout.
+enum SplatPlyDecoder {
+    SPLAT_PLY_DECODER_GENERIC = 0, // any type and byte order, converted per property
+    SPLAT_PLY_DECODER_F32,         // little endian float properties in any order
+    SPLAT_PLY_DECODER_3DGS,        // the record written by 3DGS training, see mShDegree and mHasNormals
+};
+
+// Maps one PLY property, or a numbered run of them, to a stream component.
+// A numbered entry matches mName followed by 0, 1, 2... and fills the stream
+// from mComponent on. A numbered SH rest entry at component 0 is as long as
+// the run in the file and is split evenly over the three color channels, so
+// files of any SH degree land in the channel major layout.
+struct SplatPlySchemaEntry {
+    const char* mName;
+    uint32_t    mStream;    // SplatPlyStream
+    uint32_t    mComponent; // first component written
+    bool        mNumbered;
+};
+
+struct SplatPlySchema {
+    const struct SplatPlySchemaEntry* pEntries;
+    uint32_t                          mNumEntries;
+};
+
+// A schema entry resolved to one property name and one destination component.
+struct SplatPlyBinding {
+    char     mName[32];
+    uint32_t mStream;
+    uint32_t mComponent;
+};
+
+// Byte offset of one property inside a vertex record.
+struct SplatPlyField {
+    uint32_t mOffset;
+    uint32_t mType; // SplatPlyType, SPLAT_PLY_TYPE_NONE when the file lacks the property
+};
+
+// Vertex layout resolved once from the PLY header, so decoding a vertex is a
+// fixed set of loads instead of a hash lookup per property.
+struct SplatPlyLayout {
+    uint32_t mFormat;
+    uint32_t mStride;
+    uint64_t mNumVertices;
+    uint64_t mDataOffset; // first byte of the vertex payload in the file
+    bool     mAllFloat32; // every vertex property is a 32 bit float
+    bool     mHasNormals;
+    uint32_t mDecoder;    // SplatPlyDecoder
+    uint32_t mShDegree;   // highest band fully present in the file
+    uint32_t mNumRest;    // rest coefficients in the file, over all channels
+    uint32_t mNumExtra;   // properties the schema does not map, skipped
+
+    struct SplatPlyField mPosition[3];
+    struct SplatPlyField mNormal[3];
+    struct SplatPlyField mScale[3];
+    struct SplatPlyField mRotation[4];
+    struct SplatPlyField mDc[3];
+    struct SplatPlyField mRest[SPLAT_PLY_MAX_REST]; // indexed like SphericalHarmonics::rest
+    struct SplatPlyField mOpacity;
+
+    uint32_t mNumProperties;
+    char     mPropertyNames[SPLAT_PLY_MAX_PROPERTIES][32];
+    struct SplatPlyField mProperties[SPLAT_PLY_MAX_PROPERTIES];
+};
+
+// The 3DGS property names: x y z, nx ny nz, f_dc_*, f_rest_*, opacity,
+// scale_* and rot_*.
+const struct SplatPlySchema* splatPlyDefaultSchema(void);
+
+// Expands schema into one binding per property for a file holding numRest
+// SH rest coefficients. Returns the number of bindings written.
+uint32_t splatPlySchemaBindings(const struct SplatPlySchema* schema, uint32_t numRest, struct SplatPlyBinding* outBindings,
+                                uint32_t maxBindings);
+
+// Writes one decoded property value of splat to the stream binding targets.
+void splatPlyStoreBinding(const struct SplatStreams* streams, uint64_t splat, const struct SplatPlyBinding* binding, float value);
+
+// Parses the header from the start of the stream and maps its properties with
+// schema, NULL for splatPlyDefaultSchema. Returns false when the file is not
+// a PLY with a fixed size vertex record as its first element; callers fall
+// back to the TF_ply reader in that case. Records in the 3DGS layout of SH
+// degree 0 to 3, with or without normals, get SPLAT_PLY_DECODER_3DGS.
+bool splatPlyReadLayout(FileStream* fs, const struct SplatPlySchema* schema, struct SplatPlyLayout* layout);
+
+// Decodes the vertex payload described by layout into streams. The payload is
+// read in chunks and every chunk is split across the worker pool while the
+// next one is being read. threadSystem may be NULL to decode inline.
+bool splatPlyLoad(ThreadSystem threadSystem, FileStream* fs, const struct SplatPlyLayout* layout, const struct SplatStreams* streams,
+                  struct SplatLoadStats* outStats);
+
+// Zero copy variant of splatPlyLoad for binary_little_endian files whose
+// properties are all float. The file is memory mapped and the vertices are
+// deinterleaved from the mapping into streams, so load time is bounded by
+// page-in bandwidth. Returns false without touching streams when the layout
+// does not qualify or the file can not be mapped, callers then use
+// splatPlyLoad.
+bool splatPlyLoadMapped(ThreadSystem threadSystem, FileStream* fs, const struct SplatPlyLayout* layout, const struct SplatStreams* streams,
+                        struct SplatLoadStats* outStats);
+
+// Opens path, allocates outStreams with splatAllocStreams and decodes the
+// whole file into them, mapped when possible. Used by tools that run without
+// the renderer. The caller frees the streams with splatFreeStreams.
+bool splatPlyLoadFile(ThreadSystem threadSystem, ResourceDirectory resourceDir, const char* path, struct SplatStreams* outStreams,
+                      uint64_t* outNumSplats);
+
+// Writes numSplats splats as a binary little endian 3DGS PLY with every SH
+// band. Needs positions, scales, rotations, opacities and shs, missing
+// normals are written as zeros.
+bool splatPlyWriteFile(ResourceDirectory resourceDir, const char* path, const struct SplatStreams* streams, uint64_t numSplats);
@@ -0,0 +1,390 @@
+/*
+ * Copyright (c) 2017-2024 The Forge Interactive Inc.
+ *
+ * This file is part of The-Forge
+ * (see https://github.com/ConfettiFX/The-Forge).
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "SplatPreprocess.h"
+
+#include "Forge/TF_Log.h"
+
+#include "SplatSh.h"
+
+// same as the reference projection in SplatRaster.cpp
+static const float gSplatPreprocessLowPassFilter = 0.3f;
+static const float gSplatPreprocessGuardBand = 1.3f;
+// coefficients of a splat above the dc band
+static const uint32_t gSplatPreprocessShRestSize = 15 * 3;
+
+void splatPreprocessBlockFromCamera(const struct SplatCamera* camera, uint64_t count, uint32_t shDegree,
+                                    const struct SplatQuantized* quantized, struct SplatPreprocessBlock* outBlock) {
+    memset(outBlock, 0, sizeof(struct SplatPreprocessBlock));
+    memcpy(outBlock->mView, camera->mView, sizeof(outBlock->mView));
+    outBlock->mCamera[0] = camera->mFocalX;
+    outBlock->mCamera[1] = camera->mFocalY;
+    outBlock->mCamera[2] = camera->mCenterX;
+    outBlock->mCamera[3] = camera->mCenterY;
+    outBlock->mViewport[0] = (float)camera->mWidth;
+    outBlock->mViewport[1] = (float)camera->mHeight;
+    outBlock->mViewport[2] = camera->mNear;
+    outBlock->mLimits[0] = gSplatPreprocessGuardBand * (float)camera->mWidth / (2.0f * camera->mFocalX);
+    outBlock->mLimits[1] = gSplatPreprocessGuardBand * (float)camera->mHeight / (2.0f * camera->mFocalY);
+    outBlock->mEye[0] = camera->mPosition.x;
+    outBlock->mEye[1] = camera->mPosition.y;
+    outBlock->mEye[2] = camera->mPosition.z;
+    outBlock->mParams[0] = (uint32_t)count;
+    outBlock->mParams[1] = shDegree > SPLAT_SH_MAX_DEGREE ? SPLAT_SH_MAX_DEGREE : shDegree;
+    outBlock->mParams[2] = quantized ? splatGpuShRestEncoding(quantized) : SPLAT_GPU_SH_REST_F32;
+    outBlock->mParams[3] = quantized ? quantized->mDesc.mChunkSize : 0;
+}
+
+void splatPackGpuSplats(const struct SplatStreams* src, uint64_t first, uint64_t count, struct SplatGpuSplat* outSplats,
+                        struct SplatGpuShRest* outShRest) {
+    // sigmoid(16) rounds to 1 in the pass
+    const float opaqueLogit = 16.0f;
+    for (uint64_t i = 0; i < count; i++) {
+        const uint64_t        index = first + i;
+        struct SplatGpuSplat* dst = &outSplats[i];
+        const struct Tf32x3_s dc = src->pShs ? src->pShs[index].dc : Tf32x3_s{ 0.0f, 0.0f, 0.0f };
+        const float           opacity = src->pOpacities ? src->pOpacities[index] : opaqueLogit;
+        memcpy(dst->mPosition, &src->pPositions[index], sizeof(dst->mPosition));
+        dst->mOpacityDcR = splatFloatToHalf(opacity) | (uint32_t)splatFloatToHalf(dc.x) << 16;
+        memcpy(dst->mRotation, &src->pRotations[index], sizeof(dst->mRotation));
+        memcpy(dst->mScale, &src->pScales[index], sizeof(dst->mScale));
+        dst->mDcGB = splatFloatToHalf(dc.y) | (uint32_t)splatFloatToHalf(dc.z) << 16;
+        if (!outShRest)
+            continue;
+        if (src->pShs)
+            memcpy(outShRest[i].mRest, src->pShs[index].rest, sizeof(outShRest[i].mRest));
+        else
+            memset(outShRest[i].mRest, 0, sizeof(outShRest[i].mRest));
+    }
+}
+
+uint32_t splatGpuShRestEncoding(const struct SplatQuantized* quantized) {
+    if (!quantized->mNumSplats)
+        return SPLAT_GPU_SH_REST_F32;
+    if (quantized->pShRestIndices)
+        return SPLAT_GPU_SH_REST_CODEBOOK;
+    return quantized->mDesc.mShEncoding == SPLAT_SH_ENCODING_F16 ? SPLAT_GPU_SH_REST_F16 : SPLAT_GPU_SH_REST_U8;
+}
+
+uint32_t splatGpuShRestWords(uint32_t encoding) {
+    switch (encoding) {
+    case SPLAT_GPU_SH_REST_F16: return (gSplatPreprocessShRestSize + 1) / 2;
+    case SPLAT_GPU_SH_REST_U8: return (gSplatPreprocessShRestSize + 3) / 4;
+    case SPLAT_GPU_SH_REST_CODEBOOK: return 1;
+    default: return gSplatPreprocessShRestSize;
+    }
+}
+
+uint64_t splatGpuShRestTableSize(const struct SplatQuantized* quantized) {
+    switch (splatGpuShRestEncoding(quantized)) {
+    case SPLAT_GPU_SH_REST_U8: return quantized->mNumChunks * 2 * gSplatPreprocessShRestSize;
+    case SPLAT_GPU_SH_REST_CODEBOOK: return (uint64_t)quantized->mDesc.mCodebookSize * gSplatPreprocessShRestSize;
+    default: return 1;
+    }
+}
+
+void splatPackGpuShRestTable(const struct SplatQuantized* quantized, float* outTable) {
+    const uint32_t encoding = splatGpuShRestEncoding(quantized);
+    if (encoding == SPLAT_GPU_SH_REST_CODEBOOK) {
+        memcpy(outTable, quantized->pShCodebook, sizeof(float) * gSplatPreprocessShRestSize * quantized->mDesc.mCodebookSize);
+    } else if (encoding == SPLAT_GPU_SH_REST_U8) {
+        // the rest coefficients follow the 3 dc ones in the ranges of a chunk
+        for (uint64_t chunk = 0; chunk < quantized->mNumChunks; chunk++) {
+            const struct SplatQuantizedChunk* ranges = &quantized->pChunks[chunk];
+            float*                            dst = &outTable[chunk * 2 * gSplatPreprocessShRestSize];
+            for (uint32_t c = 0; c < gSplatPreprocessShRestSize; c++) {
+                dst[c] = ranges->mShMin[3 + c];
+                dst[gSplatPreprocessShRestSize + c] = ranges->mShMax[3 + c] - ranges->mShMin[3 + c];
+            }
+        }
+    } else {
+        outTable[0] = 0.0f;
+    }
+}
+
+void splatPackGpuShRest(const struct SplatQuantized* quantized, uint64_t first, uint64_t count, uint32_t* outWords) {
+    const uint32_t encoding = splatGpuShRestEncoding(quantized);
+    const uint32_t numWords = splatGpuShRestWords(encoding);
+    ASSERT(encoding != SPLAT_GPU_SH_REST_F32);
+    for (uint64_t i = 0; i < count; i++) {
+        const uint64_t index = first + i;
+        uint32_t*      dst = &outWords[i * numWords];
+        if (encoding == SPLAT_GPU_SH_REST_CODEBOOK) {
+            dst[0] = quantized->pShRestIndices[index];
+            continue;
+        }
+        // the compressed copy stores the halves and bytes of a splat back to back, the words pad them
+        const uint32_t bytes = encoding == SPLAT_GPU_SH_REST_F16 ? 2 : 1;
+        memset(dst, 0, sizeof(uint32_t) * numWords);
+        memcpy(dst, &quantized->pShRest[index * gSplatPreprocessShRestSize * bytes], gSplatPreprocessShRestSize * bytes);
+    }
+}
+
+// Coefficient c of the SH above the dc band of splat i. Keep in sync with
+// splatShRest of splat_preprocess.comp.fsl.
+static float splatPreprocessShRest(const struct SplatPreprocessBlock* block, const struct SplatGpuShRestInput* shRest, uint64_t i,
+                                   uint32_t c) {
+    const uint32_t encoding = block->mParams[2];
+    const uint32_t numWords = splatGpuShRestWords(encoding);
+    if (encoding == SPLAT_GPU_SH_REST_F16) {
+        const uint32_t word = shRest->pWords[i * numWords + (c >> 1)];
+        return splatHalfToFloat((uint16_t)((word >> ((c & 1) * 16)) & 0xffffu));
+    }
+    if (encoding == SPLAT_GPU_SH_REST_U8) {
+        const uint32_t word = shRest->pWords[i * numWords + (c >> 2)];
+        const float*   ranges = &shRest->pTable[i / block->mParams[3] * 2 * gSplatPreprocessShRestSize];
+        const float    q = (float)((word >> ((c & 3) * 8)) & 0xffu);
+        return ranges[c] + ranges[gSplatPreprocessShRestSize + c] * (q * (1.0f / 255.0f));
+    }
+    if (encoding == SPLAT_GPU_SH_REST_CODEBOOK)
+        return shRest->pTable[shRest->pWords[i] * gSplatPreprocessShRestSize + c];
+    return splatPreprocessAsFloat(shRest->pWords[i * numWords + c]);
+}
+
+// Keep in sync with CS_MAIN of splat_preprocess.comp.fsl, line by line.
+bool splatPreprocessSplat(const struct SplatPreprocessBlock* block, const struct SplatGpuSplat* splats,
+                          const struct SplatGpuShRestInput* shRest, uint64_t i, struct SplatPreprocessRecord* outRecord) {
+    const float* v = block->mView;
+    outRecord->mRadius = 0.0f;
+
+    const struct SplatGpuSplat* splat = &splats[i];
+    const struct Tf32x3_s       p = { splat->mPosition[0], splat->mPosition[1], splat->mPosition[2] };
+    const float           tx = v[0] * p.x + v[1] * p.y + v[2] * p.z + v[3];
+    const float           ty = v[4] * p.x + v[5] * p.y + v[6] * p.z + v[7];
+    const float           tz = v[8] * p.x + v[9] * p.y + v[10] * p.z + v[11];
+    if (tz <= block->mViewport[2])
+        return false;
+    const float tzInv = splatPreprocessRcp(tz);
+
+    // 3D covariance, sigma = R S S^T R^T
+    const struct Tf32x4_s q = { splat->mRotation[0], splat->mRotation[1], splat->mRotation[2], splat->mRotation[3] };
+    const float           qLen2 = q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w;
+    const float           qInv = qLen2 > 0.0f ? splatPreprocessRsqrt(qLen2) : 0.0f;
+    const float           r = q.x * qInv, x = q.y * qInv, y = q.z * qInv, z = q.w * qInv;
+    const float s[3] = { splatPreprocessExp(splat->mScale[0]), splatPreprocessExp(splat->mScale[1]), splatPreprocessExp(splat->mScale[2]) };
+    const float rot[9] = {
+        1.0f - 2.0f * (y * y + z * z), 2.0f * (x * y - r * z),        2.0f * (x * z + r * y),
+        2.0f * (x * y + r * z),        1.0f - 2.0f * (x * x + z * z), 2.0f * (y * z - r * x),
+        2.0f * (x * z - r * y),        2.0f * (y * z + r * x),        1.0f - 2.0f * (x * x + y * y),
+    };
+    float m[9];
+    for (uint32_t row = 0; row < 3; row++) {
+        for (uint32_t col = 0; col < 3; col++)
+            m[row * 3 + col] = rot[row * 3 + col] * s[col];
+    }
+    float sigma[6]; // xx xy xz yy yz zz
+    sigma[0] = m[0] * m[0] + m[1] * m[1] + m[2] * m[2];
+    sigma[1] = m[0] * m[3] + m[1] * m[4] + m[2] * m[5];
+    sigma[2] = m[0] * m[6] + m[1] * m[7] + m[2] * m[8];
+    sigma[3] = m[3] * m[3] + m[4] * m[4] + m[5] * m[5];
+    sigma[4] = m[3] * m[6] + m[4] * m[7] + m[5] * m[8];
+    sigma[5] = m[6] * m[6] + m[7] * m[7] + m[8] * m[8];
+
+    // Jacobian of the perspective projection, evaluated at a mean clamped to the guard band
+    const float fx = block->mCamera[0], fy = block->mCamera[1];
+    const float txc = fminf(block->mLimits[0], fmaxf(-block->mLimits[0], tx * tzInv)) * tz;
+    const float tyc = fminf(block->mLimits[1], fmaxf(-block->mLimits[1], ty * tzInv)) * tz;
+    const float j00 = fx * tzInv;
+    const float j02 = -fx * txc * (tzInv * tzInv);
+    const float j11 = fy * tzInv;
+    const float j12 = -fy * tyc * (tzInv * tzInv);
+    // T = J W
+    const float t0[3] = { j00 * v[0] + j02 * v[8], j00 * v[1] + j02 * v[9], j00 * v[2] + j02 * v[10] };
+    const float t1[3] = { j11 * v[4] + j12 * v[8], j11 * v[5] + j12 * v[9], j11 * v[6] + j12 * v[10] };
+    const float st0[3] = { sigma[0] * t0[0] + sigma[1] * t0[1] + sigma[2] * t0[2], sigma[1] * t0[0] + sigma[3] * t0[1] + sigma[4] * t0[2],
+                           sigma[2] * t0[0] + sigma[4] * t0[1] + sigma[5] * t0[2] };
+    const float st1[3] = { sigma[0] * t1[0] + sigma[1] * t1[1] + sigma[2] * t1[2], sigma[1] * t1[0] + sigma[3] * t1[1] + sigma[4] * t1[2],
+                           sigma[2] * t1[0] + sigma[4] * t1[1] + sigma[5] * t1[2] };
+    const float a = t0[0] * st0[0] + t0[1] * st0[1] + t0[2] * st0[2] + gSplatPreprocessLowPassFilter;
+    const float b = t0[0] * st1[0] + t0[1] * st1[1] + t0[2] * st1[2];
+    const float c = t1[0] * st1[0] + t1[1] * st1[1] + t1[2] * st1[2] + gSplatPreprocessLowPassFilter;
+
+    const float det = a * c - b * b;
+    if (!(det > 0.0f))
+        return false;
+    const float detInv = splatPreprocessRcp(det);
+    const float mid = 0.5f * (a + c);
+    const float lambda = mid + splatPreprocessSqrt(fmaxf(0.1f, mid * mid - det));
+    const float radius = ceilf(3.0f * splatPreprocessSqrt(lambda));
+    const float px = fx * tx * tzInv + block->mCamera[2];
+    const float py = fy * ty * tzInv + block->mCamera[3];
+
+    // same tile rect test as the reference rasterizer, so both keep the same splats
+    const float tilesX = floorf((block->mViewport[0] + 15.0f) * 0.0625f);
+    const float tilesY = floorf((block->mViewport[1] + 15.0f) * 0.0625f);
+    const float minX = fminf(tilesX, fmaxf(0.0f, truncf((px - radius) * 0.0625f)));
+    const float minY = fminf(tilesY, fmaxf(0.0f, truncf((py - radius) * 0.0625f)));
+    const float maxX = fminf(tilesX, fmaxf(0.0f, truncf((px + radius + 15.0f) * 0.0625f)));
+    const float maxY = fminf(tilesY, fmaxf(0.0f, truncf((py + radius + 15.0f) * 0.0625f)));
+    if (minX >= maxX || minY >= maxY)
+        return false;
+
+    outRecord->mX = px;
+    outRecord->mY = py;
+    outRecord->mDepth = tz;
+    outRecord->mConic[0] = c * detInv;
+    outRecord->mConic[1] = -b * detInv;
+    outRecord->mConic[2] = a * detInv;
+    outRecord->mOpacity = splatPreprocessRcp(1.0f + splatPreprocessExp(-splatHalfToFloat((uint16_t)splat->mOpacityDcR)));
+
+    // the color along the unit direction from the eye, degree 0 ignores it and skips the cold coefficients
+    struct Tf32x3_s dir = { p.x - block->mEye[0], p.y - block->mEye[1], p.z - block->mEye[2] };
+    const float     dirLen2 = dir.x * dir.x + dir.y * dir.y + dir.z * dir.z;
+    const float     dirInv = dirLen2 > 0.0f ? splatPreprocessRsqrt(dirLen2) : 0.0f;
+    dir = { dir.x * dirInv, dir.y * dirInv, dir.z * dirInv };
+    const uint32_t            degree = shRest ? block->mParams[1] : 0;
+    struct SphericalHarmonics sh;
+    sh.dc = { splatHalfToFloat((uint16_t)(splat->mOpacityDcR >> 16)), splatHalfToFloat((uint16_t)splat->mDcGB),
+              splatHalfToFloat((uint16_t)(splat->mDcGB >> 16)) };
+    for (uint32_t c = 0; degree && c < gSplatPreprocessShRestSize; c++)
+        sh.rest[c] = splatPreprocessShRest(block, shRest, i, c);
+    const struct Tf32x3_s color = splatEvalSh(degree, &sh, dir);
+    outRecord->mColor[0] = color.x;
+    outRecord->mColor[1] = color.y;
+    outRecord->mColor[2] = color.z;
+    outRecord->mPad = 0.0f;
+    outRecord->mRadius = radius;
+    return true;
+}
+
+uint32_t splatPreprocess(const struct SplatPreprocessBlock* block, const struct SplatGpuSplat* splats,
+                         const struct SplatGpuShRestInput* shRest, struct SplatPreprocessRecord* records, uint32_t* visible,
+                         uint32_t* keys) {
+    uint32_t numVisible = 0;
+    for (uint32_t i = 0; i < block->mParams[0]; i++) {
+        if (!splatPreprocessSplat(block, splats, shRest, i, &records[i]))
+            continue;
+        visible[numVisible] = i;
+        keys[numVisible] = splatPreprocessAsUint(records[i].mDepth);
+        numVisible++;
+    }
+    return numVisible;
+}
+
+uint32_t splatPreprocessSortSteps(uint32_t capacity, struct SplatPreprocessSortStep* outSteps, uint32_t* outNumThreads) {
+    ASSERT(capacity <= (1u << 31));
+    uint32_t size = 1;
+    while (size < capacity)
+        size <<= 1;
+    uint32_t numSteps = 0;
+    for (uint32_t block = 2; block <= size; block <<= 1) {
+        // the flip step sorts the two halves of a block against each other, the others merge each half
+        outSteps[numSteps++] = { block / 2, 1 };
+        for (uint32_t span = block / 4; span > 0; span >>= 1)
+            outSteps[numSteps++] = { span, 0 };
+    }
+    *outNumThreads = size / 2;
+    return numSteps;
+}
+
+void splatPreprocessSortStep(const struct SplatPreprocessSortStep* step, uint32_t count, uint32_t thread, uint32_t* visible,
+                             uint32_t* keys) {
+    const uint32_t lane = thread % step->mSpan;
+    const uint32_t i = thread / step->mSpan * 2 * step->mSpan + lane;
+    const uint32_t j = step->mFlip ? i - lane + 2 * step->mSpan - 1 - lane : i + step->mSpan;
+    if (j >= count)
+        return;
+    const uint32_t keyI = keys[i];
+    const uint32_t keyJ = keys[j];
+    const uint32_t splatI = visible[i];
+    const uint32_t splatJ = visible[j];
+    if (keyI > keyJ || (keyI == keyJ && splatI < splatJ))
+        return;
+    keys[i] = keyJ;
+    keys[j] = keyI;
+    visible[i] = splatJ;
+    visible[j] = splatI;
+}
+
+void splatPreprocessSortArgs(uint32_t count, uint32_t step, struct SplatPreprocessDispatchArgs* outArgs) {
+    // the steps of the blocks of 2^level come after the level - 1 of every smaller block
+    uint32_t level = 1;
+    uint32_t first = 0;
+    while (first + level <= step) {
+        first += level;
+        level++;
+    }
+    uint32_t size = 1;
+    while (size < count)
+        size <<= 1;
+    const uint32_t numThreads = size / 2;
+    const uint32_t numRowThreads = numThreads < SPLAT_PREPROCESS_SORT_ROW_THREADS ? numThreads : SPLAT_PREPROCESS_SORT_ROW_THREADS;
+    if (level > 31 || (1u << level) > size) {
+        *outArgs = { 0, 0, 1 };
+        return;
+    }
+    *outArgs = { (numRowThreads + SPLAT_PREPROCESS_SORT_THREADS - 1) / SPLAT_PREPROCESS_SORT_THREADS, numThreads / numRowThreads, 1 };
+}
+
+void splatPreprocessSort(uint32_t capacity, uint32_t count, uint32_t* visible, uint32_t* keys) {
+    struct SplatPreprocessSortStep steps[SPLAT_PREPROCESS_SORT_MAX_STEPS];
+    uint32_t                       numThreads = 0;
+    const uint32_t                 numSteps = splatPreprocessSortSteps(capacity, steps, &numThreads);
+    for (uint32_t s = 0; s < numSteps; s++) {
+        struct SplatPreprocessDispatchArgs args;
+        splatPreprocessSortArgs(count, s, &args);
+        for (uint32_t row = 0; row < args.mGroupCountY; row++) {
+            for (uint32_t x = 0; x < args.mGroupCountX * SPLAT_PREPROCESS_SORT_THREADS; x++)
+                splatPreprocessSortStep(&steps[s], count, row * SPLAT_PREPROCESS_SORT_ROW_THREADS + x, visible, keys);
+        }
+    }
+}
+
+bool splatPreprocessQuad(const struct SplatPreprocessRecord* record, float outAxis[2], float outExtents[2]) {
+    // alpha reaches 1/255 where d^T conic d = 2 ln(255 opacity)
+    const float extent2 = 2.0f * logf(255.0f * record->mOpacity);
+    if (record->mRadius == 0.0f || !(extent2 > 0.0f))
+        return false;
+    // the smaller conic eigenvalue belongs to the major axis of the covariance
+    const float a = record->mConic[0], b = record->mConic[1], c = record->mConic[2];
+    const float mid = 0.5f * (a + c);
+    const float diff = sqrtf(0.25f * (a - c) * (a - c) + b * b);
+    const float minor = fmaxf(mid - diff, 1e-12f);
+    const float major = mid + diff;
+    float       axisX = a <= c ? 1.0f : 0.0f;
+    float       axisY = a <= c ? 0.0f : 1.0f;
+    if (fabsf(b) > 1e-12f) {
+        axisX = b;
+        axisY = minor - a;
+        const float axisInv = 1.0f / sqrtf(axisX * axisX + axisY * axisY);
+        axisX *= axisInv;
+        axisY *= axisInv;
+    }
+    outAxis[0] = axisX;
+    outAxis[1] = axisY;
+    outExtents[0] = fminf(record->mRadius, sqrtf(extent2 / minor));
+    outExtents[1] = fminf(record->mRadius, sqrtf(extent2 / major));
+    return true;
+}
+
+uint64_t splatPreprocessCountMismatches(const struct SplatPreprocessRecord* expected, const struct SplatPreprocessRecord* actual,
+                                        uint64_t count) {
+    uint64_t numMismatches = 0;
+    for (uint64_t i = 0; i < count; i++) {
+        const bool culled = expected[i].mRadius == 0.0f;
+        if (culled ? actual[i].mRadius != 0.0f : memcmp(&expected[i], &actual[i], sizeof(struct SplatPreprocessRecord)) != 0)
+            numMismatches++;
+    }
+    return numMismatches;
+}
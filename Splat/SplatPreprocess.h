@@ -0,0 +1,281 @@
+/*
+ * Copyright (c) 2017-2024 The Forge Interactive Inc.
+ *
+ * This file is part of The-Forge
+ * (see https://github.com/ConfettiFX/The-Forge).
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#pragma once
+
+#include <math.h>
+
+#include "Splat.h"
+#include "SplatQuantize.h"
+#include "SplatRaster.h"
+
+// CPU twin of the GPU preprocess pass (Shaders/FSL/splat_preprocess.comp.fsl).
+// One kernel thread culls and projects one splat, evaluates its SH color and,
+// when it is visible, appends it to a compacted instance list through an
+// atomic counter that doubles as the instance count of an indirect draw.
+//
+// The twin and the kernel are written statement for statement alike and only
+// use operations IEEE 754 rounds exactly (add, mul, compare, conversions and
+// bit casts): the divisions, square roots and exponentials of the reference
+// projection are replaced by the Newton and polynomial helpers below. With
+// contraction into fused multiply adds disabled on both sides the per splat
+// records match bit for bit. Neither side does so by default: the splat
+// library is built with -ffp-contract=off (see BUCK) and the kernel marks its
+// floats precise. The compaction order of the GPU depends on scheduling, the
+// visible list only matches once sorted (see splatPreprocessSort).
+//
+// The bit for bit match only holds for splats whose inputs, intermediate
+// values and outputs are normal floats or zero. GPUs may flush denormals to
+// zero, D3D12 and Vulkan leave it to the device for 32 bit floats, while the
+// twin keeps them, so a scale product or a covariance term that underflows
+// can differ in its last bits and everything computed from it. The helpers
+// take and return normal values, splatPreprocessExp saturates at e^-87,
+// above the smallest normal float.
+//
+// The math follows splatProjectScalar and agrees with it to a few ulps, but
+// for the opacity and the dc color that the inputs store as halves, see
+// Tools/SplatPreprocessBench.cpp for the tolerances.
+
+// Per frame constants of the kernel, laid out as its constant buffer.
+struct SplatPreprocessBlock {
+    float    mView[12];    // world to camera, rows of [R | t], see SplatCamera
+    float    mCamera[4];   // focal x, focal y, center x, center y
+    float    mViewport[4]; // width, height, near, unused
+    float    mLimits[4];   // guard band limits of x / z and y / z, unused
+    float    mEye[4];      // camera position, unused
+    uint32_t mParams[4];   // splat count, SH degree, SplatGpuShRestEncoding, splats per SH chunk
+};
+
+// Output of one splat, indexed by splat. Culled splats have a zero radius and
+// leave the other members undefined.
+struct SplatPreprocessRecord {
+    float mX; // pixel space mean
+    float mY;
+    float mDepth;
+    float mRadius; // whole pixels
+    float mConic[3]; // inverse of the 2D covariance, xx xy yy
+    float mOpacity;  // after the sigmoid activation
+    float mColor[3];
+    float mPad;
+};
+
+// Hot input of one splat, 48 bytes read as three uint4: everything the pass
+// needs to cull, project and color a splat at degree 0. The opacity logit
+// and the dc coefficients are halves, the rest is as loaded.
+struct SplatGpuSplat {
+    float    mPosition[3];
+    uint32_t mOpacityDcR; // half opacity logit | half dc red << 16
+    float    mRotation[4]; // w first, not normalized
+    float    mScale[3];    // log scales
+    uint32_t mDcGB;        // half dc green | half dc blue << 16
+};
+
+// Cold input of one splat, the SH coefficients above the dc band laid out as
+// SphericalHarmonics::rest. Only read when the degree is above 0.
+struct SplatGpuShRest {
+    float mRest[15 * 3];
+};
+
+// Layouts of the cold input, set in mParams[2] of the block. All but F32 are
+// the compressed copy of SplatQuantize.h as splatPackGpuShRest lays it out,
+// one run of 32 bit words per splat.
+enum SplatGpuShRestEncoding {
+    SPLAT_GPU_SH_REST_F32 = 0,  // SplatGpuShRest, 180 bytes
+    SPLAT_GPU_SH_REST_F16,      // 45 halves in 23 words, 92 bytes
+    SPLAT_GPU_SH_REST_U8,       // 45 bytes in 12 words, against the ranges of the chunk, 48 bytes
+    SPLAT_GPU_SH_REST_CODEBOOK, // codebook index, 4 bytes
+};
+
+// Cold input of the pass in the layout of mParams[2]. pTable holds the min
+// then the range of every coefficient per chunk of mParams[3] splats for U8,
+// the codebook for CODEBOOK, and is not read otherwise.
+struct SplatGpuShRestInput {
+    const uint32_t* pWords;
+    const float*    pTable;
+};
+
+// Arguments of the indirect instanced draw, mInstanceCount is the atomic
+// counter of the kernel and has to be cleared before every dispatch.
+struct SplatPreprocessDrawArgs {
+    uint32_t mVertexCount; // 4, a quad as a triangle strip
+    uint32_t mInstanceCount;
+    uint32_t mStartVertex;
+    uint32_t mStartInstance;
+};
+
+// Push constants of one step of the bitonic sort of the visible list
+// (Shaders/FSL/splat_sort.comp.fsl). A step compares entries mSpan apart, or
+// with mFlip the mirrored entries of blocks of 2 * mSpan.
+struct SplatPreprocessSortStep {
+    uint32_t mSpan;
+    uint32_t mFlip;
+};
+
+// Arguments of the indirect dispatch of one sort step, written by
+// Shaders/FSL/splat_sort_args.comp.fsl from the appended count.
+struct SplatPreprocessDispatchArgs {
+    uint32_t mGroupCountX;
+    uint32_t mGroupCountY;
+    uint32_t mGroupCountZ;
+};
+
+#define SPLAT_PREPROCESS_RECORD_FLOATS 12
+#define SPLAT_GPU_SPLAT_VECTORS 3
+#define SPLAT_PREPROCESS_THREADS 64
+#define SPLAT_PREPROCESS_SORT_THREADS 256
+// sort args threads, one per step
+#define SPLAT_PREPROCESS_SORT_ARGS_THREADS 64
+// sort threads per row of a dispatch, larger lists dispatch more rows
+#define SPLAT_PREPROCESS_SORT_ROW_THREADS (1u << 23)
+// steps of the network over 2^31 entries
+#define SPLAT_PREPROCESS_SORT_MAX_STEPS 496
+
+// Exact-rounding building blocks shared with the kernel. splatPreprocessRcp
+// and splatPreprocessRsqrt expect positive normal inputs below 2^125.
+static inline float splatPreprocessAsFloat(uint32_t bits) {
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+static inline uint32_t splatPreprocessAsUint(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+static inline float splatPreprocessRcp(float x) {
+    float r = splatPreprocessAsFloat(0x7ef311c3u - splatPreprocessAsUint(x));
+    r = r * (2.0f - x * r);
+    r = r * (2.0f - x * r);
+    r = r * (2.0f - x * r);
+    return r;
+}
+
+static inline float splatPreprocessRsqrt(float x) {
+    float r = splatPreprocessAsFloat(0x5f375a86u - (splatPreprocessAsUint(x) >> 1));
+    const float h = 0.5f * x;
+    r = r * (1.5f - h * r * r);
+    r = r * (1.5f - h * r * r);
+    r = r * (1.5f - h * r * r);
+    return r;
+}
+
+static inline float splatPreprocessSqrt(float x) { return x > 0.0f ? x * splatPreprocessRsqrt(x) : 0.0f; }
+
+// e^x through 2^n * e^f with |f| <= ln 2 / 2, exact to about 2 ulps in the
+// range of log scales and opacity logits. Saturates outside [-87, 88].
+static inline float splatPreprocessExp(float x) {
+    x = fminf(88.0f, fmaxf(-87.0f, x));
+    const float n = floorf(x * 1.44269504f + 0.5f);
+    const float f = (x - n * 0.693359375f) - n * -2.12194440e-4f;
+    float       p = 1.9875691500e-4f;
+    p = p * f + 1.3981999507e-3f;
+    p = p * f + 8.3334519073e-3f;
+    p = p * f + 4.1665795894e-2f;
+    p = p * f + 1.6666665459e-1f;
+    p = p * f + 5.0000001201e-1f;
+    p = p * (f * f) + f + 1.0f;
+    return p * splatPreprocessAsFloat((uint32_t)((int32_t)n + 127) << 23);
+}
+
+// Fills the constants for camera, count splats and an SH degree, with the
+// cold input laid out for quantized, which may be NULL for F32.
+void splatPreprocessBlockFromCamera(const struct SplatCamera* camera, uint64_t count, uint32_t shDegree,
+                                    const struct SplatQuantized* quantized, struct SplatPreprocessBlock* outBlock);
+
+// Packs count splats of src from first on into the kernel inputs, outShRest
+// may be NULL. Splats without opacity are packed fully opaque and splats
+// without SH with a zero dc.
+void splatPackGpuSplats(const struct SplatStreams* src, uint64_t first, uint64_t count, struct SplatGpuSplat* outSplats,
+                        struct SplatGpuShRest* outShRest);
+
+// Layout of the cold input for a compressed copy, F32 when there is none.
+uint32_t splatGpuShRestEncoding(const struct SplatQuantized* quantized);
+
+// 32 bit words of the cold input per splat in encoding.
+uint32_t splatGpuShRestWords(uint32_t encoding);
+
+// Floats of the table of quantized, at least one so there is always a buffer to bind.
+uint64_t splatGpuShRestTableSize(const struct SplatQuantized* quantized);
+
+// Writes the table of quantized, see SplatGpuShRestInput.
+void splatPackGpuShRestTable(const struct SplatQuantized* quantized, float* outTable);
+
+// Lays count splats of quantized from first on out as the cold input. The
+// encoding of quantized is not F32.
+void splatPackGpuShRest(const struct SplatQuantized* quantized, uint64_t first, uint64_t count, uint32_t* outWords);
+
+// One kernel thread: writes record i and returns whether splat i is visible.
+// shRest may be NULL, the splats are then colored at degree 0.
+bool splatPreprocessSplat(const struct SplatPreprocessBlock* block, const struct SplatGpuSplat* splats,
+                          const struct SplatGpuShRestInput* shRest, uint64_t i, struct SplatPreprocessRecord* outRecord);
+
+// Runs the kernel over every splat of the block in splat order: writes every
+// record, appends visible splats to visible with their depth key (the bits
+// of the positive view depth, which sort like the depth) and returns how
+// many there are. visible and keys hold the splat count.
+uint32_t splatPreprocess(const struct SplatPreprocessBlock* block, const struct SplatGpuSplat* splats,
+                         const struct SplatGpuShRestInput* shRest, struct SplatPreprocessRecord* records, uint32_t* visible,
+                         uint32_t* keys);
+
+// Steps of the bitonic network sorting a visible list of up to capacity
+// entries, returns how many were written to outSteps, which holds
+// SPLAT_PREPROCESS_SORT_MAX_STEPS. Every step runs *outNumThreads threads,
+// half the power of two at or above capacity. capacity is at most 2^31.
+uint32_t splatPreprocessSortSteps(uint32_t capacity, struct SplatPreprocessSortStep* outSteps, uint32_t* outNumThreads);
+
+// One sort kernel thread of step over the count entries of visible and keys.
+// Every comparator keeps the larger depth key, the farther splat, first and
+// breaks ties by the smaller splat index, so the sorted list does not depend
+// on the append order. Entries from count on stand for splats nearer than
+// any other, which a comparator never moves forward, and are not accessed.
+void splatPreprocessSortStep(const struct SplatPreprocessSortStep* step, uint32_t count, uint32_t thread, uint32_t* visible,
+                             uint32_t* keys);
+
+// Dispatch arguments of sort step number step for count appended entries.
+// The network over the power of two at or above count is the start of the
+// one over any larger capacity, the steps past it get no groups, so the
+// steps of the capacity can be recorded ahead and only the ones the count
+// needs run.
+void splatPreprocessSortArgs(uint32_t count, uint32_t step, struct SplatPreprocessDispatchArgs* outArgs);
+
+// Sorts the visible list back to front the way the sort passes do, running
+// the groups splatPreprocessSortArgs gives every step of the network for a
+// capacity of capacity.
+void splatPreprocessSort(uint32_t capacity, uint32_t count, uint32_t* visible, uint32_t* keys);
+
+// Screen quad of a visible record as drawn by Shaders/FSL/splat_quad.vert.fsl:
+// a rectangle along the eigenvectors of the 2D covariance, centered on the
+// mean, out to where opacity * exp(-0.5 d^T conic d) drops below 1/255 and
+// no further than the radius. outAxis is the unit major axis, outExtents the
+// half extents along it and its perpendicular in pixels. Returns false when
+// no pixel of the splat reaches 1/255. Not part of the exact-rounding
+// contract, the vertex shader uses native log and sqrt.
+bool splatPreprocessQuad(const struct SplatPreprocessRecord* record, float outAxis[2], float outExtents[2]);
+
+// Number of records that differ from expected, comparing the members defined
+// for the expected radius bit for bit.
+uint64_t splatPreprocessCountMismatches(const struct SplatPreprocessRecord* expected, const struct SplatPreprocessRecord* actual,
+                                        uint64_t count);
@@ -0,0 +1,151 @@
+/*
+ * Copyright (c) 2017-2024 The Forge Interactive Inc.
+ *
+ * This file is part of The-Forge
+ * (see https://github.com/ConfettiFX/The-Forge).
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#include "SplatProgressive.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "Forge/TF_Log.h"
+#include "Forge/Core/TF_Time.h"
+
+#define SPLAT_PROGRESSIVE_MAX_LEVELS 33
+
+static inline float splatImportance(const struct SplatStreams* streams, uint64_t i) {
+    const float opacity = streams->pOpacities ? 1.0f / (1.0f + expf(-streams->pOpacities[i])) : 1.0f;
+    if (!streams->pScales)
+        return opacity;
+    // exp of the log scales gives the volume, its 2/3 power stands in for the projected area
+    const struct Tf32x3_s s = streams->pScales[i];
+    return opacity * expf((2.0f / 3.0f) * (s.x + s.y + s.z));
+}
+
+void splatProgressiveOrder(const struct SplatStreams* streams, uint64_t count, uint32_t* outOrder, uint32_t* outNumLevels) {
+    if (count == 0) {
+        if (outNumLevels)
+            *outNumLevels = 0;
+        return;
+    }
+    uint32_t depth = 0;
+    while ((1ull << depth) < count)
+        depth++;
+
+    // the tournament, winners of the blocks at the current depth in Morton order
+    uint8_t*  levels = (uint8_t*)splatMalloc(count);
+    uint32_t* winners = (uint32_t*)splatMalloc(sizeof(uint32_t) * count);
+    float*    scores = (float*)splatMalloc(sizeof(float) * count);
+    for (uint64_t i = 0; i < count; i++) {
+        winners[i] = (uint32_t)i;
+        scores[i] = splatImportance(streams, i);
+    }
+    uint64_t numWinners = count;
+    for (uint32_t d = depth; d > 0; d--) {
+        uint64_t next = 0;
+        for (uint64_t i = 0; i + 1 < numWinners; i += 2, next++) {
+            // ties go to the first in Morton order
+            const bool     second = scores[i + 1] > scores[i];
+            const uint64_t win = second ? i + 1 : i;
+            levels[winners[second ? i : i + 1]] = (uint8_t)d;
+            winners[next] = winners[win];
+            scores[next] = scores[win];
+        }
+        if (numWinners & 1) {
+            winners[next] = winners[numWinners - 1];
+            scores[next] = scores[numWinners - 1];
+            next++;
+        }
+        numWinners = next;
+    }
+    levels[winners[0]] = 0;
+
+    // stable counting sort by level
+    uint64_t offsets[SPLAT_PROGRESSIVE_MAX_LEVELS + 1] = {};
+    for (uint64_t i = 0; i < count; i++)
+        offsets[levels[i] + 1]++;
+    for (uint32_t l = 0; l < SPLAT_PROGRESSIVE_MAX_LEVELS; l++)
+        offsets[l + 1] += offsets[l];
+    for (uint64_t i = 0; i < count; i++)
+        outOrder[offsets[levels[i]]++] = (uint32_t)i;
+    if (outNumLevels)
+        *outNumLevels = depth + 1;
+
+    splatFree(levels);
+    splatFree(winners);
+    splatFree(scores);
+}
+
+static void splatProgressiveLoadTask(void* user, uint64_t) {
+    struct SplatProgressiveLoader* loader = (struct SplatProgressiveLoader*)user;
+    uint64_t                       first = 0;
+    bool                           result = true;
+    while (result && first < loader->mNumSplats && !loader->mCancel.load(std::memory_order_relaxed)) {
+        const uint64_t count = loader->mNumSplats - first < loader->mBatchSize ? loader->mNumSplats - first : loader->mBatchSize;
+        result = splatCacheReadRange(&loader->mCache, first, count, &loader->mStreams);
+        if (result) {
+            first += count;
+            loader->mNumLoaded.store(first, std::memory_order_release);
+        }
+    }
+    if (!result)
+        LOGF(eERROR, "Failed to read splat cache batch at splat %llu.", (unsigned long long)first);
+    loader->mDurationUs = getUSec(false) - loader->mStartUs;
+    loader->mFailed.store(!result, std::memory_order_relaxed);
+    loader->mFinished.store(true, std::memory_order_release);
+}
+
+void splatProgressiveLoaderStart(struct SplatProgressiveLoader* loader, ThreadSystem threadSystem, struct SplatCache* cache,
+                                 const struct SplatStreams* streams, uint64_t batchSize) {
+    loader->mCache = *cache;
+    memset(cache, 0, sizeof(struct SplatCache));
+    loader->mStreams = *streams;
+    loader->mNumSplats = loader->mCache.mHeader.mNumSplats;
+    loader->mBatchSize = batchSize ? batchSize : 1;
+    loader->mThreadSystem = threadSystem;
+    loader->mStartUs = getUSec(false);
+    loader->mDurationUs = 0;
+    loader->mNumLoaded.store(0, std::memory_order_relaxed);
+    loader->mFailed.store(false, std::memory_order_relaxed);
+    loader->mCancel.store(false, std::memory_order_relaxed);
+    loader->mFinished.store(false, std::memory_order_release);
+    if (threadSystem)
+        threadSystemAddTask(threadSystem, splatProgressiveLoadTask, loader);
+    else
+        splatProgressiveLoadTask(loader, 0);
+}
+
+uint64_t splatProgressiveLoaderLoaded(const struct SplatProgressiveLoader* loader) {
+    return loader->mNumLoaded.load(std::memory_order_acquire);
+}
+
+bool splatProgressiveLoaderFinished(const struct SplatProgressiveLoader* loader) {
+    return loader->mFinished.load(std::memory_order_acquire);
+}
+
+void splatProgressiveLoaderExit(struct SplatProgressiveLoader* loader) {
+    loader->mCancel.store(true, std::memory_order_relaxed);
+    if (loader->mThreadSystem && !splatProgressiveLoaderFinished(loader))
+        threadSystemWaitIdle(loader->mThreadSystem);
+    splatCacheClose(&loader->mCache);
+}
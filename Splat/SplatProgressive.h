@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2017-2024 The Forge Interactive Inc.
+ *
+ * This file is part of The-Forge
+ * (see https://github.com/ConfettiFX/The-Forge).
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#pragma once
+
+#include <atomic>
+
+#include "Splat.h"
+#include "SplatCache.h"
+
+// Progressive loading: the scene is stored coarse to fine so that any prefix
+// of the streams is a spread out, importance weighted sample of the whole
+// scene, and a renderer can draw the loaded prefix while the rest arrives.
+//
+// The order is built on top of the Morton order. Over the Morton sequence
+// the splats play a knock out tournament in aligned blocks of 2, 4, 8, ...
+// on importance (opacity times a projected area proxy). A splat's level is
+// the depth of the largest block it wins, level 0 holds the winner of the
+// whole scene and level l about one splat per n / 2^l block. Sorting stably
+// by level keeps the Morton order within each level.
+
+// Writes the coarse to fine permutation of count Morton ordered splats,
+// order[i] is the splat to store at i. count must fit 32 bits. outNumLevels
+// is optional.
+void splatProgressiveOrder(const struct SplatStreams* streams, uint64_t count, uint32_t* outOrder, uint32_t* outNumLevels);
+
+// Reads a progressively ordered cache in batches on a worker of the thread
+// system, inline without one. The prefix [0, mNumLoaded) of streams is
+// complete and may be read while the load continues.
+struct SplatProgressiveLoader {
+    struct SplatCache     mCache;
+    struct SplatStreams   mStreams; // destination, owned by the caller
+    uint64_t              mNumSplats;
+    uint64_t              mBatchSize;
+    ThreadSystem          mThreadSystem;
+    int64_t               mStartUs;
+    int64_t               mDurationUs; // valid once finished
+    std::atomic<uint64_t> mNumLoaded;
+    std::atomic<bool>     mFinished;
+    std::atomic<bool>     mFailed;
+    std::atomic<bool>     mCancel;
+};
+
+// Takes ownership of the open cache.
+void splatProgressiveLoaderStart(struct SplatProgressiveLoader* loader, ThreadSystem threadSystem, struct SplatCache* cache,
+                                 const struct SplatStreams* streams, uint64_t batchSize);
+// Number of splats readable in streams, acquires their contents.
+uint64_t splatProgressiveLoaderLoaded(const struct SplatProgressiveLoader* loader);
+bool     splatProgressiveLoaderFinished(const struct SplatProgressiveLoader* loader);
+// Cancels a load in flight, waits for it and closes the cache.
+void splatProgressiveLoaderExit(struct SplatProgressiveLoader* loader);
@@ -0,0 +1,307 @@
+/*
+ * Copyright (c) 2017-2024 The Forge Interactive Inc.
+ *
+ * This file is part of The-Forge
+ * (see https://github.com/ConfettiFX/The-Forge).
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "SplatPrune.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "Forge/TF_Log.h"
+#include "Forge/Core/TF_Time.h"
+
+#include "SplatMorton.h"
+
+static const uint64_t gSplatPruneGrain = 65536;
+
+static const char* gSplatPruneRuleNames[SPLAT_PRUNE_NUM_RULES] = {
+    "kept", "invalid", "transparent", "too small", "too large", "merged",
+};
+
+struct SplatPruneContext {
+    const struct SplatPruneDesc* pDesc;
+    const struct SplatStreams*   pStreams;
+    uint8_t*                     pRules; // SplatPruneRule per splat
+    float                        mMinOpacityLogit;
+    float                        mMinLogScale;
+    float                        mMaxLogScale;
+};
+
+void splatPruneDescDefaults(struct SplatPruneDesc* outDesc) {
+    memset(outDesc, 0, sizeof(struct SplatPruneDesc));
+    outDesc->mDropInvalid = true;
+    outDesc->mMinOpacity = 1.0f / 255.0f;
+    outDesc->mMinScaleFraction = 1e-7f;
+    outDesc->mMaxScaleFraction = 0.1f;
+    outDesc->mMergeDistanceFraction = 1e-6f;
+    outDesc->mMergeMaxLogScaleDelta = 1e-3f;
+    outDesc->mMergeMinRotationDot = 0.9999f;
+    outDesc->mMergeMaxColorDelta = 1e-3f;
+}
+
+uint64_t splatPruneDescHash(const struct SplatPruneDesc* desc) {
+    const float values[] = { desc->mDropInvalid ? 1.0f : 0.0f, desc->mMinOpacity,           desc->mMinScaleFraction,
+                             desc->mMaxScaleFraction,          desc->mMergeDistanceFraction, desc->mMergeMaxLogScaleDelta,
+                             desc->mMergeMinRotationDot,       desc->mMergeMaxColorDelta };
+    // FNV-1a over the thresholds, never 0 so a pruned cache never matches an unpruned one
+    uint64_t       hash = 0xcbf29ce484222325ull;
+    const uint8_t* bytes = (const uint8_t*)values;
+    for (size_t i = 0; i < sizeof(values); i++)
+        hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+    return hash ? hash : 1;
+}
+
+const char* splatPruneRuleName(uint32_t rule) { return rule < SPLAT_PRUNE_NUM_RULES ? gSplatPruneRuleNames[rule] : "unknown"; }
+
+static bool splatAllFinite(const float* values, uint32_t count) {
+    uint32_t nonFinite = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t bits;
+        memcpy(&bits, &values[i], sizeof(bits));
+        nonFinite |= (bits & 0x7f800000u) == 0x7f800000u ? 1u : 0u;
+    }
+    return nonFinite == 0;
+}
+
+static uint8_t splatPruneClassify(const struct SplatPruneContext* ctx, uint64_t i) {
+    const struct SplatPruneDesc* desc = ctx->pDesc;
+    const struct SplatStreams*   streams = ctx->pStreams;
+    const struct Tf32x3_s        scale = streams->pScales[i];
+    const struct Tf32x4_s        rotation = streams->pRotations[i];
+    if (desc->mDropInvalid) {
+        const bool finite = splatAllFinite(&streams->pPositions[i].x, 3) && splatAllFinite(&scale.x, 3) && splatAllFinite(&rotation.x, 4) &&
+                            splatAllFinite(&streams->pOpacities[i], 1) && splatAllFinite(&streams->pShs[i].dc.x, 48) &&
+                            (!streams->pNormals || splatAllFinite(&streams->pNormals[i].x, 3));
+        const float lengthSq = rotation.x * rotation.x + rotation.y * rotation.y + rotation.z * rotation.z + rotation.w * rotation.w;
+        if (!finite || !(lengthSq > 1e-12f))
+            return SPLAT_PRUNE_INVALID;
+    }
+    // the comparisons are false for NaN, kept when the invalid rule is off
+    if (streams->pOpacities[i] < ctx->mMinOpacityLogit)
+        return SPLAT_PRUNE_TRANSPARENT;
+    const float maxLogScale = fmaxf(scale.x, fmaxf(scale.y, scale.z));
+    if (maxLogScale < ctx->mMinLogScale)
+        return SPLAT_PRUNE_TOO_SMALL;
+    if (maxLogScale > ctx->mMaxLogScale)
+        return SPLAT_PRUNE_TOO_LARGE;
+    return SPLAT_PRUNE_KEPT;
+}
+
+static void splatPruneClassifyRange(void* user, uint64_t begin, uint64_t end) {
+    const struct SplatPruneContext* ctx = (const struct SplatPruneContext*)user;
+    for (uint64_t i = begin; i < end; i++)
+        ctx->pRules[i] = splatPruneClassify(ctx, i);
+}
+
+static inline float splatSigmoid(float x) { return 1.0f / (1.0f + expf(-x)); }
+
+static bool splatPruneIsDuplicate(const struct SplatPruneDesc* desc, const struct SplatStreams* streams, uint64_t a, uint64_t b,
+                                  float maxDistanceSq) {
+    const struct Tf32x3_s pa = streams->pPositions[a], pb = streams->pPositions[b];
+    const float           dx = pa.x - pb.x, dy = pa.y - pb.y, dz = pa.z - pb.z;
+    if (dx * dx + dy * dy + dz * dz > maxDistanceSq)
+        return false;
+    const struct Tf32x3_s sa = streams->pScales[a], sb = streams->pScales[b];
+    if (fabsf(sa.x - sb.x) > desc->mMergeMaxLogScaleDelta || fabsf(sa.y - sb.y) > desc->mMergeMaxLogScaleDelta ||
+        fabsf(sa.z - sb.z) > desc->mMergeMaxLogScaleDelta)
+        return false;
+    const struct Tf32x3_s ca = streams->pShs[a].dc, cb = streams->pShs[b].dc;
+    if (fabsf(ca.x - cb.x) > desc->mMergeMaxColorDelta || fabsf(ca.y - cb.y) > desc->mMergeMaxColorDelta ||
+        fabsf(ca.z - cb.z) > desc->mMergeMaxColorDelta)
+        return false;
+    const struct Tf32x4_s qa = streams->pRotations[a], qb = streams->pRotations[b];
+    const float           dot = qa.x * qb.x + qa.y * qb.y + qa.z * qb.z + qa.w * qb.w;
+    const float           lengthSq =
+        (qa.x * qa.x + qa.y * qa.y + qa.z * qa.z + qa.w * qa.w) * (qb.x * qb.x + qb.y * qb.y + qb.z * qb.z + qb.w * qb.w);
+    return dot * dot >= desc->mMergeMinRotationDot * desc->mMergeMinRotationDot * lengthSq;
+}
+
+// Folds splat src into dst, weights are the accumulated opacities.
+static void splatPruneMerge(const struct SplatStreams* streams, uint64_t dst, uint64_t src, float* weights) {
+    const float alphaDst = splatSigmoid(streams->pOpacities[dst]);
+    const float alphaSrc = splatSigmoid(streams->pOpacities[src]);
+    const float t = alphaSrc / (weights[dst] + alphaSrc);
+    weights[dst] += alphaSrc;
+
+    float*       to = &streams->pPositions[dst].x;
+    const float* from = &streams->pPositions[src].x;
+    for (uint32_t k = 0; k < 3; k++)
+        to[k] += t * (from[k] - to[k]);
+    to = &streams->pScales[dst].x;
+    from = &streams->pScales[src].x;
+    for (uint32_t k = 0; k < 3; k++)
+        to[k] += t * (from[k] - to[k]);
+    to = &streams->pShs[dst].dc.x;
+    from = &streams->pShs[src].dc.x;
+    for (uint32_t k = 0; k < 48; k++)
+        to[k] += t * (from[k] - to[k]);
+
+    // two layers of the same footprint composited over each other
+    const float alpha = fminf(1.0f - (1.0f - alphaDst) * (1.0f - alphaSrc), 1.0f - 1e-6f);
+    streams->pOpacities[dst] = logf(alpha / (1.0f - alpha));
+}
+
+static inline uint64_t splatPruneCellKey(int64_t x, int64_t y, int64_t z) {
+    // 21 bits per axis, cells that wrap only cost extra distance tests; the top bit marks used slots
+    return (1ull << 63) | (((uint64_t)x & 0x1fffffu) << 42) | (((uint64_t)y & 0x1fffffu) << 21) | ((uint64_t)z & 0x1fffffu);
+}
+
+static inline int64_t splatPruneCell(float value, float invCellSize) {
+    // far outliers are clamped, they only share cells with each other
+    return (int64_t)fmaxf(fminf(floorf(value * invCellSize), 4e18f), -4e18f);
+}
+
+static inline uint64_t splatPruneCellSlot(uint64_t key, uint64_t mask) { return (key * 0x9e3779b97f4a7c15ull >> 32) & mask; }
+
+static void splatPruneMergeDuplicates(const struct SplatPruneDesc* desc, const struct SplatStreams* streams, uint64_t numSplats,
+                                      float cellSize, uint8_t* rules) {
+    uint64_t numCandidates = 0;
+    for (uint64_t i = 0; i < numSplats; i++)
+        numCandidates += rules[i] == SPLAT_PRUNE_KEPT ? 1 : 0;
+    uint64_t capacity = 64;
+    while (capacity < 2 * numCandidates)
+        capacity *= 2;
+    // open addressing from cell to the last splat inserted into it, splats of a cell are chained through pNext
+    uint64_t* keys = (uint64_t*)splatCalloc(capacity, sizeof(uint64_t));
+    uint32_t* heads = (uint32_t*)splatMalloc(sizeof(uint32_t) * capacity);
+    uint32_t* next = (uint32_t*)splatMalloc(sizeof(uint32_t) * numSplats);
+    float*    weights = (float*)splatMalloc(sizeof(float) * numSplats);
+    const uint64_t mask = capacity - 1;
+    const float    invCellSize = 1.0f / cellSize;
+    const float    maxDistanceSq = cellSize * cellSize;
+
+    for (uint64_t i = 0; i < numSplats; i++) {
+        if (rules[i] != SPLAT_PRUNE_KEPT)
+            continue;
+        const struct Tf32x3_s p = streams->pPositions[i];
+        if (!splatAllFinite(&p.x, 3))
+            continue;
+        const int64_t cx = splatPruneCell(p.x, invCellSize);
+        const int64_t cy = splatPruneCell(p.y, invCellSize);
+        const int64_t cz = splatPruneCell(p.z, invCellSize);
+        bool          merged = false;
+        for (int64_t dz = -1; dz <= 1 && !merged; dz++) {
+            for (int64_t dy = -1; dy <= 1 && !merged; dy++) {
+                for (int64_t dx = -1; dx <= 1 && !merged; dx++) {
+                    const uint64_t key = splatPruneCellKey(cx + dx, cy + dy, cz + dz);
+                    uint64_t       slot = splatPruneCellSlot(key, mask);
+                    while (keys[slot] && keys[slot] != key)
+                        slot = (slot + 1) & mask;
+                    if (!keys[slot])
+                        continue;
+                    for (uint32_t j = heads[slot]; j != UINT32_MAX && !merged; j = next[j]) {
+                        if (splatPruneIsDuplicate(desc, streams, j, i, maxDistanceSq)) {
+                            splatPruneMerge(streams, j, i, weights);
+                            rules[i] = SPLAT_PRUNE_MERGED;
+                            merged = true;
+                        }
+                    }
+                }
+            }
+        }
+        if (merged)
+            continue;
+
+        const uint64_t key = splatPruneCellKey(cx, cy, cz);
+        uint64_t       slot = splatPruneCellSlot(key, mask);
+        while (keys[slot] && keys[slot] != key)
+            slot = (slot + 1) & mask;
+        next[i] = keys[slot] ? heads[slot] : UINT32_MAX;
+        keys[slot] = key;
+        heads[slot] = (uint32_t)i;
+        weights[i] = splatSigmoid(streams->pOpacities[i]);
+    }
+
+    splatFree(keys);
+    splatFree(heads);
+    splatFree(next);
+    splatFree(weights);
+}
+
+template <typename T> static void splatPruneCompact(T* data, const uint8_t* rules, uint64_t numSplats) {
+    if (!data)
+        return;
+    uint64_t count = 0;
+    for (uint64_t i = 0; i < numSplats; i++) {
+        if (rules[i] == SPLAT_PRUNE_KEPT)
+            data[count++] = data[i];
+    }
+}
+
+uint64_t splatPrune(ThreadSystem threadSystem, const struct SplatPruneDesc* desc, const struct SplatStreams* streams, uint64_t numSplats,
+                    struct SplatPruneStats* outStats) {
+    const int64_t startUs = getUSec(false);
+    memset(outStats, 0, sizeof(struct SplatPruneStats));
+    outStats->mNumInput = numSplats;
+    outStats->mNumOutput = numSplats;
+    if (!numSplats || !streams->pPositions || !streams->pScales || !streams->pRotations || !streams->pOpacities || !streams->pShs)
+        return numSplats;
+
+    struct Tf32x3_s boundsMin, boundsMax;
+    splatComputeBounds(threadSystem, streams->pPositions, numSplats, &boundsMin, &boundsMax, NULL);
+    const float dx = boundsMax.x - boundsMin.x, dy = boundsMax.y - boundsMin.y, dz = boundsMax.z - boundsMin.z;
+    const float diagonal = sqrtf(dx * dx + dy * dy + dz * dz);
+
+    struct SplatPruneContext ctx = {};
+    ctx.pDesc = desc;
+    ctx.pStreams = streams;
+    ctx.pRules = (uint8_t*)splatMalloc(numSplats);
+    ctx.mMinOpacityLogit = desc->mMinOpacity > 0.0f ? logf(desc->mMinOpacity / (1.0f - desc->mMinOpacity)) : -INFINITY;
+    ctx.mMinLogScale = desc->mMinScaleFraction > 0.0f && diagonal > 0.0f ? logf(desc->mMinScaleFraction * diagonal) : -INFINITY;
+    ctx.mMaxLogScale = desc->mMaxScaleFraction > 0.0f && diagonal > 0.0f ? logf(desc->mMaxScaleFraction * diagonal) : INFINITY;
+    splatParallelFor(threadSystem, numSplats, gSplatPruneGrain, splatPruneClassifyRange, &ctx);
+
+    const float cellSize = desc->mMergeDistanceFraction * diagonal;
+    if (cellSize > 0.0f && numSplats < UINT32_MAX)
+        splatPruneMergeDuplicates(desc, streams, numSplats, cellSize, ctx.pRules);
+
+    for (uint64_t i = 0; i < numSplats; i++)
+        outStats->mNumRemoved[ctx.pRules[i]]++;
+    outStats->mNumOutput = outStats->mNumRemoved[SPLAT_PRUNE_KEPT];
+    outStats->mNumRemoved[SPLAT_PRUNE_KEPT] = 0;
+    if (outStats->mNumOutput < numSplats) {
+        splatPruneCompact(streams->pPositions, ctx.pRules, numSplats);
+        splatPruneCompact(streams->pColors, ctx.pRules, numSplats);
+        splatPruneCompact(streams->pNormals, ctx.pRules, numSplats);
+        splatPruneCompact(streams->pScales, ctx.pRules, numSplats);
+        splatPruneCompact(streams->pRotations, ctx.pRules, numSplats);
+        splatPruneCompact(streams->pOpacities, ctx.pRules, numSplats);
+        splatPruneCompact(streams->pShs, ctx.pRules, numSplats);
+    }
+    splatFree(ctx.pRules);
+
+    const uint64_t bytesPerSplat = sizeof(struct Tf32x3_s) * ((streams->pColors ? 1 : 0) + (streams->pNormals ? 1 : 0) + 2) +
+                                   sizeof(struct Tf32x4_s) + sizeof(float) + sizeof(struct SphericalHarmonics);
+    outStats->mBytesSaved = (numSplats - outStats->mNumOutput) * bytesPerSplat;
+    outStats->mDurationUs = getUSec(false) - startUs;
+    return outStats->mNumOutput;
+}
+
+void splatLogPruneStats(const struct SplatPruneStats* stats) {
+    LOGF(eINFO, "Splat prune: %llu of %llu splats kept, %.1f MB saved in %.2f ms", (unsigned long long)stats->mNumOutput,
+         (unsigned long long)stats->mNumInput, (double)stats->mBytesSaved / (1024.0 * 1024.0), stats->mDurationUs / 1000.0);
+    LOGF(eINFO, "Splat prune removed: %llu invalid, %llu transparent, %llu too small, %llu too large, %llu merged",
+         (unsigned long long)stats->mNumRemoved[SPLAT_PRUNE_INVALID], (unsigned long long)stats->mNumRemoved[SPLAT_PRUNE_TRANSPARENT],
+         (unsigned long long)stats->mNumRemoved[SPLAT_PRUNE_TOO_SMALL], (unsigned long long)stats->mNumRemoved[SPLAT_PRUNE_TOO_LARGE],
+         (unsigned long long)stats->mNumRemoved[SPLAT_PRUNE_MERGED]);
+}
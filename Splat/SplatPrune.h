@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2017-2024 The Forge Interactive Inc.
+ *
+ * This file is part of The-Forge
+ * (see https://github.com/ConfettiFX/The-Forge).
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#pragma once
+
+#include "Splat.h"
+
+// Load time pruning of splats that cost raster time without contributing to
+// the image. Rules run in this order and a splat is counted under the first
+// one that drops it:
+//
+// - invalid: a NaN or Inf attribute, or a zero rotation quaternion
+// - transparent: sigmoid(opacity) below mMinOpacity
+// - too small / too large: the largest activated scale axis outside the
+//   given fractions of the scene bounds diagonal. The upper bound is the
+//   criterion the 3DGS training uses to split big splats.
+// - merged: a near duplicate of an earlier splat, found through a spatial
+//   hash with cells of the merge distance. Two splats are duplicates when
+//   their centers are closer than the merge distance and their scales,
+//   rotations and base colors match within the tolerances. The earlier splat
+//   absorbs the later one: the opacities combine like two composited layers,
+//   centers, scales and SH are averaged weighted by opacity.
+//
+// Surviving splats keep their relative order. Every threshold set to 0
+// disables its rule.
+
+struct SplatPruneDesc {
+    bool  mDropInvalid;
+    float mMinOpacity;          // activated
+    float mMinScaleFraction;    // of the bounds diagonal, activated
+    float mMaxScaleFraction;
+    float mMergeDistanceFraction;
+    float mMergeMaxLogScaleDelta; // per axis, the scales are in log space
+    float mMergeMinRotationDot;   // |dot| of the normalized quaternions
+    float mMergeMaxColorDelta;    // per channel of the SH DC
+};
+
+enum SplatPruneRule {
+    SPLAT_PRUNE_KEPT = 0,
+    SPLAT_PRUNE_INVALID,
+    SPLAT_PRUNE_TRANSPARENT,
+    SPLAT_PRUNE_TOO_SMALL,
+    SPLAT_PRUNE_TOO_LARGE,
+    SPLAT_PRUNE_MERGED,
+    SPLAT_PRUNE_NUM_RULES
+};
+
+struct SplatPruneStats {
+    uint64_t mNumInput;
+    uint64_t mNumOutput;
+    uint64_t mNumRemoved[SPLAT_PRUNE_NUM_RULES]; // by rule, SPLAT_PRUNE_KEPT stays 0
+    uint64_t mBytesSaved; // over the streams present
+    int64_t  mDurationUs;
+};
+
+// Thresholds that only drop what can not be seen: opacity below 1/255,
+// scales outside 1e-7 to 0.1 of the scene size and near exact clones.
+void splatPruneDescDefaults(struct SplatPruneDesc* outDesc);
+// Changes whenever a threshold does, to key caches of pruned scenes.
+uint64_t splatPruneDescHash(const struct SplatPruneDesc* desc);
+const char* splatPruneRuleName(uint32_t rule);
+
+// Prunes numSplats splats of streams in place and returns how many are left
+// at the start of every stream. Needs positions, scales, rotations,
+// opacities and shs, other streams are compacted when present. The streams
+// keep their size, see splatShrinkStreams.
+uint64_t splatPrune(ThreadSystem threadSystem, const struct SplatPruneDesc* desc, const struct SplatStreams* streams, uint64_t numSplats,
+                    struct SplatPruneStats* outStats);
+
+void splatLogPruneStats(const struct SplatPruneStats* stats);
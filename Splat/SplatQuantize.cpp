@@ -0,0 +1,597 @@
+/*
+ * Copyright (c) 2017-2024 The Forge Interactive Inc.
+ *
+ * This file is part of The-Forge
+ * (see https://github.com/ConfettiFX/The-Forge).
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#include "SplatQuantize.h"
+
+#include <math.h>
+#include <float.h>
+#include <string.h>
+
+#include "Forge/TF_Log.h"
+
+#define SPLAT_SH_COEFFS 48
+#define SPLAT_SH_REST_COEFFS 45
+
+static const float gSplatSmallestThreeRange = 0.70710678118f; // 1 / sqrt(2)
+
+void splatQuantizeDescForQuality(uint32_t quality, struct SplatQuantizeDesc* desc) {
+    memset(desc, 0, sizeof(struct SplatQuantizeDesc));
+    desc->mChunkSize = 256;
+    desc->mCodebookIterations = 8;
+    desc->mCodebookTrainingSamples = 65536;
+    switch (quality) {
+    case SPLAT_QUALITY_LOW:
+        desc->mShEncoding = SPLAT_SH_ENCODING_U8;
+        desc->mScaleBits = 8;
+        desc->mCodebookSize = 4096;
+        break;
+    case SPLAT_QUALITY_MEDIUM:
+        desc->mShEncoding = SPLAT_SH_ENCODING_U8;
+        desc->mScaleBits = 16;
+        break;
+    default:
+        desc->mShEncoding = SPLAT_SH_ENCODING_F16;
+        desc->mScaleBits = 16;
+        break;
+    }
+}
+
+static inline uint32_t splatQuantizeUnorm(float value, float lo, float hi, uint32_t maxValue) {
+    if (!(hi > lo))
+        return 0;
+    float t = (value - lo) / (hi - lo);
+    t = t < 0.0f ? 0.0f : (t > 1.0f ? 1.0f : t);
+    return (uint32_t)(t * (float)maxValue + 0.5f);
+}
+
+static inline float splatDequantizeUnorm(uint32_t value, float lo, float hi, uint32_t maxValue) {
+    return lo + (hi - lo) * ((float)value / (float)maxValue);
+}
+
+static inline float splatShCoeff(const struct SphericalHarmonics* harmonics, uint32_t idx) {
+    return idx < 3 ? harmonics->dc.v[idx] : harmonics->rest[idx - 3];
+}
+
+static uint32_t splatPackQuaternion(struct Tf32x4_s q) {
+    const float len = sqrtf(q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w);
+    if (!(len > 0.0f))
+        q = { 1.0f, 0.0f, 0.0f, 0.0f };
+    else
+        q = { q.x / len, q.y / len, q.z / len, q.w / len };
+
+    uint32_t largest = 0;
+    for (uint32_t i = 1; i < 4; i++) {
+        if (fabsf(q.v[i]) > fabsf(q.v[largest]))
+            largest = i;
+    }
+    // q and -q are the same rotation, keep the dropped component positive
+    const float sign = q.v[largest] < 0.0f ? -1.0f : 1.0f;
+    uint32_t    packed = largest << 30;
+    uint32_t    shift = 20;
+    for (uint32_t i = 0; i < 4; i++) {
+        if (i == largest)
+            continue;
+        packed |= splatQuantizeUnorm(q.v[i] * sign, -gSplatSmallestThreeRange, gSplatSmallestThreeRange, 1023) << shift;
+        shift -= 10;
+    }
+    return packed;
+}
+
+static struct Tf32x4_s splatUnpackQuaternion(uint32_t packed) {
+    const uint32_t  largest = packed >> 30;
+    struct Tf32x4_s q = {};
+    uint32_t        shift = 20;
+    float           sum = 0.0f;
+    for (uint32_t i = 0; i < 4; i++) {
+        if (i == largest)
+            continue;
+        q.v[i] = splatDequantizeUnorm((packed >> shift) & 1023u, -gSplatSmallestThreeRange, gSplatSmallestThreeRange, 1023);
+        sum += q.v[i] * q.v[i];
+        shift -= 10;
+    }
+    q.v[largest] = sqrtf(sum < 1.0f ? 1.0f - sum : 0.0f);
+    return q;
+}
+
+static inline uint32_t splatShBytes(uint32_t encoding) { return encoding == SPLAT_SH_ENCODING_F16 ? 2 : 1; }
+
+static inline void splatStoreSh(uint8_t* dst, uint32_t encoding, float value, float lo, float hi) {
+    if (encoding == SPLAT_SH_ENCODING_F16) {
+        const uint16_t half = splatFloatToHalf(value);
+        memcpy(dst, &half, sizeof(half));
+    } else {
+        *dst = (uint8_t)splatQuantizeUnorm(value, lo, hi, 255);
+    }
+}
+
+static inline float splatLoadSh(const uint8_t* src, uint32_t encoding, float lo, float hi) {
+    if (encoding == SPLAT_SH_ENCODING_F16) {
+        uint16_t half;
+        memcpy(&half, src, sizeof(half));
+        return splatHalfToFloat(half);
+    }
+    return splatDequantizeUnorm(*src, lo, hi, 255);
+}
+
+static inline void splatStoreScale(uint8_t* dst, uint32_t bits, float value, float lo, float hi) {
+    if (bits == 16) {
+        const uint16_t q = (uint16_t)splatQuantizeUnorm(value, lo, hi, 65535);
+        memcpy(dst, &q, sizeof(q));
+    } else {
+        *dst = (uint8_t)splatQuantizeUnorm(value, lo, hi, 255);
+    }
+}
+
+static inline float splatLoadScale(const uint8_t* src, uint32_t bits, float lo, float hi) {
+    if (bits == 16) {
+        uint16_t q;
+        memcpy(&q, src, sizeof(q));
+        return splatDequantizeUnorm(q, lo, hi, 65535);
+    }
+    return splatDequantizeUnorm(*src, lo, hi, 255);
+}
+
+struct SplatQuantizeContext {
+    struct SplatQuantized*     pOut;
+    const struct SplatStreams* pSrc;
+};
+
+// Computes the ranges of a chunk and encodes its splats, one range is a set of chunks.
+static void splatQuantizeChunks(void* user, uint64_t beginChunk, uint64_t endChunk) {
+    const struct SplatQuantizeContext* ctx = (const struct SplatQuantizeContext*)user;
+    struct SplatQuantized*             out = ctx->pOut;
+    const struct SplatStreams*         src = ctx->pSrc;
+    const struct SplatQuantizeDesc*    desc = &out->mDesc;
+    const uint32_t                     shBytes = splatShBytes(desc->mShEncoding);
+    const uint32_t                     scaleBytes = desc->mScaleBits / 8;
+
+    for (uint64_t chunkIdx = beginChunk; chunkIdx < endChunk; chunkIdx++) {
+        const uint64_t first = chunkIdx * desc->mChunkSize;
+        const uint64_t last = first + desc->mChunkSize < out->mNumSplats ? first + desc->mChunkSize : out->mNumSplats;
+
+        struct SplatQuantizedChunk* chunk = &out->pChunks[chunkIdx];
+        for (uint32_t c = 0; c < 3; c++) {
+            chunk->mScaleMin[c] = FLT_MAX;
+            chunk->mScaleMax[c] = -FLT_MAX;
+        }
+        chunk->mOpacityMin = FLT_MAX;
+        chunk->mOpacityMax = -FLT_MAX;
+        for (uint32_t c = 0; c < SPLAT_SH_COEFFS; c++) {
+            chunk->mShMin[c] = FLT_MAX;
+            chunk->mShMax[c] = -FLT_MAX;
+        }
+        for (uint64_t i = first; i < last; i++) {
+            for (uint32_t c = 0; c < 3; c++) {
+                chunk->mScaleMin[c] = fminf(chunk->mScaleMin[c], src->pScales[i].v[c]);
+                chunk->mScaleMax[c] = fmaxf(chunk->mScaleMax[c], src->pScales[i].v[c]);
+            }
+            chunk->mOpacityMin = fminf(chunk->mOpacityMin, src->pOpacities[i]);
+            chunk->mOpacityMax = fmaxf(chunk->mOpacityMax, src->pOpacities[i]);
+            for (uint32_t c = 0; c < SPLAT_SH_COEFFS; c++) {
+                const float value = splatShCoeff(&src->pShs[i], c);
+                chunk->mShMin[c] = fminf(chunk->mShMin[c], value);
+                chunk->mShMax[c] = fmaxf(chunk->mShMax[c], value);
+            }
+        }
+
+        for (uint64_t i = first; i < last; i++) {
+            out->pPositions[i] = src->pPositions[i];
+            out->pRotations[i] = splatPackQuaternion(src->pRotations[i]);
+            for (uint32_t c = 0; c < 3; c++) {
+                splatStoreScale(&out->pScales[(i * 3 + c) * scaleBytes], desc->mScaleBits, src->pScales[i].v[c], chunk->mScaleMin[c],
+                                chunk->mScaleMax[c]);
+                splatStoreSh(&out->pShDc[(i * 3 + c) * shBytes], desc->mShEncoding, src->pShs[i].dc.v[c], chunk->mShMin[c],
+                             chunk->mShMax[c]);
+            }
+            out->pOpacities[i] = (uint8_t)splatQuantizeUnorm(src->pOpacities[i], chunk->mOpacityMin, chunk->mOpacityMax, 255);
+            if (out->pShRest) {
+                for (uint32_t c = 0; c < SPLAT_SH_REST_COEFFS; c++) {
+                    splatStoreSh(&out->pShRest[(i * SPLAT_SH_REST_COEFFS + c) * shBytes], desc->mShEncoding, src->pShs[i].rest[c],
+                                 chunk->mShMin[3 + c], chunk->mShMax[3 + c]);
+                }
+            }
+        }
+    }
+}
+
+// Codebooks above this many centroids are searched through a coarse index:
+// the centroids are clustered into gSplatKMeansGroups groups and a splat only
+// scans the members of the gSplatKMeansProbes groups nearest to it. That
+// bounds an assignment to about (groups + probes * size / groups) distances
+// instead of size, 320 instead of 4096 for the LOW codebook, at the price of
+// missing the nearest centroid when it sits in a group that is not probed.
+static const uint32_t gSplatKMeansGroups = 64;
+static const uint32_t gSplatKMeansProbes = 4;
+static const uint32_t gSplatKMeansGroupIterations = 4;
+static const uint32_t gSplatKMeansIndexMinSize = gSplatKMeansGroups * gSplatKMeansProbes;
+
+struct SplatKMeansIndex {
+    float*    pGroupCenters; // gSplatKMeansGroups * SPLAT_SH_REST_COEFFS
+    uint32_t  mGroupStarts[gSplatKMeansGroups + 1]; // into pMembers
+    uint16_t* pMembers; // centroids ordered by group
+};
+
+struct SplatKMeansContext {
+    const float*                   pCodebook;
+    uint32_t                       mCodebookSize;
+    const struct SplatKMeansIndex* pIndex; // NULL scans every centroid
+    const struct SplatStreams*     pSrc;
+    const uint64_t*                pSampleIndices; // NULL assigns every splat
+    uint16_t*                      pAssignments;
+};
+
+// Squared distance, abandoned once it reaches bestDist.
+static inline float splatKMeansDistance(const float* a, const float* b, float bestDist) {
+    float dist = 0.0f;
+    for (uint32_t c = 0; c < SPLAT_SH_REST_COEFFS && dist < bestDist; c++) {
+        const float d = a[c] - b[c];
+        dist += d * d;
+    }
+    return dist;
+}
+
+static void splatKMeansAssign(void* user, uint64_t begin, uint64_t end) {
+    const struct SplatKMeansContext* ctx = (const struct SplatKMeansContext*)user;
+    const struct SplatKMeansIndex*   index = ctx->pIndex;
+    for (uint64_t i = begin; i < end; i++) {
+        const uint64_t splatIdx = ctx->pSampleIndices ? ctx->pSampleIndices[i] : i;
+        const float*   rest = ctx->pSrc->pShs[splatIdx].rest;
+        float          bestDist = FLT_MAX;
+        uint32_t       best = 0;
+        if (!index) {
+            for (uint32_t k = 0; k < ctx->mCodebookSize; k++) {
+                const float dist = splatKMeansDistance(rest, &ctx->pCodebook[k * SPLAT_SH_REST_COEFFS], bestDist);
+                if (dist < bestDist) {
+                    bestDist = dist;
+                    best = k;
+                }
+            }
+            ctx->pAssignments[i] = (uint16_t)best;
+            continue;
+        }
+
+        // the nearest groups, by insertion into a short sorted list
+        uint32_t probes[gSplatKMeansProbes];
+        float    probeDists[gSplatKMeansProbes];
+        for (uint32_t p = 0; p < gSplatKMeansProbes; p++)
+            probeDists[p] = FLT_MAX;
+        for (uint32_t g = 0; g < gSplatKMeansGroups; g++) {
+            const float* center = &index->pGroupCenters[g * SPLAT_SH_REST_COEFFS];
+            const float  dist = splatKMeansDistance(rest, center, probeDists[gSplatKMeansProbes - 1]);
+            uint32_t     p = gSplatKMeansProbes;
+            for (; p > 0 && dist < probeDists[p - 1]; p--) {
+                if (p < gSplatKMeansProbes) {
+                    probes[p] = probes[p - 1];
+                    probeDists[p] = probeDists[p - 1];
+                }
+            }
+            if (p < gSplatKMeansProbes) {
+                probes[p] = g;
+                probeDists[p] = dist;
+            }
+        }
+        for (uint32_t p = 0; p < gSplatKMeansProbes && probeDists[p] < FLT_MAX; p++) {
+            for (uint32_t m = index->mGroupStarts[probes[p]]; m < index->mGroupStarts[probes[p] + 1]; m++) {
+                const uint32_t k = index->pMembers[m];
+                const float    dist = splatKMeansDistance(rest, &ctx->pCodebook[k * SPLAT_SH_REST_COEFFS], bestDist);
+                if (dist < bestDist) {
+                    bestDist = dist;
+                    best = k;
+                }
+            }
+        }
+        ctx->pAssignments[i] = (uint16_t)best;
+    }
+}
+
+// Clusters the centroids of codebook into the groups of index with a few Lloyd
+// iterations, seeded with evenly strided centroids.
+static void splatKMeansBuildIndex(const float* codebook, uint32_t numCentroids, struct SplatKMeansIndex* index, uint16_t* groupOf) {
+    for (uint32_t g = 0; g < gSplatKMeansGroups; g++) {
+        const uint64_t seed = (uint64_t)g * numCentroids / gSplatKMeansGroups;
+        memcpy(&index->pGroupCenters[g * SPLAT_SH_REST_COEFFS], &codebook[seed * SPLAT_SH_REST_COEFFS],
+               sizeof(float) * SPLAT_SH_REST_COEFFS);
+    }
+    double   sums[gSplatKMeansGroups * SPLAT_SH_REST_COEFFS];
+    uint32_t counts[gSplatKMeansGroups];
+    for (uint32_t iteration = 0; iteration <= gSplatKMeansGroupIterations; iteration++) {
+        memset(sums, 0, sizeof(sums));
+        memset(counts, 0, sizeof(counts));
+        for (uint32_t k = 0; k < numCentroids; k++) {
+            const float* centroid = &codebook[k * SPLAT_SH_REST_COEFFS];
+            float        bestDist = FLT_MAX;
+            uint32_t     best = 0;
+            for (uint32_t g = 0; g < gSplatKMeansGroups; g++) {
+                const float dist = splatKMeansDistance(centroid, &index->pGroupCenters[g * SPLAT_SH_REST_COEFFS], bestDist);
+                if (dist < bestDist) {
+                    bestDist = dist;
+                    best = g;
+                }
+            }
+            groupOf[k] = (uint16_t)best;
+            counts[best]++;
+            for (uint32_t c = 0; c < SPLAT_SH_REST_COEFFS; c++)
+                sums[best * SPLAT_SH_REST_COEFFS + c] += centroid[c];
+        }
+        // the last pass only assigns, the centers stay those the members were measured against
+        for (uint32_t g = 0; iteration < gSplatKMeansGroupIterations && g < gSplatKMeansGroups; g++) {
+            for (uint32_t c = 0; counts[g] && c < SPLAT_SH_REST_COEFFS; c++)
+                index->pGroupCenters[g * SPLAT_SH_REST_COEFFS + c] = (float)(sums[g * SPLAT_SH_REST_COEFFS + c] / counts[g]);
+        }
+    }
+    index->mGroupStarts[0] = 0;
+    for (uint32_t g = 0; g < gSplatKMeansGroups; g++)
+        index->mGroupStarts[g + 1] = index->mGroupStarts[g] + counts[g];
+    uint32_t cursors[gSplatKMeansGroups];
+    memcpy(cursors, index->mGroupStarts, sizeof(cursors));
+    for (uint32_t k = 0; k < numCentroids; k++)
+        index->pMembers[cursors[groupOf[k]]++] = (uint16_t)k;
+}
+
+// Lloyd iterations on a strided sample of the splats, then a final assignment of every splat.
+static void splatBuildShCodebook(ThreadSystem threadSystem, struct SplatQuantized* out, const struct SplatStreams* src) {
+    const uint32_t numCentroids = out->mDesc.mCodebookSize;
+    uint64_t       numSamples = out->mDesc.mCodebookTrainingSamples > numCentroids ? out->mDesc.mCodebookTrainingSamples : numCentroids;
+    numSamples = numSamples < out->mNumSplats ? numSamples : out->mNumSplats;
+
+    uint64_t* samples = (uint64_t*)splatMalloc(sizeof(uint64_t) * numSamples);
+    for (uint64_t i = 0; i < numSamples; i++)
+        samples[i] = i * out->mNumSplats / numSamples;
+    for (uint32_t k = 0; k < numCentroids; k++) {
+        memcpy(&out->pShCodebook[k * SPLAT_SH_REST_COEFFS], src->pShs[samples[(uint64_t)k * numSamples / numCentroids]].rest,
+               sizeof(float) * SPLAT_SH_REST_COEFFS);
+    }
+
+    // the index is rebuilt for every codebook the splats are assigned to
+    struct SplatKMeansIndex index = {};
+    uint16_t*               groupOf = NULL;
+    const bool              indexed = numCentroids >= gSplatKMeansIndexMinSize;
+    if (indexed) {
+        index.pGroupCenters = (float*)splatMalloc(sizeof(float) * gSplatKMeansGroups * SPLAT_SH_REST_COEFFS);
+        index.pMembers = (uint16_t*)splatMalloc(sizeof(uint16_t) * numCentroids);
+        groupOf = (uint16_t*)splatMalloc(sizeof(uint16_t) * numCentroids);
+    }
+
+    uint16_t* assignments = (uint16_t*)splatMalloc(sizeof(uint16_t) * numSamples);
+    double*   sums = (double*)splatMalloc(sizeof(double) * numCentroids * SPLAT_SH_REST_COEFFS);
+    uint64_t* counts = (uint64_t*)splatMalloc(sizeof(uint64_t) * numCentroids);
+    struct SplatKMeansContext ctx = { out->pShCodebook, numCentroids, indexed ? &index : NULL, src, samples, assignments };
+    for (uint32_t iteration = 0; iteration < out->mDesc.mCodebookIterations; iteration++) {
+        if (indexed)
+            splatKMeansBuildIndex(out->pShCodebook, numCentroids, &index, groupOf);
+        splatParallelFor(threadSystem, numSamples, 1024, splatKMeansAssign, &ctx);
+
+        memset(sums, 0, sizeof(double) * numCentroids * SPLAT_SH_REST_COEFFS);
+        memset(counts, 0, sizeof(uint64_t) * numCentroids);
+        for (uint64_t i = 0; i < numSamples; i++) {
+            const float* rest = src->pShs[samples[i]].rest;
+            double*      sum = &sums[assignments[i] * SPLAT_SH_REST_COEFFS];
+            for (uint32_t c = 0; c < SPLAT_SH_REST_COEFFS; c++)
+                sum[c] += rest[c];
+            counts[assignments[i]]++;
+        }
+        // empty clusters keep their previous centroid
+        for (uint32_t k = 0; k < numCentroids; k++) {
+            if (counts[k] == 0)
+                continue;
+            for (uint32_t c = 0; c < SPLAT_SH_REST_COEFFS; c++)
+                out->pShCodebook[k * SPLAT_SH_REST_COEFFS + c] = (float)(sums[k * SPLAT_SH_REST_COEFFS + c] / (double)counts[k]);
+        }
+    }
+    splatFree(counts);
+    splatFree(sums);
+    splatFree(assignments);
+    splatFree(samples);
+
+    ctx.pSampleIndices = NULL;
+    ctx.pAssignments = out->pShRestIndices;
+    if (indexed)
+        splatKMeansBuildIndex(out->pShCodebook, numCentroids, &index, groupOf);
+    splatParallelFor(threadSystem, out->mNumSplats, 1024, splatKMeansAssign, &ctx);
+    splatFree(groupOf);
+    splatFree(index.pMembers);
+    splatFree(index.pGroupCenters);
+}
+
+bool splatQuantize(ThreadSystem threadSystem, const struct SplatQuantizeDesc* desc, uint64_t numSplats, const struct SplatStreams* src,
+                   struct SplatQuantized* out) {
+    memset(out, 0, sizeof(struct SplatQuantized));
+    if (!src->pPositions || !src->pScales || !src->pRotations || !src->pOpacities || !src->pShs || numSplats == 0)
+        return false;
+    if ((desc->mScaleBits != 8 && desc->mScaleBits != 16) || desc->mChunkSize == 0 || desc->mCodebookSize > 65536) {
+        LOGF(eERROR, "Invalid splat quantization settings.");
+        return false;
+    }
+
+    out->mDesc = *desc;
+    out->mNumSplats = numSplats;
+    out->mNumChunks = (numSplats + desc->mChunkSize - 1) / desc->mChunkSize;
+    const uint32_t shBytes = splatShBytes(desc->mShEncoding);
+    out->pPositions = (struct Tf32x3_s*)splatMalloc(sizeof(struct Tf32x3_s) * numSplats);
+    out->pRotations = (uint32_t*)splatMalloc(sizeof(uint32_t) * numSplats);
+    out->pScales = (uint8_t*)splatMalloc(3 * (desc->mScaleBits / 8) * numSplats);
+    out->pOpacities = (uint8_t*)splatMalloc(numSplats);
+    out->pShDc = (uint8_t*)splatMalloc(3 * shBytes * numSplats);
+    out->pChunks = (struct SplatQuantizedChunk*)splatMalloc(sizeof(struct SplatQuantizedChunk) * out->mNumChunks);
+    if (desc->mCodebookSize > 0) {
+        out->pShRestIndices = (uint16_t*)splatMalloc(sizeof(uint16_t) * numSplats);
+        out->pShCodebook = (float*)splatMalloc(sizeof(float) * SPLAT_SH_REST_COEFFS * desc->mCodebookSize);
+    } else {
+        out->pShRest = (uint8_t*)splatMalloc(SPLAT_SH_REST_COEFFS * shBytes * numSplats);
+    }
+
+    struct SplatQuantizeContext ctx = { out, src };
+    splatParallelFor(threadSystem, out->mNumChunks, 64, splatQuantizeChunks, &ctx);
+    if (desc->mCodebookSize > 0)
+        splatBuildShCodebook(threadSystem, out, src);
+    return true;
+}
+
+void splatQuantizedFree(struct SplatQuantized* quantized) {
+    splatFree(quantized->pPositions);
+    splatFree(quantized->pRotations);
+    splatFree(quantized->pScales);
+    splatFree(quantized->pOpacities);
+    splatFree(quantized->pShDc);
+    splatFree(quantized->pShRest);
+    splatFree(quantized->pShRestIndices);
+    splatFree(quantized->pShCodebook);
+    splatFree(quantized->pChunks);
+    memset(quantized, 0, sizeof(struct SplatQuantized));
+}
+
+uint64_t splatQuantizedSize(const struct SplatQuantized* quantized) {
+    const struct SplatQuantizeDesc* desc = &quantized->mDesc;
+    const uint32_t                  shBytes = splatShBytes(desc->mShEncoding);
+    uint64_t perSplat = sizeof(struct Tf32x3_s) + sizeof(uint32_t) + 3 * (desc->mScaleBits / 8) + 1 + 3 * shBytes;
+    perSplat += desc->mCodebookSize > 0 ? sizeof(uint16_t) : SPLAT_SH_REST_COEFFS * shBytes;
+    return perSplat * quantized->mNumSplats + sizeof(struct SplatQuantizedChunk) * quantized->mNumChunks +
+           sizeof(float) * SPLAT_SH_REST_COEFFS * desc->mCodebookSize;
+}
+
+void splatDequantize(const struct SplatQuantized* quantized, uint64_t first, uint64_t count, const struct SplatStreams* dst) {
+    const struct SplatQuantizeDesc* desc = &quantized->mDesc;
+    const uint32_t                  shBytes = splatShBytes(desc->mShEncoding);
+    const uint32_t                  scaleBytes = desc->mScaleBits / 8;
+    for (uint64_t i = first; i < first + count; i++) {
+        const struct SplatQuantizedChunk* chunk = &quantized->pChunks[i / desc->mChunkSize];
+        if (dst->pPositions)
+            dst->pPositions[i] = quantized->pPositions[i];
+        if (dst->pColors)
+            dst->pColors[i] = quantized->pPositions[i];
+        if (dst->pNormals)
+            dst->pNormals[i] = { 0.0f, 0.0f, 0.0f };
+        if (dst->pRotations)
+            dst->pRotations[i] = splatUnpackQuaternion(quantized->pRotations[i]);
+        if (dst->pScales) {
+            for (uint32_t c = 0; c < 3; c++) {
+                dst->pScales[i].v[c] =
+                    splatLoadScale(&quantized->pScales[(i * 3 + c) * scaleBytes], desc->mScaleBits, chunk->mScaleMin[c],
+                                   chunk->mScaleMax[c]);
+            }
+        }
+        if (dst->pOpacities)
+            dst->pOpacities[i] = splatDequantizeUnorm(quantized->pOpacities[i], chunk->mOpacityMin, chunk->mOpacityMax, 255);
+        if (dst->pShs) {
+            struct SphericalHarmonics* harmonics = &dst->pShs[i];
+            for (uint32_t c = 0; c < 3; c++) {
+                harmonics->dc.v[c] =
+                    splatLoadSh(&quantized->pShDc[(i * 3 + c) * shBytes], desc->mShEncoding, chunk->mShMin[c], chunk->mShMax[c]);
+            }
+            if (quantized->pShRest) {
+                for (uint32_t c = 0; c < SPLAT_SH_REST_COEFFS; c++) {
+                    harmonics->rest[c] = splatLoadSh(&quantized->pShRest[(i * SPLAT_SH_REST_COEFFS + c) * shBytes], desc->mShEncoding,
+                                                     chunk->mShMin[3 + c], chunk->mShMax[3 + c]);
+                }
+            } else {
+                memcpy(harmonics->rest, &quantized->pShCodebook[quantized->pShRestIndices[i] * SPLAT_SH_REST_COEFFS],
+                       sizeof(float) * SPLAT_SH_REST_COEFFS);
+            }
+        }
+    }
+}
+
+struct SplatErrorAccum {
+    double mSquaredError;
+    double mCount;
+    float  mMin;
+    float  mMax;
+};
+
+static inline void splatAccumError(struct SplatErrorAccum* accum, float reference, float decoded) {
+    const double d = (double)reference - (double)decoded;
+    accum->mSquaredError += d * d;
+    accum->mCount += 1.0;
+    accum->mMin = fminf(accum->mMin, reference);
+    accum->mMax = fmaxf(accum->mMax, reference);
+}
+
+static double splatPsnr(const struct SplatErrorAccum* accum) {
+    if (accum->mCount == 0.0)
+        return 0.0;
+    const double mse = accum->mSquaredError / accum->mCount;
+    const double peak = (double)accum->mMax - (double)accum->mMin;
+    if (mse <= 0.0)
+        return INFINITY;
+    return 10.0 * log10((peak > 0.0 ? peak * peak : 1.0) / mse);
+}
+
+void splatQuantizeMeasure(const struct SplatQuantized* quantized, const struct SplatStreams* src, struct SplatQuantizeReport* outReport) {
+    memset(outReport, 0, sizeof(struct SplatQuantizeReport));
+    struct SplatErrorAccum dc = { 0.0, 0.0, FLT_MAX, -FLT_MAX };
+    struct SplatErrorAccum rest = dc;
+    struct SplatErrorAccum scale = dc;
+    struct SplatErrorAccum rotation = dc;
+    struct SplatErrorAccum opacity = dc;
+
+    const uint64_t      chunkSize = quantized->mDesc.mChunkSize;
+    struct SplatStreams decoded = {};
+    decoded.pScales = (struct Tf32x3_s*)splatMalloc(sizeof(struct Tf32x3_s) * quantized->mNumSplats);
+    decoded.pRotations = (struct Tf32x4_s*)splatMalloc(sizeof(struct Tf32x4_s) * quantized->mNumSplats);
+    decoded.pOpacities = (float*)splatMalloc(sizeof(float) * quantized->mNumSplats);
+    decoded.pShs = (struct SphericalHarmonics*)splatMalloc(sizeof(struct SphericalHarmonics) * quantized->mNumSplats);
+    for (uint64_t first = 0; first < quantized->mNumSplats; first += chunkSize) {
+        const uint64_t count = quantized->mNumSplats - first < chunkSize ? quantized->mNumSplats - first : chunkSize;
+        splatDequantize(quantized, first, count, &decoded);
+        for (uint64_t i = first; i < first + count; i++) {
+            for (uint32_t c = 0; c < 3; c++) {
+                splatAccumError(&dc, src->pShs[i].dc.v[c], decoded.pShs[i].dc.v[c]);
+                splatAccumError(&scale, src->pScales[i].v[c], decoded.pScales[i].v[c]);
+            }
+            for (uint32_t c = 0; c < SPLAT_SH_REST_COEFFS; c++)
+                splatAccumError(&rest, src->pShs[i].rest[c], decoded.pShs[i].rest[c]);
+            splatAccumError(&opacity, src->pOpacities[i], decoded.pOpacities[i]);
+
+            // compare against the normalized source, with the sign of the decoded quaternion
+            struct Tf32x4_s q = src->pRotations[i];
+            const float     len = sqrtf(q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w);
+            const float     invLen = len > 0.0f ? 1.0f / len : 0.0f;
+            float           dot = 0.0f;
+            for (uint32_t c = 0; c < 4; c++)
+                dot += q.v[c] * invLen * decoded.pRotations[i].v[c];
+            const float sign = dot < 0.0f ? -1.0f : 1.0f;
+            for (uint32_t c = 0; c < 4; c++)
+                splatAccumError(&rotation, q.v[c] * invLen * sign, decoded.pRotations[i].v[c]);
+        }
+    }
+    splatFreeStreams(&decoded);
+
+    outReport->mSourceBytes = quantized->mNumSplats * (sizeof(struct Tf32x3_s) * 2 + sizeof(struct Tf32x4_s) + sizeof(float) +
+                                                       sizeof(struct SphericalHarmonics));
+    outReport->mQuantizedBytes = splatQuantizedSize(quantized);
+    outReport->mShDcPsnr = splatPsnr(&dc);
+    outReport->mShRestPsnr = splatPsnr(&rest);
+    outReport->mScalePsnr = splatPsnr(&scale);
+    outReport->mRotationPsnr = splatPsnr(&rotation);
+    outReport->mOpacityPsnr = splatPsnr(&opacity);
+}
+
+void splatLogQuantizeReport(const struct SplatQuantizeReport* report) {
+    LOGF(eINFO, "Splat quantization: %.1f MB -> %.1f MB (%.2fx)", (double)report->mSourceBytes / (1024.0 * 1024.0),
+         (double)report->mQuantizedBytes / (1024.0 * 1024.0),
+         report->mQuantizedBytes ? (double)report->mSourceBytes / (double)report->mQuantizedBytes : 0.0);
+    LOGF(eINFO, "Splat quantization PSNR: sh dc %.2f dB, sh rest %.2f dB, scale %.2f dB, rotation %.2f dB, opacity %.2f dB",
+         report->mShDcPsnr, report->mShRestPsnr, report->mScalePsnr, report->mRotationPsnr, report->mOpacityPsnr);
+}
@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2017-2024 The Forge Interactive Inc.
+ *
+ * This file is part of The-Forge
+ * (see https://github.com/ConfettiFX/The-Forge).
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#pragma once
+
+#include "Splat.h"
+
+// Compressed system memory representation of a splat scene, built at load
+// time from the fp32 streams.
+//
+// - SH coefficients are stored as fp16, or as 8 bit values quantized against
+//   a per chunk min/max of every coefficient.
+// - Rotations use the smallest three encoding, 2 bits for the index of the
+//   dropped component and 10 bits for each of the other three.
+// - Scales are kept in the log space they come in from the PLY and quantized
+//   to 8 or 16 bits against a per chunk min/max, as is the opacity logit.
+// - Optionally the rest bands (degree 1 to 3) are replaced by an index into
+//   a k-means codebook.
+//
+// The GPU preprocess pass reads the SH above the dc band from the copy, see
+// SplatGpuShRestEncoding; positions, rotations, scales, opacities and the dc
+// band are still uploaded from the fp32 streams.
+
+enum SplatQuality {
+    SPLAT_QUALITY_NONE = 0, // fp32 only, no compressed copy is built
+    SPLAT_QUALITY_HIGH,     // fp16 SH, 16 bit scale
+    SPLAT_QUALITY_MEDIUM,   // 8 bit SH, 16 bit scale
+    SPLAT_QUALITY_LOW,      // 8 bit SH DC, codebook rest bands, 8 bit scale
+};
+
+enum SplatShEncoding {
+    SPLAT_SH_ENCODING_F16 = 0,
+    SPLAT_SH_ENCODING_U8,
+};
+
+struct SplatQuantizeDesc {
+    uint32_t mShEncoding;
+    uint32_t mScaleBits; // 8 or 16
+    uint32_t mChunkSize; // splats sharing one set of min/max ranges
+    uint32_t mCodebookSize; // 0 keeps the rest bands per splat
+    uint32_t mCodebookIterations;
+    uint32_t mCodebookTrainingSamples;
+};
+
+struct SplatQuantizedChunk {
+    float mScaleMin[3];
+    float mScaleMax[3];
+    float mOpacityMin;
+    float mOpacityMax;
+    float mShMin[48]; // dc then rest, only used by SPLAT_SH_ENCODING_U8
+    float mShMax[48];
+};
+
+struct SplatQuantized {
+    struct SplatQuantizeDesc mDesc;
+    uint64_t mNumSplats;
+    uint64_t mNumChunks;
+
+    struct Tf32x3_s*            pPositions;
+    uint32_t*                   pRotations; // smallest three, 2:10:10:10
+    uint8_t*                    pScales; // 3 values of mScaleBits each per splat
+    uint8_t*                    pOpacities;
+    uint8_t*                    pShDc; // 3 values per splat, fp16 or u8
+    uint8_t*                    pShRest; // 45 values per splat, NULL with a codebook
+    uint16_t*                   pShRestIndices; // codebook index per splat
+    float*                      pShCodebook; // mCodebookSize * 45 floats
+    struct SplatQuantizedChunk* pChunks;
+};
+
+struct SplatQuantizeReport {
+    uint64_t mSourceBytes;
+    uint64_t mQuantizedBytes;
+    // PSNR of the decoded values against the fp32 source, peak is the value range of the attribute
+    double mShDcPsnr;
+    double mShRestPsnr;
+    double mScalePsnr;
+    double mRotationPsnr;
+    double mOpacityPsnr;
+};
+
+void splatQuantizeDescForQuality(uint32_t quality, struct SplatQuantizeDesc* desc);
+
+// src needs positions, scales, rotations, opacities and shs.
+bool splatQuantize(ThreadSystem threadSystem, const struct SplatQuantizeDesc* desc, uint64_t numSplats, const struct SplatStreams* src,
+                   struct SplatQuantized* out);
+void splatQuantizedFree(struct SplatQuantized* quantized);
+uint64_t splatQuantizedSize(const struct SplatQuantized* quantized);
+
+// Decodes count splats starting at first back to fp32 into the streams of dst that are not NULL.
+void splatDequantize(const struct SplatQuantized* quantized, uint64_t first, uint64_t count, const struct SplatStreams* dst);
+
+void splatQuantizeMeasure(const struct SplatQuantized* quantized, const struct SplatStreams* src, struct SplatQuantizeReport* outReport);
+void splatLogQuantizeReport(const struct SplatQuantizeReport* report);
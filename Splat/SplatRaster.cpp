@@ -0,0 +1,847 @@
+/*
+ * Copyright (c) 2017-2024 The Forge Interactive Inc.
+ *
+ * This file is part of The-Forge
+ * (see https://github.com/ConfettiFX/The-Forge).
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#include "SplatRaster.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "Forge/TF_Log.h"
+#include "Forge/Core/TF_Time.h"
+#include "Forge/Math/TF_Simd32x4.h"
+
+#include "SplatSh.h"
+
+// Terms of the reference rasterizer, see "3D Gaussian Splatting for Real-Time Radiance Field Rendering".
+static const float gSplatLowPassFilter = 0.3f;
+static const float gSplatFrustumGuardBand = 1.3f;
+static const float gSplatMinAlpha = 1.0f / 255.0f;
+static const float gSplatMaxAlpha = 0.99f;
+static const float gSplatMinTransmittance = 0.0001f;
+
+void splatCameraLookAt(struct Tf32x3_s eye, struct Tf32x3_s target, struct Tf32x3_s up, float fovY, uint32_t width, uint32_t height,
+                       struct SplatCamera* outCamera) {
+    struct Tf32x3_s forward = { target.x - eye.x, target.y - eye.y, target.z - eye.z };
+    float           len = sqrtf(forward.x * forward.x + forward.y * forward.y + forward.z * forward.z);
+    forward = { forward.x / len, forward.y / len, forward.z / len };
+    // +x right, +y down
+    struct Tf32x3_s right = { forward.y * up.z - forward.z * up.y, forward.z * up.x - forward.x * up.z,
+                              forward.x * up.y - forward.y * up.x };
+    len = sqrtf(right.x * right.x + right.y * right.y + right.z * right.z);
+    right = { right.x / len, right.y / len, right.z / len };
+    const struct Tf32x3_s down = { forward.y * right.z - forward.z * right.y, forward.z * right.x - forward.x * right.z,
+                                   forward.x * right.y - forward.y * right.x };
+    const struct Tf32x3_s rows[3] = { right, down, forward };
+
+    memset(outCamera, 0, sizeof(struct SplatCamera));
+    for (uint32_t r = 0; r < 3; r++) {
+        outCamera->mView[r * 4 + 0] = rows[r].x;
+        outCamera->mView[r * 4 + 1] = rows[r].y;
+        outCamera->mView[r * 4 + 2] = rows[r].z;
+        outCamera->mView[r * 4 + 3] = -(rows[r].x * eye.x + rows[r].y * eye.y + rows[r].z * eye.z);
+    }
+    outCamera->mPosition = eye;
+    outCamera->mFocalY = (float)height / (2.0f * tanf(fovY * 0.5f));
+    outCamera->mFocalX = outCamera->mFocalY;
+    outCamera->mCenterX = (float)width * 0.5f;
+    outCamera->mCenterY = (float)height * 0.5f;
+    outCamera->mWidth = width;
+    outCamera->mHeight = height;
+    outCamera->mNear = 0.2f;
+}
+
+// Direction from the camera to splat i, for the SH colors.
+static inline struct Tf32x3_s splatViewDirection(const struct SplatCamera* camera, const struct SplatStreams* streams, uint64_t i) {
+    const struct Tf32x3_s p = streams->pPositions[i];
+    struct Tf32x3_s       dir = { p.x - camera->mPosition.x, p.y - camera->mPosition.y, p.z - camera->mPosition.z };
+    const float           dirLen = sqrtf(dir.x * dir.x + dir.y * dir.y + dir.z * dir.z);
+    return { dir.x / dirLen, dir.y / dirLen, dir.z / dirLen };
+}
+
+// Tile rect, color and opacity of a splat whose conic and radius are known.
+// The color is left to a later pass when color is false.
+static void splatProjectFinish(const struct SplatCamera* camera, uint32_t shDegree, const struct SplatStreams* streams, uint64_t i,
+                               float px, float py, float depth, const float conic[3], int32_t radius, bool color,
+                               struct SplatProjected* out) {
+    const int32_t tilesX = (int32_t)((camera->mWidth + SPLAT_TILE_SIZE - 1) / SPLAT_TILE_SIZE);
+    const int32_t tilesY = (int32_t)((camera->mHeight + SPLAT_TILE_SIZE - 1) / SPLAT_TILE_SIZE);
+    const int32_t minX = (int32_t)((px - (float)radius) / SPLAT_TILE_SIZE);
+    const int32_t minY = (int32_t)((py - (float)radius) / SPLAT_TILE_SIZE);
+    const int32_t maxX = (int32_t)((px + (float)radius + SPLAT_TILE_SIZE - 1) / SPLAT_TILE_SIZE);
+    const int32_t maxY = (int32_t)((py + (float)radius + SPLAT_TILE_SIZE - 1) / SPLAT_TILE_SIZE);
+    out->mTileRect[0] = (uint32_t)(minX < 0 ? 0 : (minX > tilesX ? tilesX : minX));
+    out->mTileRect[1] = (uint32_t)(minY < 0 ? 0 : (minY > tilesY ? tilesY : minY));
+    out->mTileRect[2] = (uint32_t)(maxX < 0 ? 0 : (maxX > tilesX ? tilesX : maxX));
+    out->mTileRect[3] = (uint32_t)(maxY < 0 ? 0 : (maxY > tilesY ? tilesY : maxY));
+    if (out->mTileRect[0] >= out->mTileRect[2] || out->mTileRect[1] >= out->mTileRect[3])
+        return;
+
+    out->mX = px;
+    out->mY = py;
+    out->mConic[0] = conic[0];
+    out->mConic[1] = conic[1];
+    out->mConic[2] = conic[2];
+    out->mDepth = depth;
+    out->mOpacity = streams->pOpacities ? 1.0f / (1.0f + expf(-streams->pOpacities[i])) : 1.0f;
+    if (color)
+        out->mColor = splatEvalSh(shDegree, &streams->pShs[i], splatViewDirection(camera, streams, i));
+    out->mRadius = radius;
+}
+
+// Projects items [first, first + count), item k being splat indices[k], or
+// splat k without indices.
+static void splatProjectScalarImpl(const struct SplatCamera* camera, uint32_t shDegree, const struct SplatStreams* streams,
+                                   const struct SplatCovariances* covariances, const uint32_t* indices, uint64_t first, uint64_t count,
+                                   bool color, struct SplatProjected* projected) {
+    const float* v = camera->mView;
+    const float  limX = gSplatFrustumGuardBand * (float)camera->mWidth / (2.0f * camera->mFocalX);
+    const float  limY = gSplatFrustumGuardBand * (float)camera->mHeight / (2.0f * camera->mFocalY);
+
+    for (uint64_t k = first; k < first + count; k++) {
+        const uint64_t         i = indices ? indices[k] : k;
+        struct SplatProjected* out = &projected[i];
+        out->mRadius = 0;
+
+        const struct Tf32x3_s p = streams->pPositions[i];
+        const float tx = v[0] * p.x + v[1] * p.y + v[2] * p.z + v[3];
+        const float ty = v[4] * p.x + v[5] * p.y + v[6] * p.z + v[7];
+        const float tz = v[8] * p.x + v[9] * p.y + v[10] * p.z + v[11];
+        if (tz <= camera->mNear)
+            continue;
+
+        // 3D covariance, sigma = R S S^T R^T, stored at load time or built here
+        float sigma[6]; // xx xy xz yy yz zz
+        if (splatCovariancesStored(covariances))
+            splatCovarianceFetch(covariances, i, sigma);
+        else
+            splatCovarianceCompute(streams->pScales[i], streams->pRotations[i], sigma);
+
+        // Jacobian of the perspective projection, evaluated at a mean clamped to the guard band
+        const float txc = fminf(limX, fmaxf(-limX, tx / tz)) * tz;
+        const float tyc = fminf(limY, fmaxf(-limY, ty / tz)) * tz;
+        const float j00 = camera->mFocalX / tz;
+        const float j02 = -camera->mFocalX * txc / (tz * tz);
+        const float j11 = camera->mFocalY / tz;
+        const float j12 = -camera->mFocalY * tyc / (tz * tz);
+        // T = J W
+        const float t0[3] = { j00 * v[0] + j02 * v[8], j00 * v[1] + j02 * v[9], j00 * v[2] + j02 * v[10] };
+        const float t1[3] = { j11 * v[4] + j12 * v[8], j11 * v[5] + j12 * v[9], j11 * v[6] + j12 * v[10] };
+        const float st0[3] = { sigma[0] * t0[0] + sigma[1] * t0[1] + sigma[2] * t0[2],
+                               sigma[1] * t0[0] + sigma[3] * t0[1] + sigma[4] * t0[2],
+                               sigma[2] * t0[0] + sigma[4] * t0[1] + sigma[5] * t0[2] };
+        const float st1[3] = { sigma[0] * t1[0] + sigma[1] * t1[1] + sigma[2] * t1[2],
+                               sigma[1] * t1[0] + sigma[3] * t1[1] + sigma[4] * t1[2],
+                               sigma[2] * t1[0] + sigma[4] * t1[1] + sigma[5] * t1[2] };
+        const float a = t0[0] * st0[0] + t0[1] * st0[1] + t0[2] * st0[2] + gSplatLowPassFilter;
+        const float b = t0[0] * st1[0] + t0[1] * st1[1] + t0[2] * st1[2];
+        const float c = t1[0] * st1[0] + t1[1] * st1[1] + t1[2] * st1[2] + gSplatLowPassFilter;
+
+        const float det = a * c - b * b;
+        if (!(det > 0.0f))
+            continue;
+        const float detInv = 1.0f / det;
+        const float mid = 0.5f * (a + c);
+        const float lambda = mid + sqrtf(fmaxf(0.1f, mid * mid - det));
+        const float conic[3] = { c * detInv, -b * detInv, a * detInv };
+        const float px = camera->mFocalX * tx / tz + camera->mCenterX;
+        const float py = camera->mFocalY * ty / tz + camera->mCenterY;
+        splatProjectFinish(camera, shDegree, streams, i, px, py, tz, conic, (int32_t)ceilf(3.0f * sqrtf(lambda)), color, out);
+    }
+}
+
+void splatProjectScalar(const struct SplatCamera* camera, uint32_t shDegree, const struct SplatStreams* streams,
+                        const struct SplatCovariances* covariances, uint64_t first, uint64_t count, struct SplatProjected* projected) {
+    splatProjectScalarImpl(camera, shDegree, streams, covariances, NULL, first, count, true, projected);
+}
+
+static inline void splatSimdStore(Tsimd_f32x4_t value, float out[4]) { memcpy(out, &value, sizeof(float) * 4); }
+
+static inline Tsimd_f32x4_t splatSimdDot3(Tsimd_f32x4_t ax, Tsimd_f32x4_t ay, Tsimd_f32x4_t az, Tsimd_f32x4_t bx, Tsimd_f32x4_t by,
+                                          Tsimd_f32x4_t bz) {
+    return tfSimdAdd_f32x4(tfSimdAdd_f32x4(tfSimdMul_f32x4(ax, bx), tfSimdMul_f32x4(ay, by)), tfSimdMul_f32x4(az, bz));
+}
+
+static void splatProjectSimdImpl(const struct SplatCamera* camera, uint32_t shDegree, const struct SplatStreams* streams,
+                                 const struct SplatCovariances* covariances, const uint32_t* indices, uint64_t first, uint64_t count,
+                                 bool color, struct SplatProjected* projected) {
+    const uint64_t numBatches = count / 4;
+    if (numBatches == 0) {
+        splatProjectScalarImpl(camera, shDegree, streams, covariances, indices, first, count, color, projected);
+        return;
+    }
+
+    Tsimd_f32x4_t view[12];
+    for (uint32_t i = 0; i < 12; i++)
+        view[i] = tfSimdSplat_f32x4(camera->mView[i]);
+    const Tsimd_f32x4_t zero = tfSimdSplat_f32x4(0.0f);
+    const Tsimd_f32x4_t one = tfSimdSplat_f32x4(1.0f);
+    const Tsimd_f32x4_t two = tfSimdSplat_f32x4(2.0f);
+    const Tsimd_f32x4_t half = tfSimdSplat_f32x4(0.5f);
+    const Tsimd_f32x4_t lowPass = tfSimdSplat_f32x4(gSplatLowPassFilter);
+    const Tsimd_f32x4_t minDiscriminant = tfSimdSplat_f32x4(0.1f);
+    const Tsimd_f32x4_t focalX = tfSimdSplat_f32x4(camera->mFocalX);
+    const Tsimd_f32x4_t focalY = tfSimdSplat_f32x4(camera->mFocalY);
+    const Tsimd_f32x4_t centerX = tfSimdSplat_f32x4(camera->mCenterX);
+    const Tsimd_f32x4_t centerY = tfSimdSplat_f32x4(camera->mCenterY);
+    const Tsimd_f32x4_t limX = tfSimdSplat_f32x4(gSplatFrustumGuardBand * (float)camera->mWidth / (2.0f * camera->mFocalX));
+    const Tsimd_f32x4_t limY = tfSimdSplat_f32x4(gSplatFrustumGuardBand * (float)camera->mHeight / (2.0f * camera->mFocalY));
+    const Tsimd_f32x4_t negLimX = tfSimdSub_f32x4(zero, limX);
+    const Tsimd_f32x4_t negLimY = tfSimdSub_f32x4(zero, limY);
+
+    for (uint64_t batch = 0; batch < numBatches; batch++) {
+        const uint64_t         base = first + batch * 4;
+        const uint64_t         ids[4] = { indices ? indices[base] : base, indices ? indices[base + 1] : base + 1,
+                                          indices ? indices[base + 2] : base + 2, indices ? indices[base + 3] : base + 3 };
+        const struct Tf32x3_s  p[4] = { streams->pPositions[ids[0]], streams->pPositions[ids[1]], streams->pPositions[ids[2]],
+                                        streams->pPositions[ids[3]] };
+        // gather four splats into lanes
+        const Tsimd_f32x4_t px = tfSimdLoad_f32x4(p[0].x, p[1].x, p[2].x, p[3].x);
+        const Tsimd_f32x4_t py = tfSimdLoad_f32x4(p[0].y, p[1].y, p[2].y, p[3].y);
+        const Tsimd_f32x4_t pz = tfSimdLoad_f32x4(p[0].z, p[1].z, p[2].z, p[3].z);
+        const Tsimd_f32x4_t tx = tfSimdAdd_f32x4(splatSimdDot3(view[0], view[1], view[2], px, py, pz), view[3]);
+        const Tsimd_f32x4_t ty = tfSimdAdd_f32x4(splatSimdDot3(view[4], view[5], view[6], px, py, pz), view[7]);
+        const Tsimd_f32x4_t tz = tfSimdAdd_f32x4(splatSimdDot3(view[8], view[9], view[10], px, py, pz), view[11]);
+
+        Tsimd_f32x4_t s00, s01, s02, s11, s12, s22;
+        if (splatCovariancesStored(covariances)) {
+            float sigma[4][6];
+            for (uint32_t lane = 0; lane < 4; lane++)
+                splatCovarianceFetch(covariances, ids[lane], sigma[lane]);
+            s00 = tfSimdLoad_f32x4(sigma[0][0], sigma[1][0], sigma[2][0], sigma[3][0]);
+            s01 = tfSimdLoad_f32x4(sigma[0][1], sigma[1][1], sigma[2][1], sigma[3][1]);
+            s02 = tfSimdLoad_f32x4(sigma[0][2], sigma[1][2], sigma[2][2], sigma[3][2]);
+            s11 = tfSimdLoad_f32x4(sigma[0][3], sigma[1][3], sigma[2][3], sigma[3][3]);
+            s12 = tfSimdLoad_f32x4(sigma[0][4], sigma[1][4], sigma[2][4], sigma[3][4]);
+            s22 = tfSimdLoad_f32x4(sigma[0][5], sigma[1][5], sigma[2][5], sigma[3][5]);
+        } else {
+            const struct Tf32x4_s q[4] = { streams->pRotations[ids[0]], streams->pRotations[ids[1]], streams->pRotations[ids[2]],
+                                           streams->pRotations[ids[3]] };
+            const struct Tf32x3_s scale[4] = { streams->pScales[ids[0]], streams->pScales[ids[1]], streams->pScales[ids[2]],
+                                               streams->pScales[ids[3]] };
+            Tsimd_f32x4_t         qr = tfSimdLoad_f32x4(q[0].x, q[1].x, q[2].x, q[3].x);
+            Tsimd_f32x4_t         qx = tfSimdLoad_f32x4(q[0].y, q[1].y, q[2].y, q[3].y);
+            Tsimd_f32x4_t         qy = tfSimdLoad_f32x4(q[0].z, q[1].z, q[2].z, q[3].z);
+            Tsimd_f32x4_t         qz = tfSimdLoad_f32x4(q[0].w, q[1].w, q[2].w, q[3].w);
+            const Tsimd_f32x4_t   sx = tfSimdLoad_f32x4(expf(scale[0].x), expf(scale[1].x), expf(scale[2].x), expf(scale[3].x));
+            const Tsimd_f32x4_t   sy = tfSimdLoad_f32x4(expf(scale[0].y), expf(scale[1].y), expf(scale[2].y), expf(scale[3].y));
+            const Tsimd_f32x4_t   sz = tfSimdLoad_f32x4(expf(scale[0].z), expf(scale[1].z), expf(scale[2].z), expf(scale[3].z));
+
+            // normalize the quaternion, a zero quaternion yields a zero rotation like the scalar path
+            const Tsimd_f32x4_t qLenSq = tfSimdAdd_f32x4(splatSimdDot3(qr, qx, qy, qr, qx, qy), tfSimdMul_f32x4(qz, qz));
+            const Tsimd_f32x4_t qInv = tfSimdDiv_f32x4(one, tfSimdSqrt_f32x4(tfSimdMaxPerElem_f32x4(qLenSq, tfSimdSplat_f32x4(1e-30f))));
+            qr = tfSimdMul_f32x4(qr, qInv);
+            qx = tfSimdMul_f32x4(qx, qInv);
+            qy = tfSimdMul_f32x4(qy, qInv);
+            qz = tfSimdMul_f32x4(qz, qInv);
+
+            const Tsimd_f32x4_t xx = tfSimdMul_f32x4(qx, qx), yy = tfSimdMul_f32x4(qy, qy), zz = tfSimdMul_f32x4(qz, qz);
+            const Tsimd_f32x4_t xy = tfSimdMul_f32x4(qx, qy), xz = tfSimdMul_f32x4(qx, qz), yz = tfSimdMul_f32x4(qy, qz);
+            const Tsimd_f32x4_t rx = tfSimdMul_f32x4(qr, qx), ry = tfSimdMul_f32x4(qr, qy), rz = tfSimdMul_f32x4(qr, qz);
+            // M = R S
+            const Tsimd_f32x4_t m0 = tfSimdMul_f32x4(tfSimdSub_f32x4(one, tfSimdMul_f32x4(two, tfSimdAdd_f32x4(yy, zz))), sx);
+            const Tsimd_f32x4_t m1 = tfSimdMul_f32x4(tfSimdMul_f32x4(two, tfSimdSub_f32x4(xy, rz)), sy);
+            const Tsimd_f32x4_t m2 = tfSimdMul_f32x4(tfSimdMul_f32x4(two, tfSimdAdd_f32x4(xz, ry)), sz);
+            const Tsimd_f32x4_t m3 = tfSimdMul_f32x4(tfSimdMul_f32x4(two, tfSimdAdd_f32x4(xy, rz)), sx);
+            const Tsimd_f32x4_t m4 = tfSimdMul_f32x4(tfSimdSub_f32x4(one, tfSimdMul_f32x4(two, tfSimdAdd_f32x4(xx, zz))), sy);
+            const Tsimd_f32x4_t m5 = tfSimdMul_f32x4(tfSimdMul_f32x4(two, tfSimdSub_f32x4(yz, rx)), sz);
+            const Tsimd_f32x4_t m6 = tfSimdMul_f32x4(tfSimdMul_f32x4(two, tfSimdSub_f32x4(xz, ry)), sx);
+            const Tsimd_f32x4_t m7 = tfSimdMul_f32x4(tfSimdMul_f32x4(two, tfSimdAdd_f32x4(yz, rx)), sy);
+            const Tsimd_f32x4_t m8 = tfSimdMul_f32x4(tfSimdSub_f32x4(one, tfSimdMul_f32x4(two, tfSimdAdd_f32x4(xx, yy))), sz);
+            // sigma = M M^T
+            s00 = splatSimdDot3(m0, m1, m2, m0, m1, m2);
+            s01 = splatSimdDot3(m0, m1, m2, m3, m4, m5);
+            s02 = splatSimdDot3(m0, m1, m2, m6, m7, m8);
+            s11 = splatSimdDot3(m3, m4, m5, m3, m4, m5);
+            s12 = splatSimdDot3(m3, m4, m5, m6, m7, m8);
+            s22 = splatSimdDot3(m6, m7, m8, m6, m7, m8);
+        }
+
+        // lanes behind the near plane produce garbage here and are culled below
+        const Tsimd_f32x4_t tzInv = tfSimdDiv_f32x4(one, tz);
+        const Tsimd_f32x4_t txc =
+            tfSimdMul_f32x4(tfSimdMinPerElem_f32x4(limX, tfSimdMaxPerElem_f32x4(negLimX, tfSimdMul_f32x4(tx, tzInv))), tz);
+        const Tsimd_f32x4_t tyc =
+            tfSimdMul_f32x4(tfSimdMinPerElem_f32x4(limY, tfSimdMaxPerElem_f32x4(negLimY, tfSimdMul_f32x4(ty, tzInv))), tz);
+        const Tsimd_f32x4_t tzInvSq = tfSimdMul_f32x4(tzInv, tzInv);
+        const Tsimd_f32x4_t j00 = tfSimdMul_f32x4(focalX, tzInv);
+        const Tsimd_f32x4_t j02 = tfSimdSub_f32x4(zero, tfSimdMul_f32x4(tfSimdMul_f32x4(focalX, txc), tzInvSq));
+        const Tsimd_f32x4_t j11 = tfSimdMul_f32x4(focalY, tzInv);
+        const Tsimd_f32x4_t j12 = tfSimdSub_f32x4(zero, tfSimdMul_f32x4(tfSimdMul_f32x4(focalY, tyc), tzInvSq));
+        const Tsimd_f32x4_t t00 = tfSimdAdd_f32x4(tfSimdMul_f32x4(j00, view[0]), tfSimdMul_f32x4(j02, view[8]));
+        const Tsimd_f32x4_t t01 = tfSimdAdd_f32x4(tfSimdMul_f32x4(j00, view[1]), tfSimdMul_f32x4(j02, view[9]));
+        const Tsimd_f32x4_t t02 = tfSimdAdd_f32x4(tfSimdMul_f32x4(j00, view[2]), tfSimdMul_f32x4(j02, view[10]));
+        const Tsimd_f32x4_t t10 = tfSimdAdd_f32x4(tfSimdMul_f32x4(j11, view[4]), tfSimdMul_f32x4(j12, view[8]));
+        const Tsimd_f32x4_t t11 = tfSimdAdd_f32x4(tfSimdMul_f32x4(j11, view[5]), tfSimdMul_f32x4(j12, view[9]));
+        const Tsimd_f32x4_t t12 = tfSimdAdd_f32x4(tfSimdMul_f32x4(j11, view[6]), tfSimdMul_f32x4(j12, view[10]));
+        const Tsimd_f32x4_t st00 = splatSimdDot3(s00, s01, s02, t00, t01, t02);
+        const Tsimd_f32x4_t st01 = splatSimdDot3(s01, s11, s12, t00, t01, t02);
+        const Tsimd_f32x4_t st02 = splatSimdDot3(s02, s12, s22, t00, t01, t02);
+        const Tsimd_f32x4_t st10 = splatSimdDot3(s00, s01, s02, t10, t11, t12);
+        const Tsimd_f32x4_t st11 = splatSimdDot3(s01, s11, s12, t10, t11, t12);
+        const Tsimd_f32x4_t st12 = splatSimdDot3(s02, s12, s22, t10, t11, t12);
+        const Tsimd_f32x4_t a = tfSimdAdd_f32x4(splatSimdDot3(t00, t01, t02, st00, st01, st02), lowPass);
+        const Tsimd_f32x4_t b = splatSimdDot3(t00, t01, t02, st10, st11, st12);
+        const Tsimd_f32x4_t c = tfSimdAdd_f32x4(splatSimdDot3(t10, t11, t12, st10, st11, st12), lowPass);
+
+        const Tsimd_f32x4_t det = tfSimdSub_f32x4(tfSimdMul_f32x4(a, c), tfSimdMul_f32x4(b, b));
+        const Tsimd_f32x4_t detInv = tfSimdDiv_f32x4(one, det);
+        const Tsimd_f32x4_t mid = tfSimdMul_f32x4(half, tfSimdAdd_f32x4(a, c));
+        const Tsimd_f32x4_t discriminant = tfSimdSub_f32x4(tfSimdMul_f32x4(mid, mid), det);
+        const Tsimd_f32x4_t lambda = tfSimdAdd_f32x4(mid, tfSimdSqrt_f32x4(tfSimdMaxPerElem_f32x4(minDiscriminant, discriminant)));
+        const Tsimd_f32x4_t extent = tfSimdMul_f32x4(tfSimdSplat_f32x4(3.0f), tfSimdSqrt_f32x4(lambda));
+
+        float depthLanes[4], detLanes[4], extentLanes[4], xLanes[4], yLanes[4], conicLanes[3][4];
+        splatSimdStore(tz, depthLanes);
+        splatSimdStore(det, detLanes);
+        splatSimdStore(extent, extentLanes);
+        splatSimdStore(tfSimdAdd_f32x4(tfSimdMul_f32x4(tfSimdMul_f32x4(focalX, tx), tzInv), centerX), xLanes);
+        splatSimdStore(tfSimdAdd_f32x4(tfSimdMul_f32x4(tfSimdMul_f32x4(focalY, ty), tzInv), centerY), yLanes);
+        splatSimdStore(tfSimdMul_f32x4(c, detInv), conicLanes[0]);
+        splatSimdStore(tfSimdSub_f32x4(zero, tfSimdMul_f32x4(b, detInv)), conicLanes[1]);
+        splatSimdStore(tfSimdMul_f32x4(a, detInv), conicLanes[2]);
+
+        for (uint32_t lane = 0; lane < 4; lane++) {
+            struct SplatProjected* out = &projected[ids[lane]];
+            out->mRadius = 0;
+            if (depthLanes[lane] <= camera->mNear || !(detLanes[lane] > 0.0f))
+                continue;
+            const float conic[3] = { conicLanes[0][lane], conicLanes[1][lane], conicLanes[2][lane] };
+            splatProjectFinish(camera, shDegree, streams, ids[lane], xLanes[lane], yLanes[lane], depthLanes[lane], conic,
+                               (int32_t)ceilf(extentLanes[lane]), color, out);
+        }
+    }
+
+    const uint64_t tail = numBatches * 4;
+    if (tail < count)
+        splatProjectScalarImpl(camera, shDegree, streams, covariances, indices, first + tail, count - tail, color, projected);
+}
+
+void splatProjectSimd(const struct SplatCamera* camera, uint32_t shDegree, const struct SplatStreams* streams,
+                      const struct SplatCovariances* covariances, uint64_t first, uint64_t count, struct SplatProjected* projected) {
+    splatProjectSimdImpl(camera, shDegree, streams, covariances, NULL, first, count, true, projected);
+}
+
+// Splats per range of the splat stages. Cull, project, SH, count and scatter
+// share it, so range r of every stage covers the same splats.
+static const uint64_t gSplatRasterSplatGrain = 8192;
+// Tiles per range of the sort stage.
+static const uint64_t gSplatRasterSortGrain = 16;
+// The blend plan aims at this many jobs per worker, a tile whose cost is
+// above that share of the frame is split. Jobs never get cheaper than the
+// minimum, in pairs times rows, so light frames are not cut into crumbs.
+static const uint64_t gSplatRasterBlendJobsPerWorker = 8;
+static const uint64_t gSplatRasterBlendMinJobCost = 4096;
+// tile index, first row and row count - 1 of a blend job
+#define SPLAT_RASTER_BLEND_TILE_SHIFT 8
+#define SPLAT_RASTER_MAX_TILES (1u << 24)
+
+static const char* gSplatRasterStageNames[SPLAT_RASTER_NUM_STAGES] = {
+    "Cull", "Project", "SH", "Bin Count", "Bin Scan", "Bin Scatter", "Sort", "Blend Plan", "Blend",
+};
+
+const char* splatRasterStageName(enum SplatRasterStage stage) { return gSplatRasterStageNames[stage]; }
+
+void splatRasterizerInit(struct SplatRasterizer* rasterizer) {
+    memset((void*)rasterizer, 0, sizeof(struct SplatRasterizer));
+    rasterizer->mShDegree = SPLAT_SH_MAX_DEGREE;
+    for (uint32_t stage = 0; stage < SPLAT_RASTER_NUM_STAGES; stage++)
+        rasterizer->mProfileTokens[stage] = SPLAT_JOB_NO_PROFILE;
+}
+
+void splatRasterizerExit(struct SplatRasterizer* rasterizer) {
+    splatFree(rasterizer->pProjected);
+    splatFree(rasterizer->pVisible);
+    splatFree(rasterizer->pRangeCounts);
+    splatFree(rasterizer->pTileRanges);
+    splatFree(rasterizer->pTileCursors);
+    splatFree(rasterizer->pKeys);
+    splatFree(rasterizer->pValues);
+    splatSortScratchExit(&rasterizer->mSortScratch);
+    splatFree(rasterizer->pBlendJobs);
+    splatFree(rasterizer->pBlendJobScratch);
+    splatFree(rasterizer->pImage);
+    memset((void*)rasterizer, 0, sizeof(struct SplatRasterizer));
+}
+
+struct SplatRasterContext {
+    struct SplatRasterizer*    pRasterizer;
+    const struct SplatCamera*  pCamera;
+    const struct SplatStreams* pStreams;
+    uint64_t                   mNumSplats;
+    uint32_t                   mTilesX;
+    uint32_t                   mNumTiles;
+    uint64_t                   mNumVisible;
+    uint64_t                   mNumPairs;
+    bool                       mFailed;
+    // blend plan and its progress, a lane is a range of the blend stage
+    uint32_t                   mNumBlendLanes;
+    uint32_t                   mNumBlendJobs;
+    uint32_t                   mNumSplitTiles;
+    uint32_t                   mMaxTilePairs;
+    std::atomic<uint32_t>      mNextBlendJob;
+    int64_t                    mLaneUs[SPLAT_JOB_MAX_WORKERS];
+    uint32_t                   mLaneJobs[SPLAT_JOB_MAX_WORKERS];
+};
+
+// Keeps every splat whose footprint may reach a tile. The footprint radius
+// is bounded from above with the largest scale and the Frobenius norm of
+// the projection Jacobian at the same guard band clamped mean the
+// projection uses, plus the low pass filter and the eigenvalue floor.
+static void splatRasterCullRange(void* user, uint64_t begin, uint64_t end) {
+    const struct SplatRasterContext* ctx = (const struct SplatRasterContext*)user;
+    struct SplatRasterizer*          rasterizer = ctx->pRasterizer;
+    const struct SplatCamera*        camera = ctx->pCamera;
+    const struct SplatStreams*       streams = ctx->pStreams;
+    const float*                     v = camera->mView;
+    const float                      limX = gSplatFrustumGuardBand * (float)camera->mWidth / (2.0f * camera->mFocalX);
+    const float                      limY = gSplatFrustumGuardBand * (float)camera->mHeight / (2.0f * camera->mFocalY);
+    const float                      focal = fmaxf(camera->mFocalX, camera->mFocalY);
+    // the tile rects round towards zero, a splat reaches a tile up to a tile outside the view
+    const float minPixel = -(float)SPLAT_TILE_SIZE;
+    const float maxX = (float)(ctx->mTilesX + 1) * SPLAT_TILE_SIZE;
+    const float maxY = (float)(ctx->mNumTiles / ctx->mTilesX + 1) * SPLAT_TILE_SIZE;
+    uint32_t    numVisible = 0;
+    for (uint64_t i = begin; i < end; i++) {
+        const struct Tf32x3_s p = streams->pPositions[i];
+        const float           tz = v[8] * p.x + v[9] * p.y + v[10] * p.z + v[11];
+        bool                  visible = tz > camera->mNear;
+        if (visible) {
+            const float           tx = v[0] * p.x + v[1] * p.y + v[2] * p.z + v[3];
+            const float           ty = v[4] * p.x + v[5] * p.y + v[6] * p.z + v[7];
+            const struct Tf32x3_s scale = streams->pScales[i];
+            const float           sigma = expf(fmaxf(scale.x, fmaxf(scale.y, scale.z)));
+            const float           cx = fminf(limX, fmaxf(-limX, tx / tz));
+            const float           cy = fminf(limY, fmaxf(-limY, ty / tz));
+            const float           jacobianSq = focal * focal / (tz * tz) * (2.0f + cx * cx + cy * cy);
+            const float           radius = 3.0f * sqrtf(jacobianSq * sigma * sigma + gSplatLowPassFilter + 0.32f) + 1.0f;
+            const float           px = camera->mFocalX * tx / tz + camera->mCenterX;
+            const float           py = camera->mFocalY * ty / tz + camera->mCenterY;
+            visible = px + radius >= minPixel && px - radius <= maxX && py + radius >= minPixel && py - radius <= maxY;
+        }
+        if (visible)
+            rasterizer->pVisible[begin + numVisible++] = (uint32_t)i;
+        else
+            rasterizer->pProjected[i].mRadius = 0;
+    }
+    rasterizer->pRangeCounts[(begin / gSplatRasterSplatGrain) * 3] = numVisible;
+}
+
+static void splatRasterProjectRange(void* user, uint64_t begin, uint64_t) {
+    const struct SplatRasterContext* ctx = (const struct SplatRasterContext*)user;
+    struct SplatRasterizer*          rasterizer = ctx->pRasterizer;
+    const uint32_t                   numVisible = rasterizer->pRangeCounts[(begin / gSplatRasterSplatGrain) * 3];
+    if (rasterizer->mScalarProjection)
+        splatProjectScalarImpl(ctx->pCamera, rasterizer->mShDegree, ctx->pStreams, rasterizer->pCovariances, rasterizer->pVisible, begin,
+                               numVisible, false, rasterizer->pProjected);
+    else
+        splatProjectSimdImpl(ctx->pCamera, rasterizer->mShDegree, ctx->pStreams, rasterizer->pCovariances, rasterizer->pVisible, begin,
+                             numVisible, false, rasterizer->pProjected);
+}
+
+static void splatRasterShRange(void* user, uint64_t begin, uint64_t) {
+    const struct SplatRasterContext* ctx = (const struct SplatRasterContext*)user;
+    struct SplatRasterizer*          rasterizer = ctx->pRasterizer;
+    const uint32_t                   numVisible = rasterizer->pRangeCounts[(begin / gSplatRasterSplatGrain) * 3];
+    for (uint64_t k = begin; k < begin + numVisible; k++) {
+        const uint32_t         i = rasterizer->pVisible[k];
+        struct SplatProjected* splat = &rasterizer->pProjected[i];
+        if (splat->mRadius)
+            splat->mColor = splatEvalSh(rasterizer->mShDegree, &ctx->pStreams->pShs[i], splatViewDirection(ctx->pCamera, ctx->pStreams, i));
+    }
+}
+
+static void splatRasterBinCountRange(void* user, uint64_t begin, uint64_t) {
+    const struct SplatRasterContext* ctx = (const struct SplatRasterContext*)user;
+    struct SplatRasterizer*          rasterizer = ctx->pRasterizer;
+    uint32_t*                        counts = &rasterizer->pRangeCounts[(begin / gSplatRasterSplatGrain) * 3];
+    uint32_t                         numDrawn = 0;
+    uint32_t                         numPairs = 0;
+    for (uint64_t k = begin; k < begin + counts[0]; k++) {
+        const struct SplatProjected* splat = &rasterizer->pProjected[rasterizer->pVisible[k]];
+        if (splat->mRadius == 0)
+            continue;
+        numDrawn++;
+        for (uint32_t ty = splat->mTileRect[1]; ty < splat->mTileRect[3]; ty++) {
+            for (uint32_t tx = splat->mTileRect[0]; tx < splat->mTileRect[2]; tx++)
+                rasterizer->pTileCursors[ty * ctx->mTilesX + tx].fetch_add(1, std::memory_order_relaxed);
+        }
+        numPairs += (splat->mTileRect[2] - splat->mTileRect[0]) * (splat->mTileRect[3] - splat->mTileRect[1]);
+    }
+    counts[1] = numDrawn;
+    counts[2] = numPairs;
+}
+
+// Turns the tile counts into ranges and the cursors into the range starts.
+static void splatRasterBinScan(void* user, uint64_t, uint64_t) {
+    struct SplatRasterContext* ctx = (struct SplatRasterContext*)user;
+    struct SplatRasterizer*    rasterizer = ctx->pRasterizer;
+    uint64_t                   numPairs = 0;
+    for (uint32_t tile = 0; tile < ctx->mNumTiles; tile++) {
+        const uint32_t count = rasterizer->pTileCursors[tile].load(std::memory_order_relaxed);
+        rasterizer->pTileRanges[tile] = (uint32_t)numPairs;
+        rasterizer->pTileCursors[tile].store((uint32_t)numPairs, std::memory_order_relaxed);
+        numPairs += count;
+    }
+    const uint64_t numRanges = (ctx->mNumSplats + gSplatRasterSplatGrain - 1) / gSplatRasterSplatGrain;
+    uint64_t       rangePairs = 0;
+    for (uint64_t range = 0; range < numRanges; range++) {
+        ctx->mNumVisible += rasterizer->pRangeCounts[range * 3 + 1];
+        rangePairs += rasterizer->pRangeCounts[range * 3 + 2];
+    }
+    // per range counts wrap first, a tile count would need as many splats as the whole scene
+    if (numPairs > UINT32_MAX || rangePairs != numPairs) {
+        LOGF(eERROR, "Too many splat tile pairs.");
+        ctx->mFailed = true;
+        return;
+    }
+    rasterizer->pTileRanges[ctx->mNumTiles] = (uint32_t)numPairs;
+    ctx->mNumPairs = numPairs;
+    if (rasterizer->mPairsCapacity < numPairs) {
+        rasterizer->pKeys = (uint64_t*)splatRealloc(rasterizer->pKeys, sizeof(uint64_t) * numPairs);
+        rasterizer->pValues = (uint32_t*)splatRealloc(rasterizer->pValues, sizeof(uint32_t) * numPairs);
+        rasterizer->mPairsCapacity = numPairs;
+    }
+    splatSortScratchReserve(&rasterizer->mSortScratch, numPairs);
+}
+
+static uint64_t splatRasterSplatCount(void* user) {
+    const struct SplatRasterContext* ctx = (const struct SplatRasterContext*)user;
+    return ctx->mFailed ? 0 : ctx->mNumSplats;
+}
+
+static uint64_t splatRasterTileCount(void* user) {
+    const struct SplatRasterContext* ctx = (const struct SplatRasterContext*)user;
+    return ctx->mFailed ? 0 : ctx->mNumTiles;
+}
+
+static uint64_t splatRasterBlendPlanCount(void* user) {
+    const struct SplatRasterContext* ctx = (const struct SplatRasterContext*)user;
+    return ctx->mFailed ? 0 : 1;
+}
+
+static void splatRasterBinScatterRange(void* user, uint64_t begin, uint64_t) {
+    const struct SplatRasterContext* ctx = (const struct SplatRasterContext*)user;
+    struct SplatRasterizer*          rasterizer = ctx->pRasterizer;
+    const uint32_t                   numVisible = rasterizer->pRangeCounts[(begin / gSplatRasterSplatGrain) * 3];
+    for (uint64_t k = begin; k < begin + numVisible; k++) {
+        const uint32_t               i = rasterizer->pVisible[k];
+        const struct SplatProjected* splat = &rasterizer->pProjected[i];
+        if (splat->mRadius == 0)
+            continue;
+        // positive float depths sort like their bit patterns
+        uint32_t depthBits;
+        memcpy(&depthBits, &splat->mDepth, sizeof(depthBits));
+        const uint64_t key = ((uint64_t)depthBits << 32) | i;
+        for (uint32_t ty = splat->mTileRect[1]; ty < splat->mTileRect[3]; ty++) {
+            for (uint32_t tx = splat->mTileRect[0]; tx < splat->mTileRect[2]; tx++)
+                rasterizer->pKeys[rasterizer->pTileCursors[ty * ctx->mTilesX + tx].fetch_add(1, std::memory_order_relaxed)] = key;
+        }
+    }
+}
+
+// Sorts the keys of one tile ascending. Keys are unique, so the order does
+// not depend on the order the scatter wrote them in. Short tiles use an
+// insertion sort, longer ones an LSD radix sort that skips digits every key
+// shares, like splatRadixSort.
+static void splatRasterSortTile(uint64_t* keys, uint64_t* scratch, uint32_t count) {
+    if (count <= 32) {
+        for (uint32_t i = 1; i < count; i++) {
+            const uint64_t key = keys[i];
+            uint32_t       j = i;
+            for (; j > 0 && keys[j - 1] > key; j--)
+                keys[j] = keys[j - 1];
+            keys[j] = key;
+        }
+        return;
+    }
+
+    uint32_t histograms[SPLAT_SORT_NUM_DIGITS][SPLAT_SORT_RADIX];
+    memset(histograms, 0, sizeof(histograms));
+    for (uint32_t i = 0; i < count; i++) {
+        for (uint32_t digit = 0; digit < SPLAT_SORT_NUM_DIGITS; digit++)
+            histograms[digit][(keys[i] >> (digit * SPLAT_SORT_RADIX_BITS)) & (SPLAT_SORT_RADIX - 1)]++;
+    }
+    uint64_t* src = keys;
+    uint64_t* dst = scratch;
+    for (uint32_t digit = 0; digit < SPLAT_SORT_NUM_DIGITS; digit++) {
+        const uint32_t shift = digit * SPLAT_SORT_RADIX_BITS;
+        uint32_t*      histogram = histograms[digit];
+        if (histogram[(src[0] >> shift) & (SPLAT_SORT_RADIX - 1)] == count)
+            continue;
+        uint32_t offset = 0;
+        for (uint32_t bucket = 0; bucket < SPLAT_SORT_RADIX; bucket++) {
+            const uint32_t bucketCount = histogram[bucket];
+            histogram[bucket] = offset;
+            offset += bucketCount;
+        }
+        for (uint32_t i = 0; i < count; i++)
+            dst[histogram[(src[i] >> shift) & (SPLAT_SORT_RADIX - 1)]++] = src[i];
+        uint64_t* swap = src;
+        src = dst;
+        dst = swap;
+    }
+    if (src != keys)
+        memcpy(keys, src, sizeof(uint64_t) * count);
+}
+
+static void splatRasterSortTiles(void* user, uint64_t begin, uint64_t end) {
+    const struct SplatRasterContext* ctx = (const struct SplatRasterContext*)user;
+    struct SplatRasterizer*          rasterizer = ctx->pRasterizer;
+    for (uint64_t tile = begin; tile < end; tile++) {
+        const uint32_t first = rasterizer->pTileRanges[tile];
+        const uint32_t last = rasterizer->pTileRanges[tile + 1];
+        splatRasterSortTile(&rasterizer->pKeys[first], &rasterizer->mSortScratch.pKeys[first], last - first);
+        for (uint32_t pairIdx = first; pairIdx < last; pairIdx++)
+            rasterizer->pValues[pairIdx] = (uint32_t)rasterizer->pKeys[pairIdx];
+    }
+}
+
+// Turns the pair count of every tile into blend jobs. The cost of a job is
+// its pairs times its rows, plus a row for the background of an empty tile.
+// A tile is halved into bands of rows until a band fits the share of one
+// job, then every job is sorted by cost, largest first, so the long jobs
+// start early and the short ones fill the gaps at the end.
+static void splatRasterBlendPlan(void* user, uint64_t, uint64_t) {
+    struct SplatRasterContext* ctx = (struct SplatRasterContext*)user;
+    struct SplatRasterizer*    rasterizer = ctx->pRasterizer;
+    const uint32_t             height = rasterizer->mImageHeight;
+    uint64_t                   totalCost = 0;
+    uint32_t                   maxTilePairs = 0;
+    for (uint32_t tile = 0; tile < ctx->mNumTiles; tile++) {
+        const uint32_t pairs = rasterizer->pTileRanges[tile + 1] - rasterizer->pTileRanges[tile];
+        totalCost += (uint64_t)(pairs + 1) * SPLAT_TILE_SIZE;
+        maxTilePairs = pairs > maxTilePairs ? pairs : maxTilePairs;
+    }
+    ctx->mMaxTilePairs = maxTilePairs;
+
+    uint64_t  jobCost = totalCost / ((uint64_t)ctx->mNumBlendLanes * gSplatRasterBlendJobsPerWorker);
+    uint64_t* jobs = rasterizer->pBlendJobs;
+    uint32_t  numJobs = 0;
+    uint32_t  numSplitTiles = 0;
+    jobCost = jobCost > gSplatRasterBlendMinJobCost ? jobCost : gSplatRasterBlendMinJobCost;
+    for (uint32_t tile = 0; tile < ctx->mNumTiles; tile++) {
+        const uint64_t pairs = rasterizer->pTileRanges[tile + 1] - rasterizer->pTileRanges[tile];
+        const uint32_t y0 = (tile / ctx->mTilesX) * SPLAT_TILE_SIZE;
+        const uint32_t rows = height - y0 < SPLAT_TILE_SIZE ? height - y0 : SPLAT_TILE_SIZE;
+        uint32_t       bandRows = rows;
+        if (!rasterizer->mTileOrderBlend) {
+            while (bandRows > 1 && (pairs + 1) * bandRows > jobCost)
+                bandRows = (bandRows + 1) / 2;
+        }
+        numSplitTiles += bandRows < rows ? 1 : 0;
+        for (uint32_t row = 0; row < rows; row += bandRows) {
+            const uint32_t count = rows - row < bandRows ? rows - row : bandRows;
+            const uint64_t cost = (pairs + 1) * count;
+            // the inverted cost sorts the largest job first, ties keep tile order
+            const uint64_t rank = rasterizer->mTileOrderBlend ? 0 : UINT32_MAX - (cost < UINT32_MAX ? cost : UINT32_MAX);
+            jobs[numJobs++] = (rank << 32) | ((uint64_t)tile << SPLAT_RASTER_BLEND_TILE_SHIFT) | (row << 4) | (count - 1);
+        }
+    }
+    if (!rasterizer->mTileOrderBlend)
+        splatRasterSortTile(jobs, rasterizer->pBlendJobScratch, numJobs);
+    ctx->mNumBlendJobs = numJobs;
+    ctx->mNumSplitTiles = numSplitTiles;
+}
+
+static uint64_t splatRasterBlendLaneCount(void* user) {
+    const struct SplatRasterContext* ctx = (const struct SplatRasterContext*)user;
+    return ctx->mFailed ? 0 : ctx->mNumBlendLanes;
+}
+
+// Blends rows [rowBegin, rowEnd) of a tile.
+static void splatRasterBlendRows(const struct SplatRasterContext* ctx, uint32_t tile, uint32_t rowBegin, uint32_t rowEnd) {
+    const struct SplatRasterizer* rasterizer = ctx->pRasterizer;
+    const uint32_t                width = rasterizer->mImageWidth;
+    const uint32_t                x0 = (tile % ctx->mTilesX) * SPLAT_TILE_SIZE;
+    const uint32_t                y0 = (tile / ctx->mTilesX) * SPLAT_TILE_SIZE;
+    const uint32_t                first = rasterizer->pTileRanges[tile];
+    const uint32_t                last = rasterizer->pTileRanges[tile + 1];
+    for (uint32_t y = y0 + rowBegin; y < y0 + rowEnd; y++) {
+        for (uint32_t x = x0; x < x0 + SPLAT_TILE_SIZE && x < width; x++) {
+            float transmittance = 1.0f;
+            float color[3] = { 0.0f, 0.0f, 0.0f };
+            for (uint32_t pairIdx = first; pairIdx < last; pairIdx++) {
+                const struct SplatProjected* splat = &rasterizer->pProjected[rasterizer->pValues[pairIdx]];
+                const float                  dx = splat->mX - (float)x;
+                const float                  dy = splat->mY - (float)y;
+                const float power = -0.5f * (splat->mConic[0] * dx * dx + splat->mConic[2] * dy * dy) - splat->mConic[1] * dx * dy;
+                if (power > 0.0f)
+                    continue;
+                const float alpha = fminf(gSplatMaxAlpha, splat->mOpacity * expf(power));
+                if (alpha < gSplatMinAlpha)
+                    continue;
+                const float nextTransmittance = transmittance * (1.0f - alpha);
+                if (nextTransmittance < gSplatMinTransmittance)
+                    break;
+                for (uint32_t c = 0; c < 3; c++)
+                    color[c] += splat->mColor.v[c] * alpha * transmittance;
+                transmittance = nextTransmittance;
+            }
+            float* pixel = &rasterizer->pImage[((size_t)y * width + x) * 3];
+            for (uint32_t c = 0; c < 3; c++)
+                pixel[c] = color[c] + transmittance * rasterizer->mBackground.v[c];
+        }
+    }
+}
+
+// One lane per worker: takes the next job of the plan until none is left.
+// A worker only finishes its lane once the plan is drained, so a lane that
+// blended any job maps to one thread and its time is the thread time.
+static void splatRasterBlendLane(void* user, uint64_t begin, uint64_t) {
+    struct SplatRasterContext*    ctx = (struct SplatRasterContext*)user;
+    const struct SplatRasterizer* rasterizer = ctx->pRasterizer;
+    const int64_t                 startUs = getUSec(false);
+    uint32_t                      numJobs = 0;
+    for (;;) {
+        const uint32_t jobIdx = ctx->mNextBlendJob.fetch_add(1, std::memory_order_relaxed);
+        if (jobIdx >= ctx->mNumBlendJobs)
+            break;
+        const uint32_t job = (uint32_t)rasterizer->pBlendJobs[jobIdx];
+        const uint32_t row = (job >> 4) & 0xfu;
+        splatRasterBlendRows(ctx, job >> SPLAT_RASTER_BLEND_TILE_SHIFT, row, row + (job & 0xfu) + 1);
+        numJobs++;
+    }
+    ctx->mLaneJobs[begin] = numJobs;
+    ctx->mLaneUs[begin] = numJobs ? getUSec(false) - startUs : 0;
+}
+
+bool splatRasterize(struct SplatJobSystem* jobs, struct SplatRasterizer* rasterizer, const struct SplatCamera* camera, uint64_t numSplats,
+                    const struct SplatStreams* streams, struct SplatRasterStats* outStats) {
+    if (!streams->pPositions || !streams->pScales || !streams->pRotations || !streams->pShs || numSplats > UINT32_MAX) {
+        LOGF(eERROR, "Splat rasterizer needs positions, scales, rotations and SH.");
+        return false;
+    }
+
+    const uint32_t tilesX = (camera->mWidth + SPLAT_TILE_SIZE - 1) / SPLAT_TILE_SIZE;
+    const uint32_t tilesY = (camera->mHeight + SPLAT_TILE_SIZE - 1) / SPLAT_TILE_SIZE;
+    const uint32_t numTiles = tilesX * tilesY;
+    if (numTiles >= SPLAT_RASTER_MAX_TILES) {
+        LOGF(eERROR, "Splat rasterizer image is too large.");
+        return false;
+    }
+    const uint64_t numRanges = (numSplats + gSplatRasterSplatGrain - 1) / gSplatRasterSplatGrain;
+    if (rasterizer->mProjectedCapacity < numSplats) {
+        rasterizer->pProjected = (struct SplatProjected*)splatRealloc(rasterizer->pProjected, sizeof(struct SplatProjected) * numSplats);
+        rasterizer->pVisible = (uint32_t*)splatRealloc(rasterizer->pVisible, sizeof(uint32_t) * numSplats);
+        rasterizer->mProjectedCapacity = numSplats;
+    }
+    if (rasterizer->mRangeCapacity < numRanges) {
+        rasterizer->pRangeCounts = (uint32_t*)splatRealloc(rasterizer->pRangeCounts, sizeof(uint32_t) * 3 * numRanges);
+        rasterizer->mRangeCapacity = numRanges;
+    }
+    if (rasterizer->mTileRangesCapacity < numTiles + 1) {
+        rasterizer->pTileRanges = (uint32_t*)splatRealloc(rasterizer->pTileRanges, sizeof(uint32_t) * (numTiles + 1));
+        splatFree(rasterizer->pTileCursors);
+        rasterizer->pTileCursors = (std::atomic<uint32_t>*)splatMalloc(sizeof(std::atomic<uint32_t>) * (numTiles + 1));
+        rasterizer->mTileRangesCapacity = numTiles + 1;
+    }
+    // every tile split down to single rows at most
+    if (rasterizer->mBlendJobsCapacity < (uint64_t)numTiles * SPLAT_TILE_SIZE) {
+        rasterizer->mBlendJobsCapacity = (uint64_t)numTiles * SPLAT_TILE_SIZE;
+        rasterizer->pBlendJobs = (uint64_t*)splatRealloc(rasterizer->pBlendJobs, sizeof(uint64_t) * rasterizer->mBlendJobsCapacity);
+        rasterizer->pBlendJobScratch =
+            (uint64_t*)splatRealloc(rasterizer->pBlendJobScratch, sizeof(uint64_t) * rasterizer->mBlendJobsCapacity);
+    }
+    if (rasterizer->mImageWidth != camera->mWidth || rasterizer->mImageHeight != camera->mHeight) {
+        rasterizer->pImage = (float*)splatRealloc(rasterizer->pImage, sizeof(float) * 3 * camera->mWidth * camera->mHeight);
+        rasterizer->mImageWidth = camera->mWidth;
+        rasterizer->mImageHeight = camera->mHeight;
+    }
+    for (uint32_t tile = 0; tile < numTiles; tile++)
+        rasterizer->pTileCursors[tile].store(0, std::memory_order_relaxed);
+
+    struct SplatRasterContext ctx = {};
+    ctx.pRasterizer = rasterizer;
+    ctx.pCamera = camera;
+    ctx.pStreams = streams;
+    ctx.mNumSplats = numSplats;
+    ctx.mTilesX = tilesX;
+    ctx.mNumTiles = numTiles;
+    ctx.mNumBlendLanes = jobs && jobs->mNumWorkers > 1 ? jobs->mNumWorkers : 1;
+
+    struct SplatJobGraph* graph = &rasterizer->mGraph;
+    splatJobGraphReset(graph);
+    const uint32_t cull = splatJobGraphAddStage(graph, gSplatRasterStageNames[SPLAT_RASTER_STAGE_CULL], numSplats, gSplatRasterSplatGrain,
+                                                splatRasterCullRange, &ctx);
+    const uint32_t project = splatJobGraphAddStage(graph, gSplatRasterStageNames[SPLAT_RASTER_STAGE_PROJECT], numSplats,
+                                                   gSplatRasterSplatGrain, splatRasterProjectRange, &ctx);
+    splatJobGraphAddDependency(graph, project, cull);
+    const uint32_t sh = splatJobGraphAddStage(graph, gSplatRasterStageNames[SPLAT_RASTER_STAGE_SH], numSplats, gSplatRasterSplatGrain,
+                                              splatRasterShRange, &ctx);
+    splatJobGraphAddDependency(graph, sh, project);
+    const uint32_t binCount = splatJobGraphAddStage(graph, gSplatRasterStageNames[SPLAT_RASTER_STAGE_BIN_COUNT], numSplats,
+                                                    gSplatRasterSplatGrain, splatRasterBinCountRange, &ctx);
+    splatJobGraphAddDependency(graph, binCount, project);
+    const uint32_t binScan =
+        splatJobGraphAddStage(graph, gSplatRasterStageNames[SPLAT_RASTER_STAGE_BIN_SCAN], 1, 1, splatRasterBinScan, &ctx);
+    splatJobGraphAddDependency(graph, binScan, binCount);
+    const uint32_t binScatter =
+        splatJobGraphAddDeferredStage(graph, gSplatRasterStageNames[SPLAT_RASTER_STAGE_BIN_SCATTER], splatRasterSplatCount,
+                                      gSplatRasterSplatGrain, splatRasterBinScatterRange, &ctx);
+    splatJobGraphAddDependency(graph, binScatter, binScan);
+    const uint32_t sort = splatJobGraphAddDeferredStage(graph, gSplatRasterStageNames[SPLAT_RASTER_STAGE_SORT], splatRasterTileCount,
+                                                        gSplatRasterSortGrain, splatRasterSortTiles, &ctx);
+    splatJobGraphAddDependency(graph, sort, binScatter);
+    const uint32_t blendPlan = splatJobGraphAddDeferredStage(graph, gSplatRasterStageNames[SPLAT_RASTER_STAGE_BLEND_PLAN],
+                                                             splatRasterBlendPlanCount, 1, splatRasterBlendPlan, &ctx);
+    splatJobGraphAddDependency(graph, blendPlan, binScan);
+    const uint32_t blend = splatJobGraphAddDeferredStage(graph, gSplatRasterStageNames[SPLAT_RASTER_STAGE_BLEND], splatRasterBlendLaneCount,
+                                                         1, splatRasterBlendLane, &ctx);
+    splatJobGraphAddDependency(graph, blend, sort);
+    splatJobGraphAddDependency(graph, blend, sh);
+    splatJobGraphAddDependency(graph, blend, blendPlan);
+    for (uint32_t stage = 0; stage < SPLAT_RASTER_NUM_STAGES; stage++)
+        graph->mStages[stage].mProfileToken = rasterizer->mProfileTokens[stage];
+
+    struct SplatRasterStats stats = {};
+    splatJobGraphRun(jobs, graph, &stats.mJobs);
+    if (ctx.mFailed)
+        return false;
+
+    stats.mNumVisible = ctx.mNumVisible;
+    stats.mNumTilePairs = ctx.mNumPairs;
+    stats.mCullUs = splatJobStageUs(&graph->mStages[cull]);
+    stats.mProjectUs = splatJobStageUs(&graph->mStages[project]);
+    stats.mShUs = splatJobStageUs(&graph->mStages[sh]);
+    stats.mBinUs = graph->mStages[binScatter].mDoneUs - graph->mStages[binCount].mReadyUs;
+    stats.mSortUs = splatJobStageUs(&graph->mStages[sort]);
+    stats.mBlendPlanUs = splatJobStageUs(&graph->mStages[blendPlan]);
+    stats.mBlendUs = splatJobStageUs(&graph->mStages[blend]);
+    stats.mMaxTilePairs = ctx.mMaxTilePairs;
+    stats.mNumBlendJobs = ctx.mNumBlendJobs;
+    stats.mNumSplitTiles = ctx.mNumSplitTiles;
+    int64_t sumThreadUs = 0;
+    for (uint32_t lane = 0; lane < ctx.mNumBlendLanes; lane++) {
+        if (!ctx.mLaneJobs[lane])
+            continue;
+        stats.mNumBlendThreads++;
+        sumThreadUs += ctx.mLaneUs[lane];
+        stats.mBlendMaxThreadUs = ctx.mLaneUs[lane] > stats.mBlendMaxThreadUs ? ctx.mLaneUs[lane] : stats.mBlendMaxThreadUs;
+    }
+    stats.mBlendMeanThreadUs = stats.mNumBlendThreads ? sumThreadUs / stats.mNumBlendThreads : 0;
+    if (outStats)
+        *outStats = stats;
+    return true;
+}
@@ -0,0 +1,175 @@
+/*
+ * Copyright (c) 2017-2024 The Forge Interactive Inc.
+ *
+ * This file is part of The-Forge
+ * (see https://github.com/ConfettiFX/The-Forge).
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#pragma once
+
+#include "Splat.h"
+#include "SplatCovariance.h"
+#include "SplatJobs.h"
+#include "SplatSort.h"
+
+// CPU reference rasterizer for 3D Gaussian splats. Follows the tile based
+// pipeline of the original implementation: splats are projected to 2D
+// conics, binned into 16x16 pixel tiles, sorted per tile by depth and alpha
+// blended front to back with early termination. Every step is a stage of a
+// job graph, see SplatRasterStage. It reads the same streams
+// the loader produces (log scales, raw quaternions, opacity logits) and is
+// meant as a golden reference and a CPU baseline, not for interactive use.
+
+#define SPLAT_TILE_SIZE 16
+
+// Pinhole camera in the convention of the 3DGS reference: the camera looks
+// down +z with +x right and +y down, pixel (0, 0) is the top left corner.
+struct SplatCamera {
+    float           mView[12]; // world to camera, rows of [R | t]
+    struct Tf32x3_s mPosition; // camera position in world space
+    float           mFocalX;
+    float           mFocalY;
+    float           mCenterX;
+    float           mCenterY;
+    uint32_t        mWidth;
+    uint32_t        mHeight;
+    float           mNear;
+};
+
+// Builds a camera at eye looking at target, fovY in radians.
+void splatCameraLookAt(struct Tf32x3_s eye, struct Tf32x3_s target, struct Tf32x3_s up, float fovY, uint32_t width, uint32_t height,
+                       struct SplatCamera* outCamera);
+
+struct SplatProjected {
+    float           mX; // pixel space mean
+    float           mY;
+    float           mConic[3]; // inverse of the 2D covariance, xx xy yy
+    float           mDepth;
+    float           mOpacity; // after the sigmoid activation
+    int32_t         mRadius; // 0 when the splat is culled
+    uint32_t        mTileRect[4]; // min x, min y, max x, max y in tiles, max exclusive
+    struct Tf32x3_s mColor;
+};
+
+// Projects splats [first, first + count) into projected (indexed by splat).
+// covariances may be NULL or empty to build sigma from the scales and
+// rotations, otherwise it covers every projected splat.
+void splatProjectScalar(const struct SplatCamera* camera, uint32_t shDegree, const struct SplatStreams* streams,
+                        const struct SplatCovariances* covariances, uint64_t first, uint64_t count, struct SplatProjected* projected);
+// Same as splatProjectScalar, four splats at a time through TF_Simd32x4. The
+// covariance, Jacobian and conic math runs in lanes; culling, tile rects and
+// SH colors are finished per splat. Results match the scalar path up to
+// float rounding.
+void splatProjectSimd(const struct SplatCamera* camera, uint32_t shDegree, const struct SplatStreams* streams,
+                      const struct SplatCovariances* covariances, uint64_t first, uint64_t count, struct SplatProjected* projected);
+
+// Stages of a rasterization, in graph order. Cull bounds the screen radius
+// of every splat from its largest scale, so it never drops a splat that
+// reaches a tile; projection makes the exact decision.
+// SH colors and tile binning both follow projection and run side by side.
+// Pairs are scattered to their tiles in any order and every tile is sorted
+// by (depth, splat index) on its own, which gives the same order as a
+// stable global sort.
+// The blend plan turns the pair count of every tile into blend jobs while
+// the tiles are scattered and sorted: a tile heavier than its share of the
+// frame is split into bands of rows, and the jobs are ordered by cost,
+// largest first. Every worker then takes the next job of the plan until
+// none is left, so a hot tile no longer finishes long after the rest.
+enum SplatRasterStage {
+    SPLAT_RASTER_STAGE_CULL,
+    SPLAT_RASTER_STAGE_PROJECT,
+    SPLAT_RASTER_STAGE_SH,
+    SPLAT_RASTER_STAGE_BIN_COUNT,
+    SPLAT_RASTER_STAGE_BIN_SCAN,
+    SPLAT_RASTER_STAGE_BIN_SCATTER,
+    SPLAT_RASTER_STAGE_SORT,
+    SPLAT_RASTER_STAGE_BLEND_PLAN,
+    SPLAT_RASTER_STAGE_BLEND,
+    SPLAT_RASTER_NUM_STAGES
+};
+
+struct SplatRasterStats {
+    uint64_t mNumVisible;
+    uint64_t mNumTilePairs;
+    int64_t  mCullUs;
+    int64_t  mProjectUs;
+    int64_t  mShUs;
+    int64_t  mBinUs; // count, scan and scatter
+    int64_t  mSortUs;
+    int64_t  mBlendPlanUs; // overlaps the scatter and the sort
+    int64_t  mBlendUs;
+    // load balance of the blend, mBlendMaxThreadUs / mBlendMeanThreadUs is
+    // its imbalance, over the threads that blended any job
+    uint32_t mMaxTilePairs;
+    uint32_t mNumBlendJobs;
+    uint32_t mNumSplitTiles;
+    uint32_t mNumBlendThreads;
+    int64_t  mBlendMaxThreadUs;
+    int64_t  mBlendMeanThreadUs;
+    struct SplatJobStats mJobs;
+};
+
+struct SplatRasterizer {
+    uint32_t        mShDegree;
+    struct Tf32x3_s mBackground;
+    bool            mScalarProjection; // use splatProjectScalar instead of splatProjectSimd
+    bool            mTileOrderBlend;   // blend whole tiles in tile order instead of the balanced plan
+    // optional stored covariances of the rasterized splats, see splatCovariancesBuild
+    const struct SplatCovariances* pCovariances;
+
+    // ProfileToken of every SplatRasterStage, SPLAT_JOB_NO_PROFILE by default
+    uint64_t mProfileTokens[SPLAT_RASTER_NUM_STAGES];
+
+    // grow only scratch, reused between frames
+    struct SplatProjected*  pProjected;
+    uint32_t*               pVisible; // splats that pass the cull, stored at the start of their range
+    uint64_t                mProjectedCapacity;
+    uint32_t*               pRangeCounts; // culled, drawn and pair count of every range of splats
+    uint64_t                mRangeCapacity;
+    uint32_t*               pTileRanges; // numTiles + 1 offsets into pPairs
+    std::atomic<uint32_t>*  pTileCursors; // pair counts, then write cursors of the scatter
+    uint32_t                mTileRangesCapacity;
+    uint64_t*               pKeys; // depth bits in the high word, splat index in the low word, grouped by tile
+    uint32_t*               pValues; // splat index of every key
+    uint64_t                mPairsCapacity;
+    struct SplatSortScratch mSortScratch; // its key buffer is the per tile sort scratch
+    uint64_t*               pBlendJobs; // cost in the high word, largest first, tile and rows in the low word
+    uint64_t*               pBlendJobScratch;
+    uint64_t                mBlendJobsCapacity;
+
+    // graph of the last rasterization, holds the per stage timings
+    struct SplatJobGraph mGraph;
+
+    // linear RGB, rows top to bottom
+    float*   pImage;
+    uint32_t mImageWidth;
+    uint32_t mImageHeight;
+};
+
+void splatRasterizerInit(struct SplatRasterizer* rasterizer);
+void splatRasterizerExit(struct SplatRasterizer* rasterizer);
+
+// Name of the job graph stage, also used for its profiler scope.
+const char* splatRasterStageName(enum SplatRasterStage stage);
+
+// jobs may be NULL to rasterize on the calling thread.
+bool splatRasterize(struct SplatJobSystem* jobs, struct SplatRasterizer* rasterizer, const struct SplatCamera* camera, uint64_t numSplats,
+                    const struct SplatStreams* streams, struct SplatRasterStats* outStats);
@@ -0,0 +1,250 @@
+/*
+ * Copyright (c) 2017-2024 The Forge Interactive Inc.
+ *
+ * This file is part of The-Forge
+ * (see https://github.com/ConfettiFX/The-Forge).
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "SplatScene.h"
+
+#include <string.h>
+
+#include "Forge/TF_Log.h"
+#include "Forge/Core/TF_Time.h"
+
+#include "SplatCache.h"
+#include "SplatMorton.h"
+#include "SplatPly.h"
+#include "SplatProgressive.h"
+
+uint64_t splatSceneCacheHash(ResourceDirectory dir, const char* path, FileStream* fs, const struct SplatSceneDesc* desc) {
+    uint64_t hash = splatCacheHashSource(dir, path, fs);
+    if (desc->mPrune)
+        hash ^= splatPruneDescHash(&desc->mPruneDesc);
+    return hash;
+}
+
+static inline bool splatSceneCancelled(const std::atomic<bool>* cancel) { return cancel && cancel->load(std::memory_order_relaxed); }
+
+// Decodes the cache or the PLY behind fh into outScene->mStreams.
+static bool splatSceneDecode(ThreadSystem threadSystem, FileStream* fh, const char* path, const struct SplatSceneDesc* desc,
+                             struct SplatCache* cache, struct SplatScene* outScene) {
+    struct SplatLoadStats loadStats = {};
+    if (cache) {
+        outScene->mNumSplats = cache->mHeader.mNumSplats;
+        splatAllocStreams(&outScene->mStreams, outScene->mNumSplats);
+        if (!splatCacheRead(cache, &outScene->mStreams, &loadStats))
+            return false;
+        splatLogLoadStats("Splat cache load", &loadStats);
+        return true;
+    }
+
+    // binary files go through the chunked loader, anything else through the fallback
+    struct SplatPlyLayout* layout = (struct SplatPlyLayout*)splatMalloc(sizeof(struct SplatPlyLayout));
+    bool                   result = splatPlyReadLayout(fh, NULL, layout);
+    if (result) {
+        outScene->mNumSplats = layout->mNumVertices;
+        splatAllocStreams(&outScene->mStreams, outScene->mNumSplats);
+        if (splatPlyLoadMapped(threadSystem, fh, layout, &outScene->mStreams, &loadStats)) {
+            splatLogLoadStats("Splat PLY load (mapped)", &loadStats);
+        } else if (splatPlyLoad(threadSystem, fh, layout, &outScene->mStreams, &loadStats)) {
+            splatLogLoadStats("Splat PLY load", &loadStats);
+        } else {
+            LOGF(eERROR, "Failed to decode ply.");
+            result = false;
+        }
+    } else if (desc->pDecodeFallback) {
+        fsSeekStream(fh, SBO_START_OF_FILE, 0);
+        result = desc->pDecodeFallback(fh, &outScene->mStreams, &outScene->mNumSplats);
+    } else {
+        LOGF(eERROR, "Unsupported splat PLY layout in %s.", path);
+    }
+    splatFree(layout);
+    return result;
+}
+
+static bool splatSceneLoadImpl(ThreadSystem threadSystem, const char* path, const struct SplatSceneDesc* desc,
+                               const std::atomic<bool>* cancel, struct SplatScene* outScene) {
+    memset(outScene, 0, sizeof(struct SplatScene));
+    const int64_t startUs = getUSec(false);
+    FileStream    fh = {};
+    if (!fsOpenStreamFromPath(desc->mSourceDir, path, FM_READ, &fh)) {
+        LOGF(eERROR, "Failed to open splat scene %s.", path);
+        return false;
+    }
+
+    // a valid cache skips the PLY entirely
+    char cachePath[FS_MAX_PATH] = {};
+    splatCacheMakePath(path, cachePath, sizeof(cachePath));
+    const uint64_t    sourceHash = splatSceneCacheHash(desc->mSourceDir, path, &fh, desc);
+    struct SplatCache cache = {};
+    const bool        cacheHit = desc->mUseCache && splatCacheOpen(desc->mCacheDir, cachePath, sourceHash, &cache);
+    const uint32_t    cacheFlags = cacheHit ? cache.mHeader.mFlags : 0;
+    const bool        cacheProgressive = (cacheFlags & SPLAT_CACHE_FLAG_PROGRESSIVE_ORDER) != 0;
+    // a coarse to fine cache is Morton ordered per level only, it is sorted again when progressive order is off
+    const bool mortonReorder =
+        desc->mMortonOrder && (!(cacheFlags & SPLAT_CACHE_FLAG_MORTON_ORDER) || (cacheProgressive && !desc->mProgressiveOrder));
+    const bool progressiveReorder = desc->mProgressiveOrder && desc->mUseCache && (mortonReorder || !cacheProgressive);
+
+    bool result = splatSceneDecode(threadSystem, &fh, path, desc, cacheHit ? &cache : NULL, outScene);
+    if (cacheHit)
+        splatCacheClose(&cache);
+    fsCloseStream(&fh);
+    struct SplatStreams* streams = &outScene->mStreams;
+
+    // pruned before anything else looks at the splats, the cache stores the result
+    if (result && desc->mPrune && !cacheHit && !splatSceneCancelled(cancel)) {
+        struct SplatPruneStats pruneStats;
+        outScene->mNumSplats = splatPrune(threadSystem, &desc->mPruneDesc, streams, outScene->mNumSplats, &pruneStats);
+        splatShrinkStreams(streams, outScene->mNumSplats);
+        splatLogPruneStats(&pruneStats);
+    }
+
+    // reorder before the cache write and the compressed copy, so both keep the sorted order
+    const uint64_t numSplats = outScene->mNumSplats;
+    uint32_t       flags = cacheFlags;
+    if (result && mortonReorder && !splatSceneCancelled(cancel)) {
+        const int64_t mortonStartUs = getUSec(false);
+        if (splatMortonReorderStreams(threadSystem, streams, numSplats, desc->mMortonWideCodes)) {
+            flags = SPLAT_CACHE_FLAG_MORTON_ORDER;
+            LOGF(eINFO, "Splat Morton reorder: %llu splats in %.2f ms", (unsigned long long)numSplats,
+                 (getUSec(false) - mortonStartUs) / 1000.0);
+        }
+    }
+    if (result && progressiveReorder && numSplats <= UINT32_MAX && !splatSceneCancelled(cancel)) {
+        const int64_t orderStartUs = getUSec(false);
+        uint32_t*     order = (uint32_t*)splatMalloc(sizeof(uint32_t) * numSplats);
+        uint32_t      numLevels = 0;
+        splatProgressiveOrder(streams, numSplats, order, &numLevels);
+        splatPermuteStreams(threadSystem, streams, order, numSplats);
+        splatFree(order);
+        flags |= SPLAT_CACHE_FLAG_PROGRESSIVE_ORDER;
+        LOGF(eINFO, "Splat progressive order: %u levels in %.2f ms", numLevels, (getUSec(false) - orderStartUs) / 1000.0);
+    }
+
+    // a cache hit in another order is rewritten once sorted
+    if (result && desc->mUseCache && (!cacheHit || flags != cacheFlags) && !splatSceneCancelled(cancel))
+        splatCacheWrite(desc->mCacheDir, cachePath, sourceHash, numSplats, flags, streams);
+
+    if (result && desc->mQuality != SPLAT_QUALITY_NONE && !splatSceneCancelled(cancel)) {
+        struct SplatQuantizeDesc quantizeDesc = {};
+        splatQuantizeDescForQuality(desc->mQuality, &quantizeDesc);
+        if (splatQuantize(threadSystem, &quantizeDesc, numSplats, streams, &outScene->mQuantized)) {
+            struct SplatQuantizeReport quantizeReport = {};
+            splatQuantizeMeasure(&outScene->mQuantized, streams, &quantizeReport);
+            splatLogQuantizeReport(&quantizeReport);
+        }
+    }
+
+    if (result && desc->mLod && !splatSceneCancelled(cancel)) {
+        struct SplatLodBuildStats lodStats = {};
+        if (splatLodBuild(threadSystem, numSplats, streams, &outScene->mLod, &lodStats)) {
+            LOGF(eINFO, "Splat LOD: %llu merged nodes in %u levels, morton %.2f ms, merge %.2f ms",
+                 (unsigned long long)outScene->mLod.mNumMerged, outScene->mLod.mNumLevels, lodStats.mMortonUs / 1000.0f,
+                 lodStats.mMergeUs / 1000.0f);
+        }
+    }
+
+    if (result && desc->mBvh && !splatSceneCancelled(cancel)) {
+        struct SplatBvhBuildStats bvhStats = {};
+        splatBvhBuild(threadSystem, numSplats, streams, &outScene->mBvh, &bvhStats);
+        LOGF(eINFO, "Splat BVH: %llu nodes, morton %.2f ms, leaves %.2f ms, nodes %.2f ms", (unsigned long long)outScene->mBvh.mNumNodes,
+             bvhStats.mMortonUs / 1000.0f, bvhStats.mLeavesUs / 1000.0f, bvhStats.mNodesUs / 1000.0f);
+    }
+
+    // after every reorder, in the final order of the streams
+    if (result && desc->mCovarianceMode != SPLAT_COVARIANCE_ON_THE_FLY && !splatSceneCancelled(cancel)) {
+        const int64_t covarianceStartUs = getUSec(false);
+        if (splatCovariancesBuild(streams, numSplats, desc->mCovarianceMode, &outScene->mCovariances))
+            LOGF(eINFO, "Splat covariances: %.1f MB in %.2f ms",
+                 (double)splatCovarianceStride(desc->mCovarianceMode) * (double)numSplats / (1024.0 * 1024.0),
+                 (getUSec(false) - covarianceStartUs) / 1000.0);
+    }
+
+    if (!result || splatSceneCancelled(cancel)) {
+        splatSceneFree(outScene);
+        return false;
+    }
+    outScene->mDurationUs = getUSec(false) - startUs;
+    return true;
+}
+
+bool splatSceneLoad(ThreadSystem threadSystem, const char* path, const struct SplatSceneDesc* desc, struct SplatScene* outScene) {
+    return splatSceneLoadImpl(threadSystem, path, desc, NULL, outScene);
+}
+
+void splatSceneFree(struct SplatScene* scene) {
+    splatFreeStreams(&scene->mStreams);
+    splatLodFree(&scene->mLod);
+    splatQuantizedFree(&scene->mQuantized);
+    splatBvhFree(&scene->mBvh);
+    splatCovariancesFree(&scene->mCovariances);
+    memset(scene, 0, sizeof(struct SplatScene));
+}
+
+static void splatSceneLoadTask(void* user, uint64_t) {
+    struct SplatSceneLoader* loader = (struct SplatSceneLoader*)user;
+    // a task must not wait on its own thread system, every step runs inline
+    const bool result = splatSceneLoadImpl(NULL, loader->mPath, &loader->mDesc, &loader->mCancel, &loader->mScene);
+    loader->mFailed.store(!result, std::memory_order_relaxed);
+    loader->mFinished.store(true, std::memory_order_release);
+}
+
+void splatSceneLoaderStart(struct SplatSceneLoader* loader, ThreadSystem threadSystem, const char* path,
+                           const struct SplatSceneDesc* desc) {
+    strncpy(loader->mPath, path, sizeof(loader->mPath) - 1);
+    loader->mPath[sizeof(loader->mPath) - 1] = '\0';
+    loader->mDesc = *desc;
+    memset(&loader->mScene, 0, sizeof(struct SplatScene));
+    loader->mThreadSystem = threadSystem;
+    loader->mActive = true;
+    loader->mFailed.store(false, std::memory_order_relaxed);
+    loader->mCancel.store(false, std::memory_order_relaxed);
+    loader->mFinished.store(false, std::memory_order_release);
+    if (threadSystem)
+        threadSystemAddTask(threadSystem, splatSceneLoadTask, loader);
+    else
+        splatSceneLoadTask(loader, 0);
+}
+
+bool splatSceneLoaderFinished(const struct SplatSceneLoader* loader) {
+    return loader->mActive && loader->mFinished.load(std::memory_order_acquire);
+}
+
+bool splatSceneLoaderTake(struct SplatSceneLoader* loader, struct SplatScene* outScene) {
+    const bool result = splatSceneLoaderFinished(loader) && !loader->mFailed.load(std::memory_order_relaxed);
+    if (result)
+        *outScene = loader->mScene;
+    else
+        memset(outScene, 0, sizeof(struct SplatScene));
+    memset(&loader->mScene, 0, sizeof(struct SplatScene));
+    loader->mActive = false;
+    return result;
+}
+
+void splatSceneLoaderExit(struct SplatSceneLoader* loader) {
+    if (!loader->mActive)
+        return;
+    loader->mCancel.store(true, std::memory_order_relaxed);
+    if (loader->mThreadSystem && !loader->mFinished.load(std::memory_order_acquire))
+        threadSystemWaitIdle(loader->mThreadSystem);
+    splatSceneFree(&loader->mScene);
+    loader->mActive = false;
+}
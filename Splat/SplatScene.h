@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2017-2024 The Forge Interactive Inc.
+ *
+ * This file is part of The-Forge
+ * (see https://github.com/ConfettiFX/The-Forge).
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+
+#include "Forge/TF_FileSystem.h"
+#include "Common_3/Utilities/Threading/ThreadSystem.h"
+
+#include "SplatBvh.h"
+#include "SplatCovariance.h"
+#include "SplatLod.h"
+#include "SplatPrune.h"
+#include "SplatQuantize.h"
+
+// CPU side of loading a scene: the splat cache or the PLY is decoded into
+// system memory and everything the renderer derives from the splats is
+// built, pruning, Morton and coarse to fine order, the cache for the next
+// launch, the compressed copy, the LOD hierarchy, the BVH and the stored
+// covariances.
+
+// Decodes a file splatPlyReadLayout rejects, fh is at its start. Allocates
+// outStreams with splatAllocStreams.
+typedef bool (*SplatSceneDecodeFunc)(FileStream* fh, struct SplatStreams* outStreams, uint64_t* outNumSplats);
+
+struct SplatSceneDesc {
+    ResourceDirectory     mSourceDir;
+    ResourceDirectory     mCacheDir;
+    bool                  mUseCache;         // read a matching cache, write one after a PLY load
+    bool                  mPrune;            // with mPruneDesc, skipped on a cache hit
+    bool                  mMortonOrder;
+    bool                  mMortonWideCodes;
+    bool                  mProgressiveOrder; // coarse to fine cache for progressive loading, needs mUseCache
+    bool                  mLod;
+    bool                  mBvh;
+    uint32_t              mQuality;          // SplatQuality of the compressed copy
+    uint32_t              mCovarianceMode;   // SplatCovarianceMode of mCovariances
+    struct SplatPruneDesc mPruneDesc;
+    SplatSceneDecodeFunc  pDecodeFallback;   // optional
+};
+
+// Everything a loaded scene owns in system memory.
+struct SplatScene {
+    struct SplatStreams     mStreams;
+    uint64_t                mNumSplats;
+    struct SplatLod         mLod;         // when mLod was set and the build succeeded
+    struct SplatQuantized   mQuantized;   // when mQuality is not SPLAT_QUALITY_NONE
+    struct SplatBvh         mBvh;         // when mBvh was set
+    struct SplatCovariances mCovariances; // empty with SPLAT_COVARIANCE_ON_THE_FLY
+    int64_t                 mDurationUs;
+};
+
+// Hash a splat cache of the PLY in fs, opened from path in dir, has to match,
+// covers the pruning thresholds. Rewinds fs.
+uint64_t splatSceneCacheHash(ResourceDirectory dir, const char* path, FileStream* fs, const struct SplatSceneDesc* desc);
+
+// Loads path from mSourceDir into outScene. threadSystem may be NULL to run
+// inline, it must be NULL on a task of the thread system.
+bool splatSceneLoad(ThreadSystem threadSystem, const char* path, const struct SplatSceneDesc* desc, struct SplatScene* outScene);
+void splatSceneFree(struct SplatScene* scene);
+
+// Runs splatSceneLoad on one task of the thread system, so a renderer can
+// keep drawing its current scene while the next one loads. The task works
+// inline and never waits on the thread system.
+struct SplatSceneLoader {
+    char                  mPath[FS_MAX_PATH];
+    struct SplatSceneDesc mDesc;
+    struct SplatScene     mScene; // valid once finished without failing
+    ThreadSystem          mThreadSystem;
+    std::atomic<bool>     mFinished;
+    std::atomic<bool>     mFailed;
+    std::atomic<bool>     mCancel;
+    bool                  mActive;
+};
+
+void splatSceneLoaderStart(struct SplatSceneLoader* loader, ThreadSystem threadSystem, const char* path, const struct SplatSceneDesc* desc);
+bool splatSceneLoaderFinished(const struct SplatSceneLoader* loader);
+// Moves the loaded scene to outScene and makes the loader idle. Returns false
+// when the load failed or was cancelled, outScene is then cleared.
+bool splatSceneLoaderTake(struct SplatSceneLoader* loader, struct SplatScene* outScene);
+// Cancels a load in flight, waits for it and frees a scene nobody took.
+void splatSceneLoaderExit(struct SplatSceneLoader* loader);
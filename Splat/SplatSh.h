@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2017-2024 The Forge Interactive Inc.
+ *
+ * This file is part of The-Forge
+ * (see https://github.com/ConfettiFX/The-Forge).
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#pragma once
+
+#include "Splat.h"
+
+// Real spherical harmonics basis used by 3D Gaussian splatting, degree 0 to 3.
+#define SPLAT_SH_C0 0.28209479177387814f
+#define SPLAT_SH_C1 0.4886025119029199f
+#define SPLAT_SH_MAX_DEGREE 3
+
+static const float gSplatShC2[5] = { 1.0925484305920792f, -1.0925484305920792f, 0.31539156525252005f, -1.0925484305920792f,
+                                     0.5462742152960396f };
+static const float gSplatShC3[7] = { -0.5900435899266435f, 2.890611442640554f, -0.4570457994644658f, 0.3731763325901154f,
+                                     -0.4570457994644658f, 1.445305721320277f,  -0.5900435899266435f };
+
+// Number of rest coefficients per channel used by a degree.
+static inline uint32_t splatShRestCount(uint32_t degree) { return (degree + 1) * (degree + 1) - 1; }
+
+// Evaluates the RGB color of a splat seen along dir (unit vector from the
+// camera to the splat). Follows the reference implementation: 0.5 is added
+// and the result is clamped at 0.
+static inline struct Tf32x3_s splatEvalSh(uint32_t degree, const struct SphericalHarmonics* sh, struct Tf32x3_s dir) {
+    const float x = dir.x, y = dir.y, z = dir.z;
+    float       basis[16];
+    basis[0] = SPLAT_SH_C0;
+    if (degree > 0) {
+        basis[1] = -SPLAT_SH_C1 * y;
+        basis[2] = SPLAT_SH_C1 * z;
+        basis[3] = -SPLAT_SH_C1 * x;
+    }
+    if (degree > 1) {
+        const float xx = x * x, yy = y * y, zz = z * z;
+        basis[4] = gSplatShC2[0] * x * y;
+        basis[5] = gSplatShC2[1] * y * z;
+        basis[6] = gSplatShC2[2] * (2.0f * zz - xx - yy);
+        basis[7] = gSplatShC2[3] * x * z;
+        basis[8] = gSplatShC2[4] * (xx - yy);
+        if (degree > 2) {
+            basis[9] = gSplatShC3[0] * y * (3.0f * xx - yy);
+            basis[10] = gSplatShC3[1] * x * y * z;
+            basis[11] = gSplatShC3[2] * y * (4.0f * zz - xx - yy);
+            basis[12] = gSplatShC3[3] * z * (2.0f * zz - 3.0f * xx - 3.0f * yy);
+            basis[13] = gSplatShC3[4] * x * (4.0f * zz - xx - yy);
+            basis[14] = gSplatShC3[5] * z * (xx - yy);
+            basis[15] = gSplatShC3[6] * x * (xx - 3.0f * yy);
+        }
+    }
+
+    const uint32_t  numRest = splatShRestCount(degree > SPLAT_SH_MAX_DEGREE ? SPLAT_SH_MAX_DEGREE : degree);
+    struct Tf32x3_s color;
+    for (uint32_t c = 0; c < 3; c++) {
+        // rest coefficients are channel major, see SphericalHarmonics
+        float value = basis[0] * sh->dc.v[c];
+        for (uint32_t k = 0; k < numRest; k++)
+            value += basis[k + 1] * sh->rest[c * 15 + k];
+        value += 0.5f;
+        color.v[c] = value > 0.0f ? value : 0.0f;
+    }
+    return color;
+}
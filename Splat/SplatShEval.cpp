@@ -0,0 +1,247 @@
+/*
+ * Copyright (c) 2017-2024 The Forge Interactive Inc.
+ *
+ * This file is part of The-Forge
+ * (see https://github.com/ConfettiFX/The-Forge).
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include "SplatShEval.h"
+
+#include <atomic>
+#include <math.h>
+#include <string.h>
+
+#include "Forge/Core/TF_Time.h"
+#include "Forge/Math/TF_Simd32x4.h"
+
+// Colors of four splats, dx/dy/dz are the unnormalized directions from the
+// eye. Lanes with a zero direction get a zero basis above degree 0.
+static void splatEvalSh4(uint32_t degree, const struct SphericalHarmonics* const sh[4], Tsimd_f32x4_t dx, Tsimd_f32x4_t dy,
+                         Tsimd_f32x4_t dz, struct Tf32x3_s* const out[4]) {
+    Tsimd_f32x4_t basis[16];
+    basis[0] = tfSimdSplat_f32x4(SPLAT_SH_C0);
+    if (degree > 0) {
+        const Tsimd_f32x4_t lenSq = tfSimdAdd_f32x4(tfSimdAdd_f32x4(tfSimdMul_f32x4(dx, dx), tfSimdMul_f32x4(dy, dy)),
+                                                    tfSimdMul_f32x4(dz, dz));
+        const Tsimd_f32x4_t inv =
+            tfSimdDiv_f32x4(tfSimdSplat_f32x4(1.0f), tfSimdSqrt_f32x4(tfSimdMaxPerElem_f32x4(lenSq, tfSimdSplat_f32x4(1e-30f))));
+        const Tsimd_f32x4_t x = tfSimdMul_f32x4(dx, inv), y = tfSimdMul_f32x4(dy, inv), z = tfSimdMul_f32x4(dz, inv);
+        const Tsimd_f32x4_t c1 = tfSimdSplat_f32x4(SPLAT_SH_C1);
+        const Tsimd_f32x4_t zero = tfSimdSplat_f32x4(0.0f);
+        basis[1] = tfSimdSub_f32x4(zero, tfSimdMul_f32x4(c1, y));
+        basis[2] = tfSimdMul_f32x4(c1, z);
+        basis[3] = tfSimdSub_f32x4(zero, tfSimdMul_f32x4(c1, x));
+        if (degree > 1) {
+            const Tsimd_f32x4_t xx = tfSimdMul_f32x4(x, x), yy = tfSimdMul_f32x4(y, y), zz = tfSimdMul_f32x4(z, z);
+            const Tsimd_f32x4_t xy = tfSimdMul_f32x4(x, y), yz = tfSimdMul_f32x4(y, z), xz = tfSimdMul_f32x4(x, z);
+            const Tsimd_f32x4_t xxPlusYy = tfSimdAdd_f32x4(xx, yy);
+            basis[4] = tfSimdMul_f32x4(tfSimdSplat_f32x4(gSplatShC2[0]), xy);
+            basis[5] = tfSimdMul_f32x4(tfSimdSplat_f32x4(gSplatShC2[1]), yz);
+            basis[6] = tfSimdMul_f32x4(tfSimdSplat_f32x4(gSplatShC2[2]), tfSimdSub_f32x4(tfSimdAdd_f32x4(zz, zz), xxPlusYy));
+            basis[7] = tfSimdMul_f32x4(tfSimdSplat_f32x4(gSplatShC2[3]), xz);
+            basis[8] = tfSimdMul_f32x4(tfSimdSplat_f32x4(gSplatShC2[4]), tfSimdSub_f32x4(xx, yy));
+            if (degree > 2) {
+                const Tsimd_f32x4_t three = tfSimdSplat_f32x4(3.0f);
+                const Tsimd_f32x4_t four = tfSimdSplat_f32x4(4.0f);
+                const Tsimd_f32x4_t fourZzMinus = tfSimdSub_f32x4(tfSimdMul_f32x4(four, zz), xxPlusYy);
+                basis[9] = tfSimdMul_f32x4(tfSimdSplat_f32x4(gSplatShC3[0]),
+                                           tfSimdMul_f32x4(y, tfSimdSub_f32x4(tfSimdMul_f32x4(three, xx), yy)));
+                basis[10] = tfSimdMul_f32x4(tfSimdSplat_f32x4(gSplatShC3[1]), tfSimdMul_f32x4(xy, z));
+                basis[11] = tfSimdMul_f32x4(tfSimdSplat_f32x4(gSplatShC3[2]), tfSimdMul_f32x4(y, fourZzMinus));
+                basis[12] = tfSimdMul_f32x4(tfSimdSplat_f32x4(gSplatShC3[3]),
+                                            tfSimdMul_f32x4(z, tfSimdSub_f32x4(tfSimdAdd_f32x4(zz, zz), tfSimdMul_f32x4(three, xxPlusYy))));
+                basis[13] = tfSimdMul_f32x4(tfSimdSplat_f32x4(gSplatShC3[4]), tfSimdMul_f32x4(x, fourZzMinus));
+                basis[14] = tfSimdMul_f32x4(tfSimdSplat_f32x4(gSplatShC3[5]), tfSimdMul_f32x4(z, tfSimdSub_f32x4(xx, yy)));
+                basis[15] = tfSimdMul_f32x4(tfSimdSplat_f32x4(gSplatShC3[6]),
+                                            tfSimdMul_f32x4(x, tfSimdSub_f32x4(xx, tfSimdMul_f32x4(three, yy))));
+            }
+        }
+    }
+
+    const uint32_t numRest = splatShRestCount(degree);
+    const Tsimd_f32x4_t half = tfSimdSplat_f32x4(0.5f);
+    const Tsimd_f32x4_t zero = tfSimdSplat_f32x4(0.0f);
+    for (uint32_t c = 0; c < 3; c++) {
+        Tsimd_f32x4_t value = tfSimdMul_f32x4(basis[0], tfSimdLoad_f32x4(sh[0]->dc.v[c], sh[1]->dc.v[c], sh[2]->dc.v[c], sh[3]->dc.v[c]));
+        for (uint32_t k = 0; k < numRest; k++) {
+            const uint32_t j = c * 15 + k;
+            value = tfSimdAdd_f32x4(value,
+                                    tfSimdMul_f32x4(basis[k + 1],
+                                                    tfSimdLoad_f32x4(sh[0]->rest[j], sh[1]->rest[j], sh[2]->rest[j], sh[3]->rest[j])));
+        }
+        float lanes[4];
+        const Tsimd_f32x4_t clamped = tfSimdMaxPerElem_f32x4(tfSimdAdd_f32x4(value, half), zero);
+        memcpy(lanes, &clamped, sizeof(lanes));
+        for (uint32_t lane = 0; lane < 4; lane++)
+            out[lane]->v[c] = lanes[lane];
+    }
+}
+
+void splatEvalShBatch(uint32_t degree, const struct Tf32x3_s* positions, const struct SphericalHarmonics* shs, uint64_t count,
+                      struct Tf32x3_s eye, struct Tf32x3_s* outColors) {
+    if (degree > SPLAT_SH_MAX_DEGREE)
+        degree = SPLAT_SH_MAX_DEGREE;
+
+    const Tsimd_f32x4_t eyeX = tfSimdSplat_f32x4(eye.x);
+    const Tsimd_f32x4_t eyeY = tfSimdSplat_f32x4(eye.y);
+    const Tsimd_f32x4_t eyeZ = tfSimdSplat_f32x4(eye.z);
+    const uint64_t      numBatches = count / 4;
+    for (uint64_t batch = 0; batch < numBatches; batch++) {
+        const uint64_t                         base = batch * 4;
+        const struct Tf32x3_s*                 p = &positions[base];
+        const struct SphericalHarmonics* const sh[4] = { &shs[base], &shs[base + 1], &shs[base + 2], &shs[base + 3] };
+        struct Tf32x3_s* const out[4] = { &outColors[base], &outColors[base + 1], &outColors[base + 2], &outColors[base + 3] };
+        // degree 0 does not depend on the direction, skip the position loads
+        if (degree == 0) {
+            const Tsimd_f32x4_t zero = tfSimdSplat_f32x4(0.0f);
+            splatEvalSh4(0, sh, zero, zero, zero, out);
+            continue;
+        }
+        const Tsimd_f32x4_t dx = tfSimdSub_f32x4(tfSimdLoad_f32x4(p[0].x, p[1].x, p[2].x, p[3].x), eyeX);
+        const Tsimd_f32x4_t dy = tfSimdSub_f32x4(tfSimdLoad_f32x4(p[0].y, p[1].y, p[2].y, p[3].y), eyeY);
+        const Tsimd_f32x4_t dz = tfSimdSub_f32x4(tfSimdLoad_f32x4(p[0].z, p[1].z, p[2].z, p[3].z), eyeZ);
+        splatEvalSh4(degree, sh, dx, dy, dz, out);
+    }
+
+    for (uint64_t i = numBatches * 4; i < count; i++) {
+        struct Tf32x3_s dir = { 0.0f, 0.0f, 0.0f };
+        if (degree > 0) {
+            dir = { positions[i].x - eye.x, positions[i].y - eye.y, positions[i].z - eye.z };
+            const float len = sqrtf(dir.x * dir.x + dir.y * dir.y + dir.z * dir.z);
+            const float inv = len > 0.0f ? 1.0f / len : 0.0f;
+            dir = { dir.x * inv, dir.y * inv, dir.z * inv };
+        }
+        outColors[i] = splatEvalSh(degree, &shs[i], dir);
+    }
+}
+
+void splatShCacheInit(struct SplatShCache* cache, const struct Tf32x3_s* positions, uint64_t numSplats) {
+    memset(cache, 0, sizeof(struct SplatShCache));
+    cache->mNumSplats = numSplats;
+    cache->mNumClusters = (numSplats + SPLAT_SH_CLUSTER_SIZE - 1) / SPLAT_SH_CLUSTER_SIZE;
+    cache->pBounds = (struct Tf32x4_s*)splatMalloc(sizeof(struct Tf32x4_s) * (cache->mNumClusters ? cache->mNumClusters : 1));
+    cache->pEyes = (struct Tf32x3_s*)splatMalloc(sizeof(struct Tf32x3_s) * (cache->mNumClusters ? cache->mNumClusters : 1));
+    cache->pEvalFrames = (uint64_t*)splatCalloc(cache->mNumClusters ? cache->mNumClusters : 1, sizeof(uint64_t));
+
+    for (uint64_t cluster = 0; cluster < cache->mNumClusters; cluster++) {
+        const uint64_t first = cluster * SPLAT_SH_CLUSTER_SIZE;
+        const uint64_t last = first + SPLAT_SH_CLUSTER_SIZE < numSplats ? first + SPLAT_SH_CLUSTER_SIZE : numSplats;
+        struct Tf32x3_s lo = positions[first], hi = positions[first];
+        for (uint64_t i = first + 1; i < last; i++) {
+            for (uint32_t c = 0; c < 3; c++) {
+                lo.v[c] = positions[i].v[c] < lo.v[c] ? positions[i].v[c] : lo.v[c];
+                hi.v[c] = positions[i].v[c] > hi.v[c] ? positions[i].v[c] : hi.v[c];
+            }
+        }
+        const float ex = 0.5f * (hi.x - lo.x), ey = 0.5f * (hi.y - lo.y), ez = 0.5f * (hi.z - lo.z);
+        cache->pBounds[cluster] = { lo.x + ex, lo.y + ey, lo.z + ez, sqrtf(ex * ex + ey * ey + ez * ez) };
+    }
+}
+
+void splatShCacheExit(struct SplatShCache* cache) {
+    splatFree(cache->pBounds);
+    splatFree(cache->pEyes);
+    splatFree(cache->pEvalFrames);
+    memset(cache, 0, sizeof(struct SplatShCache));
+}
+
+void splatShCacheInvalidate(struct SplatShCache* cache) {
+    if (cache->pEvalFrames)
+        memset(cache->pEvalFrames, 0, sizeof(uint64_t) * cache->mNumClusters);
+}
+
+static void splatShCachedRange(void* user, uint64_t begin, uint64_t end) {
+    struct SplatShCachedJob* ctx = (struct SplatShCachedJob*)user;
+    struct SplatShCache*     cache = ctx->pCache;
+    const struct Tf32x3_s    eye = ctx->mEye;
+    uint64_t                 numEvaluated = 0;
+    for (uint64_t cluster = begin; cluster < end; cluster++) {
+        if (cache->pEvalFrames[cluster] && !ctx->mDegreeChanged) {
+            // degree 0 colors never depend on the eye
+            if (ctx->mDegree == 0)
+                continue;
+            // the direction to a splat turns by at most asin(moved / distance), distance being
+            // at least the distance to the cluster bounds
+            const struct Tf32x4_s bounds = cache->pBounds[cluster];
+            const struct Tf32x3_s last = cache->pEyes[cluster];
+            const float cx = bounds.x - eye.x, cy = bounds.y - eye.y, cz = bounds.z - eye.z;
+            const float mx = eye.x - last.x, my = eye.y - last.y, mz = eye.z - last.z;
+            const float distance = sqrtf(cx * cx + cy * cy + cz * cz) - bounds.w;
+            if (distance > 0.0f && sqrtf(mx * mx + my * my + mz * mz) <= ctx->mMaxAngle * distance)
+                continue;
+        }
+
+        const uint64_t first = cluster * SPLAT_SH_CLUSTER_SIZE;
+        const uint64_t last = first + SPLAT_SH_CLUSTER_SIZE < cache->mNumSplats ? first + SPLAT_SH_CLUSTER_SIZE : cache->mNumSplats;
+        splatEvalShBatch(ctx->mDegree, &ctx->pStreams->pPositions[first], &ctx->pStreams->pShs[first], last - first, eye,
+                         &ctx->pColors[first]);
+        cache->pEyes[cluster] = eye;
+        cache->pEvalFrames[cluster] = cache->mFrame;
+        numEvaluated++;
+    }
+    ctx->mNumEvaluated += numEvaluated;
+}
+
+// Stamps the cache when the evaluation starts, returns the cluster count.
+static uint64_t splatShCachedBegin(void* user) {
+    struct SplatShCachedJob* job = (struct SplatShCachedJob*)user;
+    job->mStartUs = getUSec(false);
+    job->mDegreeChanged = job->mDegree != job->pCache->mDegree;
+    job->mNumEvaluated = 0;
+    job->mFrame = ++job->pCache->mFrame;
+    return job->pCache->mNumClusters;
+}
+
+static void splatShCachedEnd(void* user, uint64_t, uint64_t) {
+    struct SplatShCachedJob* job = (struct SplatShCachedJob*)user;
+    job->pCache->mDegree = job->mDegree;
+    job->mStats.mNumEvaluated = job->mNumEvaluated;
+    job->mStats.mNumSkipped = job->pCache->mNumClusters - job->mStats.mNumEvaluated;
+    job->mStats.mDurationUs = getUSec(false) - job->mStartUs;
+}
+
+static void splatShCachedJobInit(struct SplatShCachedJob* job, struct SplatShCache* cache, uint32_t degree,
+                                 const struct SplatStreams* streams, struct Tf32x3_s eye, float maxAngle, struct Tf32x3_s* colors) {
+    job->pCache = cache;
+    job->pStreams = streams;
+    job->pColors = colors;
+    job->mEye = eye;
+    job->mMaxAngle = maxAngle;
+    job->mDegree = degree > SPLAT_SH_MAX_DEGREE ? SPLAT_SH_MAX_DEGREE : degree;
+}
+
+uint64_t splatEvalShCached(ThreadSystem threadSystem, struct SplatShCache* cache, uint32_t degree, const struct SplatStreams* streams,
+                           struct Tf32x3_s eye, float maxAngle, struct Tf32x3_s* colors, struct SplatShEvalStats* outStats) {
+    struct SplatShCachedJob job;
+    splatShCachedJobInit(&job, cache, degree, streams, eye, maxAngle, colors);
+    splatParallelFor(threadSystem, splatShCachedBegin(&job), 64, splatShCachedRange, &job);
+    splatShCachedEnd(&job, 0, 1);
+    if (outStats)
+        *outStats = job.mStats;
+    return job.mFrame;
+}
+
+uint32_t splatEvalShCachedStages(struct SplatJobGraph* graph, struct SplatShCachedJob* job, struct SplatShCache* cache, uint32_t degree,
+                                 const struct SplatStreams* streams, struct Tf32x3_s eye, float maxAngle, struct Tf32x3_s* colors) {
+    splatShCachedJobInit(job, cache, degree, streams, eye, maxAngle, colors);
+    const uint32_t eval = splatJobGraphAddDeferredStage(graph, "SH Eval", splatShCachedBegin, 64, splatShCachedRange, job);
+    const uint32_t end = splatJobGraphAddStage(graph, "SH Eval Stats", 1, 1, splatShCachedEnd, job);
+    splatJobGraphAddDependency(graph, end, eval);
+    return end;
+}
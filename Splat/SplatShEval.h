@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2017-2024 The Forge Interactive Inc.
+ *
+ * This file is part of The-Forge
+ * (see https://github.com/ConfettiFX/The-Forge).
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#pragma once
+
+#include "Splat.h"
+#include "SplatJobs.h"
+#include "SplatSh.h"
+
+// Batched view dependent color: evaluates the spherical harmonics of many
+// splats for one eye position, four splats per SIMD lane group. The result
+// matches splatEvalSh up to float rounding. Degree 0 only reads the dc term.
+//
+// The cache splits the splats into clusters of SPLAT_SH_CLUSTER_SIZE
+// consecutive splats (spatially coherent once the streams are Morton
+// ordered) and only re-evaluates a cluster when the direction from the eye
+// to any of its splats may have turned by more than a threshold angle since
+// its last evaluation.
+
+#define SPLAT_SH_CLUSTER_SIZE 64
+
+// Writes the colors of count splats seen from eye. degree is clamped to
+// SPLAT_SH_MAX_DEGREE.
+void splatEvalShBatch(uint32_t degree, const struct Tf32x3_s* positions, const struct SphericalHarmonics* shs, uint64_t count,
+                      struct Tf32x3_s eye, struct Tf32x3_s* outColors);
+
+struct SplatShCache {
+    uint64_t         mNumSplats;
+    uint64_t         mNumClusters;
+    uint64_t         mFrame;      // stamp of the last splatEvalShCached call
+    uint32_t         mDegree;     // degree of the cached colors
+    struct Tf32x4_s* pBounds;     // cluster center and radius
+    struct Tf32x3_s* pEyes;       // eye of the last evaluation per cluster
+    uint64_t*        pEvalFrames; // stamp of the last evaluation per cluster, 0 for never
+};
+
+struct SplatShEvalStats {
+    uint64_t mNumEvaluated; // clusters
+    uint64_t mNumSkipped;   // clusters
+    int64_t  mDurationUs;
+};
+
+// Computes the cluster bounds of numSplats positions.
+void splatShCacheInit(struct SplatShCache* cache, const struct Tf32x3_s* positions, uint64_t numSplats);
+void splatShCacheExit(struct SplatShCache* cache);
+// Forces the next evaluation to cover every cluster.
+void splatShCacheInvalidate(struct SplatShCache* cache);
+
+// Updates colors (one per splat of the cache) for eye. A cluster is kept
+// when the eye moved less than maxAngle radians as seen from the nearest
+// point of its bounds, a change of degree evaluates all clusters. Clusters
+// evaluated by this call get pEvalFrames set to the returned stamp, so a
+// caller mirroring colors elsewhere can copy only what changed since the
+// stamp it last copied. outStats is optional.
+uint64_t splatEvalShCached(ThreadSystem threadSystem, struct SplatShCache* cache, uint32_t degree, const struct SplatStreams* streams,
+                           struct Tf32x3_s eye, float maxAngle, struct Tf32x3_s* colors, struct SplatShEvalStats* outStats);
+
+// State of a cached evaluation that runs as stages of a job graph. It has to
+// live until the graph ran.
+struct SplatShCachedJob {
+    struct SplatShCache*       pCache;
+    const struct SplatStreams* pStreams;
+    struct Tf32x3_s*           pColors;
+    struct Tf32x3_s            mEye;
+    float                      mMaxAngle;
+    uint32_t                   mDegree;
+    bool                       mDegreeChanged;
+    int64_t                    mStartUs;
+    std::atomic<uint64_t>      mNumEvaluated;
+    uint64_t                   mFrame; // the stamp splatEvalShCached would return, once the graph ran
+    struct SplatShEvalStats    mStats;
+};
+
+// Adds splatEvalShCached to graph as an evaluation stage and a stage that
+// finishes the stats, returns the latter. The cache is stamped when the
+// evaluation stage starts.
+uint32_t splatEvalShCachedStages(struct SplatJobGraph* graph, struct SplatShCachedJob* job, struct SplatShCache* cache, uint32_t degree,
+                                 const struct SplatStreams* streams, struct Tf32x3_s eye, float maxAngle, struct Tf32x3_s* colors);
@@ -0,0 +1,206 @@
+/*
+ * Copyright (c) 2017-2024 The Forge Interactive Inc.
+ *
+ * This file is part of The-Forge
+ * (see https://github.com/ConfettiFX/The-Forge).
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#include "SplatSort.h"
+
+#include <string.h>
+
+#include "Forge/Core/TF_Time.h"
+
+// smaller inputs are not worth splitting across threads
+static const uint64_t gSplatSortMinBlockSize = 1 << 16;
+
+void splatSortScratchInit(struct SplatSortScratch* scratch) { memset(scratch, 0, sizeof(struct SplatSortScratch)); }
+
+void splatSortScratchExit(struct SplatSortScratch* scratch) {
+    splatFree(scratch->pKeys);
+    splatFree(scratch->pValues);
+    splatFree(scratch->pHistograms);
+    memset(scratch, 0, sizeof(struct SplatSortScratch));
+}
+
+void splatSortScratchReserve(struct SplatSortScratch* scratch, uint64_t count) {
+    if (!scratch->pHistograms)
+        scratch->pHistograms =
+            (uint32_t*)splatMalloc(sizeof(uint32_t) * SPLAT_SORT_MAX_BLOCKS * SPLAT_SORT_NUM_DIGITS * SPLAT_SORT_RADIX);
+    if (scratch->mCapacity >= count)
+        return;
+    // grow with some headroom, the pair count changes a little every frame
+    const uint64_t capacity = count + count / 4;
+    splatFree(scratch->pKeys);
+    splatFree(scratch->pValues);
+    scratch->pKeys = (uint64_t*)splatMalloc(sizeof(uint64_t) * capacity);
+    scratch->pValues = (uint32_t*)splatMalloc(sizeof(uint32_t) * capacity);
+    scratch->mCapacity = capacity;
+}
+
+struct SplatSortContext {
+    const uint64_t* pSrcKeys;
+    const uint32_t* pSrcValues;
+    uint64_t*       pDstKeys;
+    uint32_t*       pDstValues;
+    uint32_t*       pHistograms;
+    uint64_t        mCount;
+    uint64_t        mBlockSize;
+    uint32_t        mShift;
+};
+
+static inline uint32_t* splatSortHistogram(const struct SplatSortContext* ctx, uint64_t block, uint32_t digit) {
+    return &ctx->pHistograms[(block * SPLAT_SORT_NUM_DIGITS + digit) * SPLAT_SORT_RADIX];
+}
+
+// Counts every digit of the keys of one block in a single read. The totals
+// tell which passes can be skipped, the per block counts are valid for the
+// first pass only.
+static void splatSortCountBlocks(void* user, uint64_t begin, uint64_t end) {
+    const struct SplatSortContext* ctx = (const struct SplatSortContext*)user;
+    for (uint64_t block = begin; block < end; block++) {
+        uint32_t* histograms = splatSortHistogram(ctx, block, 0);
+        memset(histograms, 0, sizeof(uint32_t) * SPLAT_SORT_NUM_DIGITS * SPLAT_SORT_RADIX);
+        const uint64_t first = block * ctx->mBlockSize;
+        const uint64_t last = first + ctx->mBlockSize < ctx->mCount ? first + ctx->mBlockSize : ctx->mCount;
+        for (uint64_t i = first; i < last; i++) {
+            const uint64_t key = ctx->pSrcKeys[i];
+            for (uint32_t digit = 0; digit < SPLAT_SORT_NUM_DIGITS; digit++)
+                histograms[digit * SPLAT_SORT_RADIX + ((key >> (digit * SPLAT_SORT_RADIX_BITS)) & (SPLAT_SORT_RADIX - 1))]++;
+        }
+    }
+}
+
+// Recounts the current digit of one block, needed from the second pass on
+// since earlier passes moved keys between blocks.
+static void splatSortCountDigitBlocks(void* user, uint64_t begin, uint64_t end) {
+    const struct SplatSortContext* ctx = (const struct SplatSortContext*)user;
+    for (uint64_t block = begin; block < end; block++) {
+        uint32_t* histogram = splatSortHistogram(ctx, block, ctx->mShift / SPLAT_SORT_RADIX_BITS);
+        memset(histogram, 0, sizeof(uint32_t) * SPLAT_SORT_RADIX);
+        const uint64_t first = block * ctx->mBlockSize;
+        const uint64_t last = first + ctx->mBlockSize < ctx->mCount ? first + ctx->mBlockSize : ctx->mCount;
+        for (uint64_t i = first; i < last; i++)
+            histogram[(ctx->pSrcKeys[i] >> ctx->mShift) & (SPLAT_SORT_RADIX - 1)]++;
+    }
+}
+
+// Scatters one block, its histogram of the current digit was turned into
+// output offsets by the caller.
+static void splatSortScatterBlocks(void* user, uint64_t begin, uint64_t end) {
+    const struct SplatSortContext* ctx = (const struct SplatSortContext*)user;
+    for (uint64_t block = begin; block < end; block++) {
+        uint32_t*      offsets = splatSortHistogram(ctx, block, ctx->mShift / SPLAT_SORT_RADIX_BITS);
+        const uint64_t first = block * ctx->mBlockSize;
+        const uint64_t last = first + ctx->mBlockSize < ctx->mCount ? first + ctx->mBlockSize : ctx->mCount;
+        for (uint64_t i = first; i < last; i++) {
+            const uint64_t key = ctx->pSrcKeys[i];
+            const uint32_t dst = offsets[(key >> ctx->mShift) & (SPLAT_SORT_RADIX - 1)]++;
+            ctx->pDstKeys[dst] = key;
+            ctx->pDstValues[dst] = ctx->pSrcValues[i];
+        }
+    }
+}
+
+void splatRadixSort(ThreadSystem threadSystem, struct SplatSortScratch* scratch, uint64_t* keys, uint32_t* values, uint64_t count,
+                    struct SplatSortStats* outStats) {
+    const int64_t         startUs = getUSec(false);
+    struct SplatSortStats stats = {};
+    if (count < 2 || count > UINT32_MAX) {
+        if (outStats)
+            *outStats = stats;
+        return;
+    }
+
+    const uint64_t oldCapacity = scratch->mCapacity;
+    splatSortScratchReserve(scratch, count);
+    stats.mNumAllocations = scratch->mCapacity != oldCapacity ? 1 : 0;
+
+    uint64_t numBlocks = threadSystem ? getNumCPUCores() : 1;
+    if (numBlocks > SPLAT_SORT_MAX_BLOCKS)
+        numBlocks = SPLAT_SORT_MAX_BLOCKS;
+    if (numBlocks > (count + gSplatSortMinBlockSize - 1) / gSplatSortMinBlockSize)
+        numBlocks = (count + gSplatSortMinBlockSize - 1) / gSplatSortMinBlockSize;
+    stats.mNumBlocks = (uint32_t)numBlocks;
+
+    struct SplatSortContext ctx = {};
+    ctx.pSrcKeys = keys;
+    ctx.pSrcValues = values;
+    ctx.pHistograms = scratch->pHistograms;
+    ctx.mCount = count;
+    ctx.mBlockSize = (count + numBlocks - 1) / numBlocks;
+    splatParallelFor(threadSystem, numBlocks, 1, splatSortCountBlocks, &ctx);
+
+    uint64_t* srcKeys = keys;
+    uint32_t* srcValues = values;
+    uint64_t* dstKeys = scratch->pKeys;
+    uint32_t* dstValues = scratch->pValues;
+    for (uint32_t digit = 0; digit < SPLAT_SORT_NUM_DIGITS; digit++) {
+        // a digit that is the same for every key leaves the order unchanged
+        uint64_t total[SPLAT_SORT_RADIX] = {};
+        bool     constant = false;
+        for (uint32_t bucket = 0; bucket < SPLAT_SORT_RADIX && !constant; bucket++) {
+            for (uint64_t block = 0; block < numBlocks; block++)
+                total[bucket] += splatSortHistogram(&ctx, block, digit)[bucket];
+            constant = total[bucket] == count;
+        }
+        if (constant)
+            continue;
+
+        ctx.pSrcKeys = srcKeys;
+        ctx.pSrcValues = srcValues;
+        ctx.pDstKeys = dstKeys;
+        ctx.pDstValues = dstValues;
+        ctx.mShift = digit * SPLAT_SORT_RADIX_BITS;
+        if (stats.mNumPasses > 0 && numBlocks > 1)
+            splatParallelFor(threadSystem, numBlocks, 1, splatSortCountDigitBlocks, &ctx);
+
+        // exclusive prefix in (bucket, block) order keeps the scatter stable
+        uint32_t offset = 0;
+        for (uint32_t bucket = 0; bucket < SPLAT_SORT_RADIX; bucket++) {
+            for (uint64_t block = 0; block < numBlocks; block++) {
+                uint32_t*      histogram = splatSortHistogram(&ctx, block, digit);
+                const uint32_t bucketCount = histogram[bucket];
+                histogram[bucket] = offset;
+                offset += bucketCount;
+            }
+        }
+
+        splatParallelFor(threadSystem, numBlocks, 1, splatSortScatterBlocks, &ctx);
+        stats.mNumPasses++;
+
+        uint64_t* swapKeys = srcKeys;
+        uint32_t* swapValues = srcValues;
+        srcKeys = dstKeys;
+        srcValues = dstValues;
+        dstKeys = swapKeys;
+        dstValues = swapValues;
+    }
+
+    if (srcKeys != keys) {
+        memcpy(keys, srcKeys, sizeof(uint64_t) * count);
+        memcpy(values, srcValues, sizeof(uint32_t) * count);
+    }
+
+    stats.mDurationUs = getUSec(false) - startUs;
+    if (outStats)
+        *outStats = stats;
+}
@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2017-2024 The Forge Interactive Inc.
+ *
+ * This file is part of The-Forge
+ * (see https://github.com/ConfettiFX/The-Forge).
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#pragma once
+
+#include "Splat.h"
+
+// LSD radix sort of 64 bit keys with 32 bit values, used to order tile/splat
+// pairs by (tile, depth). Keys are sorted 8 bits per pass. A single read of
+// the keys builds the histograms of every digit, passes whose digit is the
+// same for all keys are skipped, so a key range that only spans the low
+// tile bits costs no more passes than it needs. Every pass is split into
+// blocks that build private histograms and scatter in parallel.
+
+#define SPLAT_SORT_RADIX_BITS 8
+#define SPLAT_SORT_RADIX (1u << SPLAT_SORT_RADIX_BITS)
+#define SPLAT_SORT_NUM_DIGITS (64 / SPLAT_SORT_RADIX_BITS)
+#define SPLAT_SORT_MAX_BLOCKS 64
+
+// Ping-pong buffers and histograms, grown on demand and reused between
+// sorts, so sorting at a steady size does not allocate.
+struct SplatSortScratch {
+    uint64_t* pKeys;
+    uint32_t* pValues;
+    uint64_t  mCapacity;
+    uint32_t* pHistograms; // SPLAT_SORT_MAX_BLOCKS * SPLAT_SORT_NUM_DIGITS * SPLAT_SORT_RADIX
+};
+
+struct SplatSortStats {
+    uint32_t mNumPasses; // passes that actually moved data
+    uint32_t mNumBlocks;
+    uint32_t mNumAllocations; // scratch growths during this sort
+    int64_t  mDurationUs;
+};
+
+void splatSortScratchInit(struct SplatSortScratch* scratch);
+void splatSortScratchExit(struct SplatSortScratch* scratch);
+// Makes sure the scratch holds count pairs, so a later sort does not allocate.
+void splatSortScratchReserve(struct SplatSortScratch* scratch, uint64_t count);
+
+// Sorts keys ascending and permutes values along, stable. The result is in
+// keys and values on return. threadSystem may be NULL to sort inline.
+void splatRadixSort(ThreadSystem threadSystem, struct SplatSortScratch* scratch, uint64_t* keys, uint32_t* values, uint64_t count,
+                    struct SplatSortStats* outStats);
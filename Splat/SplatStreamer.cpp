@@ -0,0 +1,351 @@
+/*
+ * Copyright (c) 2017-2024 The Forge Interactive Inc.
+ *
+ * This file is part of The-Forge
+ * (see https://github.com/ConfettiFX/The-Forge).
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "SplatStreamer.h"
+
+#include <math.h>
+#include <string.h>
+#include <thread>
+
+#include "Forge/TF_Log.h"
+#include "Forge/Core/TF_Time.h"
+
+#include "SplatDepthSort.h"
+
+static const uint32_t gSplatStreamerNone = UINT32_MAX;
+// prefetch requests sort after every visible one
+static const uint64_t gSplatStreamerPrefetchPriority = 1ull << 63;
+
+bool splatStreamerInit(struct SplatStreamer* streamer, ThreadSystem threadSystem, ResourceDirectory dir, const char* path,
+                       const struct SplatStreamerDesc* desc) {
+    memset((void*)streamer, 0, sizeof(struct SplatStreamer));
+    if (!splatChunkOpenFile(dir, path, &streamer->mFile))
+        return false;
+
+    const struct SplatChunkFileHeader* header = &streamer->mFile.mHeader;
+    streamer->mDesc = *desc;
+    if (streamer->mDesc.mMaxInFlight == 0)
+        streamer->mDesc.mMaxInFlight = 1;
+    if (streamer->mDesc.mMaxInFlight > SPLAT_STREAMER_MAX_IN_FLIGHT)
+        streamer->mDesc.mMaxInFlight = SPLAT_STREAMER_MAX_IN_FLIGHT;
+    streamer->mThreadSystem = threadSystem;
+    streamer->mSlotSize = splatChunkBlockSize(header->mChunkCapacity);
+    uint64_t numSlots = desc->mBudgetBytes / streamer->mSlotSize;
+    if (numSlots > header->mNumChunks)
+        numSlots = header->mNumChunks;
+    // splat indices of the slot pool have to fit 32 bits
+    if (numSlots * header->mChunkCapacity > UINT32_MAX)
+        numSlots = UINT32_MAX / header->mChunkCapacity;
+    if (numSlots == 0) {
+        LOGF(eERROR, "Splat streaming budget of %llu bytes does not hold a single %llu byte chunk.", (unsigned long long)desc->mBudgetBytes,
+             (unsigned long long)streamer->mSlotSize);
+        splatChunkCloseFile(&streamer->mFile);
+        return false;
+    }
+    streamer->mNumSlots = (uint32_t)numSlots;
+
+    bool result = true;
+    for (uint32_t i = 0; i < SPLAT_STREAMER_MAX_IN_FLIGHT; i++) {
+        streamer->mReads[i].pStreamer = streamer;
+        streamer->mReads[i].mChunk = gSplatStreamerNone;
+        if (i < streamer->mDesc.mMaxInFlight && result)
+            result = fsOpenStreamFromPath(dir, path, FM_READ, &streamer->mReads[i].mStream);
+    }
+    if (!result) {
+        LOGF(eERROR, "Failed to open splat chunk file '%s' for streaming.", path);
+        splatStreamerExit(streamer);
+        return false;
+    }
+
+    streamer->pSlotMemory = (uint8_t*)splatMalloc(streamer->mSlotSize * numSlots);
+    streamer->pSlots = (struct SplatStreamerSlot*)splatCalloc(numSlots, sizeof(struct SplatStreamerSlot));
+    for (uint32_t slot = 0; slot < streamer->mNumSlots; slot++) {
+        streamer->pSlots[slot].mChunk = gSplatStreamerNone;
+        splatChunkBlockStreams(streamer->pSlotMemory + slot * streamer->mSlotSize, header->mChunkCapacity,
+                               &streamer->pSlots[slot].mStreams);
+    }
+    streamer->pChunks = (struct SplatStreamerChunk*)splatCalloc(header->mNumChunks, sizeof(struct SplatStreamerChunk));
+    for (uint32_t chunk = 0; chunk < header->mNumChunks; chunk++) {
+        streamer->pChunks[chunk].mState.store(SPLAT_CHUNK_STATE_EVICTED, std::memory_order_relaxed);
+        streamer->pChunks[chunk].mSlot = gSplatStreamerNone;
+    }
+    streamer->pNewSlots = (uint32_t*)splatMalloc(sizeof(uint32_t) * numSlots);
+    streamer->pVisibleSlots = (uint32_t*)splatMalloc(sizeof(uint32_t) * numSlots);
+    streamer->pVisibleChunks = (uint32_t*)splatMalloc(sizeof(uint32_t) * header->mNumChunks);
+    streamer->pRequestKeys = (uint64_t*)splatMalloc(sizeof(uint64_t) * header->mNumChunks);
+    streamer->pRequestChunks = (uint32_t*)splatMalloc(sizeof(uint32_t) * header->mNumChunks);
+    splatSortScratchInit(&streamer->mRequestScratch);
+    // at most one request per chunk, sorting them never allocates during a frame
+    splatSortScratchReserve(&streamer->mRequestScratch, header->mNumChunks);
+    LOGF(eINFO, "Splat streaming: %u chunks of %u splats, %u slots of %.1f MB", header->mNumChunks, header->mChunkCapacity,
+         streamer->mNumSlots, streamer->mSlotSize / (1024.0 * 1024.0));
+    return true;
+}
+
+void splatStreamerExit(struct SplatStreamer* streamer) {
+    bool busy = false;
+    for (uint32_t i = 0; i < SPLAT_STREAMER_MAX_IN_FLIGHT; i++)
+        busy = busy || streamer->mReads[i].mChunk != gSplatStreamerNone;
+    if (busy && streamer->mThreadSystem)
+        threadSystemWaitIdle(streamer->mThreadSystem);
+    for (uint32_t i = 0; i < streamer->mDesc.mMaxInFlight; i++)
+        fsCloseStream(&streamer->mReads[i].mStream);
+    splatChunkCloseFile(&streamer->mFile);
+    splatSortScratchExit(&streamer->mRequestScratch);
+    splatFree(streamer->pSlotMemory);
+    splatFree(streamer->pSlots);
+    splatFree(streamer->pChunks);
+    splatFree(streamer->pNewSlots);
+    splatFree(streamer->pVisibleSlots);
+    splatFree(streamer->pVisibleChunks);
+    splatFree(streamer->pRequestKeys);
+    splatFree(streamer->pRequestChunks);
+    memset((void*)streamer, 0, sizeof(struct SplatStreamer));
+}
+
+static void splatStreamerReadTask(void* user, uint64_t) {
+    struct SplatStreamerRead*    read = (struct SplatStreamerRead*)user;
+    struct SplatStreamer*        streamer = read->pStreamer;
+    struct SplatStreamerChunk*   chunk = &streamer->pChunks[read->mChunk];
+    const struct SplatChunkInfo* info = &streamer->mFile.pChunks[read->mChunk];
+    uint8_t*                     dst = streamer->pSlotMemory + chunk->mSlot * streamer->mSlotSize;
+    const bool ok = fsSeekStream(&read->mStream, SBO_START_OF_FILE, (ssize_t)info->mOffset) &&
+                    fsReadFromStream(&read->mStream, dst, streamer->mSlotSize) == streamer->mSlotSize;
+    chunk->mState.store(ok ? SPLAT_CHUNK_STATE_LOADED : SPLAT_CHUNK_STATE_FAILED, std::memory_order_release);
+}
+
+// Makes finished reads resident and frees their read slots.
+static void splatStreamerReap(struct SplatStreamer* streamer) {
+    struct SplatStreamerStats* stats = &streamer->mStats;
+    for (uint32_t i = 0; i < streamer->mDesc.mMaxInFlight; i++) {
+        struct SplatStreamerRead* read = &streamer->mReads[i];
+        if (read->mChunk == gSplatStreamerNone)
+            continue;
+        struct SplatStreamerChunk* chunk = &streamer->pChunks[read->mChunk];
+        const uint32_t             state = chunk->mState.load(std::memory_order_acquire);
+        if (state == SPLAT_CHUNK_STATE_LOADED) {
+            chunk->mState.store(SPLAT_CHUNK_STATE_RESIDENT, std::memory_order_relaxed);
+            streamer->pNewSlots[streamer->mNumNewSlots++] = chunk->mSlot;
+            stats->mResidentChunks++;
+            stats->mResidentBytes += streamer->mSlotSize;
+            stats->mPeakResidentBytes =
+                stats->mResidentBytes > stats->mPeakResidentBytes ? stats->mResidentBytes : stats->mPeakResidentBytes;
+            stats->mBytesLoaded += streamer->mSlotSize;
+            read->mChunk = gSplatStreamerNone;
+        } else if (state == SPLAT_CHUNK_STATE_FAILED) {
+            streamer->pSlots[chunk->mSlot].mChunk = gSplatStreamerNone;
+            chunk->mSlot = gSplatStreamerNone;
+            stats->mFailed++;
+            read->mChunk = gSplatStreamerNone;
+        }
+    }
+}
+
+// A free slot, or the slot of the least recently used chunk that is out of the eviction delay.
+static uint32_t splatStreamerAcquireSlot(struct SplatStreamer* streamer) {
+    uint32_t victim = gSplatStreamerNone;
+    uint64_t victimFrame = UINT64_MAX;
+    for (uint32_t slot = 0; slot < streamer->mNumSlots; slot++) {
+        const uint32_t chunkIndex = streamer->pSlots[slot].mChunk;
+        if (chunkIndex == gSplatStreamerNone)
+            return slot;
+        const struct SplatStreamerChunk* chunk = &streamer->pChunks[chunkIndex];
+        if (chunk->mState.load(std::memory_order_relaxed) != SPLAT_CHUNK_STATE_RESIDENT ||
+            chunk->mLastUsedFrame + streamer->mDesc.mEvictDelayFrames >= streamer->mFrame)
+            continue;
+        if (chunk->mLastUsedFrame < victimFrame) {
+            victim = slot;
+            victimFrame = chunk->mLastUsedFrame;
+        }
+    }
+    if (victim != gSplatStreamerNone) {
+        struct SplatStreamerChunk* chunk = &streamer->pChunks[streamer->pSlots[victim].mChunk];
+        chunk->mState.store(SPLAT_CHUNK_STATE_EVICTED, std::memory_order_relaxed);
+        chunk->mSlot = gSplatStreamerNone;
+        chunk->mPrefetched = false;
+        streamer->pSlots[victim].mChunk = gSplatStreamerNone;
+        streamer->mStats.mEvictions++;
+        streamer->mStats.mResidentChunks--;
+        streamer->mStats.mResidentBytes -= streamer->mSlotSize;
+    }
+    return victim;
+}
+
+// Starts the read of a chunk. Returns false when no read or slot is available.
+static bool splatStreamerIssue(struct SplatStreamer* streamer, uint32_t chunkIndex, bool prefetch) {
+    struct SplatStreamerRead* read = NULL;
+    for (uint32_t i = 0; i < streamer->mDesc.mMaxInFlight && !read; i++)
+        read = streamer->mReads[i].mChunk == gSplatStreamerNone ? &streamer->mReads[i] : NULL;
+    if (!read)
+        return false;
+    const uint32_t slot = splatStreamerAcquireSlot(streamer);
+    if (slot == gSplatStreamerNone) {
+        streamer->mStats.mDropped++;
+        return false;
+    }
+
+    struct SplatStreamerChunk* chunk = &streamer->pChunks[chunkIndex];
+    chunk->mSlot = slot;
+    chunk->mLastUsedFrame = streamer->mFrame;
+    chunk->mPrefetched = prefetch;
+    chunk->mState.store(SPLAT_CHUNK_STATE_LOADING, std::memory_order_relaxed);
+    streamer->pSlots[slot].mChunk = chunkIndex;
+    read->mChunk = chunkIndex;
+    streamer->mStats.mRequests++;
+    streamer->mStats.mPrefetches += prefetch ? 1 : 0;
+    if (streamer->mThreadSystem)
+        threadSystemAddTask(streamer->mThreadSystem, splatStreamerReadTask, read);
+    else
+        splatStreamerReadTask(read, 0);
+    return true;
+}
+
+static float splatBoxDistance(const struct SplatChunkInfo* info, struct Tf32x3_s p) {
+    float squared = 0.0f;
+    for (uint32_t axis = 0; axis < 3; axis++) {
+        const float d = fmaxf(fmaxf(info->mBoundsMin[axis] - p.v[axis], p.v[axis] - info->mBoundsMax[axis]), 0.0f);
+        squared += d * d;
+    }
+    return sqrtf(squared);
+}
+
+static bool splatBoxInFrustum(const struct SplatChunkInfo* info, const struct SplatFrustum* frustum) {
+    for (uint32_t plane = 0; plane < 6; plane++) {
+        const float* n = frustum->mPlanes[plane];
+        // corner furthest along the plane normal
+        const float x = n[0] >= 0.0f ? info->mBoundsMax[0] : info->mBoundsMin[0];
+        const float y = n[1] >= 0.0f ? info->mBoundsMax[1] : info->mBoundsMin[1];
+        const float z = n[2] >= 0.0f ? info->mBoundsMax[2] : info->mBoundsMin[2];
+        if (n[0] * x + n[1] * y + n[2] * z + n[3] < 0.0f)
+            return false;
+    }
+    return true;
+}
+
+static inline uint32_t splatFloatKey(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits; // only used for non negative distances
+}
+
+void splatStreamerUpdate(struct SplatStreamer* streamer, struct Tf32x3_s eye, const struct SplatFrustum* frustum, float deltaSeconds) {
+    struct SplatStreamerStats* stats = &streamer->mStats;
+    streamer->mFrame++;
+    streamer->mNumNewSlots = 0;
+    splatStreamerReap(streamer);
+
+    // eye predicted along the velocity of the last update
+    struct Tf32x3_s predicted = eye;
+    bool            prefetch = false;
+    if (streamer->mHasLastEye && deltaSeconds > 0.0f && streamer->mDesc.mPrefetchSeconds > 0.0f) {
+        const float scale = streamer->mDesc.mPrefetchSeconds / deltaSeconds;
+        predicted = { eye.x + (eye.x - streamer->mLastEye.x) * scale, eye.y + (eye.y - streamer->mLastEye.y) * scale,
+                      eye.z + (eye.z - streamer->mLastEye.z) * scale };
+        prefetch = predicted.x != eye.x || predicted.y != eye.y || predicted.z != eye.z;
+    }
+    streamer->mLastEye = eye;
+    streamer->mHasLastEye = true;
+
+    const uint32_t numChunks = streamer->mFile.mHeader.mNumChunks;
+    uint32_t       numVisible = 0;
+    uint64_t       numRequests = 0;
+    for (uint32_t c = 0; c < numChunks; c++) {
+        const struct SplatChunkInfo* info = &streamer->mFile.pChunks[c];
+        struct SplatStreamerChunk*   chunk = &streamer->pChunks[c];
+        const uint32_t               state = chunk->mState.load(std::memory_order_acquire);
+        if (!frustum || splatBoxInFrustum(info, frustum)) {
+            streamer->pVisibleChunks[numVisible++] = c;
+            chunk->mLastUsedFrame = streamer->mFrame;
+            if (state == SPLAT_CHUNK_STATE_RESIDENT) {
+                stats->mPrefetchHits += chunk->mPrefetched ? 1 : 0;
+                chunk->mPrefetched = false;
+                continue;
+            }
+            stats->mMisses++;
+            chunk->mPrefetched = false;
+            if (state == SPLAT_CHUNK_STATE_EVICTED) {
+                streamer->pRequestKeys[numRequests] = splatFloatKey(splatBoxDistance(info, eye));
+                streamer->pRequestChunks[numRequests++] = c;
+            }
+        } else if (prefetch && state == SPLAT_CHUNK_STATE_EVICTED) {
+            const float distance = splatBoxDistance(info, predicted);
+            if (distance <= streamer->mDesc.mPrefetchRadius) {
+                streamer->pRequestKeys[numRequests] = gSplatStreamerPrefetchPriority | splatFloatKey(distance);
+                streamer->pRequestChunks[numRequests++] = c;
+            }
+        }
+    }
+
+    // nearest visible chunks first, then prefetches nearest to the predicted eye
+    splatRadixSort(NULL, &streamer->mRequestScratch, streamer->pRequestKeys, streamer->pRequestChunks, numRequests, NULL);
+    for (uint64_t i = 0; i < numRequests; i++) {
+        const bool isPrefetch = (streamer->pRequestKeys[i] & gSplatStreamerPrefetchPriority) != 0;
+        if (!splatStreamerIssue(streamer, streamer->pRequestChunks[i], isPrefetch))
+            break;
+    }
+
+    stats->mLastStallUs = 0;
+    if (streamer->mDesc.mMaxStallUs > 0 && streamer->mThreadSystem) {
+        const int64_t startUs = getUSec(false);
+        for (;;) {
+            bool waiting = false;
+            for (uint32_t v = 0; v < numVisible && !waiting; v++)
+                waiting =
+                    streamer->pChunks[streamer->pVisibleChunks[v]].mState.load(std::memory_order_acquire) == SPLAT_CHUNK_STATE_LOADING;
+            stats->mLastStallUs = getUSec(false) - startUs;
+            if (!waiting || stats->mLastStallUs >= streamer->mDesc.mMaxStallUs)
+                break;
+            std::this_thread::yield();
+        }
+        stats->mStallUs += stats->mLastStallUs;
+    }
+    splatStreamerReap(streamer);
+
+    streamer->mNumVisibleSlots = 0;
+    for (uint32_t v = 0; v < numVisible; v++) {
+        const struct SplatStreamerChunk* chunk = &streamer->pChunks[streamer->pVisibleChunks[v]];
+        if (chunk->mState.load(std::memory_order_relaxed) == SPLAT_CHUNK_STATE_RESIDENT)
+            streamer->pVisibleSlots[streamer->mNumVisibleSlots++] = chunk->mSlot;
+    }
+    stats->mVisibleChunks = numVisible;
+    stats->mVisibleResident = streamer->mNumVisibleSlots;
+}
+
+uint64_t splatStreamerGatherVisible(const struct SplatStreamer* streamer, const float depthRow[4], uint32_t* outIndices, uint64_t* keys,
+                                    struct SplatSortScratch* scratch) {
+    const uint32_t capacity = streamer->mFile.mHeader.mChunkCapacity;
+    uint64_t       count = 0;
+    for (uint32_t v = 0; v < streamer->mNumVisibleSlots; v++) {
+        const uint32_t               slot = streamer->pVisibleSlots[v];
+        const struct SplatChunkInfo* info = &streamer->mFile.pChunks[streamer->pSlots[slot].mChunk];
+        const struct Tf32x3_s*       positions = streamer->pSlots[slot].mStreams.pPositions;
+        for (uint32_t i = 0; i < info->mNumSplats; i++) {
+            const struct Tf32x3_s p = positions[i];
+            outIndices[count] = slot * capacity + i;
+            keys[count++] = splatDepthKey(depthRow[0] * p.x + depthRow[1] * p.y + depthRow[2] * p.z + depthRow[3]);
+        }
+    }
+    splatRadixSort(NULL, scratch, keys, outIndices, count, NULL);
+    return count;
+}
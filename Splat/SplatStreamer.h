@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2017-2024 The Forge Interactive Inc.
+ *
+ * This file is part of The-Forge
+ * (see https://github.com/ConfettiFX/The-Forge).
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+
+#include "SplatBvh.h"
+#include "SplatChunk.h"
+#include "SplatSort.h"
+
+// Out of core streaming of a chunk file written by splatChunkWriteFile.
+//
+// Resident chunks live in a fixed pool of slots carved out of the memory
+// budget, one chunk per slot, so the renderer can mirror the pool in GPU
+// buffers of the same fixed size and address splat i of slot s as
+// s * mChunkCapacity + i. Every update:
+// - finished reads become resident and are reported in pNewSlots for upload,
+// - chunks intersecting the frustum are marked used, missing ones are
+//   requested nearest first,
+// - chunks near the eye position predicted along the camera velocity are
+//   prefetched after those,
+// - requests take a free slot or evict the least recently used chunk that
+//   has not been used for mEvictDelayFrames frames, so slots the GPU may
+//   still read are never overwritten,
+// - reads run as tasks on the thread system, inline without one.
+// With mMaxStallUs the update waits that long for visible chunks in flight.
+
+#define SPLAT_STREAMER_MAX_IN_FLIGHT 16
+
+enum SplatChunkState {
+    SPLAT_CHUNK_STATE_EVICTED = 0,
+    SPLAT_CHUNK_STATE_LOADING,
+    SPLAT_CHUNK_STATE_LOADED, // read finished, resident after the next update
+    SPLAT_CHUNK_STATE_RESIDENT,
+    SPLAT_CHUNK_STATE_FAILED,
+};
+
+struct SplatStreamerDesc {
+    uint64_t mBudgetBytes; // memory for resident chunks, rounded down to whole slots
+    uint32_t mMaxInFlight; // concurrent chunk reads, at most SPLAT_STREAMER_MAX_IN_FLIGHT
+    uint32_t mEvictDelayFrames; // frames after its last use before a chunk may be evicted
+    float    mPrefetchSeconds; // look ahead along the camera velocity
+    float    mPrefetchRadius; // chunks this close to the predicted eye are prefetched
+    int64_t  mMaxStallUs; // per update wait for visible chunks in flight, 0 never waits
+};
+
+struct SplatStreamerStats {
+    uint64_t mResidentBytes;
+    uint64_t mPeakResidentBytes;
+    uint32_t mResidentChunks;
+    uint32_t mVisibleChunks; // last update
+    uint32_t mVisibleResident; // last update
+    uint64_t mRequests;
+    uint64_t mMisses; // visible chunks that were not resident, counted every update
+    uint64_t mPrefetches;
+    uint64_t mPrefetchHits; // prefetched chunks that became visible while resident
+    uint64_t mEvictions;
+    uint64_t mDropped; // requests without a slot, every resident chunk was in use
+    uint64_t mFailed;
+    uint64_t mBytesLoaded;
+    int64_t  mStallUs; // total time waited for visible chunks
+    int64_t  mLastStallUs;
+};
+
+struct SplatStreamerChunk {
+    std::atomic<uint32_t> mState; // SplatChunkState
+    uint32_t              mSlot; // UINT32_MAX when not resident or loading
+    uint64_t              mLastUsedFrame;
+    bool                  mPrefetched; // loaded by a prefetch and not visible since
+};
+
+struct SplatStreamerSlot {
+    uint32_t            mChunk; // UINT32_MAX when free
+    struct SplatStreams mStreams; // arrays of the slot, mChunkCapacity entries each
+};
+
+struct SplatStreamerRead {
+    struct SplatStreamer* pStreamer;
+    uint32_t              mChunk; // UINT32_MAX when the read slot is idle
+    FileStream            mStream;
+};
+
+struct SplatStreamer {
+    struct SplatStreamerDesc mDesc;
+    struct SplatChunkFile    mFile;
+    ThreadSystem             mThreadSystem;
+    uint64_t                 mSlotSize;
+    uint32_t                 mNumSlots;
+    uint8_t*                 pSlotMemory;
+    struct SplatStreamerSlot* pSlots;
+    struct SplatStreamerChunk* pChunks;
+    struct SplatStreamerRead mReads[SPLAT_STREAMER_MAX_IN_FLIGHT];
+
+    uint64_t        mFrame;
+    struct Tf32x3_s mLastEye;
+    bool            mHasLastEye;
+
+    // per update results
+    uint32_t* pNewSlots; // slots that became resident, to upload
+    uint32_t  mNumNewSlots;
+    uint32_t* pVisibleSlots; // resident slots intersecting the frustum
+    uint32_t  mNumVisibleSlots;
+
+    // scratch
+    uint32_t*               pVisibleChunks;
+    uint64_t*               pRequestKeys; // prefetch flag in the top bit, then the distance bits
+    uint32_t*               pRequestChunks;
+    struct SplatSortScratch mRequestScratch;
+
+    struct SplatStreamerStats mStats;
+};
+
+bool splatStreamerInit(struct SplatStreamer* streamer, ThreadSystem threadSystem, ResourceDirectory dir, const char* path,
+                       const struct SplatStreamerDesc* desc);
+// Waits for reads in flight before freeing.
+void splatStreamerExit(struct SplatStreamer* streamer);
+
+void splatStreamerUpdate(struct SplatStreamer* streamer, struct Tf32x3_s eye, const struct SplatFrustum* frustum, float deltaSeconds);
+
+// Splat indices s * mChunkCapacity + i of every splat in pVisibleSlots,
+// sorted back to front. depthRow is the row of the world to view matrix
+// that yields view depth, keys needs room for as many keys as indices.
+// Returns the number of indices.
+uint64_t splatStreamerGatherVisible(const struct SplatStreamer* streamer, const float depthRow[4], uint32_t* outIndices, uint64_t* keys,
+                                    struct SplatSortScratch* scratch);
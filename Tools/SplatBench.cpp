@@ -0,0 +1,366 @@
+/*
+ * Copyright (c) 2017-2024 The Forge Interactive Inc.
+ *
+ * This file is part of The-Forge
+ * (see https://github.com/ConfettiFX/The-Forge).
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+// Headless benchmark of the CPU splat pipeline, for machines without a GPU.
+// Loads a PLY and replays a camera path through the stages the app runs on
+// the CPU every frame (BVH frustum cull and cached SH evaluation as one job
+// graph, then the depth sort) followed by the reference rasterizer. Writes a
+// JSON report with p50/p95/p99 latencies of every stage, visible splats,
+// tile pairs, peak splat heap memory and a checksum of every image.
+//
+//   splat_bench <scene.ply> [--path camera_path.txt] [--frames n] [--warmup n] [--size width height] [--sh degree]
+//               [--workers n] [--out report.json]
+//
+// See SplatCameraPath.h for the path format. Without a path the camera
+// orbits the scene in --frames frames. The first --warmup frames of the path
+// are replayed before measuring so every scratch buffer has grown. Without
+// --out the report goes to stdout.
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Forge/TF_FileSystem.h"
+#include "Forge/TF_Log.h"
+#include "Forge/Core/TF_Time.h"
+#include "Forge/Mem/TF_Memory.h"
+#include "Common_3/Utilities/Threading/ThreadSystem.h"
+
+#include "Splat/SplatBvh.h"
+#include "Splat/SplatCameraPath.h"
+#include "Splat/SplatDepthSort.h"
+#include "Splat/SplatJobs.h"
+#include "Splat/SplatRaster.h"
+#include "Splat/SplatShEval.h"
+
+#include "Tools/SplatToolCommon.h"
+
+enum BenchStage {
+    BENCH_STAGE_FRUSTUM_CULL,
+    BENCH_STAGE_SH_EVAL,
+    BENCH_STAGE_DEPTH_SORT,
+    BENCH_STAGE_RASTER_CULL,
+    BENCH_STAGE_RASTER_PROJECT,
+    BENCH_STAGE_RASTER_SH,
+    BENCH_STAGE_RASTER_BIN,
+    BENCH_STAGE_RASTER_SORT,
+    BENCH_STAGE_RASTER_BLEND,
+    BENCH_STAGE_FRAME,
+    BENCH_NUM_STAGES
+};
+
+static const char* gBenchStageNames[BENCH_NUM_STAGES] = {
+    "frustum_cull", "sh_eval",     "depth_sort",  "raster_cull",  "raster_project",
+    "raster_sh",    "raster_bin",  "raster_sort", "raster_blend", "frame",
+};
+
+struct BenchFrame {
+    int64_t  mStageUs[BENCH_NUM_STAGES];
+    uint64_t mNumVisible; // by the frustum cull
+    uint64_t mNumRasterVisible;
+    uint64_t mNumTilePairs;
+    uint64_t mImageHash;
+};
+
+// growing text buffer for the report
+struct BenchText {
+    char*  pData;
+    size_t mSize;
+    size_t mCapacity;
+};
+
+// big, kept out of the stack of main
+static struct SplatJobSystem gJobSystem;
+
+static void textPrintf(struct BenchText* text, const char* format, ...) {
+    for (;;) {
+        va_list args;
+        va_start(args, format);
+        const int written = vsnprintf(text->pData + text->mSize, text->mCapacity - text->mSize, format, args);
+        va_end(args);
+        if (written < 0)
+            return;
+        if (text->mSize + (size_t)written < text->mCapacity) {
+            text->mSize += (size_t)written;
+            return;
+        }
+        text->mCapacity = 2 * text->mCapacity + (size_t)written + 1;
+        text->pData = (char*)tf_realloc(text->pData, text->mCapacity);
+    }
+}
+
+static int compareInt64(const void* a, const void* b) {
+    const int64_t lhs = *(const int64_t*)a, rhs = *(const int64_t*)b;
+    return lhs < rhs ? -1 : (lhs > rhs ? 1 : 0);
+}
+
+// nearest rank percentile of sorted values
+static int64_t percentile(const int64_t* sorted, uint32_t count, double p) {
+    uint32_t rank = (uint32_t)ceil(p / 100.0 * count);
+    return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+static uint64_t imageHash(const float* image, uint64_t numValues) {
+    // FNV-1a over the bytes, the rasterizer is deterministic for any worker count
+    uint64_t       hash = 0xcbf29ce484222325ull;
+    const uint8_t* bytes = (const uint8_t*)image;
+    for (uint64_t i = 0; i < numValues * sizeof(float); i++)
+        hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+    return hash;
+}
+
+static void writeSummary(struct BenchText* text, const char* name, const uint64_t* values, uint32_t count, bool last) {
+    uint64_t minValue = UINT64_MAX, maxValue = 0;
+    double   sum = 0.0;
+    for (uint32_t i = 0; i < count; i++) {
+        minValue = values[i] < minValue ? values[i] : minValue;
+        maxValue = values[i] > maxValue ? values[i] : maxValue;
+        sum += (double)values[i];
+    }
+    textPrintf(text, "    \"%s\": { \"mean\": %.1f, \"min\": %llu, \"max\": %llu }%s\n", name, sum / count, (unsigned long long)minValue,
+               (unsigned long long)maxValue, last ? "" : ",");
+}
+
+int main(int argc, char** argv) {
+    const char* scenePath = NULL;
+    const char* cameraPathFile = NULL;
+    const char* outPath = NULL;
+    uint32_t    numFrames = 64;
+    uint32_t    numWarmup = 2;
+    uint32_t    width = 1280;
+    uint32_t    height = 720;
+    uint32_t    shDegree = SPLAT_SH_MAX_DEGREE;
+    uint32_t    numWorkers = 0;
+
+    const struct SplatToolOptions options = { &scenePath, &cameraPathFile, NULL, &numFrames, &width, &height };
+    for (int argIdx = 1; argIdx < argc; argIdx++) {
+        if (splatToolParseOption(&options, argc, argv, &argIdx))
+            continue;
+        if (!strcmp(argv[argIdx], "--warmup") && argIdx + 1 < argc)
+            numWarmup = (uint32_t)atoi(argv[++argIdx]);
+        else if (!strcmp(argv[argIdx], "--sh") && argIdx + 1 < argc)
+            shDegree = (uint32_t)atoi(argv[++argIdx]);
+        else if (!strcmp(argv[argIdx], "--workers") && argIdx + 1 < argc)
+            numWorkers = (uint32_t)atoi(argv[++argIdx]);
+        else if (!strcmp(argv[argIdx], "--out") && argIdx + 1 < argc)
+            outPath = argv[++argIdx];
+        else {
+            scenePath = NULL;
+            break;
+        }
+    }
+    if (!scenePath) {
+        printf("usage: %s <scene.ply> [--path camera_path.txt] [--frames n] [--warmup n] [--size width height] [--sh degree] "
+               "[--workers n] [--out report.json]\n",
+               argv[0]);
+        return 1;
+    }
+    if (numFrames == 0 || width == 0 || height == 0 || shDegree > SPLAT_SH_MAX_DEGREE || numWorkers > SPLAT_JOB_MAX_WORKERS) {
+        printf("invalid frame count, image size, SH degree or worker count\n");
+        return 1;
+    }
+
+    if (!splatToolInit("SplatBench"))
+        return 1;
+
+    ThreadSystem         threadSystem = NULL;
+    ThreadSystemInitDesc threadSystemDesc = {};
+    threadSystemDesc.mThreadCount = getNumCPUCores() > 1 ? getNumCPUCores() - 1 : 1;
+    if (numWorkers > threadSystemDesc.mThreadCount + 1)
+        threadSystemDesc.mThreadCount = numWorkers - 1;
+    initThreadSystem(&threadSystemDesc, &threadSystem);
+    splatJobSystemInit(&gJobSystem, threadSystem, numWorkers ? numWorkers : threadSystemDesc.mThreadCount + 1);
+
+    // everything the scene needs before the first frame
+    int                     result = 1;
+    struct SplatStreams     streams = {};
+    uint64_t                numSplats = 0;
+    struct SplatBvh         bvh = {};
+    struct SplatShCache     shCache = {};
+    struct SplatDepthSorter sorter = {};
+    struct SplatCameraPath  cameraPath = {};
+    const int64_t           loadStartUs = getUSec(false);
+    const bool              loaded = splatToolLoadScene(threadSystem, scenePath, 0.0f, &streams, &numSplats);
+    const int64_t           loadUs = getUSec(false) - loadStartUs;
+    const bool              built = loaded && splatBvhBuild(threadSystem, numSplats, &streams, &bvh, NULL);
+    const bool              havePath = built && splatToolLoadCameraPath(threadSystem, cameraPathFile, 60.0f * 3.14159265f / 180.0f,
+                                                                        &streams, numSplats, 0.8f, numFrames, &cameraPath);
+
+    if (havePath) {
+        splatShCacheInit(&shCache, streams.pPositions, numSplats);
+        splatDepthSorterInit(&sorter, threadSystem, numSplats, streams.pPositions);
+        struct Tf32x3_s*       colors = (struct Tf32x3_s*)splatMalloc(sizeof(struct Tf32x3_s) * numSplats);
+        uint32_t*              visible = (uint32_t*)splatMalloc(sizeof(uint32_t) * numSplats);
+        struct SplatRasterizer rasterizer;
+        splatRasterizerInit(&rasterizer);
+        rasterizer.mShDegree = shDegree;
+        struct SplatJobGraph    graph;
+        struct SplatBvhCullJob  cullJob;
+        struct SplatShCachedJob shJob;
+        const uint64_t          loadPeakBytes = splatHeapPeakBytes();
+
+        const uint32_t     numMeasured = cameraPath.mNumKeys;
+        struct BenchFrame* frames = (struct BenchFrame*)tf_calloc(numMeasured, sizeof(struct BenchFrame));
+        result = 0;
+        for (uint32_t step = 0; step < numWarmup + numMeasured && !result; step++) {
+            // the warm-up frames are the start of the path
+            const bool                   warmup = step < numWarmup;
+            const uint32_t               frame = warmup ? step % numMeasured : step - numWarmup;
+            const struct SplatCameraKey* key = &cameraPath.pKeys[frame];
+            if (step == numWarmup) {
+                // a measured run starts from the same state whatever the warm-up did
+                splatShCacheInvalidate(&shCache);
+                splatHeapResetPeak();
+            }
+            struct SplatCamera camera = {};
+            splatCameraLookAt(key->mEye, key->mTarget, key->mUp, key->mFovY, width, height, &camera);
+            struct SplatFrustum frustum;
+            splatFrustumFromCamera(&camera, 1e30f, &frustum);
+
+            struct BenchFrame* out = &frames[frame];
+            const int64_t      frameStartUs = getUSec(false);
+            splatJobGraphReset(&graph);
+            const uint32_t cullStage = splatBvhCullFrustumStages(&graph, &cullJob, &bvh, &frustum, visible);
+            const uint32_t shStage = splatEvalShCachedStages(&graph, &shJob, &shCache, shDegree, &streams, camera.mPosition,
+                                                             0.25f * 3.14159265f / 180.0f, colors);
+            splatJobGraphRun(&gJobSystem, &graph, NULL);
+            // the graph adds the evaluating stage right before the one returned
+            out->mStageUs[BENCH_STAGE_FRUSTUM_CULL] = graph.mStages[cullStage].mDoneUs - graph.mStages[cullStage - 1].mReadyUs;
+            out->mStageUs[BENCH_STAGE_SH_EVAL] = graph.mStages[shStage].mDoneUs - graph.mStages[shStage - 1].mReadyUs;
+            out->mNumVisible = cullJob.mNumVisible;
+
+            int64_t startUs = getUSec(false);
+            splatDepthSort(&sorter, &camera.mView[8]);
+            out->mStageUs[BENCH_STAGE_DEPTH_SORT] = getUSec(false) - startUs;
+
+            struct SplatRasterStats stats = {};
+            if (!splatRasterize(&gJobSystem, &rasterizer, &camera, numSplats, &streams, &stats)) {
+                result = 1;
+                break;
+            }
+            out->mStageUs[BENCH_STAGE_FRAME] = getUSec(false) - frameStartUs;
+            out->mStageUs[BENCH_STAGE_RASTER_CULL] = stats.mCullUs;
+            out->mStageUs[BENCH_STAGE_RASTER_PROJECT] = stats.mProjectUs;
+            out->mStageUs[BENCH_STAGE_RASTER_SH] = stats.mShUs;
+            out->mStageUs[BENCH_STAGE_RASTER_BIN] = stats.mBinUs;
+            out->mStageUs[BENCH_STAGE_RASTER_SORT] = stats.mSortUs;
+            out->mStageUs[BENCH_STAGE_RASTER_BLEND] = stats.mBlendUs;
+            out->mNumRasterVisible = stats.mNumVisible;
+            out->mNumTilePairs = stats.mNumTilePairs;
+            out->mImageHash = imageHash(rasterizer.pImage, (uint64_t)width * height * 3);
+        }
+
+        if (!result) {
+            struct BenchText text = {};
+            textPrintf(&text, "{\n");
+            textPrintf(&text, "  \"scene\": \"%s\",\n  \"splats\": %llu,\n  \"width\": %u,\n  \"height\": %u,\n  \"sh_degree\": %u,\n",
+                       scenePath, (unsigned long long)numSplats, width, height, shDegree);
+            textPrintf(&text, "  \"frames\": %u,\n  \"warmup_frames\": %u,\n  \"workers\": %u,\n  \"load_ms\": %.3f,\n", numMeasured,
+                       numWarmup, gJobSystem.mNumWorkers, loadUs / 1000.0);
+
+            int64_t* sorted = (int64_t*)tf_malloc(sizeof(int64_t) * numMeasured);
+            textPrintf(&text, "  \"stages_ms\": {\n");
+            for (uint32_t stage = 0; stage < BENCH_NUM_STAGES; stage++) {
+                double sum = 0.0;
+                for (uint32_t frame = 0; frame < numMeasured; frame++) {
+                    sorted[frame] = frames[frame].mStageUs[stage];
+                    sum += (double)sorted[frame];
+                }
+                qsort(sorted, numMeasured, sizeof(int64_t), compareInt64);
+                textPrintf(&text,
+                           "    \"%s\": { \"mean\": %.3f, \"p50\": %.3f, \"p95\": %.3f, \"p99\": %.3f, \"min\": %.3f, \"max\": %.3f }%s\n",
+                           gBenchStageNames[stage], sum / numMeasured / 1000.0, percentile(sorted, numMeasured, 50.0) / 1000.0,
+                           percentile(sorted, numMeasured, 95.0) / 1000.0, percentile(sorted, numMeasured, 99.0) / 1000.0,
+                           sorted[0] / 1000.0, sorted[numMeasured - 1] / 1000.0, stage + 1 < BENCH_NUM_STAGES ? "," : "");
+            }
+            textPrintf(&text, "  },\n");
+            tf_free(sorted);
+
+            uint64_t* values = (uint64_t*)tf_malloc(sizeof(uint64_t) * numMeasured * 3);
+            for (uint32_t frame = 0; frame < numMeasured; frame++) {
+                values[frame] = frames[frame].mNumVisible;
+                values[numMeasured + frame] = frames[frame].mNumRasterVisible;
+                values[2 * numMeasured + frame] = frames[frame].mNumTilePairs;
+            }
+            textPrintf(&text, "  \"counts\": {\n");
+            writeSummary(&text, "visible_splats", values, numMeasured, false);
+            writeSummary(&text, "raster_visible_splats", values + numMeasured, numMeasured, false);
+            writeSummary(&text, "tile_pairs", values + 2 * numMeasured, numMeasured, true);
+            textPrintf(&text, "  },\n");
+            tf_free(values);
+
+            textPrintf(&text, "  \"memory_bytes\": { \"load_peak\": %llu, \"frame_peak\": %llu, \"resident\": %llu },\n",
+                       (unsigned long long)loadPeakBytes, (unsigned long long)splatHeapPeakBytes(), (unsigned long long)splatHeapBytes());
+
+            textPrintf(&text, "  \"per_frame\": [\n");
+            for (uint32_t frame = 0; frame < numMeasured; frame++) {
+                const struct BenchFrame* f = &frames[frame];
+                textPrintf(&text,
+                           "    { \"frame\": %u, \"frame_ms\": %.3f, \"visible_splats\": %llu, \"tile_pairs\": %llu, "
+                           "\"image_hash\": \"%016llx\" }%s\n",
+                           frame, f->mStageUs[BENCH_STAGE_FRAME] / 1000.0, (unsigned long long)f->mNumVisible,
+                           (unsigned long long)f->mNumTilePairs, (unsigned long long)f->mImageHash, frame + 1 < numMeasured ? "," : "");
+            }
+            textPrintf(&text, "  ]\n}\n");
+
+            if (outPath) {
+                FileStream fh = {};
+                if (fsOpenStreamFromPath(RD_OTHER_FILES, outPath, FM_WRITE, &fh)) {
+                    if (fsWriteToStream(&fh, text.pData, text.mSize) != text.mSize)
+                        result = 1;
+                    fsCloseStream(&fh);
+                } else {
+                    result = 1;
+                }
+                if (result)
+                    LOGF(eERROR, "Failed to write %s.", outPath);
+                else
+                    printf("# %u frames of %llu splats, report in %s\n", numMeasured, (unsigned long long)numSplats, outPath);
+            } else {
+                fwrite(text.pData, 1, text.mSize, stdout);
+            }
+            tf_free(text.pData);
+        }
+
+        tf_free(frames);
+        splatRasterizerExit(&rasterizer);
+        splatFree(visible);
+        splatFree(colors);
+        splatDepthSorterExit(&sorter);
+        splatShCacheExit(&shCache);
+    }
+    if (havePath)
+        splatCameraPathFree(&cameraPath);
+    if (built)
+        splatBvhFree(&bvh);
+    if (loaded)
+        splatFreeStreams(&streams);
+
+    splatJobSystemExit(&gJobSystem);
+    exitThreadSystem(threadSystem);
+    splatToolExit();
+    return result;
+}
@@ -0,0 +1,150 @@
+/*
+ * Copyright (c) 2017-2024 The Forge Interactive Inc.
+ *
+ * This file is part of The-Forge
+ * (see https://github.com/ConfettiFX/The-Forge).
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+// Benchmark of the splat BVH: build time, and per frame frustum cull time and
+// visible fraction along a camera path compared with testing every splat.
+//
+//   splat_bvh_bench [scene.ply] [--count splats] [--path camera_path.txt] [--frames n] [--size width height]
+//
+// Without a scene a random cloud is used, without a path the camera orbits
+// inside the scene bounds. Per frame results are printed as CSV.
+
+#include <math.h>
+#include <stdio.h>
+
+#include "Forge/Core/TF_Time.h"
+#include "Forge/Mem/TF_Memory.h"
+#include "Common_3/Utilities/Threading/ThreadSystem.h"
+
+#include "Splat/SplatBvh.h"
+#include "Splat/SplatCameraPath.h"
+
+#include "Tools/SplatToolCommon.h"
+
+// Tests every splat sphere against the frustum.
+static uint64_t bruteForceCull(const struct SplatStreams* streams, uint64_t numSplats, const struct SplatFrustum* frustum) {
+    uint64_t count = 0;
+    for (uint64_t i = 0; i < numSplats; i++) {
+        const struct Tf32x3_s p = streams->pPositions[i];
+        const struct Tf32x3_s s = streams->pScales[i];
+        const float           radius = 3.0f * expf(fmaxf(s.x, fmaxf(s.y, s.z)));
+        bool                  inside = true;
+        for (uint32_t plane = 0; plane < 6 && inside; plane++) {
+            const float* n = frustum->mPlanes[plane];
+            inside = n[0] * p.x + n[1] * p.y + n[2] * p.z + n[3] >= -radius;
+        }
+        count += inside ? 1 : 0;
+    }
+    return count;
+}
+
+int main(int argc, char** argv) {
+    const char* scenePath = NULL;
+    const char* cameraPathFile = NULL;
+    uint64_t    numSplats = 4000000;
+    uint32_t    numFrames = 120;
+    uint32_t    width = 1920;
+    uint32_t    height = 1080;
+
+    const struct SplatToolOptions options = { &scenePath, &cameraPathFile, &numSplats, &numFrames, &width, &height };
+    for (int argIdx = 1; argIdx < argc; argIdx++) {
+        if (!splatToolParseOption(&options, argc, argv, &argIdx)) {
+            printf("usage: %s [scene.ply] [--count splats] [--path camera_path.txt] [--frames n] [--size width height]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (numSplats == 0 || numFrames == 0 || width == 0 || height == 0) {
+        printf("invalid splat count, frame count or image size\n");
+        return 1;
+    }
+
+    if (!splatToolInit("SplatBvhBench"))
+        return 1;
+
+    ThreadSystem         threadSystem = NULL;
+    ThreadSystemInitDesc threadSystemDesc = {};
+    threadSystemDesc.mThreadCount = getNumCPUCores() > 1 ? getNumCPUCores() - 1 : 1;
+    initThreadSystem(&threadSystemDesc, &threadSystem);
+
+    int                 result = 1;
+    struct SplatStreams streams = {};
+    if (splatToolLoadScene(threadSystem, scenePath, 50.0f, &streams, &numSplats)) {
+        struct SplatBvh           bvh;
+        struct SplatBvhBuildStats buildStats = {};
+        int64_t                   startUs = getUSec(false);
+        splatBvhBuild(NULL, numSplats, &streams, &bvh, &buildStats);
+        const int64_t serialBuildUs = getUSec(false) - startUs;
+        splatBvhFree(&bvh);
+        startUs = getUSec(false);
+        splatBvhBuild(threadSystem, numSplats, &streams, &bvh, &buildStats);
+        const int64_t parallelBuildUs = getUSec(false) - startUs;
+        printf("# %llu splats, %llu nodes, %u levels\n", (unsigned long long)numSplats, (unsigned long long)bvh.mNumNodes, bvh.mNumLevels);
+        printf("# build 1 thread %.2f ms, thread pool %.2f ms (morton %.2f ms, leaves %.2f ms, nodes %.2f ms)\n", serialBuildUs / 1000.0,
+               parallelBuildUs / 1000.0, buildStats.mMortonUs / 1000.0, buildStats.mLeavesUs / 1000.0, buildStats.mNodesUs / 1000.0);
+
+        struct SplatCameraPath cameraPath = {};
+        if (splatToolLoadCameraPath(threadSystem, cameraPathFile, 1.0f, &streams, numSplats, 0.3f, numFrames, &cameraPath)) {
+            uint32_t* visible = (uint32_t*)tf_malloc(sizeof(uint32_t) * numSplats);
+            double    totalCullUs = 0.0;
+            double    totalBruteUs = 0.0;
+            double    totalFraction = 0.0;
+            uint32_t  mismatches = 0;
+            printf("frame,visible,visible_fraction,bvh_cull_us,brute_force_us\n");
+            for (uint32_t frame = 0; frame < cameraPath.mNumKeys; frame++) {
+                const struct SplatCameraKey* key = &cameraPath.pKeys[frame];
+                struct SplatCamera           camera = {};
+                splatCameraLookAt(key->mEye, key->mTarget, key->mUp, key->mFovY, width, height, &camera);
+                struct SplatFrustum frustum;
+                splatFrustumFromCamera(&camera, 1e30f, &frustum);
+
+                startUs = getUSec(false);
+                const uint64_t numVisible = splatBvhCullFrustum(threadSystem, &bvh, &frustum, visible);
+                const int64_t  cullUs = getUSec(false) - startUs;
+                startUs = getUSec(false);
+                const uint64_t numBruteForce = bruteForceCull(&streams, numSplats, &frustum);
+                const int64_t  bruteUs = getUSec(false) - startUs;
+                mismatches += numVisible != numBruteForce ? 1 : 0;
+
+                const double fraction = (double)numVisible / (double)numSplats;
+                printf("%u,%llu,%.4f,%lld,%lld\n", frame, (unsigned long long)numVisible, fraction, (long long)cullUs, (long long)bruteUs);
+                totalCullUs += (double)cullUs;
+                totalBruteUs += (double)bruteUs;
+                totalFraction += fraction;
+            }
+            printf("# mean visible fraction %.4f, bvh cull %.2f ms, brute force %.2f ms, %u frames disagree\n",
+                   totalFraction / cameraPath.mNumKeys, totalCullUs / cameraPath.mNumKeys / 1000.0,
+                   totalBruteUs / cameraPath.mNumKeys / 1000.0, mismatches);
+            tf_free(visible);
+            splatCameraPathFree(&cameraPath);
+            result = mismatches ? 1 : 0;
+        }
+        splatBvhFree(&bvh);
+        splatFreeStreams(&streams);
+    }
+
+    exitThreadSystem(threadSystem);
+    splatToolExit();
+    return result;
+}
@@ -0,0 +1,201 @@
+/*
+ * Copyright (c) 2017-2024 The Forge Interactive Inc.
+ *
+ * This file is part of The-Forge
+ * (see https://github.com/ConfettiFX/The-Forge).
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+// Converts a scene to a chunk file for out of core streaming and replays a
+// camera path against a chunk file with a memory budget, printing the
+// streaming counters per frame.
+//
+//   splat_chunk convert out.splatchunks [scene.ply] [--count splats] [--chunk-size splats]
+//   splat_chunk replay file.splatchunks [--budget-mb mb] [--path camera_path.txt] [--frames n] [--fps fps] [--stall-ms ms]
+//
+// Converting needs the whole scene in memory, without a scene a random cloud
+// is written. Without a path the replay orbits the scene bounds.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Forge/TF_FileSystem.h"
+#include "Forge/TF_Log.h"
+#include "Forge/Core/TF_Time.h"
+#include "Forge/Mem/TF_Memory.h"
+#include "Common_3/Utilities/Threading/ThreadSystem.h"
+
+#include "Splat/SplatCameraPath.h"
+#include "Splat/SplatChunk.h"
+#include "Splat/SplatRaster.h"
+#include "Splat/SplatStreamer.h"
+
+#include "Tools/SplatToolCommon.h"
+
+static int convertScene(ThreadSystem threadSystem, const char* outPath, const char* scenePath, uint64_t numSplats, uint32_t chunkCapacity) {
+    struct SplatStreams streams = {};
+    if (!splatToolLoadScene(threadSystem, scenePath, 50.0f, &streams, &numSplats))
+        return 1;
+    struct SplatChunkWriteStats stats = {};
+    const bool written = splatChunkWriteFile(threadSystem, RD_OTHER_FILES, outPath, chunkCapacity, numSplats, &streams, &stats);
+    if (written)
+        printf("# %llu splats in %llu chunks of %u, %.1f MB, %.2f ms\n", (unsigned long long)numSplats,
+               (unsigned long long)stats.mNumChunks, chunkCapacity, stats.mNumBytes / (1024.0 * 1024.0), stats.mDurationUs / 1000.0);
+    splatFreeStreams(&streams);
+    return written ? 0 : 1;
+}
+
+static int replayPath(ThreadSystem threadSystem, const char* path, const char* cameraPathFile, uint32_t numFrames, uint32_t budgetMB,
+                      float fps, float stallMs) {
+    struct SplatStreamerDesc desc = {};
+    desc.mBudgetBytes = (uint64_t)budgetMB * 1024 * 1024;
+    desc.mMaxInFlight = 4;
+    desc.mEvictDelayFrames = 3;
+    desc.mPrefetchSeconds = 0.5f;
+    desc.mMaxStallUs = (int64_t)(stallMs * 1000.0f);
+    struct SplatStreamer streamer;
+    if (!splatStreamerInit(&streamer, threadSystem, RD_OTHER_FILES, path, &desc))
+        return 1;
+    const struct SplatChunkFileHeader* header = &streamer.mFile.mHeader;
+    const float extent = header->mBoundsMax[0] - header->mBoundsMin[0];
+    // a chunk about as wide as the view distance covers
+    streamer.mDesc.mPrefetchRadius = 0.25f * extent;
+
+    struct SplatCameraPath cameraPath = {};
+    if (cameraPathFile) {
+        if (!splatCameraPathLoad(RD_OTHER_FILES, cameraPathFile, 1.0f, &cameraPath)) {
+            splatStreamerExit(&streamer);
+            return 1;
+        }
+    } else {
+        const struct Tf32x3_s center = { 0.5f * (header->mBoundsMin[0] + header->mBoundsMax[0]),
+                                         0.5f * (header->mBoundsMin[1] + header->mBoundsMax[1]),
+                                         0.5f * (header->mBoundsMin[2] + header->mBoundsMax[2]) };
+        // inside the scene so only part of it is visible at a time
+        splatCameraPathOrbit(center, 0.25f * extent, 0.0f, 1.0f, numFrames, &cameraPath);
+    }
+
+    const uint64_t          maxIndices = (uint64_t)streamer.mNumSlots * header->mChunkCapacity;
+    uint32_t*               indices = (uint32_t*)tf_malloc(sizeof(uint32_t) * maxIndices);
+    uint64_t*               keys = (uint64_t*)tf_malloc(sizeof(uint64_t) * maxIndices);
+    struct SplatSortScratch scratch;
+    splatSortScratchInit(&scratch);
+
+    printf("frame,visible_chunks,visible_resident,resident_chunks,resident_mb,splats,new_slots,misses,requests,prefetch_hits,evictions,"
+           "stall_us,update_us,gather_us\n");
+    const struct SplatStreamerStats* stats = &streamer.mStats;
+    for (uint32_t frame = 0; frame < cameraPath.mNumKeys; frame++) {
+        const struct SplatCameraKey* key = &cameraPath.pKeys[frame];
+        struct SplatCamera           camera = {};
+        splatCameraLookAt(key->mEye, key->mTarget, key->mUp, key->mFovY, 1280, 720, &camera);
+        struct SplatFrustum frustum;
+        splatFrustumFromCamera(&camera, 1e30f, &frustum);
+
+        const uint64_t misses = stats->mMisses;
+        const uint64_t requests = stats->mRequests;
+        int64_t        startUs = getUSec(false);
+        splatStreamerUpdate(&streamer, camera.mPosition, &frustum, 1.0f / fps);
+        const int64_t updateUs = getUSec(false) - startUs;
+        startUs = getUSec(false);
+        const uint64_t numIndices = splatStreamerGatherVisible(&streamer, &camera.mView[8], indices, keys, &scratch);
+        const int64_t  gatherUs = getUSec(false) - startUs;
+        printf("%u,%u,%u,%u,%.1f,%llu,%u,%llu,%llu,%llu,%llu,%lld,%lld,%lld\n", frame, stats->mVisibleChunks, stats->mVisibleResident,
+               stats->mResidentChunks, stats->mResidentBytes / (1024.0 * 1024.0), (unsigned long long)numIndices, streamer.mNumNewSlots,
+               (unsigned long long)(stats->mMisses - misses), (unsigned long long)(stats->mRequests - requests),
+               (unsigned long long)stats->mPrefetchHits, (unsigned long long)stats->mEvictions, (long long)stats->mLastStallUs,
+               (long long)updateUs, (long long)gatherUs);
+    }
+    printf("# %u slots of %.1f MB, peak resident %.1f MB, %.1f MB loaded, %llu requests, %llu misses, %llu prefetches (%llu hits), %llu "
+           "evictions, %llu dropped, %llu failed, stalled %.2f ms\n",
+           streamer.mNumSlots, streamer.mSlotSize / (1024.0 * 1024.0), stats->mPeakResidentBytes / (1024.0 * 1024.0),
+           stats->mBytesLoaded / (1024.0 * 1024.0), (unsigned long long)stats->mRequests, (unsigned long long)stats->mMisses,
+           (unsigned long long)stats->mPrefetches, (unsigned long long)stats->mPrefetchHits, (unsigned long long)stats->mEvictions,
+           (unsigned long long)stats->mDropped, (unsigned long long)stats->mFailed, stats->mStallUs / 1000.0);
+
+    splatSortScratchExit(&scratch);
+    tf_free(indices);
+    tf_free(keys);
+    splatCameraPathFree(&cameraPath);
+    splatStreamerExit(&streamer);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    const bool  convert = argc > 1 && !strcmp(argv[1], "convert");
+    const bool  replay = argc > 1 && !strcmp(argv[1], "replay");
+    const char* filePath = NULL;
+    const char* scenePath = NULL;
+    const char* cameraPathFile = NULL;
+    uint64_t    numSplats = 1000000;
+    uint32_t    chunkCapacity = SPLAT_CHUNK_DEFAULT_CAPACITY;
+    uint32_t    numFrames = 240;
+    uint32_t    budgetMB = 256;
+    float       fps = 60.0f;
+    float       stallMs = 0.0f;
+    bool        valid = convert || replay;
+    for (int argIdx = 2; argIdx < argc && valid; argIdx++) {
+        if (!strcmp(argv[argIdx], "--count") && argIdx + 1 < argc)
+            numSplats = strtoull(argv[++argIdx], NULL, 10);
+        else if (!strcmp(argv[argIdx], "--chunk-size") && argIdx + 1 < argc)
+            chunkCapacity = (uint32_t)atoi(argv[++argIdx]);
+        else if (!strcmp(argv[argIdx], "--budget-mb") && argIdx + 1 < argc)
+            budgetMB = (uint32_t)atoi(argv[++argIdx]);
+        else if (!strcmp(argv[argIdx], "--path") && argIdx + 1 < argc)
+            cameraPathFile = argv[++argIdx];
+        else if (!strcmp(argv[argIdx], "--frames") && argIdx + 1 < argc)
+            numFrames = (uint32_t)atoi(argv[++argIdx]);
+        else if (!strcmp(argv[argIdx], "--fps") && argIdx + 1 < argc)
+            fps = (float)atof(argv[++argIdx]);
+        else if (!strcmp(argv[argIdx], "--stall-ms") && argIdx + 1 < argc)
+            stallMs = (float)atof(argv[++argIdx]);
+        else if (argv[argIdx][0] != '-' && !filePath)
+            filePath = argv[argIdx];
+        else if (argv[argIdx][0] != '-' && convert && !scenePath)
+            scenePath = argv[argIdx];
+        else
+            valid = false;
+    }
+    if (!valid || !filePath) {
+        printf("usage: %s convert out.splatchunks [scene.ply] [--count splats] [--chunk-size splats]\n"
+               "       %s replay file.splatchunks [--budget-mb mb] [--path camera_path.txt] [--frames n] [--fps fps] [--stall-ms ms]\n",
+               argv[0], argv[0]);
+        return 1;
+    }
+    if (numSplats == 0 || chunkCapacity == 0 || numFrames == 0 || budgetMB == 0 || !(fps > 0.0f)) {
+        printf("invalid splat count, chunk size, frame count, budget or frame rate\n");
+        return 1;
+    }
+
+    if (!splatToolInit("SplatChunk"))
+        return 1;
+
+    ThreadSystem         threadSystem = NULL;
+    ThreadSystemInitDesc threadSystemDesc = {};
+    threadSystemDesc.mThreadCount = getNumCPUCores() > 1 ? getNumCPUCores() - 1 : 1;
+    initThreadSystem(&threadSystemDesc, &threadSystem);
+
+    const int result = convert ? convertScene(threadSystem, filePath, scenePath, numSplats, chunkCapacity)
+                               : replayPath(threadSystem, filePath, cameraPathFile, numFrames, budgetMB, fps, stallMs);
+
+    exitThreadSystem(threadSystem);
+    splatToolExit();
+    return result;
+}
@@ -0,0 +1,208 @@
+/*
+ * Copyright (c) 2017-2024 The Forge Interactive Inc.
+ *
+ * This file is part of The-Forge
+ * (see https://github.com/ConfettiFX/The-Forge).
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+// Scaling of the reference rasterizer on the job system: the same view is
+// rendered with 1, 2, 4, ... workers up to --max-workers and the mean time of
+// every stage, the speedup and the parallel efficiency over one worker are
+// printed, with the work stealing counters. Every image is compared with the
+// one worker image, the stages are deterministic so they have to match.
+// The blend columns give the slowest and the mean blend thread and their
+// ratio, the load imbalance of the frame.
+//
+//   splat_job_bench [scene.ply] [--count splats] [--frames n] [--size width height] [--max-workers n]
+//                   [--hotspot fraction] [--tile-order]
+//
+// Without a scene a random cloud is used. --hotspot packs that fraction of
+// the splats into a small ball in the middle of the view, so a few tiles
+// hold most of the overlaps. --tile-order blends whole tiles in tile order
+// instead of the balanced plan, as a baseline. The thread system gets enough
+// threads for the largest worker count, more workers than cores are
+// oversubscribed and the summary says so.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Forge/Core/TF_Time.h"
+#include "Forge/Mem/TF_Memory.h"
+#include "Common_3/Utilities/Threading/ThreadSystem.h"
+
+#include "Splat/SplatJobs.h"
+#include "Splat/SplatMorton.h"
+#include "Splat/SplatRaster.h"
+
+#include "Tools/SplatToolCommon.h"
+
+// big, kept out of the stack of main
+static struct SplatJobSystem gJobSystem;
+
+int main(int argc, char** argv) {
+    const char* scenePath = NULL;
+    uint64_t    numSplats = 1000000;
+    uint32_t    numFrames = 8;
+    uint32_t    width = 1920;
+    uint32_t    height = 1080;
+    uint32_t    maxWorkers = 32;
+    float       hotspot = 0.0f;
+    bool        tileOrder = false;
+
+    const struct SplatToolOptions options = { &scenePath, NULL, &numSplats, &numFrames, &width, &height };
+    for (int argIdx = 1; argIdx < argc; argIdx++) {
+        if (splatToolParseOption(&options, argc, argv, &argIdx))
+            continue;
+        if (!strcmp(argv[argIdx], "--max-workers") && argIdx + 1 < argc)
+            maxWorkers = (uint32_t)atoi(argv[++argIdx]);
+        else if (!strcmp(argv[argIdx], "--hotspot") && argIdx + 1 < argc)
+            hotspot = (float)atof(argv[++argIdx]);
+        else if (!strcmp(argv[argIdx], "--tile-order"))
+            tileOrder = true;
+        else {
+            printf("usage: %s [scene.ply] [--count splats] [--frames n] [--size width height] [--max-workers n] [--hotspot fraction] "
+                   "[--tile-order]\n",
+                   argv[0]);
+            return 1;
+        }
+    }
+    if (numSplats == 0 || numFrames == 0 || width == 0 || height == 0 || maxWorkers == 0 || maxWorkers > SPLAT_JOB_MAX_WORKERS ||
+        !(hotspot >= 0.0f && hotspot <= 1.0f)) {
+        printf("invalid splat count, frame count, image size, worker count or hotspot fraction\n");
+        return 1;
+    }
+
+    if (!splatToolInit("SplatJobBench"))
+        return 1;
+
+    const uint32_t       numCores = getNumCPUCores();
+    ThreadSystem         threadSystem = NULL;
+    ThreadSystemInitDesc threadSystemDesc = {};
+    threadSystemDesc.mThreadCount = maxWorkers > 1 ? maxWorkers - 1 : 1;
+    initThreadSystem(&threadSystemDesc, &threadSystem);
+
+    int                 result = 1;
+    struct SplatStreams streams = {};
+    if (splatToolLoadScene(threadSystem, scenePath, 50.0f, &streams, &numSplats)) {
+        struct Tf32x3_s boundsMin, boundsMax;
+        splatComputeBounds(threadSystem, streams.pPositions, numSplats, &boundsMin, &boundsMax, NULL);
+        const struct Tf32x3_s center = { 0.5f * (boundsMin.x + boundsMax.x), 0.5f * (boundsMin.y + boundsMax.y),
+                                         0.5f * (boundsMin.z + boundsMax.z) };
+        const struct Tf32x3_s eye = { center.x, center.y, center.z - 0.8f * (boundsMax.z - boundsMin.z) };
+        // every step-th splat moves into a ball a fiftieth of the scene across, around the center
+        const uint64_t step = hotspot > 0.0f ? (uint64_t)(1.0f / hotspot) : 0;
+        const float    ballRadius = 0.01f * (boundsMax.x - boundsMin.x);
+        for (uint64_t i = 0; step && i < numSplats; i += step) {
+            const struct Tf32x3_s p = streams.pPositions[i];
+            streams.pPositions[i] = { center.x + (p.x - center.x) / (boundsMax.x - boundsMin.x) * 2.0f * ballRadius,
+                                      center.y + (p.y - center.y) / (boundsMax.y - boundsMin.y) * 2.0f * ballRadius,
+                                      center.z + (p.z - center.z) / (boundsMax.z - boundsMin.z) * 2.0f * ballRadius };
+        }
+        struct SplatCamera    camera = {};
+        splatCameraLookAt(eye, center, { 0.0f, -1.0f, 0.0f }, 60.0f * 3.14159265f / 180.0f, width, height, &camera);
+
+        const uint64_t         numValues = (uint64_t)width * height * 3;
+        float*                 referenceImage = (float*)tf_malloc(sizeof(float) * numValues);
+        struct SplatRasterizer rasterizer;
+        splatRasterizerInit(&rasterizer);
+        rasterizer.mTileOrderBlend = tileOrder;
+
+        printf("# %llu splats, %ux%u, %u frames, %u cores\n", (unsigned long long)numSplats, width, height, numFrames, numCores);
+        printf("workers,cull_us,project_us,sh_us,bin_us,sort_us,blend_us,total_us,speedup,efficiency,ranges,steals,max_diff,"
+               "blend_max_thread_us,blend_mean_thread_us,imbalance,max_tile_pairs,split_tiles\n");
+        double   baseUs = 0.0;
+        double   lastEfficiency = 0.0;
+        uint32_t lastWorkers = 0;
+        bool     identical = true;
+        result = 0;
+        for (uint32_t workers = 1; workers <= maxWorkers; workers *= 2) {
+            splatJobSystemInit(&gJobSystem, threadSystem, workers);
+            // warm up the scratch of the rasterizer
+            splatRasterize(&gJobSystem, &rasterizer, &camera, numSplats, &streams, NULL);
+
+            double   stageUs[6] = {};
+            double   totalUs = 0.0;
+            uint64_t numRanges = 0, numSteals = 0;
+            double   blendMaxThreadUs = 0.0, blendMeanThreadUs = 0.0, imbalance = 0.0;
+            uint32_t maxTilePairs = 0, numSplitTiles = 0;
+            for (uint32_t frame = 0; frame < numFrames; frame++) {
+                struct SplatRasterStats stats = {};
+                const int64_t           startUs = getUSec(false);
+                if (!splatRasterize(&gJobSystem, &rasterizer, &camera, numSplats, &streams, &stats)) {
+                    result = 1;
+                    break;
+                }
+                totalUs += (double)(getUSec(false) - startUs);
+                stageUs[0] += (double)stats.mCullUs;
+                stageUs[1] += (double)stats.mProjectUs;
+                stageUs[2] += (double)stats.mShUs;
+                stageUs[3] += (double)stats.mBinUs;
+                stageUs[4] += (double)stats.mSortUs;
+                stageUs[5] += (double)stats.mBlendUs;
+                numRanges += stats.mJobs.mNumRanges;
+                numSteals += stats.mJobs.mNumSteals;
+                blendMaxThreadUs += (double)stats.mBlendMaxThreadUs;
+                blendMeanThreadUs += (double)stats.mBlendMeanThreadUs;
+                imbalance += stats.mBlendMeanThreadUs ? (double)stats.mBlendMaxThreadUs / (double)stats.mBlendMeanThreadUs : 1.0;
+                maxTilePairs = stats.mMaxTilePairs;
+                numSplitTiles = stats.mNumSplitTiles;
+            }
+            const uint32_t numWorkers = gJobSystem.mNumWorkers;
+            splatJobSystemExit(&gJobSystem);
+            if (result)
+                break;
+
+            if (workers == 1)
+                memcpy(referenceImage, rasterizer.pImage, sizeof(float) * numValues);
+            float maxDiff = 0.0f;
+            for (uint64_t i = 0; i < numValues; i++)
+                maxDiff = fmaxf(maxDiff, fabsf(rasterizer.pImage[i] - referenceImage[i]));
+            identical = identical && maxDiff == 0.0f;
+
+            totalUs /= numFrames;
+            if (workers == 1)
+                baseUs = totalUs;
+            const double speedup = baseUs / totalUs;
+            lastEfficiency = speedup / numWorkers;
+            lastWorkers = numWorkers;
+            printf("%u,%.0f,%.0f,%.0f,%.0f,%.0f,%.0f,%.0f,%.2f,%.2f,%llu,%llu,%g,", numWorkers, stageUs[0] / numFrames,
+                   stageUs[1] / numFrames, stageUs[2] / numFrames, stageUs[3] / numFrames, stageUs[4] / numFrames, stageUs[5] / numFrames,
+                   totalUs, speedup, lastEfficiency, (unsigned long long)(numRanges / numFrames),
+                   (unsigned long long)(numSteals / numFrames), maxDiff);
+            printf("%.0f,%.0f,%.2f,%u,%u\n", blendMaxThreadUs / numFrames, blendMeanThreadUs / numFrames, imbalance / numFrames,
+                   maxTilePairs, numSplitTiles);
+        }
+        if (!result) {
+            printf("# %u workers: efficiency %.2f, images %s%s\n", lastWorkers, lastEfficiency, identical ? "identical" : "DIFFER",
+                   lastWorkers > numCores ? ", oversubscribed" : "");
+            result = identical ? 0 : 1;
+        }
+
+        splatRasterizerExit(&rasterizer);
+        tf_free(referenceImage);
+        splatFreeStreams(&streams);
+    }
+
+    exitThreadSystem(threadSystem);
+    splatToolExit();
+    return result;
+}
@@ -0,0 +1,261 @@
+/*
+ * Copyright (c) 2017-2024 The Forge Interactive Inc.
+ *
+ * This file is part of The-Forge
+ * (see https://github.com/ConfettiFX/The-Forge).
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+// Before and after numbers for the Morton reorder of the splat streams: the
+// same camera path is rendered with the streams in file order and again
+// after splatMortonReorderStreams.
+//
+//   splat_locality_bench [scene.ply] [--count splats] [--path camera_path.txt] [--frames n] [--size width height] [--cache-kb size]
+//
+// Per frame it reports the reference rasterizer time and the misses of a
+// simulated 8 way LRU cache with 64 byte lines (1 MB by default) for the two
+// gathers that depend on the stream order:
+// - blend, the pProjected reads of the tile sorted (tile, splat) pairs
+// - cull, reading every stream of the splats the BVH finds in the frustum
+// The simulation keeps the numbers comparable between machines, hardware
+// counters are left to a profiler.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Forge/Core/TF_Time.h"
+#include "Forge/Mem/TF_Memory.h"
+#include "Common_3/Utilities/Threading/ThreadSystem.h"
+
+#include "Splat/SplatBvh.h"
+#include "Splat/SplatCameraPath.h"
+#include "Splat/SplatJobs.h"
+#include "Splat/SplatMorton.h"
+#include "Splat/SplatRaster.h"
+
+#include "Tools/SplatToolCommon.h"
+
+#define CACHE_LINE_SIZE 64u
+#define CACHE_WAYS 8u
+
+struct SimulatedCache {
+    uint64_t* pTags; // line address + 1 per way, 0 is empty
+    uint64_t* pAges;
+    uint64_t  mNumSets;
+    uint64_t  mClock;
+    uint64_t  mNumAccesses;
+    uint64_t  mNumMisses;
+};
+
+// big, kept out of the stack of main
+static struct SplatJobSystem gJobSystem;
+
+static void cacheInit(struct SimulatedCache* cache, uint64_t sizeKb) {
+    memset(cache, 0, sizeof(struct SimulatedCache));
+    cache->mNumSets = sizeKb * 1024 / (CACHE_LINE_SIZE * CACHE_WAYS);
+    if (cache->mNumSets == 0)
+        cache->mNumSets = 1;
+    cache->pTags = (uint64_t*)tf_calloc(cache->mNumSets * CACHE_WAYS, sizeof(uint64_t));
+    cache->pAges = (uint64_t*)tf_calloc(cache->mNumSets * CACHE_WAYS, sizeof(uint64_t));
+}
+
+static void cacheReset(struct SimulatedCache* cache) {
+    memset(cache->pTags, 0, sizeof(uint64_t) * cache->mNumSets * CACHE_WAYS);
+    cache->mNumAccesses = 0;
+    cache->mNumMisses = 0;
+}
+
+static void cacheExit(struct SimulatedCache* cache) {
+    tf_free(cache->pTags);
+    tf_free(cache->pAges);
+}
+
+static void cacheAccessLine(struct SimulatedCache* cache, uint64_t line) {
+    uint64_t* tags = cache->pTags + (line % cache->mNumSets) * CACHE_WAYS;
+    uint64_t* ages = cache->pAges + (line % cache->mNumSets) * CACHE_WAYS;
+    cache->mNumAccesses++;
+    cache->mClock++;
+    uint32_t victim = 0;
+    for (uint32_t way = 0; way < CACHE_WAYS; way++) {
+        if (tags[way] == line + 1) {
+            ages[way] = cache->mClock;
+            return;
+        }
+        // an empty way wins, otherwise the least recently used one
+        if (tags[victim] != 0 && (tags[way] == 0 || ages[way] < ages[victim]))
+            victim = way;
+    }
+    cache->mNumMisses++;
+    tags[victim] = line + 1;
+    ages[victim] = cache->mClock;
+}
+
+static void cacheAccess(struct SimulatedCache* cache, const void* address, uint64_t size) {
+    const uint64_t first = (uint64_t)(uintptr_t)address / CACHE_LINE_SIZE;
+    const uint64_t last = ((uint64_t)(uintptr_t)address + size - 1) / CACHE_LINE_SIZE;
+    for (uint64_t line = first; line <= last; line++)
+        cacheAccessLine(cache, line);
+}
+
+struct FrameTotals {
+    double mFrameUs;
+    double mBlendUs;
+    double mCullUs;
+    double mBlendMisses;
+    double mCullMisses;
+    double mBlendAccesses;
+    double mCullAccesses;
+};
+
+static void runPath(ThreadSystem threadSystem, const char* label, const struct SplatStreams* streams, uint64_t numSplats,
+                    const struct SplatCameraPath* path, uint32_t width, uint32_t height, uint64_t cacheKb, struct FrameTotals* totals) {
+    struct SplatBvh bvh;
+    splatBvhBuild(threadSystem, numSplats, streams, &bvh, NULL);
+    struct SplatRasterizer rasterizer;
+    splatRasterizerInit(&rasterizer);
+    struct SimulatedCache cache;
+    cacheInit(&cache, cacheKb);
+    uint32_t* visible = (uint32_t*)tf_malloc(sizeof(uint32_t) * numSplats);
+    memset(totals, 0, sizeof(struct FrameTotals));
+
+    for (uint32_t frame = 0; frame < path->mNumKeys; frame++) {
+        const struct SplatCameraKey* key = &path->pKeys[frame];
+        struct SplatCamera           camera = {};
+        splatCameraLookAt(key->mEye, key->mTarget, key->mUp, key->mFovY, width, height, &camera);
+
+        struct SplatRasterStats stats = {};
+        const int64_t           startUs = getUSec(false);
+        splatRasterize(&gJobSystem, &rasterizer, &camera, numSplats, streams, &stats);
+        const int64_t frameUs = getUSec(false) - startUs;
+
+        cacheReset(&cache);
+        for (uint64_t pair = 0; pair < stats.mNumTilePairs; pair++)
+            cacheAccess(&cache, &rasterizer.pProjected[rasterizer.pValues[pair]], sizeof(struct SplatProjected));
+        const uint64_t blendMisses = cache.mNumMisses;
+        const uint64_t blendAccesses = cache.mNumAccesses;
+
+        struct SplatFrustum frustum;
+        splatFrustumFromCamera(&camera, 1e30f, &frustum);
+        const int64_t  cullStartUs = getUSec(false);
+        const uint64_t numVisible = splatBvhCullFrustum(threadSystem, &bvh, &frustum, visible);
+        const int64_t  cullUs = getUSec(false) - cullStartUs;
+        cacheReset(&cache);
+        for (uint64_t i = 0; i < numVisible; i++) {
+            const uint32_t splat = visible[i];
+            cacheAccess(&cache, &streams->pPositions[splat], sizeof(struct Tf32x3_s));
+            cacheAccess(&cache, &streams->pScales[splat], sizeof(struct Tf32x3_s));
+            cacheAccess(&cache, &streams->pRotations[splat], sizeof(struct Tf32x4_s));
+            cacheAccess(&cache, &streams->pOpacities[splat], sizeof(float));
+            cacheAccess(&cache, &streams->pShs[splat], sizeof(struct SphericalHarmonics));
+        }
+
+        printf("%s,%u,%lld,%lld,%llu,%llu,%llu,%lld,%llu,%llu\n", label, frame, (long long)frameUs, (long long)stats.mBlendUs,
+               (unsigned long long)stats.mNumTilePairs, (unsigned long long)blendMisses, (unsigned long long)numVisible, (long long)cullUs,
+               (unsigned long long)cache.mNumMisses, (unsigned long long)cache.mNumAccesses);
+        totals->mFrameUs += (double)frameUs;
+        totals->mBlendUs += (double)stats.mBlendUs;
+        totals->mCullUs += (double)cullUs;
+        totals->mBlendMisses += (double)blendMisses;
+        totals->mBlendAccesses += (double)blendAccesses;
+        totals->mCullMisses += (double)cache.mNumMisses;
+        totals->mCullAccesses += (double)cache.mNumAccesses;
+    }
+
+    tf_free(visible);
+    cacheExit(&cache);
+    splatRasterizerExit(&rasterizer);
+    splatBvhFree(&bvh);
+}
+
+static void printTotals(const char* label, const struct FrameTotals* totals, uint32_t numFrames) {
+    printf("# %-11s frame %8.2f ms, blend %8.2f ms, blend misses %10.0f (%5.1f%%), cull %6.2f ms, cull misses %10.0f (%5.1f%%)\n", label,
+           totals->mFrameUs / numFrames / 1000.0, totals->mBlendUs / numFrames / 1000.0, totals->mBlendMisses / numFrames,
+           totals->mBlendAccesses > 0.0 ? 100.0 * totals->mBlendMisses / totals->mBlendAccesses : 0.0, totals->mCullUs / numFrames / 1000.0,
+           totals->mCullMisses / numFrames, totals->mCullAccesses > 0.0 ? 100.0 * totals->mCullMisses / totals->mCullAccesses : 0.0);
+}
+
+int main(int argc, char** argv) {
+    const char* scenePath = NULL;
+    const char* cameraPathFile = NULL;
+    uint64_t    numSplats = 1000000;
+    uint32_t    numFrames = 16;
+    uint32_t    width = 1280;
+    uint32_t    height = 720;
+    uint64_t    cacheKb = 1024;
+
+    const struct SplatToolOptions options = { &scenePath, &cameraPathFile, &numSplats, &numFrames, &width, &height };
+    for (int argIdx = 1; argIdx < argc; argIdx++) {
+        if (splatToolParseOption(&options, argc, argv, &argIdx))
+            continue;
+        if (!strcmp(argv[argIdx], "--cache-kb") && argIdx + 1 < argc)
+            cacheKb = strtoull(argv[++argIdx], NULL, 10);
+        else {
+            printf("usage: %s [scene.ply] [--count splats] [--path camera_path.txt] [--frames n] [--size width height] [--cache-kb size]\n",
+                   argv[0]);
+            return 1;
+        }
+    }
+    if (numSplats == 0 || numFrames == 0 || width == 0 || height == 0 || cacheKb == 0) {
+        printf("invalid splat count, frame count, image size or cache size\n");
+        return 1;
+    }
+
+    if (!splatToolInit("SplatLocalityBench"))
+        return 1;
+
+    ThreadSystem         threadSystem = NULL;
+    ThreadSystemInitDesc threadSystemDesc = {};
+    threadSystemDesc.mThreadCount = getNumCPUCores() > 1 ? getNumCPUCores() - 1 : 1;
+    initThreadSystem(&threadSystemDesc, &threadSystem);
+    splatJobSystemInit(&gJobSystem, threadSystem, threadSystemDesc.mThreadCount + 1);
+
+    int                    result = 1;
+    struct SplatStreams    streams = {};
+    const bool             loaded = splatToolLoadScene(threadSystem, scenePath, 50.0f, &streams, &numSplats);
+    struct SplatCameraPath cameraPath = {};
+    const bool             havePath =
+        loaded && splatToolLoadCameraPath(threadSystem, cameraPathFile, 1.0f, &streams, numSplats, 0.3f, numFrames, &cameraPath);
+    if (havePath) {
+        printf("# %llu splats, %ux%u, %u frames, simulated %llu KB cache\n", (unsigned long long)numSplats, width, height,
+               cameraPath.mNumKeys, (unsigned long long)cacheKb);
+        printf("order,frame,frame_us,blend_us,tile_pairs,blend_misses,visible,cull_us,cull_misses,cull_accesses\n");
+        struct FrameTotals fileOrder, mortonOrder;
+        runPath(threadSystem, "file", &streams, numSplats, &cameraPath, width, height, cacheKb, &fileOrder);
+
+        const int64_t startUs = getUSec(false);
+        if (splatMortonReorderStreams(threadSystem, &streams, numSplats, false)) {
+            const int64_t reorderUs = getUSec(false) - startUs;
+            runPath(threadSystem, "morton", &streams, numSplats, &cameraPath, width, height, cacheKb, &mortonOrder);
+            printf("# reorder %.2f ms\n", reorderUs / 1000.0);
+            printTotals("file order", &fileOrder, cameraPath.mNumKeys);
+            printTotals("morton", &mortonOrder, cameraPath.mNumKeys);
+            result = 0;
+        }
+        splatCameraPathFree(&cameraPath);
+    }
+    if (loaded)
+        splatFreeStreams(&streams);
+
+    splatJobSystemExit(&gJobSystem);
+    exitThreadSystem(threadSystem);
+    splatToolExit();
+    return result;
+}
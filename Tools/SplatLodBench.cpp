@@ -0,0 +1,206 @@
+/*
+ * Copyright (c) 2017-2024 The Forge Interactive Inc.
+ *
+ * This file is part of The-Forge
+ * (see https://github.com/ConfettiFX/The-Forge).
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+// Benchmark of the splat LOD hierarchy: build time and size, then per frame
+// along a camera path the cut size, its screen space error and the time of
+// the reference rasterizer on the cut compared with the full scene.
+//
+//   splat_lod_bench [scene.ply] [--count splats] [--path camera_path.txt] [--frames n] [--size width height] [--error pixels]
+//
+// Without a scene a random cloud is used, without a path the camera orbits
+// the scene. The first frame is also cut at half and double resolution to
+// show how the cut follows the image size.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Forge/Core/TF_Time.h"
+#include "Forge/Mem/TF_Memory.h"
+#include "Common_3/Utilities/Threading/ThreadSystem.h"
+
+#include "Splat/SplatCameraPath.h"
+#include "Splat/SplatJobs.h"
+#include "Splat/SplatLod.h"
+#include "Splat/SplatRaster.h"
+
+#include "Tools/SplatToolCommon.h"
+
+// big, kept out of the stack of main
+static struct SplatJobSystem gJobSystem;
+
+static double imagePsnr(const float* a, const float* b, uint64_t numValues) {
+    double squaredError = 0.0;
+    for (uint64_t i = 0; i < numValues; i++) {
+        const double d = fmin(fmax((double)a[i], 0.0), 1.0) - fmin(fmax((double)b[i], 0.0), 1.0);
+        squaredError += d * d;
+    }
+    const double mse = squaredError / (double)numValues;
+    return mse > 0.0 ? 10.0 * log10(1.0 / mse) : INFINITY;
+}
+
+static void makeCutDesc(const struct SplatCamera* camera, float maxErrorPixels, const struct SplatFrustum* frustum,
+                        struct SplatLodCutDesc* out) {
+    out->mEye = camera->mPosition;
+    out->mFocalPixels = camera->mFocalY;
+    out->mMaxErrorPixels = maxErrorPixels;
+    out->pFrustum = frustum;
+}
+
+int main(int argc, char** argv) {
+    const char* scenePath = NULL;
+    const char* cameraPathFile = NULL;
+    uint64_t    numSplats = 1000000;
+    uint32_t    numFrames = 8;
+    uint32_t    width = 1280;
+    uint32_t    height = 720;
+    float       maxErrorPixels = 1.0f;
+
+    const struct SplatToolOptions options = { &scenePath, &cameraPathFile, &numSplats, &numFrames, &width, &height };
+    for (int argIdx = 1; argIdx < argc; argIdx++) {
+        if (splatToolParseOption(&options, argc, argv, &argIdx))
+            continue;
+        if (!strcmp(argv[argIdx], "--error") && argIdx + 1 < argc)
+            maxErrorPixels = (float)atof(argv[++argIdx]);
+        else {
+            printf("usage: %s [scene.ply] [--count splats] [--path camera_path.txt] [--frames n] [--size width height] [--error pixels]\n",
+                   argv[0]);
+            return 1;
+        }
+    }
+    if (numSplats == 0 || numFrames == 0 || width == 0 || height == 0 || !(maxErrorPixels > 0.0f)) {
+        printf("invalid splat count, frame count, image size or error\n");
+        return 1;
+    }
+
+    if (!splatToolInit("SplatLodBench"))
+        return 1;
+
+    ThreadSystem         threadSystem = NULL;
+    ThreadSystemInitDesc threadSystemDesc = {};
+    threadSystemDesc.mThreadCount = getNumCPUCores() > 1 ? getNumCPUCores() - 1 : 1;
+    initThreadSystem(&threadSystemDesc, &threadSystem);
+    splatJobSystemInit(&gJobSystem, threadSystem, threadSystemDesc.mThreadCount + 1);
+
+    int                       result = 1;
+    struct SplatStreams       streams = {};
+    const bool                loaded = splatToolLoadScene(threadSystem, scenePath, 50.0f, &streams, &numSplats);
+    struct SplatLod           lod = {};
+    struct SplatLodBuildStats buildStats = {};
+    int64_t                   startUs = getUSec(false);
+    const bool                built = loaded && splatLodBuild(threadSystem, numSplats, &streams, &lod, &buildStats);
+    const int64_t             buildUs = getUSec(false) - startUs;
+
+    struct SplatCameraPath cameraPath = {};
+    const bool             havePath =
+        built && splatToolLoadCameraPath(threadSystem, cameraPathFile, 1.0f, &streams, numSplats, 0.8f, numFrames, &cameraPath);
+
+    if (havePath) {
+        const uint64_t mergedBytes = lod.mNumMerged * (sizeof(struct Tf32x3_s) * 2 + sizeof(struct Tf32x4_s) + sizeof(float) +
+                                                       sizeof(struct SphericalHarmonics) + sizeof(uint32_t) * 4 + sizeof(uint8_t));
+        printf("# %llu splats, %llu merged nodes in %u levels, %.1f MB, build %.2f ms (morton %.2f ms, merge %.2f ms)\n",
+               (unsigned long long)numSplats, (unsigned long long)lod.mNumMerged, lod.mNumLevels, mergedBytes / (1024.0 * 1024.0),
+               buildUs / 1000.0, buildStats.mMortonUs / 1000.0, buildStats.mMergeUs / 1000.0);
+
+        uint32_t*              nodes = (uint32_t*)tf_malloc(sizeof(uint32_t) * (lod.mNumSplats + lod.mNumMerged));
+        struct SplatStreams    cutStreams = {};
+        struct SplatRasterizer fullRasterizer, cutRasterizer;
+        splatAllocStreams(&cutStreams, lod.mNumSplats + lod.mNumMerged);
+        splatRasterizerInit(&fullRasterizer);
+        splatRasterizerInit(&cutRasterizer);
+
+        // same view at other resolutions, the cut grows with the focal length in pixels
+        {
+            const struct SplatCameraKey* key = &cameraPath.pKeys[0];
+            const uint32_t               scales[] = { 1, 2, 4 };
+            for (uint32_t i = 0; i < TF_ARRAY_COUNT(scales); i++) {
+                struct SplatCamera camera = {};
+                splatCameraLookAt(key->mEye, key->mTarget, key->mUp, key->mFovY, width * scales[i] / 2, height * scales[i] / 2,
+                                  &camera);
+                struct SplatFrustum frustum;
+                splatFrustumFromCamera(&camera, 1e30f, &frustum);
+                struct SplatLodCutDesc  cutDesc;
+                struct SplatLodCutStats cutStats;
+                makeCutDesc(&camera, maxErrorPixels, &frustum, &cutDesc);
+                splatLodCut(&lod, &cutDesc, nodes, &cutStats);
+                printf("# %ux%u: cut %llu nodes (%llu merged) for %llu splats\n", camera.mWidth, camera.mHeight,
+                       (unsigned long long)cutStats.mNumNodes, (unsigned long long)cutStats.mNumMerged,
+                       (unsigned long long)cutStats.mNumRepresented);
+            }
+        }
+
+        double totalFullUs = 0.0, totalCutUs = 0.0, totalCutNodes = 0.0, totalPsnr = 0.0;
+        printf("frame,cut_nodes,merged,represented,culled,max_error_px,mean_error_px,cut_us,full_raster_us,cut_raster_us,psnr\n");
+        for (uint32_t frame = 0; frame < cameraPath.mNumKeys; frame++) {
+            const struct SplatCameraKey* key = &cameraPath.pKeys[frame];
+            struct SplatCamera           camera = {};
+            splatCameraLookAt(key->mEye, key->mTarget, key->mUp, key->mFovY, width, height, &camera);
+            struct SplatFrustum frustum;
+            splatFrustumFromCamera(&camera, 1e30f, &frustum);
+            struct SplatLodCutDesc  cutDesc;
+            struct SplatLodCutStats cutStats;
+            makeCutDesc(&camera, maxErrorPixels, &frustum, &cutDesc);
+            const uint64_t numNodes = splatLodCut(&lod, &cutDesc, nodes, &cutStats);
+
+            startUs = getUSec(false);
+            splatRasterize(&gJobSystem, &fullRasterizer, &camera, numSplats, &streams, NULL);
+            const int64_t fullUs = getUSec(false) - startUs;
+            // the gather is part of the cut cost, the app uploads node ids instead
+            startUs = getUSec(false);
+            splatLodGatherStreams(&lod, &streams, nodes, numNodes, &cutStreams);
+            splatRasterize(&gJobSystem, &cutRasterizer, &camera, numNodes, &cutStreams, NULL);
+            const int64_t cutUs = getUSec(false) - startUs;
+            const double  psnr = imagePsnr(fullRasterizer.pImage, cutRasterizer.pImage, (uint64_t)width * height * 3);
+
+            printf("%u,%llu,%llu,%llu,%llu,%.3f,%.3f,%lld,%lld,%lld,%.2f\n", frame, (unsigned long long)numNodes,
+                   (unsigned long long)cutStats.mNumMerged, (unsigned long long)cutStats.mNumRepresented,
+                   (unsigned long long)cutStats.mNumCulled, cutStats.mMaxErrorPixels, cutStats.mMeanErrorPixels,
+                   (long long)cutStats.mDurationUs, (long long)fullUs, (long long)cutUs, psnr);
+            totalFullUs += (double)fullUs;
+            totalCutUs += (double)cutUs;
+            totalCutNodes += (double)numNodes;
+            totalPsnr += psnr;
+        }
+        printf("# mean cut %.0f nodes (%.1f%% of the splats), full raster %.2f ms, cut raster %.2f ms, psnr %.2f dB\n",
+               totalCutNodes / cameraPath.mNumKeys, 100.0 * totalCutNodes / cameraPath.mNumKeys / numSplats,
+               totalFullUs / cameraPath.mNumKeys / 1000.0, totalCutUs / cameraPath.mNumKeys / 1000.0, totalPsnr / cameraPath.mNumKeys);
+
+        splatRasterizerExit(&fullRasterizer);
+        splatRasterizerExit(&cutRasterizer);
+        splatFreeStreams(&cutStreams);
+        tf_free(nodes);
+        splatCameraPathFree(&cameraPath);
+        result = 0;
+    }
+    if (built)
+        splatLodFree(&lod);
+    if (loaded)
+        splatFreeStreams(&streams);
+
+    splatJobSystemExit(&gJobSystem);
+    exitThreadSystem(threadSystem);
+    splatToolExit();
+    return result;
+}
@@ -0,0 +1,355 @@
+/*
+ * Copyright (c) 2017-2024 The Forge Interactive Inc.
+ *
+ * This file is part of The-Forge
+ * (see https://github.com/ConfettiFX/The-Forge).
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+// Benchmark and check of the CPU twin of the GPU preprocess pass.
+//
+//   splat_preprocess_bench [scene.ply] [--count splats] [--iterations n] [--sh degree] [--quality level]
+//
+// Without a scene a random cloud around the origin is used. A SplatQuality
+// level above 0 feeds the twin the SH above the dc band from the compressed
+// copy, as the app uploads it, and the reference the same bands decoded by
+// splatDequantize. The twin runs
+// single threaded and is compared to splatProjectScalar: both must keep the
+// same splats, and the projection may only differ by the rounding of the
+// exact-rounding helpers that replace division, sqrt and exp, within the ulp
+// tolerances below. No GPU is involved. A second run
+// has to reproduce the first bit for bit. The area of the quads the draw
+// rasterizes is reported next to squares over the culling radius. The
+// bitonic network of the sort passes has to order the visible list like a
+// comparison sort, back to front with ties in splat order.
+//
+// The bytes the kernel fetches per frame are counted in 32 byte sectors,
+// walking the reads each thread makes up to where it culls its splat, for
+// the packed hot and cold inputs and for the separate float streams they
+// replaced (positions, scales, rotations, opacities and whole SH records).
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Forge/Core/TF_Time.h"
+#include "Forge/Mem/TF_Memory.h"
+
+#include "Splat/SplatPreprocess.h"
+#include "Splat/SplatRaster.h"
+
+#include "Tools/SplatToolCommon.h"
+
+// Back to front, the order of the sort passes.
+static int compareVisible(const void* a, const void* b) {
+    const uint64_t* entryA = (const uint64_t*)a;
+    const uint64_t* entryB = (const uint64_t*)b;
+    return *entryA < *entryB ? 1 : *entryA > *entryB ? -1 : 0;
+}
+
+// Tolerances of the twin against splatProjectScalar, in units in the last
+// place. The mean is measured in ulps of the viewport extent, it is offset by
+// the principal point. The conic is measured in ulps of its larger eigenvalue
+// per unit of condition number, inverting the covariance scales its rounding
+// by it. Opacity and color are measured in ulps of halves, the precision of
+// their inputs, the color in those of 0.5 at least, the offset of the dc term.
+#define MEAN_TOLERANCE_ULPS 4.0f
+#define DEPTH_TOLERANCE_ULPS 4.0f
+#define CONIC_TOLERANCE_ULPS 128.0f
+#define HALF_TOLERANCE_ULPS 4.0f
+
+// |reference - value| in ulps of a float with mantissaBits explicit bits at
+// the magnitude of reference, or of scale when that is larger.
+static float ulpError(float reference, float value, float scale, int mantissaBits) {
+    int exponent;
+    frexpf(fmaxf(fabsf(reference), scale), &exponent);
+    return fabsf(reference - value) / ldexpf(1.0f, exponent - 1 - mantissaBits);
+}
+
+// Distinct 32 byte sectors of one buffer touched by a frame.
+struct SectorSet {
+    uint8_t* pSectors;
+    uint64_t mNumTouched;
+};
+
+static void sectorsInit(struct SectorSet* set, uint64_t bufferSize) {
+    set->pSectors = (uint8_t*)tf_calloc((bufferSize + 31) / 32, 1);
+    set->mNumTouched = 0;
+}
+
+static void sectorsTouch(struct SectorSet* set, uint64_t offset, uint64_t size) {
+    for (uint64_t sector = offset / 32; sector <= (offset + size - 1) / 32; sector++) {
+        set->mNumTouched += set->pSectors[sector] ? 0 : 1;
+        set->pSectors[sector] = 1;
+    }
+}
+
+// Bytes a frame fetches: near culled threads only read the position, visible
+// ones also the opacity and the SH coefficients of the degree, in the cold
+// layout of the block and from the table of numTable floats.
+static void fetchedBytes(const struct SplatPreprocessBlock* block, const struct SplatGpuSplat* splats,
+                         const struct SplatGpuShRestInput* shRest, uint64_t numTable, const struct SplatPreprocessRecord* records,
+                         uint64_t numSplats, uint64_t* outPacked, uint64_t* outStreams) {
+    const uint32_t degree = block->mParams[1];
+    const uint32_t numRest = (degree + 1) * (degree + 1) - 1;
+    const uint32_t encoding = block->mParams[2];
+    enum { HOT, COLD, TABLE, POSITIONS, SCALES, ROTATIONS, OPACITIES, SHS, NUM_BUFFERS };
+    const uint64_t   strides[NUM_BUFFERS] = { sizeof(struct SplatGpuSplat), sizeof(uint32_t) * splatGpuShRestWords(encoding), 0, 12, 12, 16,
+                                              4, sizeof(struct SphericalHarmonics) };
+    struct SectorSet sets[NUM_BUFFERS];
+    for (uint32_t b = 0; b < NUM_BUFFERS; b++)
+        sectorsInit(&sets[b], b == TABLE ? sizeof(float) * numTable : strides[b] * numSplats);
+    const float* v = block->mView;
+    for (uint64_t i = 0; i < numSplats; i++) {
+        const float* p = splats[i].mPosition;
+        const bool   nearCulled = v[8] * p[0] + v[9] * p[1] + v[10] * p[2] + v[11] <= block->mViewport[2];
+        const bool   visible = records[i].mRadius != 0.0f;
+        sectorsTouch(&sets[HOT], i * strides[HOT], 16);
+        sectorsTouch(&sets[POSITIONS], i * strides[POSITIONS], 12);
+        if (nearCulled)
+            continue;
+        sectorsTouch(&sets[HOT], i * strides[HOT] + 16, 32);
+        sectorsTouch(&sets[SCALES], i * strides[SCALES], 12);
+        sectorsTouch(&sets[ROTATIONS], i * strides[ROTATIONS], 16);
+        if (!visible)
+            continue;
+        sectorsTouch(&sets[OPACITIES], i * strides[OPACITIES], 4);
+        sectorsTouch(&sets[SHS], i * strides[SHS], 12);
+        for (uint32_t k = 0; k < numRest; k++) {
+            for (uint32_t c = 0; c < 3; c++) {
+                const uint32_t coeff = c * 15 + k;
+                // the word holding the coefficient, or the index, then the table entries it points at
+                const uint32_t word = encoding == SPLAT_GPU_SH_REST_F16 ? coeff / 2
+                                      : encoding == SPLAT_GPU_SH_REST_U8 ? coeff / 4
+                                      : encoding == SPLAT_GPU_SH_REST_CODEBOOK ? 0
+                                                                               : coeff;
+                sectorsTouch(&sets[COLD], i * strides[COLD] + sizeof(uint32_t) * word, sizeof(uint32_t));
+                if (encoding == SPLAT_GPU_SH_REST_U8) {
+                    const uint64_t ranges = i / block->mParams[3] * 2 * 45;
+                    sectorsTouch(&sets[TABLE], sizeof(float) * (ranges + coeff), sizeof(float));
+                    sectorsTouch(&sets[TABLE], sizeof(float) * (ranges + 45 + coeff), sizeof(float));
+                } else if (encoding == SPLAT_GPU_SH_REST_CODEBOOK) {
+                    sectorsTouch(&sets[TABLE], sizeof(float) * ((uint64_t)shRest->pWords[i] * 45 + coeff), sizeof(float));
+                }
+                sectorsTouch(&sets[SHS], i * strides[SHS] + sizeof(float) * (3 + coeff), sizeof(float));
+            }
+        }
+    }
+    *outPacked = 32 * (sets[HOT].mNumTouched + sets[COLD].mNumTouched + sets[TABLE].mNumTouched);
+    *outStreams = 32 * (sets[POSITIONS].mNumTouched + sets[SCALES].mNumTouched + sets[ROTATIONS].mNumTouched +
+                        sets[OPACITIES].mNumTouched + sets[SHS].mNumTouched);
+    for (uint32_t b = 0; b < NUM_BUFFERS; b++)
+        tf_free(sets[b].pSectors);
+}
+
+int main(int argc, char** argv) {
+    const char* scenePath = NULL;
+    uint64_t    numSplats = 1000000;
+    uint32_t    iterations = 10;
+    uint32_t    shDegree = 0;
+    uint32_t    quality = SPLAT_QUALITY_NONE;
+
+    const struct SplatToolOptions options = { &scenePath, NULL, &numSplats, NULL, NULL, NULL };
+    for (int argIdx = 1; argIdx < argc; argIdx++) {
+        if (splatToolParseOption(&options, argc, argv, &argIdx))
+            continue;
+        if (!strcmp(argv[argIdx], "--iterations") && argIdx + 1 < argc)
+            iterations = (uint32_t)atoi(argv[++argIdx]);
+        else if (!strcmp(argv[argIdx], "--sh") && argIdx + 1 < argc)
+            shDegree = (uint32_t)atoi(argv[++argIdx]);
+        else if (!strcmp(argv[argIdx], "--quality") && argIdx + 1 < argc)
+            quality = (uint32_t)atoi(argv[++argIdx]);
+        else {
+            printf("usage: %s [scene.ply] [--count splats] [--iterations n] [--sh degree] [--quality level]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (numSplats == 0 || numSplats > UINT32_MAX || iterations == 0 || shDegree > 3 || quality > SPLAT_QUALITY_LOW) {
+        printf("invalid splat count, iteration count, SH degree or quality level\n");
+        return 1;
+    }
+
+    if (!splatToolInit("SplatPreprocessBench"))
+        return 1;
+
+    struct SplatStreams streams = {};
+    int                 result = 1;
+    if (splatToolLoadScene(NULL, scenePath, 4.0f, &streams, &numSplats)) {
+        struct SplatCamera camera = {};
+        splatCameraLookAt({ 0.0f, 0.0f, -8.0f }, { 0.0f, 0.0f, 0.0f }, { 0.0f, -1.0f, 0.0f }, 1.0f, 1920, 1080, &camera);
+        struct SplatQuantized quantized = {};
+        if (quality != SPLAT_QUALITY_NONE) {
+            struct SplatQuantizeDesc quantizeDesc = {};
+            splatQuantizeDescForQuality(quality, &quantizeDesc);
+            splatQuantize(NULL, &quantizeDesc, numSplats, &streams, &quantized);
+        }
+        struct SplatPreprocessBlock block = {};
+        splatPreprocessBlockFromCamera(&camera, numSplats, shDegree, &quantized, &block);
+
+        // the inputs as the app uploads them
+        const uint32_t        encoding = block.mParams[2];
+        const uint64_t        numTable = splatGpuShRestTableSize(&quantized);
+        struct SplatGpuSplat* splats = (struct SplatGpuSplat*)tf_malloc(sizeof(struct SplatGpuSplat) * numSplats);
+        uint32_t*             shWords = (uint32_t*)tf_malloc(sizeof(uint32_t) * splatGpuShRestWords(encoding) * numSplats);
+        float*                shTable = (float*)tf_malloc(sizeof(float) * numTable);
+        splatPackGpuSplats(&streams, 0, numSplats, splats, encoding == SPLAT_GPU_SH_REST_F32 ? (struct SplatGpuShRest*)shWords : NULL);
+        if (encoding != SPLAT_GPU_SH_REST_F32)
+            splatPackGpuShRest(&quantized, 0, numSplats, shWords);
+        splatPackGpuShRestTable(&quantized, shTable);
+        const struct SplatGpuShRestInput shRest = { shWords, shTable };
+        // the reference sees the decoded bands above dc, the twin keeps the dc band of the streams
+        if (encoding != SPLAT_GPU_SH_REST_F32) {
+            struct SplatStreams decoded = {};
+            decoded.pShs = (struct SphericalHarmonics*)tf_malloc(sizeof(struct SphericalHarmonics) * numSplats);
+            splatDequantize(&quantized, 0, numSplats, &decoded);
+            for (uint64_t i = 0; i < numSplats; i++)
+                memcpy(streams.pShs[i].rest, decoded.pShs[i].rest, sizeof(decoded.pShs[i].rest));
+            tf_free(decoded.pShs);
+        }
+        struct SplatPreprocessRecord* records = (struct SplatPreprocessRecord*)tf_malloc(sizeof(struct SplatPreprocessRecord) * numSplats);
+        struct SplatPreprocessRecord* rerun = (struct SplatPreprocessRecord*)tf_malloc(sizeof(struct SplatPreprocessRecord) * numSplats);
+        uint32_t*                     visible = (uint32_t*)tf_malloc(sizeof(uint32_t) * numSplats);
+        uint32_t*                     keys = (uint32_t*)tf_malloc(sizeof(uint32_t) * numSplats);
+        struct SplatProjected*        projected = (struct SplatProjected*)tf_malloc(sizeof(struct SplatProjected) * numSplats);
+
+        splatPreprocess(&block, splats, &shRest, rerun, visible, keys); // warm up
+        int64_t  bestUs = INT64_MAX;
+        uint32_t numVisible = 0;
+        for (uint32_t i = 0; i < iterations; i++) {
+            const int64_t startUs = getUSec(false);
+            numVisible = splatPreprocess(&block, splats, &shRest, records, visible, keys);
+            const int64_t durationUs = getUSec(false) - startUs;
+            bestUs = durationUs < bestUs ? durationUs : bestUs;
+        }
+        const uint64_t rerunMismatches = splatPreprocessCountMismatches(records, rerun, numSplats);
+        splatProjectScalar(&camera, shDegree, &streams, NULL, 0, numSplats, projected);
+
+        const float viewportExtent = fmaxf(block.mViewport[0], block.mViewport[1]);
+        uint64_t    cullMismatches = 0;
+        uint64_t    keyMismatches = 0;
+        uint64_t    toleranceMismatches = 0;
+        float       maxMeanUlps = 0.0f;
+        float       maxDepthUlps = 0.0f;
+        float       maxConicUlps = 0.0f;
+        float       maxOpacityUlps = 0.0f;
+        float       maxColorUlps = 0.0f;
+        for (uint64_t i = 0; i < numSplats; i++) {
+            if ((projected[i].mRadius == 0) != (records[i].mRadius == 0.0f)) {
+                cullMismatches++;
+                continue;
+            }
+            if (projected[i].mRadius == 0)
+                continue;
+            const struct SplatProjected*        ref = &projected[i];
+            const struct SplatPreprocessRecord* twin = &records[i];
+            const float meanUlps = fmaxf(ulpError(ref->mX, twin->mX, viewportExtent, 23), ulpError(ref->mY, twin->mY, viewportExtent, 23));
+            const float depthUlps = ulpError(ref->mDepth, twin->mDepth, 0.0f, 23);
+            // eigenvalues of the reference conic
+            const float mid = 0.5f * (ref->mConic[0] + ref->mConic[2]);
+            const float diff = sqrtf(0.25f * (ref->mConic[0] - ref->mConic[2]) * (ref->mConic[0] - ref->mConic[2]) +
+                                     ref->mConic[1] * ref->mConic[1]);
+            const float condition = (mid + diff) / (mid - diff);
+            float       conicUlps = 0.0f;
+            for (uint32_t c = 0; c < 3; c++)
+                conicUlps = fmaxf(conicUlps, ulpError(ref->mConic[c], twin->mConic[c], mid + diff, 23) / condition);
+            const float opacityUlps = ulpError(ref->mOpacity, twin->mOpacity, 0.0f, 10);
+            const float colorUlps = fmaxf(ulpError(ref->mColor.x, twin->mColor[0], 0.5f, 10),
+                                          fmaxf(ulpError(ref->mColor.y, twin->mColor[1], 0.5f, 10),
+                                                ulpError(ref->mColor.z, twin->mColor[2], 0.5f, 10)));
+            toleranceMismatches += meanUlps > MEAN_TOLERANCE_ULPS || depthUlps > DEPTH_TOLERANCE_ULPS ||
+                                           conicUlps > CONIC_TOLERANCE_ULPS || opacityUlps > HALF_TOLERANCE_ULPS ||
+                                           colorUlps > HALF_TOLERANCE_ULPS
+                                       ? 1
+                                       : 0;
+            maxMeanUlps = fmaxf(maxMeanUlps, meanUlps);
+            maxDepthUlps = fmaxf(maxDepthUlps, depthUlps);
+            maxConicUlps = fmaxf(maxConicUlps, conicUlps);
+            maxOpacityUlps = fmaxf(maxOpacityUlps, opacityUlps);
+            maxColorUlps = fmaxf(maxColorUlps, colorUlps);
+        }
+        // what the quad draw rasterizes against a square over the radius
+        double   quadArea = 0.0;
+        double   squareArea = 0.0;
+        uint32_t numQuads = 0;
+        for (uint32_t k = 0; k < numVisible; k++) {
+            float depth;
+            memcpy(&depth, &keys[k], sizeof(depth));
+            keyMismatches += depth != records[visible[k]].mDepth ? 1 : 0;
+            float axis[2];
+            float extents[2];
+            const float radius = records[visible[k]].mRadius;
+            squareArea += 4.0 * radius * radius;
+            if (splatPreprocessQuad(&records[visible[k]], axis, extents)) {
+                quadArea += 4.0 * extents[0] * extents[1];
+                numQuads++;
+            }
+        }
+        // the keys are positive floats, key then inverted index sorts descending like the network
+        uint64_t* expectedOrder = (uint64_t*)tf_malloc(sizeof(uint64_t) * (numVisible + 1));
+        for (uint32_t k = 0; k < numVisible; k++)
+            expectedOrder[k] = (uint64_t)keys[k] << 32 | (UINT32_MAX - visible[k]);
+        qsort(expectedOrder, numVisible, sizeof(uint64_t), compareVisible);
+        const int64_t sortStartUs = getUSec(false);
+        splatPreprocessSort(block.mParams[0], numVisible, visible, keys);
+        const int64_t sortUs = getUSec(false) - sortStartUs;
+        uint64_t      sortMismatches = 0;
+        for (uint32_t k = 0; k < numVisible; k++)
+            sortMismatches += visible[k] != UINT32_MAX - (uint32_t)expectedOrder[k] || keys[k] != expectedOrder[k] >> 32 ? 1 : 0;
+        tf_free(expectedOrder);
+
+        uint64_t packedBytes = 0;
+        uint64_t streamBytes = 0;
+        fetchedBytes(&block, splats, &shRest, numTable, records, numSplats, &packedBytes, &streamBytes);
+        tf_free(splats);
+        tf_free(shWords);
+        tf_free(shTable);
+        splatQuantizedFree(&quantized);
+        tf_free(records);
+        tf_free(rerun);
+        tf_free(visible);
+        tf_free(keys);
+        tf_free(projected);
+
+        static const char* encodingNames[] = { "f32", "f16", "u8", "codebook" };
+        printf("splats            %llu (%u visible)\n", (unsigned long long)numSplats, numVisible);
+        printf("SH rest           %s, %u B per splat\n", encodingNames[encoding],
+               (uint32_t)sizeof(uint32_t) * splatGpuShRestWords(encoding));
+        printf("twin              %.2f ns/splat\n", (double)bestUs * 1000.0 / (double)numSplats);
+        printf("rerun mismatches  %llu\n", (unsigned long long)rerunMismatches);
+        printf("key mismatches    %llu\n", (unsigned long long)keyMismatches);
+        printf("sort mismatches   %llu (%.2f ms single threaded)\n", (unsigned long long)sortMismatches, sortUs / 1000.0);
+        printf("cull mismatches   %llu\n", (unsigned long long)cullMismatches);
+        printf("max mean error    %.2f ulps (%.0f allowed)\n", maxMeanUlps, MEAN_TOLERANCE_ULPS);
+        printf("max depth error   %.2f ulps (%.0f allowed)\n", maxDepthUlps, DEPTH_TOLERANCE_ULPS);
+        printf("max conic error   %.2f ulps (%.0f allowed)\n", maxConicUlps, CONIC_TOLERANCE_ULPS);
+        printf("max opacity error %.2f half ulps (%.0f allowed)\n", maxOpacityUlps, HALF_TOLERANCE_ULPS);
+        printf("max color error   %.2f half ulps (%.0f allowed)\n", maxColorUlps, HALF_TOLERANCE_ULPS);
+        printf("over tolerance    %llu\n", (unsigned long long)toleranceMismatches);
+        printf("fetched           %.2f MB/frame packed, %.2f MB/frame as streams (%.0f%%)\n", packedBytes / (1024.0 * 1024.0),
+               streamBytes / (1024.0 * 1024.0), streamBytes ? 100.0 * (double)packedBytes / (double)streamBytes : 0.0);
+        printf("quads             %u, %.1f px mean area (radius square %.1f px)\n", numQuads,
+               numVisible ? quadArea / numVisible : 0.0, numVisible ? squareArea / numVisible : 0.0);
+        splatFreeStreams(&streams);
+        result = rerunMismatches || keyMismatches || sortMismatches || cullMismatches || toleranceMismatches ? 1 : 0;
+    }
+
+    splatToolExit();
+    return result;
+}
@@ -0,0 +1,177 @@
+/*
+ * Copyright (c) 2017-2024 The Forge Interactive Inc.
+ *
+ * This file is part of The-Forge
+ * (see https://github.com/ConfettiFX/The-Forge).
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+// Benchmark of progressive loading. Renders prefixes of the scene in file
+// (Morton) order and in coarse to fine order with the reference rasterizer
+// and compares each against the full scene, then writes a progressive cache
+// and times the batched loader: time to the first batch and to the full scene.
+//
+//   splat_progressive_bench [scene.ply] [--count splats] [--batch splats] [--size width height]
+//
+// Without a scene a random cloud is used. The cache is left in the working
+// directory as splat_progressive_bench.splatcache.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Forge/TF_FileSystem.h"
+#include "Forge/Core/TF_Time.h"
+#include "Forge/Mem/TF_Memory.h"
+#include "Common_3/Utilities/Threading/ThreadSystem.h"
+
+#include "Splat/SplatCache.h"
+#include "Splat/SplatJobs.h"
+#include "Splat/SplatMorton.h"
+#include "Splat/SplatProgressive.h"
+#include "Splat/SplatRaster.h"
+
+#include "Tools/SplatToolCommon.h"
+
+// big, kept out of the stack of main
+static struct SplatJobSystem gJobSystem;
+
+static double imagePsnr(const float* a, const float* b, uint64_t numValues) {
+    double squaredError = 0.0;
+    for (uint64_t i = 0; i < numValues; i++) {
+        const double d = fmin(fmax((double)a[i], 0.0), 1.0) - fmin(fmax((double)b[i], 0.0), 1.0);
+        squaredError += d * d;
+    }
+    const double mse = squaredError / (double)numValues;
+    return mse > 0.0 ? 10.0 * log10(1.0 / mse) : INFINITY;
+}
+
+int main(int argc, char** argv) {
+    const char* scenePath = NULL;
+    uint64_t    numSplats = 1000000;
+    uint64_t    batchSize = 65536;
+    uint32_t    width = 1280;
+    uint32_t    height = 720;
+
+    const struct SplatToolOptions options = { &scenePath, NULL, &numSplats, NULL, &width, &height };
+    for (int argIdx = 1; argIdx < argc; argIdx++) {
+        if (splatToolParseOption(&options, argc, argv, &argIdx))
+            continue;
+        if (!strcmp(argv[argIdx], "--batch") && argIdx + 1 < argc)
+            batchSize = strtoull(argv[++argIdx], NULL, 10);
+        else {
+            printf("usage: %s [scene.ply] [--count splats] [--batch splats] [--size width height]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (numSplats == 0 || numSplats > UINT32_MAX || batchSize == 0 || width == 0 || height == 0) {
+        printf("invalid splat count, batch size or image size\n");
+        return 1;
+    }
+
+    if (!splatToolInit("SplatProgressiveBench"))
+        return 1;
+
+    ThreadSystem         threadSystem = NULL;
+    ThreadSystemInitDesc threadSystemDesc = {};
+    threadSystemDesc.mThreadCount = getNumCPUCores() > 1 ? getNumCPUCores() - 1 : 1;
+    initThreadSystem(&threadSystemDesc, &threadSystem);
+    splatJobSystemInit(&gJobSystem, threadSystem, threadSystemDesc.mThreadCount + 1);
+
+    int                 result = 1;
+    struct SplatStreams streams = {};
+    const bool          loaded = splatToolLoadScene(threadSystem, scenePath, 50.0f, &streams, &numSplats);
+    if (loaded && splatMortonReorderStreams(threadSystem, &streams, numSplats, false)) {
+        struct SplatStreams progressive = {};
+        splatAllocStreams(&progressive, numSplats);
+        splatCopyStreams(&progressive, &streams, 0, numSplats);
+        uint32_t* order = (uint32_t*)tf_malloc(sizeof(uint32_t) * numSplats);
+        uint32_t  numLevels = 0;
+        int64_t   startUs = getUSec(false);
+        splatProgressiveOrder(&progressive, numSplats, order, &numLevels);
+        splatPermuteStreams(threadSystem, &progressive, order, numSplats);
+        printf("# %llu splats, %u levels, order %.2f ms\n", (unsigned long long)numSplats, numLevels, (getUSec(false) - startUs) / 1000.0);
+
+        struct Tf32x3_s boundsMin, boundsMax;
+        splatComputeBounds(threadSystem, streams.pPositions, numSplats, &boundsMin, &boundsMax, NULL);
+        const struct Tf32x3_s center = { 0.5f * (boundsMin.x + boundsMax.x), 0.5f * (boundsMin.y + boundsMax.y),
+                                         0.5f * (boundsMin.z + boundsMax.z) };
+        const struct Tf32x3_s eye = { center.x, center.y, center.z - 1.2f * (boundsMax.z - boundsMin.z) };
+        struct SplatCamera    camera = {};
+        splatCameraLookAt(eye, center, { 0.0f, -1.0f, 0.0f }, 1.0f, width, height, &camera);
+
+        struct SplatRasterizer reference, prefix;
+        splatRasterizerInit(&reference);
+        splatRasterizerInit(&prefix);
+        splatRasterize(&gJobSystem, &reference, &camera, numSplats, &streams, NULL);
+        const uint64_t numValues = (uint64_t)width * height * 3;
+        printf("fraction,splats,file_order_psnr,progressive_psnr\n");
+        const double fractions[] = { 0.001, 0.01, 0.05, 0.1, 0.25, 0.5 };
+        for (uint32_t i = 0; i < TF_ARRAY_COUNT(fractions); i++) {
+            const uint64_t count = (uint64_t)(fractions[i] * (double)numSplats) > 0 ? (uint64_t)(fractions[i] * (double)numSplats) : 1;
+            splatRasterize(&gJobSystem, &prefix, &camera, count, &streams, NULL);
+            const double filePsnr = imagePsnr(reference.pImage, prefix.pImage, numValues);
+            splatRasterize(&gJobSystem, &prefix, &camera, count, &progressive, NULL);
+            const double progressivePsnr = imagePsnr(reference.pImage, prefix.pImage, numValues);
+            printf("%.3f,%llu,%.2f,%.2f\n", fractions[i], (unsigned long long)count, filePsnr, progressivePsnr);
+        }
+        splatRasterizerExit(&reference);
+        splatRasterizerExit(&prefix);
+
+        // the batched loader on a cache written in progressive order
+        const char* cachePath = "splat_progressive_bench.splatcache";
+        if (splatCacheWrite(RD_OTHER_FILES, cachePath, 1, numSplats, SPLAT_CACHE_FLAG_MORTON_ORDER | SPLAT_CACHE_FLAG_PROGRESSIVE_ORDER,
+                            &progressive)) {
+            struct SplatCache cache = {};
+            if (splatCacheOpen(RD_OTHER_FILES, cachePath, 1, &cache)) {
+                struct SplatStreams dst = {};
+                splatAllocStreams(&dst, numSplats);
+                struct SplatProgressiveLoader loader;
+                startUs = getUSec(false);
+                splatProgressiveLoaderStart(&loader, threadSystem, &cache, &dst, batchSize);
+                int64_t firstBatchUs = -1;
+                while (!splatProgressiveLoaderFinished(&loader)) {
+                    if (firstBatchUs < 0 && splatProgressiveLoaderLoaded(&loader) > 0)
+                        firstBatchUs = getUSec(false) - startUs;
+                }
+                const int64_t fullUs = getUSec(false) - startUs;
+                if (firstBatchUs < 0)
+                    firstBatchUs = fullUs;
+                const bool same = !loader.mFailed.load() &&
+                                  !memcmp(dst.pPositions, progressive.pPositions, sizeof(struct Tf32x3_s) * numSplats);
+                printf("# loader: batch %llu splats, first batch %.2f ms, full %.2f ms, %s\n", (unsigned long long)batchSize,
+                       firstBatchUs / 1000.0, fullUs / 1000.0, same ? "contents match" : "CONTENTS DIFFER");
+                splatProgressiveLoaderExit(&loader);
+                splatFreeStreams(&dst);
+                result = same ? 0 : 1;
+            }
+        }
+        tf_free(order);
+        splatFreeStreams(&progressive);
+    }
+    if (loaded)
+        splatFreeStreams(&streams);
+
+    splatJobSystemExit(&gJobSystem);
+    exitThreadSystem(threadSystem);
+    splatToolExit();
+    return result;
+}
@@ -0,0 +1,169 @@
+/*
+ * Copyright (c) 2017-2024 The Forge Interactive Inc.
+ *
+ * This file is part of The-Forge
+ * (see https://github.com/ConfettiFX/The-Forge).
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+// Microbenchmark of the splat projection kernels, scalar against TF_Simd32x4,
+// with sigma built on the fly and fetched from covariances stored in f32 and
+// f16 (SplatCovarianceMode).
+//
+//   splat_project_bench [scene.ply] [--count splats] [--iterations n] [--sh degree]
+//
+// Without a scene a random cloud around the origin is projected. Every
+// kernel runs single threaded over the same streams and its output is
+// checked against the scalar kernel building sigma on the fly.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Forge/Core/TF_Time.h"
+#include "Forge/Mem/TF_Memory.h"
+
+#include "Splat/SplatRaster.h"
+
+#include "Tools/SplatToolCommon.h"
+
+typedef void (*ProjectFunc)(const struct SplatCamera*, uint32_t, const struct SplatStreams*, const struct SplatCovariances*, uint64_t,
+                            uint64_t, struct SplatProjected*);
+
+struct ProjectError {
+    uint64_t mCullMismatches;
+    float    mMaxPixelError;
+    float    mMaxConicError; // relative to sqrt(xx yy) of the reference conic
+};
+
+static double benchmark(ProjectFunc func, const struct SplatCamera* camera, uint32_t shDegree, const struct SplatStreams* streams,
+                        const struct SplatCovariances* covariances, uint64_t numSplats, uint32_t iterations,
+                        struct SplatProjected* projected) {
+    func(camera, shDegree, streams, covariances, 0, numSplats, projected); // warm up
+    int64_t bestUs = INT64_MAX;
+    for (uint32_t i = 0; i < iterations; i++) {
+        const int64_t startUs = getUSec(false);
+        func(camera, shDegree, streams, covariances, 0, numSplats, projected);
+        const int64_t durationUs = getUSec(false) - startUs;
+        bestUs = durationUs < bestUs ? durationUs : bestUs;
+    }
+    return (double)bestUs * 1000.0 / (double)numSplats;
+}
+
+static void compare(const struct SplatProjected* reference, const struct SplatProjected* projected, uint64_t numSplats,
+                    struct ProjectError* outError) {
+    memset(outError, 0, sizeof(struct ProjectError));
+    for (uint64_t i = 0; i < numSplats; i++) {
+        if ((reference[i].mRadius == 0) != (projected[i].mRadius == 0)) {
+            outError->mCullMismatches++;
+            continue;
+        }
+        if (reference[i].mRadius == 0)
+            continue;
+        outError->mMaxPixelError =
+            fmaxf(outError->mMaxPixelError, fmaxf(fabsf(reference[i].mX - projected[i].mX), fabsf(reference[i].mY - projected[i].mY)));
+        // relative to the size of the conic, a near zero xy term would blow up a per term ratio
+        const float scale = fmaxf(sqrtf(fabsf(reference[i].mConic[0] * reference[i].mConic[2])), 1e-6f);
+        for (uint32_t c = 0; c < 3; c++) {
+            outError->mMaxConicError = fmaxf(outError->mMaxConicError, fabsf(reference[i].mConic[c] - projected[i].mConic[c]) / scale);
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    const char* scenePath = NULL;
+    uint64_t    numSplats = 1000000;
+    uint32_t    iterations = 10;
+    uint32_t    shDegree = 0;
+
+    const struct SplatToolOptions options = { &scenePath, NULL, &numSplats, NULL, NULL, NULL };
+    for (int argIdx = 1; argIdx < argc; argIdx++) {
+        if (splatToolParseOption(&options, argc, argv, &argIdx))
+            continue;
+        if (!strcmp(argv[argIdx], "--iterations") && argIdx + 1 < argc)
+            iterations = (uint32_t)atoi(argv[++argIdx]);
+        else if (!strcmp(argv[argIdx], "--sh") && argIdx + 1 < argc)
+            shDegree = (uint32_t)atoi(argv[++argIdx]);
+        else {
+            printf("usage: %s [scene.ply] [--count splats] [--iterations n] [--sh degree]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (numSplats == 0 || iterations == 0 || shDegree > 3) {
+        printf("invalid splat count, iteration count or SH degree\n");
+        return 1;
+    }
+
+    if (!splatToolInit("SplatProjectBench"))
+        return 1;
+
+    struct SplatStreams streams = {};
+    int                 result = 1;
+    if (splatToolLoadScene(NULL, scenePath, 4.0f, &streams, &numSplats)) {
+        struct SplatCamera camera = {};
+        splatCameraLookAt({ 0.0f, 0.0f, -8.0f }, { 0.0f, 0.0f, 0.0f }, { 0.0f, -1.0f, 0.0f }, 1.0f, 1920, 1080, &camera);
+
+        static const char* modeNames[] = { "on the fly", "f32", "f16" };
+        struct SplatProjected* reference = (struct SplatProjected*)tf_malloc(sizeof(struct SplatProjected) * numSplats);
+        struct SplatProjected* projected = (struct SplatProjected*)tf_malloc(sizeof(struct SplatProjected) * numSplats);
+        const double           referenceNs =
+            benchmark(splatProjectScalar, &camera, shDegree, &streams, NULL, numSplats, iterations, reference);
+        uint64_t               numVisible = 0;
+        for (uint64_t i = 0; i < numSplats; i++)
+            numVisible += reference[i].mRadius ? 1 : 0;
+        printf("splats            %llu (%llu visible)\n", (unsigned long long)numSplats, (unsigned long long)numVisible);
+        printf("%-12s %8s %10s %10s %9s %10s %12s %12s\n", "covariance", "B/splat", "build ms", "scalar ns", "simd ns", "simd gain",
+               "pixel error", "conic error");
+
+        for (uint32_t mode = SPLAT_COVARIANCE_ON_THE_FLY; mode <= SPLAT_COVARIANCE_F16; mode++) {
+            struct SplatCovariances covariances = {};
+            const int64_t           buildStartUs = getUSec(false);
+            splatCovariancesBuild(&streams, numSplats, mode, &covariances);
+            const double buildMs = (double)(getUSec(false) - buildStartUs) / 1000.0;
+
+            // the scalar kernel on the fly is the reference itself
+            double              scalarNs = referenceNs;
+            struct ProjectError scalarError = {};
+            if (mode != SPLAT_COVARIANCE_ON_THE_FLY) {
+                scalarNs = benchmark(splatProjectScalar, &camera, shDegree, &streams, &covariances, numSplats, iterations, projected);
+                compare(reference, projected, numSplats, &scalarError);
+            }
+            const double simdNs =
+                benchmark(splatProjectSimd, &camera, shDegree, &streams, &covariances, numSplats, iterations, projected);
+            struct ProjectError simdError = {};
+            compare(reference, projected, numSplats, &simdError);
+            printf("%-12s %8u %10.2f %10.2f %9.2f %9.2fx %12g %12g\n", modeNames[mode], splatCovarianceStride(mode), buildMs, scalarNs,
+                   simdNs, scalarNs / simdNs, fmaxf(scalarError.mMaxPixelError, simdError.mMaxPixelError),
+                   fmaxf(scalarError.mMaxConicError, simdError.mMaxConicError));
+            if (scalarError.mCullMismatches || simdError.mCullMismatches)
+                printf("%-12s cull mismatches: %llu scalar, %llu simd\n", "", (unsigned long long)scalarError.mCullMismatches,
+                       (unsigned long long)simdError.mCullMismatches);
+            splatCovariancesFree(&covariances);
+        }
+        tf_free(reference);
+        tf_free(projected);
+        splatFreeStreams(&streams);
+        result = 0;
+    }
+
+    splatToolExit();
+    return result;
+}
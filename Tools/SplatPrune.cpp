@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2017-2024 The Forge Interactive Inc.
+ *
+ * This file is part of The-Forge
+ * (see https://github.com/ConfettiFX/The-Forge).
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+// Offline splat pruning: applies the load time pruning of SplatPrune to a
+// PLY, prints how many splats every rule removed and writes the result as a
+// 3DGS PLY when an output path is given.
+//
+//   splat_prune <scene.ply> [out.ply] [--min-opacity alpha] [--min-scale fraction] [--max-scale fraction]
+//               [--merge-distance fraction] [--keep-invalid]
+//
+// Thresholds default to splatPruneDescDefaults, 0 disables a rule. Scales and
+// the merge distance are fractions of the scene bounds diagonal.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Forge/TF_FileSystem.h"
+#include "Forge/TF_Log.h"
+#include "Forge/Mem/TF_Memory.h"
+#include "Common_3/Utilities/Threading/ThreadSystem.h"
+
+#include "Splat/SplatPly.h"
+#include "Splat/SplatPrune.h"
+
+int main(int argc, char** argv) {
+    const char*           scenePath = NULL;
+    const char*           outPath = NULL;
+    struct SplatPruneDesc desc;
+    splatPruneDescDefaults(&desc);
+    for (int argIdx = 1; argIdx < argc; argIdx++) {
+        if (!strcmp(argv[argIdx], "--min-opacity") && argIdx + 1 < argc)
+            desc.mMinOpacity = (float)atof(argv[++argIdx]);
+        else if (!strcmp(argv[argIdx], "--min-scale") && argIdx + 1 < argc)
+            desc.mMinScaleFraction = (float)atof(argv[++argIdx]);
+        else if (!strcmp(argv[argIdx], "--max-scale") && argIdx + 1 < argc)
+            desc.mMaxScaleFraction = (float)atof(argv[++argIdx]);
+        else if (!strcmp(argv[argIdx], "--merge-distance") && argIdx + 1 < argc)
+            desc.mMergeDistanceFraction = (float)atof(argv[++argIdx]);
+        else if (!strcmp(argv[argIdx], "--keep-invalid"))
+            desc.mDropInvalid = false;
+        else if (argv[argIdx][0] != '-' && !scenePath)
+            scenePath = argv[argIdx];
+        else if (argv[argIdx][0] != '-' && !outPath)
+            outPath = argv[argIdx];
+        else {
+            scenePath = NULL;
+            break;
+        }
+    }
+    if (!scenePath) {
+        printf("usage: %s <scene.ply> [out.ply] [--min-opacity alpha] [--min-scale fraction] [--max-scale fraction] "
+               "[--merge-distance fraction] [--keep-invalid]\n",
+               argv[0]);
+        return 1;
+    }
+    if (desc.mMinOpacity < 0.0f || desc.mMinOpacity >= 1.0f || desc.mMinScaleFraction < 0.0f || desc.mMaxScaleFraction < 0.0f ||
+        desc.mMergeDistanceFraction < 0.0f) {
+        printf("invalid threshold\n");
+        return 1;
+    }
+
+    if (!initMemAlloc("SplatPrune"))
+        return 1;
+    FileSystemInitDesc fsDesc = {};
+    fsDesc.pAppName = "SplatPrune";
+    if (!initFileSystem(&fsDesc))
+        return 1;
+    // paths on the command line are relative to the working directory
+    fsSetPathForResourceDir(pSystemFileIO, RM_CONTENT, RD_OTHER_FILES, "");
+    initLog("SplatPrune", eINFO);
+
+    ThreadSystem         threadSystem = NULL;
+    ThreadSystemInitDesc threadSystemDesc = {};
+    threadSystemDesc.mThreadCount = getNumCPUCores() > 1 ? getNumCPUCores() - 1 : 1;
+    initThreadSystem(&threadSystemDesc, &threadSystem);
+
+    int                 result = 1;
+    struct SplatStreams streams = {};
+    uint64_t            numSplats = 0;
+    if (splatPlyLoadFile(threadSystem, RD_OTHER_FILES, scenePath, &streams, &numSplats)) {
+        struct SplatPruneStats stats;
+        const uint64_t         numKept = splatPrune(threadSystem, &desc, &streams, numSplats, &stats);
+        printf("rule,removed,percent\n");
+        for (uint32_t rule = SPLAT_PRUNE_INVALID; rule < SPLAT_PRUNE_NUM_RULES; rule++)
+            printf("%s,%llu,%.3f\n", splatPruneRuleName(rule), (unsigned long long)stats.mNumRemoved[rule],
+                   100.0 * (double)stats.mNumRemoved[rule] / (double)numSplats);
+        printf("# %llu of %llu splats kept (%.2f%%), %.1f MB saved, %.2f ms\n", (unsigned long long)numKept, (unsigned long long)numSplats,
+               100.0 * (double)numKept / (double)numSplats, (double)stats.mBytesSaved / (1024.0 * 1024.0), stats.mDurationUs / 1000.0);
+        result = !outPath || splatPlyWriteFile(RD_OTHER_FILES, outPath, &streams, numKept) ? 0 : 1;
+        splatFreeStreams(&streams);
+    }
+
+    exitThreadSystem(threadSystem);
+    exitLog();
+    exitFileSystem();
+    exitMemAlloc();
+    return result;
+}
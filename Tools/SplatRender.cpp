@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) 2017-2024 The Forge Interactive Inc.
+ *
+ * This file is part of The-Forge
+ * (see https://github.com/ConfettiFX/The-Forge).
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+// Headless CPU reference render of a splat PLY.
+//
+//   splat_render <scene.ply> [--eye x y z] [--target x y z] [--up x y z] [--fov degrees]
+//                [--size width height] [--sh degree] [--out image.png|image.exr]
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Forge/TF_FileSystem.h"
+#include "Forge/TF_Log.h"
+#include "Forge/Mem/TF_Memory.h"
+#include "Common_3/Utilities/Threading/ThreadSystem.h"
+
+#include "Splat/SplatImage.h"
+#include "Splat/SplatJobs.h"
+#include "Splat/SplatPly.h"
+#include "Splat/SplatRaster.h"
+#include "Splat/SplatSh.h"
+
+// big, kept out of the stack of main
+static struct SplatJobSystem gJobSystem;
+
+static bool parseFloats(int argc, char** argv, int* argIdx, uint32_t count, float* out) {
+    if (*argIdx + (int)count >= argc)
+        return false;
+    for (uint32_t i = 0; i < count; i++)
+        out[i] = (float)atof(argv[++*argIdx]);
+    return true;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        printf("usage: %s <scene.ply> [--eye x y z] [--target x y z] [--up x y z] [--fov degrees] [--size width height] "
+               "[--sh degree] [--out image.png|image.exr]\n",
+               argv[0]);
+        return 1;
+    }
+
+    const char* scenePath = argv[1];
+    const char* outPath = "render.png";
+    float       eye[3] = { 0.0f, 0.0f, -5.0f };
+    float       target[3] = { 0.0f, 0.0f, 0.0f };
+    float       up[3] = { 0.0f, -1.0f, 0.0f }; // 3DGS scenes are captured with +y down
+    float       fov = 60.0f;
+    float       size[2] = { 1280.0f, 720.0f };
+    float       shDegree = (float)SPLAT_SH_MAX_DEGREE;
+    for (int argIdx = 2; argIdx < argc; argIdx++) {
+        bool valid = true;
+        if (!strcmp(argv[argIdx], "--eye"))
+            valid = parseFloats(argc, argv, &argIdx, 3, eye);
+        else if (!strcmp(argv[argIdx], "--target"))
+            valid = parseFloats(argc, argv, &argIdx, 3, target);
+        else if (!strcmp(argv[argIdx], "--up"))
+            valid = parseFloats(argc, argv, &argIdx, 3, up);
+        else if (!strcmp(argv[argIdx], "--fov"))
+            valid = parseFloats(argc, argv, &argIdx, 1, &fov);
+        else if (!strcmp(argv[argIdx], "--size"))
+            valid = parseFloats(argc, argv, &argIdx, 2, size);
+        else if (!strcmp(argv[argIdx], "--sh"))
+            valid = parseFloats(argc, argv, &argIdx, 1, &shDegree);
+        else if (!strcmp(argv[argIdx], "--out") && argIdx + 1 < argc)
+            outPath = argv[++argIdx];
+        else
+            valid = false;
+        if (!valid) {
+            printf("invalid argument %s\n", argv[argIdx]);
+            return 1;
+        }
+    }
+    if (size[0] < 1.0f || size[1] < 1.0f || shDegree < 0.0f || shDegree > (float)SPLAT_SH_MAX_DEGREE) {
+        printf("invalid image size or SH degree\n");
+        return 1;
+    }
+
+    if (!initMemAlloc("SplatRender"))
+        return 1;
+    FileSystemInitDesc fsDesc = {};
+    fsDesc.pAppName = "SplatRender";
+    if (!initFileSystem(&fsDesc))
+        return 1;
+    // paths on the command line are relative to the working directory
+    fsSetPathForResourceDir(pSystemFileIO, RM_CONTENT, RD_OTHER_FILES, "");
+    fsSetPathForResourceDir(pSystemFileIO, RM_DEBUG, RD_SCREENSHOTS, "");
+    initLog("SplatRender", eINFO);
+
+    ThreadSystem         threadSystem = NULL;
+    ThreadSystemInitDesc threadSystemDesc = {};
+    threadSystemDesc.mThreadCount = getNumCPUCores() > 1 ? getNumCPUCores() - 1 : 1;
+    initThreadSystem(&threadSystemDesc, &threadSystem);
+    splatJobSystemInit(&gJobSystem, threadSystem, threadSystemDesc.mThreadCount + 1);
+
+    int                 result = 1;
+    struct SplatStreams streams = {};
+    uint64_t            numSplats = 0;
+    if (splatPlyLoadFile(threadSystem, RD_OTHER_FILES, scenePath, &streams, &numSplats)) {
+        struct SplatCamera camera = {};
+        splatCameraLookAt({ eye[0], eye[1], eye[2] }, { target[0], target[1], target[2] }, { up[0], up[1], up[2] },
+                          fov * 3.14159265f / 180.0f, (uint32_t)size[0], (uint32_t)size[1], &camera);
+
+        struct SplatRasterizer rasterizer;
+        splatRasterizerInit(&rasterizer);
+        rasterizer.mShDegree = (uint32_t)shDegree;
+        struct SplatRasterStats stats = {};
+        if (splatRasterize(&gJobSystem, &rasterizer, &camera, numSplats, &streams, &stats)) {
+            LOGF(eINFO, "%llu of %llu splats visible, %llu tile pairs", (unsigned long long)stats.mNumVisible,
+                 (unsigned long long)numSplats, (unsigned long long)stats.mNumTilePairs);
+            LOGF(eINFO, "cull %.2f ms, project %.2f ms, SH %.2f ms, bin %.2f ms, sort %.2f ms, blend %.2f ms on %u workers",
+                 stats.mCullUs / 1000.0f, stats.mProjectUs / 1000.0f, stats.mShUs / 1000.0f, stats.mBinUs / 1000.0f,
+                 stats.mSortUs / 1000.0f, stats.mBlendUs / 1000.0f, stats.mJobs.mNumWorkers);
+            LOGF(eINFO, "blend %u jobs, %u split tiles, blend thread max %.2f ms, mean %.2f ms", stats.mNumBlendJobs, stats.mNumSplitTiles,
+                 stats.mBlendMaxThreadUs / 1000.0f, stats.mBlendMeanThreadUs / 1000.0f);
+            if (splatWriteImage(RD_SCREENSHOTS, outPath, camera.mWidth, camera.mHeight, rasterizer.pImage))
+                result = 0;
+        }
+        splatRasterizerExit(&rasterizer);
+        splatFreeStreams(&streams);
+    }
+
+    splatJobSystemExit(&gJobSystem);
+    exitThreadSystem(threadSystem);
+    exitLog();
+    exitFileSystem();
+    exitMemAlloc();
+    return result;
+}
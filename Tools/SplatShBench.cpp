@@ -0,0 +1,175 @@
+/*
+ * Copyright (c) 2017-2024 The Forge Interactive Inc.
+ *
+ * This file is part of The-Forge
+ * (see https://github.com/ConfettiFX/The-Forge).
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+// Benchmark of the spherical harmonics color evaluation: per degree, the
+// scalar splatEvalSh loop against the batched SIMD kernel, then the cluster
+// cache along a camera path with the fraction of clusters re-evaluated and
+// the largest color error against an exact evaluation.
+//
+//   splat_sh_bench [scene.ply] [--count splats] [--path camera_path.txt] [--frames n] [--angle degrees]
+//
+// Without a scene a random cloud is used, without a path the camera orbits
+// inside the scene bounds. Per frame cache results are printed as CSV.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Forge/Core/TF_Time.h"
+#include "Forge/Mem/TF_Memory.h"
+#include "Common_3/Utilities/Threading/ThreadSystem.h"
+
+#include "Splat/SplatCameraPath.h"
+#include "Splat/SplatMorton.h"
+#include "Splat/SplatShEval.h"
+
+#include "Tools/SplatToolCommon.h"
+
+static void evalScalar(uint32_t degree, const struct SplatStreams* streams, uint64_t count, struct Tf32x3_s eye,
+                       struct Tf32x3_s* outColors) {
+    for (uint64_t i = 0; i < count; i++) {
+        const struct Tf32x3_s p = streams->pPositions[i];
+        struct Tf32x3_s       dir = { p.x - eye.x, p.y - eye.y, p.z - eye.z };
+        const float           len = sqrtf(dir.x * dir.x + dir.y * dir.y + dir.z * dir.z);
+        dir = { dir.x / len, dir.y / len, dir.z / len };
+        outColors[i] = splatEvalSh(degree, &streams->pShs[i], dir);
+    }
+}
+
+static float maxColorError(const struct Tf32x3_s* a, const struct Tf32x3_s* b, uint64_t count) {
+    float maxError = 0.0f;
+    for (uint64_t i = 0; i < count; i++)
+        for (uint32_t c = 0; c < 3; c++)
+            maxError = fmaxf(maxError, fabsf(a[i].v[c] - b[i].v[c]));
+    return maxError;
+}
+
+int main(int argc, char** argv) {
+    const char* scenePath = NULL;
+    const char* cameraPathFile = NULL;
+    uint64_t    numSplats = 2000000;
+    uint32_t    numFrames = 240;
+    float       angleDegrees = 0.5f;
+
+    const struct SplatToolOptions options = { &scenePath, &cameraPathFile, &numSplats, &numFrames, NULL, NULL };
+    for (int argIdx = 1; argIdx < argc; argIdx++) {
+        if (splatToolParseOption(&options, argc, argv, &argIdx))
+            continue;
+        if (!strcmp(argv[argIdx], "--angle") && argIdx + 1 < argc)
+            angleDegrees = (float)atof(argv[++argIdx]);
+        else {
+            printf("usage: %s [scene.ply] [--count splats] [--path camera_path.txt] [--frames n] [--angle degrees]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (numSplats == 0 || numFrames == 0) {
+        printf("invalid splat or frame count\n");
+        return 1;
+    }
+
+    if (!splatToolInit("SplatShBench"))
+        return 1;
+
+    ThreadSystem         threadSystem = NULL;
+    ThreadSystemInitDesc threadSystemDesc = {};
+    threadSystemDesc.mThreadCount = getNumCPUCores() > 1 ? getNumCPUCores() - 1 : 1;
+    initThreadSystem(&threadSystemDesc, &threadSystem);
+
+    int                 result = 1;
+    struct SplatStreams streams = {};
+    if (splatToolLoadScene(threadSystem, scenePath, 50.0f, &streams, &numSplats)) {
+        // clusters are consecutive splats, the app keeps its streams Morton ordered too
+        splatMortonReorderStreams(threadSystem, &streams, numSplats, false);
+
+        struct Tf32x3_s boundsMin, boundsMax;
+        splatComputeBounds(threadSystem, streams.pPositions, numSplats, &boundsMin, &boundsMax, NULL);
+        const struct Tf32x3_s center = { 0.5f * (boundsMin.x + boundsMax.x), 0.5f * (boundsMin.y + boundsMax.y),
+                                         0.5f * (boundsMin.z + boundsMax.z) };
+        const struct Tf32x3_s eye = { center.x, center.y, boundsMin.z - 10.0f };
+
+        struct Tf32x3_s* reference = (struct Tf32x3_s*)tf_malloc(sizeof(struct Tf32x3_s) * numSplats);
+        struct Tf32x3_s* colors = (struct Tf32x3_s*)tf_malloc(sizeof(struct Tf32x3_s) * numSplats);
+        float            worstError = 0.0f;
+        printf("# %llu splats\n", (unsigned long long)numSplats);
+        printf("degree,scalar_ns_per_splat,batch_ns_per_splat,speedup,max_error\n");
+        for (uint32_t degree = 0; degree <= SPLAT_SH_MAX_DEGREE; degree++) {
+            int64_t startUs = getUSec(false);
+            evalScalar(degree, &streams, numSplats, eye, reference);
+            const int64_t scalarUs = getUSec(false) - startUs;
+            startUs = getUSec(false);
+            splatEvalShBatch(degree, streams.pPositions, streams.pShs, numSplats, eye, colors);
+            const int64_t batchUs = getUSec(false) - startUs;
+            const float   error = maxColorError(reference, colors, numSplats);
+            worstError = fmaxf(worstError, error);
+            printf("%u,%.3f,%.3f,%.2f,%g\n", degree, scalarUs * 1000.0 / numSplats, batchUs * 1000.0 / numSplats,
+                   batchUs > 0 ? (double)scalarUs / (double)batchUs : 0.0, error);
+        }
+
+        struct SplatCameraPath cameraPath = {};
+        if (splatToolLoadCameraPath(threadSystem, cameraPathFile, 1.0f, &streams, numSplats, 0.3f, numFrames, &cameraPath)) {
+            const float         maxAngle = angleDegrees * 3.14159265f / 180.0f;
+            struct SplatShCache cache;
+            splatShCacheInit(&cache, streams.pPositions, numSplats);
+            double totalCachedUs = 0.0;
+            double totalFullUs = 0.0;
+            double totalEvaluated = 0.0;
+            float  cacheError = 0.0f;
+            printf("frame,evaluated_clusters,skipped_clusters,cached_us,full_us,max_error\n");
+            for (uint32_t frame = 0; frame < cameraPath.mNumKeys; frame++) {
+                const struct Tf32x3_s   frameEye = cameraPath.pKeys[frame].mEye;
+                struct SplatShEvalStats stats = {};
+                splatEvalShCached(threadSystem, &cache, SPLAT_SH_MAX_DEGREE, &streams, frameEye, maxAngle, colors, &stats);
+                const int64_t startUs = getUSec(false);
+                splatEvalShBatch(SPLAT_SH_MAX_DEGREE, streams.pPositions, streams.pShs, numSplats, frameEye, reference);
+                const int64_t fullUs = getUSec(false) - startUs;
+                const float   error = maxColorError(reference, colors, numSplats);
+                cacheError = fmaxf(cacheError, error);
+                printf("%u,%llu,%llu,%lld,%lld,%g\n", frame, (unsigned long long)stats.mNumEvaluated, (unsigned long long)stats.mNumSkipped,
+                       (long long)stats.mDurationUs, (long long)fullUs, error);
+                // the first frame fills the cache
+                if (frame > 0) {
+                    totalCachedUs += (double)stats.mDurationUs;
+                    totalFullUs += (double)fullUs;
+                    totalEvaluated += (double)stats.mNumEvaluated / (double)cache.mNumClusters;
+                }
+            }
+            const double numTimed = cameraPath.mNumKeys > 1 ? (double)(cameraPath.mNumKeys - 1) : 1.0;
+            printf("# summary: batch max error %g, cache %.1f degrees re-evaluates %.1f%% of clusters per frame, %.2f ms vs %.2f ms full "
+                   "(thread pool vs 1 thread), max error %g\n",
+                   worstError, angleDegrees, 100.0 * totalEvaluated / numTimed, totalCachedUs / numTimed / 1000.0,
+                   totalFullUs / numTimed / 1000.0, cacheError);
+            splatShCacheExit(&cache);
+            splatCameraPathFree(&cameraPath);
+            result = worstError < 1e-4f ? 0 : 1;
+        }
+        tf_free(reference);
+        tf_free(colors);
+        splatFreeStreams(&streams);
+    }
+
+    exitThreadSystem(threadSystem);
+    splatToolExit();
+    return result;
+}
@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) 2017-2024 The Forge Interactive Inc.
+ *
+ * This file is part of The-Forge
+ * (see https://github.com/ConfettiFX/The-Forge).
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+// Benchmark of the (tile, depth) radix sort against qsort.
+//
+//   splat_sort_bench [--count pairs] [--tiles count] [--iterations n]
+//
+// Keys are generated like the rasterizer bins them: a tile index in the
+// high word and the bits of a positive float depth in the low word.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Forge/TF_Log.h"
+#include "Forge/TF_FileSystem.h"
+#include "Forge/Core/TF_Time.h"
+#include "Forge/Mem/TF_Memory.h"
+#include "Common_3/Utilities/Threading/ThreadSystem.h"
+
+#include "Splat/SplatSort.h"
+
+struct Pair {
+    uint64_t mKey;
+    uint32_t mValue;
+};
+
+static int comparePairs(const void* lhs, const void* rhs) {
+    const struct Pair* a = (const struct Pair*)lhs;
+    const struct Pair* b = (const struct Pair*)rhs;
+    if (a->mKey != b->mKey)
+        return a->mKey < b->mKey ? -1 : 1;
+    return a->mValue < b->mValue ? -1 : (a->mValue > b->mValue ? 1 : 0);
+}
+
+static void generateKeys(uint64_t count, uint32_t numTiles, uint64_t* keys, uint32_t* values) {
+    uint32_t state = 1;
+    for (uint64_t i = 0; i < count; i++) {
+        state = state * 1664525u + 1013904223u;
+        const uint32_t tile = (state >> 8) % numTiles;
+        state = state * 1664525u + 1013904223u;
+        const float depth = 0.2f + 100.0f * (float)(state >> 8) / (float)(1u << 24);
+        uint32_t    depthBits;
+        memcpy(&depthBits, &depth, sizeof(depthBits));
+        keys[i] = ((uint64_t)tile << 32) | depthBits;
+        values[i] = (uint32_t)i;
+    }
+}
+
+static bool verify(const uint64_t* keys, const uint32_t* values, const struct Pair* reference, uint64_t count) {
+    for (uint64_t i = 0; i < count; i++) {
+        if (keys[i] != reference[i].mKey || values[i] != reference[i].mValue)
+            return false;
+    }
+    return true;
+}
+
+static double runRadix(ThreadSystem threadSystem, uint64_t count, uint32_t numTiles, uint32_t iterations, const struct Pair* reference,
+                       uint64_t* keys, uint32_t* values, struct SplatSortStats* outStats, bool* outValid) {
+    struct SplatSortScratch scratch;
+    splatSortScratchInit(&scratch);
+    int64_t bestUs = INT64_MAX;
+    *outValid = true;
+    uint32_t allocations = 0;
+    for (uint32_t i = 0; i <= iterations; i++) {
+        generateKeys(count, numTiles, keys, values);
+        splatRadixSort(threadSystem, &scratch, keys, values, count, outStats);
+        *outValid = *outValid && verify(keys, values, reference, count);
+        if (i == 0)
+            continue; // warm up grows the scratch
+        allocations += outStats->mNumAllocations;
+        bestUs = outStats->mDurationUs < bestUs ? outStats->mDurationUs : bestUs;
+    }
+    outStats->mNumAllocations = allocations;
+    splatSortScratchExit(&scratch);
+    return (double)count / (double)(bestUs > 0 ? bestUs : 1);
+}
+
+int main(int argc, char** argv) {
+    uint64_t count = 16 * 1024 * 1024;
+    uint32_t numTiles = 120 * 68; // 1920x1080 in 16x16 tiles
+    uint32_t iterations = 5;
+    for (int argIdx = 1; argIdx < argc; argIdx++) {
+        if (!strcmp(argv[argIdx], "--count") && argIdx + 1 < argc)
+            count = strtoull(argv[++argIdx], NULL, 10);
+        else if (!strcmp(argv[argIdx], "--tiles") && argIdx + 1 < argc)
+            numTiles = (uint32_t)strtoul(argv[++argIdx], NULL, 10);
+        else if (!strcmp(argv[argIdx], "--iterations") && argIdx + 1 < argc)
+            iterations = (uint32_t)atoi(argv[++argIdx]);
+        else {
+            printf("usage: %s [--count pairs] [--tiles count] [--iterations n]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (count == 0 || count > UINT32_MAX || numTiles == 0 || iterations == 0) {
+        printf("invalid pair count, tile count or iteration count\n");
+        return 1;
+    }
+
+    if (!initMemAlloc("SplatSortBench"))
+        return 1;
+    FileSystemInitDesc fsDesc = {};
+    fsDesc.pAppName = "SplatSortBench";
+    if (!initFileSystem(&fsDesc))
+        return 1;
+    initLog("SplatSortBench", eINFO);
+
+    ThreadSystem         threadSystem = NULL;
+    ThreadSystemInitDesc threadSystemDesc = {};
+    threadSystemDesc.mThreadCount = getNumCPUCores() > 1 ? getNumCPUCores() - 1 : 1;
+    initThreadSystem(&threadSystemDesc, &threadSystem);
+
+    uint64_t*    keys = (uint64_t*)tf_malloc(sizeof(uint64_t) * count);
+    uint32_t*    values = (uint32_t*)tf_malloc(sizeof(uint32_t) * count);
+    struct Pair* reference = (struct Pair*)tf_malloc(sizeof(struct Pair) * count);
+    generateKeys(count, numTiles, keys, values);
+    for (uint64_t i = 0; i < count; i++)
+        reference[i] = { keys[i], values[i] };
+    const int64_t qsortStartUs = getUSec(false);
+    qsort(reference, count, sizeof(struct Pair), comparePairs);
+    const int64_t qsortUs = getUSec(false) - qsortStartUs;
+
+    struct SplatSortStats serialStats = {};
+    struct SplatSortStats parallelStats = {};
+    bool                  serialValid = false;
+    bool                  parallelValid = false;
+    const double serialRate = runRadix(NULL, count, numTiles, iterations, reference, keys, values, &serialStats, &serialValid);
+    const double parallelRate = runRadix(threadSystem, count, numTiles, iterations, reference, keys, values, &parallelStats,
+                                         &parallelValid);
+
+    printf("pairs             %llu over %u tiles\n", (unsigned long long)count, numTiles);
+    printf("qsort             %.1f Mpairs/s\n", (double)count / (double)(qsortUs > 0 ? qsortUs : 1));
+    printf("radix 1 thread    %.1f Mpairs/s, %u passes%s\n", serialRate, serialStats.mNumPasses, serialValid ? "" : ", WRONG ORDER");
+    printf("radix %u blocks   %.1f Mpairs/s, %u passes%s\n", parallelStats.mNumBlocks, parallelRate, parallelStats.mNumPasses,
+           parallelValid ? "" : ", WRONG ORDER");
+    printf("allocations after warm up: %u\n", serialStats.mNumAllocations + parallelStats.mNumAllocations);
+
+    tf_free(keys);
+    tf_free(values);
+    tf_free(reference);
+    exitThreadSystem(threadSystem);
+    exitLog();
+    exitFileSystem();
+    exitMemAlloc();
+    return serialValid && parallelValid ? 0 : 1;
+}
@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2017-2024 The Forge Interactive Inc.
+ *
+ * This file is part of The-Forge
+ * (see https://github.com/ConfettiFX/The-Forge).
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "SplatToolCommon.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "Forge/TF_Log.h"
+#include "Forge/Mem/TF_Memory.h"
+
+#include "Splat/SplatMorton.h"
+#include "Splat/SplatPly.h"
+
+bool splatToolParseOption(const struct SplatToolOptions* options, int argc, char** argv, int* argIdx) {
+    const char* arg = argv[*argIdx];
+    if (options->pNumSplats && !strcmp(arg, "--count") && *argIdx + 1 < argc) {
+        *options->pNumSplats = strtoull(argv[++*argIdx], NULL, 10);
+        return true;
+    }
+    if (options->ppCameraPath && !strcmp(arg, "--path") && *argIdx + 1 < argc) {
+        *options->ppCameraPath = argv[++*argIdx];
+        return true;
+    }
+    if (options->pNumFrames && !strcmp(arg, "--frames") && *argIdx + 1 < argc) {
+        *options->pNumFrames = (uint32_t)atoi(argv[++*argIdx]);
+        return true;
+    }
+    if (options->pWidth && options->pHeight && !strcmp(arg, "--size") && *argIdx + 2 < argc) {
+        *options->pWidth = (uint32_t)atoi(argv[++*argIdx]);
+        *options->pHeight = (uint32_t)atoi(argv[++*argIdx]);
+        return true;
+    }
+    if (options->ppScenePath && arg[0] != '-' && !*options->ppScenePath) {
+        *options->ppScenePath = arg;
+        return true;
+    }
+    return false;
+}
+
+bool splatToolInit(const char* appName) {
+    if (!initMemAlloc(appName))
+        return false;
+    FileSystemInitDesc fsDesc = {};
+    fsDesc.pAppName = appName;
+    if (!initFileSystem(&fsDesc))
+        return false;
+    fsSetPathForResourceDir(pSystemFileIO, RM_CONTENT, RD_OTHER_FILES, "");
+    initLog(appName, eINFO);
+    return true;
+}
+
+void splatToolExit(void) {
+    exitLog();
+    exitFileSystem();
+    exitMemAlloc();
+}
+
+bool splatToolLoadScene(ThreadSystem threadSystem, const char* scenePath, float randomExtent, struct SplatStreams* outStreams,
+                        uint64_t* ioNumSplats) {
+    if (scenePath)
+        return splatPlyLoadFile(threadSystem, RD_OTHER_FILES, scenePath, outStreams, ioNumSplats);
+    splatGenerateRandomScene(*ioNumSplats, randomExtent, 1, outStreams);
+    return true;
+}
+
+bool splatToolLoadCameraPath(ThreadSystem threadSystem, const char* cameraPathFile, float fovY, const struct SplatStreams* streams,
+                             uint64_t numSplats, float orbitScale, uint32_t numFrames, struct SplatCameraPath* outPath) {
+    if (cameraPathFile)
+        return splatCameraPathLoad(RD_OTHER_FILES, cameraPathFile, fovY, outPath);
+    struct Tf32x3_s boundsMin, boundsMax;
+    splatComputeBounds(threadSystem, streams->pPositions, numSplats, &boundsMin, &boundsMax, NULL);
+    const struct Tf32x3_s center = { 0.5f * (boundsMin.x + boundsMax.x), 0.5f * (boundsMin.y + boundsMax.y),
+                                     0.5f * (boundsMin.z + boundsMax.z) };
+    splatCameraPathOrbit(center, orbitScale * (boundsMax.x - boundsMin.x), 0.0f, fovY, numFrames, outPath);
+    return true;
+}
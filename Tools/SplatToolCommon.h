@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2017-2024 The Forge Interactive Inc.
+ *
+ * This file is part of The-Forge
+ * (see https://github.com/ConfettiFX/The-Forge).
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#pragma once
+
+// Setup shared by the splat benchmarks: the command line options they have in
+// common, the memory, file system and log init, and the scene and camera path
+// fixtures.
+
+#include "Forge/TF_FileSystem.h"
+#include "Common_3/Utilities/Threading/ThreadSystem.h"
+
+#include "Splat/Splat.h"
+#include "Splat/SplatCameraPath.h"
+
+// Where the shared options are parsed to, NULL for an option the tool does not take.
+struct SplatToolOptions {
+    const char** ppScenePath; // first argument not starting with '-'
+    const char** ppCameraPath; // --path camera_path.txt
+    uint64_t*    pNumSplats; // --count splats
+    uint32_t*    pNumFrames; // --frames n
+    uint32_t*    pWidth; // --size width height, with pHeight
+    uint32_t*    pHeight;
+};
+
+// Parses argv[*argIdx] and its values when it is one of the shared options,
+// leaving *argIdx on the last argument consumed. Returns false, without
+// consuming anything, for an argument the tool has to handle itself.
+bool splatToolParseOption(const struct SplatToolOptions* options, int argc, char** argv, int* argIdx);
+
+// Memory, file system and log for appName, with RD_OTHER_FILES at the working directory.
+bool splatToolInit(const char* appName);
+void splatToolExit(void);
+
+// The streams of the PLY at scenePath, or without one a random cloud of
+// *ioNumSplats splats randomExtent across. *ioNumSplats is the splat count on return.
+bool splatToolLoadScene(ThreadSystem threadSystem, const char* scenePath, float randomExtent, struct SplatStreams* outStreams,
+                        uint64_t* ioNumSplats);
+
+// The path in cameraPathFile, or without one numFrames keys on an orbit around
+// the center of the scene bounds, orbitScale times the bounds width across.
+bool splatToolLoadCameraPath(ThreadSystem threadSystem, const char* cameraPathFile, float fovY, const struct SplatStreams* streams,
+                             uint64_t numSplats, float orbitScale, uint32_t numFrames, struct SplatCameraPath* outPath);